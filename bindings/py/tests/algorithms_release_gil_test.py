@@ -0,0 +1,182 @@
+#!/usr/bin/env python
+# ----------------------------------------------------------------------
+# Numenta Platform for Intelligent Computing (NuPIC)
+# Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+# with Numenta, Inc., for a separate license for this software code, the
+# following terms and conditions apply:
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero Public License version 3 as
+# published by the Free Software Foundation.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU Affero Public License for more details.
+#
+# You should have received a copy of the GNU Affero Public License
+# along with this program.  If not, see http://www.gnu.org/licenses.
+#
+# http://numenta.org/licenses/
+# ----------------------------------------------------------------------
+
+"""Unit tests for the GIL-releasing numpy entry points of the algorithms."""
+
+import threading
+import unittest
+
+import numpy
+
+from nupic.bindings.algorithms import (Connections, SDRClassifier,
+                                       SpatialPooler, TemporalMemory)
+
+uintType = numpy.uint32
+
+
+
+class ReleaseGILTest(unittest.TestCase):
+
+
+  def testSpatialPoolerMatchesCompute(self):
+    sp1 = SpatialPooler([64], [128], seed=42)
+    sp2 = SpatialPooler([64], [128], seed=42)
+    rng = numpy.random.RandomState(42)
+
+    for _ in xrange(10):
+      indices = numpy.sort(rng.choice(64, 10, replace=False)).astype(uintType)
+      dense = numpy.zeros(64, dtype=uintType)
+      dense[indices] = 1
+
+      expected = numpy.zeros(128, dtype=uintType)
+      sp1.compute(dense, True, expected)
+      activeColumns = sp2.computeSparseReleaseGIL(indices, True)
+
+      self.assertEqual(uintType, activeColumns.dtype)
+      self.assertEqual(list(expected.nonzero()[0]), list(activeColumns))
+
+
+  def testSpatialPoolerSparseChecksIndicesFirst(self):
+    sp = SpatialPooler([64], [128], seed=42)
+    with self.assertRaises(Exception):
+      sp.computeSparseReleaseGIL(numpy.array([3, 64], dtype=uintType), True)
+
+    # The failed call didn't learn
+    self.assertEqual(0, sp.getIterationNum())
+    dutyCycles = numpy.zeros(128, dtype=numpy.float32)
+    sp.getActiveDutyCycles(dutyCycles)
+    self.assertEqual(0, numpy.count_nonzero(dutyCycles))
+
+    # and left no input bit behind
+    fresh = SpatialPooler([64], [128], seed=42)
+    expected = numpy.zeros(128, dtype=uintType)
+    fresh.compute(numpy.zeros(64, dtype=uintType), False, expected)
+    activeColumns = sp.computeSparseReleaseGIL(
+      numpy.array([], dtype=uintType), False)
+    self.assertEqual(list(expected.nonzero()[0]), list(activeColumns))
+
+
+  def testSpatialPoolerChecksArrays(self):
+    sp = SpatialPooler([64], [128])
+    output = numpy.zeros(128, dtype=uintType)
+    with self.assertRaises(Exception):
+      sp.computeReleaseGIL(numpy.zeros(64, dtype=numpy.float32), True, output)
+    with self.assertRaises(Exception):
+      sp.computeReleaseGIL(numpy.zeros(63, dtype=uintType), True, output)
+    with self.assertRaises(Exception):
+      sp.computeReleaseGIL(numpy.zeros(128, dtype=uintType)[::2], True,
+                           output)
+
+
+  def testTemporalMemoryMatchesCompute(self):
+    tm1 = TemporalMemory(columnDimensions=(64,), cellsPerColumn=4,
+                         minThreshold=1, activationThreshold=1)
+    tm2 = TemporalMemory(columnDimensions=(64,), cellsPerColumn=4,
+                         minThreshold=1, activationThreshold=1)
+    sequence = [numpy.arange(i, 64, 8, dtype=uintType) for i in xrange(8)]
+    out = numpy.zeros(256, dtype=uintType)
+
+    for _ in xrange(3):
+      for columns in sequence:
+        tm1.compute(columns, True)
+        tm2.computeReleaseGIL(columns, True)
+
+        n = tm2.getActiveCellsInto(out)
+        self.assertEqual(sorted(tm1.getActiveCells()), list(out[:n]))
+        n = tm2.getPredictiveCellsInto(out)
+        self.assertEqual(sorted(tm1.getPredictiveCells()), list(out[:n]))
+        n = tm2.getWinnerCellsInto(out)
+        self.assertEqual(sorted(tm1.getWinnerCells()), list(out[:n]))
+
+
+  def testConnectionsComputeActivity(self):
+    connections = Connections(1024)
+    segment = connections.createSegment(10)
+    connections.createSynapse(segment, 150, 0.85)
+    connections.createSynapse(segment, 151, 0.15)
+
+    n = connections.segmentFlatListLength()
+    numActiveConnected = numpy.zeros(n, dtype=uintType)
+    numActivePotential = numpy.zeros(n, dtype=uintType)
+    activeCells = numpy.array([50, 150, 151], dtype=uintType)
+    connections.computeActivityReleaseGIL(numActiveConnected,
+                                          numActivePotential,
+                                          activeCells, 0.5)
+
+    self.assertEqual(1, numActiveConnected[segment.flatIdx])
+    self.assertEqual(2, numActivePotential[segment.flatIdx])
+
+
+  def testSDRClassifierMatchesCompute(self):
+    c1 = SDRClassifier(steps=[1], alpha=0.1)
+    c2 = SDRClassifier(steps=[1], alpha=0.1)
+    out = numpy.zeros((2, 16), dtype=numpy.float64)
+
+    for recordNum in xrange(10):
+      pattern = numpy.array([1, 5, 9 + recordNum % 3], dtype=uintType)
+      bucket = recordNum % 3
+      expected = c1.convertedCompute(recordNum, [int(i) for i in pattern],
+                                     bucket,
+                                     float(bucket), True, True, True)
+      nBuckets = c2.computeReleaseGIL(recordNum, pattern, bucket,
+                                      float(bucket), True, True, True, out)
+
+      self.assertEqual(len(expected[1]), nBuckets)
+      numpy.testing.assert_allclose(expected["actualValues"],
+                                    out[0, :nBuckets])
+      numpy.testing.assert_allclose(expected[1], out[1, :nBuckets])
+
+
+  def testParallelSpatialPoolers(self):
+    # One model per thread, driven concurrently: the results must be those
+    # of running the models one after the other.
+    numModels = 4
+    rng = numpy.random.RandomState(42)
+    inputs = [(rng.rand(32, 256) > 0.9).astype(uintType)
+              for _ in xrange(numModels)]
+
+    def run(sp, modelInputs, outputs):
+      for i, x in enumerate(modelInputs):
+        sp.computeReleaseGIL(x, True, outputs[i])
+
+    serial = [numpy.zeros((32, 512), dtype=uintType) for _ in xrange(numModels)]
+    for m in xrange(numModels):
+      run(SpatialPooler([256], [512], seed=m + 1), inputs[m], serial[m])
+
+    parallel = [numpy.zeros((32, 512), dtype=uintType)
+                for _ in xrange(numModels)]
+    threads = [threading.Thread(target=run,
+                                args=(SpatialPooler([256], [512], seed=m + 1),
+                                      inputs[m], parallel[m]))
+               for m in xrange(numModels)]
+    for t in threads:
+      t.start()
+    for t in threads:
+      t.join()
+
+    for m in xrange(numModels):
+      numpy.testing.assert_array_equal(serial[m], parallel[m])
+
+
+
+if __name__ == '__main__':
+  unittest.main()
@@ -23,6 +23,7 @@
 #include <vector>
 #include <numeric>
 #include <algorithm>
+#include <functional>
 #include <iterator>
 #include <set>
 
@@ -42,6 +43,38 @@ namespace anomaly
 {
 
 
+static bool isStrictlyIncreasing(const vector<UInt>& v)
+{
+  return adjacent_find(v.begin(), v.end(), greater_equal<UInt>()) == v.end();
+}
+
+
+Real32 computeRawAnomalyScore(const UInt active[], size_t activeSize,
+                              const UInt predicted[], size_t predictedSize)
+{
+  // Return 0 if no active columns are present
+  if (activeSize == 0)
+  {
+    return 0.0f;
+  }
+
+  // Count the predicted active columns by merging the sorted lists. The
+  // merge is branch-free since the comparisons are unpredictable.
+  size_t nPredictedActive = 0;
+  size_t i = 0, j = 0;
+  while (i < activeSize && j < predictedSize)
+  {
+    const UInt a = active[i];
+    const UInt p = predicted[j];
+    nPredictedActive += (a == p);
+    i += (a <= p);
+    j += (p <= a);
+  }
+
+  return (activeSize - nPredictedActive) / Real32(activeSize);
+}
+
+
 Real32 computeRawAnomalyScore(const vector<UInt>& active,
                               const vector<UInt>& predicted)
 {
@@ -51,6 +84,14 @@ Real32 computeRawAnomalyScore(const vector<UInt>& active,
     return 0.0f;
   }
 
+  // Sorted inputs, e.g. from the SpatialPooler or TemporalMemory, don't need
+  // to be copied into sets
+  if (isStrictlyIncreasing(active) && isStrictlyIncreasing(predicted))
+  {
+    return computeRawAnomalyScore(active.data(), active.size(),
+                                  predicted.data(), predicted.size());
+  }
+
   set<UInt> active_{active.begin(), active.end()};
   set<UInt> predicted_{predicted.begin(), predicted.end()};
   vector<UInt> predictedActiveCols;
@@ -114,6 +155,94 @@ Real32 Anomaly::compute(
   return score;
 }
 
+MultiStreamAnomaly::MultiStreamAnomaly(UInt numStreams,
+                                       UInt slidingWindowSize,
+                                       AnomalyMode mode,
+                                       Real32 binaryAnomalyThreshold)
+    : numStreams_(numStreams),
+      windowSize_(slidingWindowSize),
+      mode_(mode),
+      binaryThreshold_(binaryAnomalyThreshold)
+{
+  NTA_CHECK(binaryAnomalyThreshold >= 0 && binaryAnomalyThreshold <= 1)
+      << "binaryAnomalyThreshold must be within [0.0,1.0]";
+  NTA_CHECK(mode_ == AnomalyMode::PURE || mode_ == AnomalyMode::WEIGHTED)
+      << "MultiStreamAnomaly implemented only for PURE and WEIGHTED modes!";
+
+  window_.resize((size_t) numStreams_ * windowSize_);
+  windowCount_.resize(numStreams_);
+  windowFirst_.resize(numStreams_);
+  windowTotal_.resize(numStreams_);
+  reset();
+}
+
+
+void MultiStreamAnomaly::reset()
+{
+  fill(windowCount_.begin(), windowCount_.end(), 0);
+  fill(windowFirst_.begin(), windowFirst_.end(), 0);
+  fill(windowTotal_.begin(), windowTotal_.end(), 0.0f);
+}
+
+
+UInt MultiStreamAnomaly::getNumStreams() const
+{
+  return numStreams_;
+}
+
+
+void MultiStreamAnomaly::compute(
+    const UInt active[], const UInt activeOffsets[],
+    const UInt predicted[], const UInt predictedOffsets[],
+    const Real32 likelihoods[], Real32 scores[])
+{
+  NTA_CHECK(mode_ != AnomalyMode::WEIGHTED || likelihoods != nullptr)
+      << "WEIGHTED mode needs a likelihood for each stream";
+
+  for (UInt stream = 0; stream < numStreams_; stream++)
+  {
+    const UInt activeBegin = activeOffsets[stream];
+    const UInt predictedBegin = predictedOffsets[stream];
+    Real32 score = computeRawAnomalyScore(
+      active + activeBegin, activeOffsets[stream + 1] - activeBegin,
+      predicted + predictedBegin,
+      predictedOffsets[stream + 1] - predictedBegin);
+
+    if (mode_ == AnomalyMode::WEIGHTED)
+    {
+      score *= likelihoods[stream];
+    }
+
+    // Same arithmetic as MovingAverage::compute, so results match Anomaly
+    if (windowSize_ > 0)
+    {
+      Real32* window = &window_[(size_t) stream * windowSize_];
+      UInt& count = windowCount_[stream];
+      Real32& total = windowTotal_[stream];
+      if (count == windowSize_)
+      {
+        UInt& first = windowFirst_[stream];
+        total -= window[first];
+        window[first] = score;
+        first = (first + 1) % windowSize_;
+      }
+      else
+      {
+        window[count++] = score;
+      }
+      total += score;
+      score = Real32(total) / Real32(count);
+    }
+
+    if (binaryThreshold_)
+    {
+      score = (score >= binaryThreshold_) ? 1.0 : 0.0;
+    }
+
+    scores[stream] = score;
+  }
+}
+
 } // namespace anomaly
 
 } // namespace algorithms
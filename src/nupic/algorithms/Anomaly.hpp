@@ -56,6 +56,21 @@ namespace nupic
       Real32 computeRawAnomalyScore(const std::vector<UInt>& active,
                                     const std::vector<UInt>& predicted);
 
+      /**
+       * Computes the raw anomaly score of sorted index lists, without
+       * allocating.
+       *
+       * @param active: active column indices, strictly increasing
+       * @param activeSize: number of active columns
+       * @param predicted: columns indices predicted in prev step, strictly
+       *     increasing
+       * @param predictedSize: number of predicted columns
+       * @return anomaly score 0..1 (Real32)
+       */
+      Real32 computeRawAnomalyScore(const UInt active[], size_t activeSize,
+                                    const UInt predicted[],
+                                    size_t predictedSize);
+
 
       enum class AnomalyMode { PURE, LIKELIHOOD, WEIGHTED };
 
@@ -118,6 +133,74 @@ namespace nupic
         std::unique_ptr<nupic::util::MovingAverage> movingAverage_;
 
       };
+
+
+      /**
+       * Scores many independent streams at once.
+       *
+       * Equivalent to one Anomaly per stream, but the inputs of all streams
+       * are passed as flat arrays, the index lists are intersected without
+       * allocating, and the moving averages are kept in one flat ring
+       * buffer.
+       *
+       * Supported modes:
+       *    PURE - the raw anomaly score
+       *    WEIGHTED - the raw anomaly score multiplied by a likelihood that
+       *        the caller computes for each stream
+       */
+      class MultiStreamAnomaly
+      {
+      public:
+        /**
+         * @param numStreams - number of streams scored by each compute
+         * @param slidingWindowSize (optional) - see Anomaly
+         * @param mode (optional) - PURE or WEIGHTED
+         * @param binaryAnomalyThreshold (optional) - see Anomaly
+         */
+        MultiStreamAnomaly(UInt numStreams, UInt slidingWindowSize=0,
+                           AnomalyMode mode=AnomalyMode::PURE,
+                           Real32 binaryAnomalyThreshold=0);
+
+        /**
+         * Compute the anomaly score of every stream.
+         *
+         * The index lists of all streams are concatenated; stream i uses
+         * active[activeOffsets[i]] through active[activeOffsets[i+1] - 1],
+         * and likewise for predicted. Each list must be strictly
+         * increasing.
+         *
+         * @param active: concatenated active column indices
+         * @param activeOffsets: numStreams + 1 offsets into active
+         * @param predicted: concatenated column indices predicted in the
+         *        previous step
+         * @param predictedOffsets: numStreams + 1 offsets into predicted
+         * @param likelihoods: one likelihood per stream for WEIGHTED mode;
+         *        ignored, and may be null, in PURE mode
+         * @param scores: receives one anomaly score per stream
+         */
+        void compute(const UInt active[], const UInt activeOffsets[],
+                     const UInt predicted[], const UInt predictedOffsets[],
+                     const Real32 likelihoods[], Real32 scores[]);
+
+        /**
+         * Clear the moving averages of all streams.
+         */
+        void reset();
+
+        UInt getNumStreams() const;
+
+      private:
+        UInt numStreams_;
+        UInt windowSize_;
+        AnomalyMode mode_;
+        Real32 binaryThreshold_;
+
+        // Moving averages: one ring buffer of windowSize_ values per stream
+        std::vector<Real32> window_;
+        std::vector<UInt> windowCount_;
+        std::vector<UInt> windowFirst_;
+        std::vector<Real32> windowTotal_;
+      };
     } // namespace anomaly
   } // namespace algorithms
 } // namespace nupic
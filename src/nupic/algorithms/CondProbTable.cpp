@@ -24,12 +24,22 @@
  * 
  */ 
 
+#include <algorithm>
+#include <limits>
+
 #include "nupic/utils/Log.hpp"
 #include "nupic/algorithms/CondProbTable.hpp"
+#include "nupic/utils/ParallelFor.hpp"
 
 using namespace std;
 
 namespace nupic {
+
+  // Number of distributions inferred together by inferRows()
+  static const UInt kTile = 16;
+
+  // cleanMax_ of a column without non-zeros
+  static const Real kNoMax = -numeric_limits<Real>::max();
  
   ////////////////////////////////////////////////////////////////////////////
   // Constructor
@@ -38,8 +48,8 @@ namespace nupic {
     :  hintNumCols_(hintNumCols),
        hintNumRows_(hintNumRows),
        tableP_(nullptr),
-       cleanTableP_(nullptr),
-       cleanTableValid_(false),
+       cleanRows_(),
+       cleanMax_(),
        rowSums_(), 
        colSums_()
   {
@@ -51,7 +61,6 @@ namespace nupic {
   CondProbTable::~CondProbTable() 
   {
     delete tableP_;
-    delete cleanTableP_;
   }  
 
   ////////////////////////////////////////////////////////////////////////////
@@ -80,8 +89,10 @@ namespace nupic {
       else
         tableP_ = new SparseMatrix<UInt, Real>(0,0);
       
-      // Setup our column sums
+      // Setup our column sums and the clean CPT
       colSums_.resize(cols, (Real)0);
+      cleanRows_.resize(cols, 0);
+      cleanMax_.resize(cols, kNoMax);
     }
 
     UInt curRows = tableP_->nRows();
@@ -91,11 +102,13 @@ namespace nupic {
 
     if ((curRows < nextRows) || (curCols < nextCols)) 
       {
-        cleanTableValid_ = false;
         tableP_->resize(nextRows, nextCols);
 
+        // New rows and columns are empty, which leaves the clean CPT as is
         rowSums_.resize(nextRows);
         colSums_.resize(nextCols);
+        cleanRows_.resize(nextCols, 0);
+        cleanMax_.resize(nextCols, kNoMax);
       }
   }  
 
@@ -113,8 +126,32 @@ namespace nupic {
     grow(row+1, cols);
   
     // Update the row
-    cleanTableValid_ = false;
     tableP_->elementRowApply(row, std::plus<Real>(), distribution.begin());
+
+    // Update the clean CPT: only the columns of this row that changed can
+    // have a new max
+    rowBuffer_.resize(tableP_->nCols());
+    tableP_->getRowToDense(row, rowBuffer_.begin());
+    UInt changedCols = min(UInt(distribution.size()), UInt(rowBuffer_.size()));
+    for (UInt col = 0; col < changedCols; ++col) {
+      if (distribution[col] == 0)
+        continue;
+
+      Real val = rowBuffer_[col];
+      if (cleanMax_[col] != kNoMax && cleanRows_[col] == row) {
+        // This row holds the max: it stays there unless it decreased
+        if (val != 0 && val >= cleanMax_[col])
+          cleanMax_[col] = val;
+        else
+          rescanCleanColumn(col);
+      }
+      else if (val != 0 &&
+               (val > cleanMax_[col] ||
+                (val == cleanMax_[col] && row < cleanRows_[col]))) {
+        cleanRows_[col] = row;
+        cleanMax_[col] = val;
+      }
+    }
   
     // Update the row sums and column sums
     Real rowSum = 0;
@@ -205,11 +242,14 @@ namespace nupic {
     // ----------------------------------------------------------------
     else if (infer == inferViterbi) {
   
-      if (!cleanTableValid_)
-        makeCleanCPT();
-    
-      // Do max product per row with clean CPD
-      cleanTableP_->vecMaxProd(distIter, outIter);
+      // Do max product per row with clean CPD: the max of the distribution
+      // over the columns whose max is in that row, or 0
+      std::fill(outIter, outIter + tableP_->nRows(), (Real)0);
+      for (UInt col = 0; col < UInt(cleanRows_.size()); ++col, ++distIter) {
+        Real& score = outIter[cleanRows_[col]];
+        if (*distIter > score)
+          score = *distIter;
+      }
     } 
   
     // ----------------------------------------------------------------
@@ -219,29 +259,173 @@ namespace nupic {
       NTA_THROW << errPrefix << "Unknown inference type " << infer;
   }
 
+  ////////////////////////////////////////////////////////////////////////////
+  // Infer a block of distributions
+  //////////////////////////////////////////////////////////////////////////////
+  void CondProbTable::inferRows(const Real* distributions, UInt nDistributions,
+                                Real* outScores, inferType infer, UInt nThreads)
+  {
+    const char* errPrefix = "CondProbTable::inferRows() - ";
+  
+    // Make sure we have a table
+    NTA_CHECK(tableP_ != nullptr) 
+      << errPrefix
+      << "Must call updateRow at least once before doing inference";
+
+    if (infer != inferMarginal && infer != inferRowEvidence &&
+        infer != inferMaxProd && infer != inferViterbi)
+      NTA_THROW << errPrefix << "Unknown inference type " << infer;
+
+    const UInt nrows = tableP_->nRows(), ncols = tableP_->nCols();
+    const size_t nTiles = (nDistributions + kTile - 1) / kTile;
+
+    parallelForShards(nTiles, parallelThreads(nTiles, nThreads),
+                  [&](size_t begin, size_t end) {
+      vector<Real> buffer(kTile * ncols);
+      for (size_t tile = begin; tile < end; ++tile) {
+        const UInt first = UInt(tile * kTile);
+        inferTile(distributions + size_t(first) * ncols,
+                  min(kTile, nDistributions - first),
+                  outScores + size_t(first) * nrows, infer, &buffer[0]);
+      }
+    });
+  }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Infer one tile of distributions
+  //
+  // The distributions are transposed into buffer, column by column, so
+  // that the products of each non-zero with the kTile distributions are
+  // contiguous and vectorize. Each score is computed with the operations
+  // of inferRow, in the same order, so the results are the same.
+  //////////////////////////////////////////////////////////////////////////////
+  void CondProbTable::inferTile(const Real* distributions, UInt n,
+                                Real* outScores, inferType infer,
+                                Real* buffer) const
+  {
+    const UInt nrows = tableP_->nRows(), ncols = tableP_->nCols();
+
+    if (infer == inferViterbi) {
+      for (UInt k = 0; k < n; ++k) {
+        const Real* dist = distributions + size_t(k) * ncols;
+        Real* out = outScores + size_t(k) * nrows;
+        std::fill(out, out + nrows, (Real)0);
+        for (UInt col = 0; col < ncols; ++col) {
+          Real& score = out[cleanRows_[col]];
+          if (dist[col] > score)
+            score = dist[col];
+        }
+      }
+      return;
+    }
+
+    for (UInt col = 0; col < ncols; ++col) {
+      Real* x = buffer + size_t(col) * kTile;
+      for (UInt k = 0; k < n; ++k) {
+        x[k] = distributions[size_t(k) * ncols + col];
+        if (infer == inferMarginal)
+          x[k] = x[k] / colSums_[col];
+      }
+      for (UInt k = n; k < kTile; ++k)
+        x[k] = 0;
+    }
+
+    Real acc[kTile];
+    for (UInt row = 0; row < nrows; ++row) {
+      const UInt nnzr = tableP_->nNonZerosOnRow(row);
+      const UInt* ind = &*tableP_->row_nz_index_begin(row);
+      const Real* nz = &*tableP_->row_nz_value_begin(row);
+
+      if (nnzr == 0) {
+        for (UInt k = 0; k < kTile; ++k)
+          acc[k] = 0;
+      }
+      else if (infer == inferMaxProd) {
+        // As SparseMatrix::vecMaxProd
+        const Real* x0 = buffer + size_t(ind[0]) * kTile;
+        for (UInt k = 0; k < kTile; ++k)
+          acc[k] = nz[0] * x0[k];
+        for (UInt i = 0; i < nnzr; ++i) {
+          const Real v = nz[i];
+          const Real* x = buffer + size_t(ind[i]) * kTile;
+          for (UInt k = 0; k < kTile; ++k) {
+            const Real p = v * x[k];
+            acc[k] = p > acc[k] ? p : acc[k];
+          }
+        }
+      }
+      else {
+        // As SparseMatrix::rightVecProd, which adds the products in pairs
+        for (UInt k = 0; k < kTile; ++k)
+          acc[k] = 0;
+        UInt i = 0;
+        for (; i + 4 <= nnzr; i += 4) {
+          for (UInt pair = i; pair < i + 4; pair += 2) {
+            const Real va = nz[pair], vb = nz[pair + 1];
+            const Real* xa = buffer + size_t(ind[pair]) * kTile;
+            const Real* xb = buffer + size_t(ind[pair + 1]) * kTile;
+            for (UInt k = 0; k < kTile; ++k) {
+              const Real a = va * xa[k], b = vb * xb[k];
+              acc[k] += a + b;
+            }
+          }
+        }
+        for (; i < nnzr; ++i) {
+          const Real v = nz[i];
+          const Real* x = buffer + size_t(ind[i]) * kTile;
+          for (UInt k = 0; k < kTile; ++k)
+            acc[k] += v * x[k];
+        }
+        if (infer == inferRowEvidence) {
+          for (UInt k = 0; k < kTile; ++k)
+            acc[k] = acc[k] / rowSums_[row];
+        }
+      }
+
+      for (UInt k = 0; k < n; ++k)
+        outScores[size_t(k) * nrows + row] = acc[k];
+    }
+  }
+
   ////////////////////////////////////////////////////////////////////////////
   // make clean CPT
   //////////////////////////////////////////////////////////////////////////////
   void CondProbTable::makeCleanCPT()
   {
-    delete cleanTableP_;
-  
     UInt nrows = tableP_->nRows(), ncols = tableP_->nCols();
-    vector<pair<UInt, Real> > col_max(ncols, make_pair(0, Real(0)));
-  
-    tableP_->colMax(col_max.begin());
-  
-    cleanTableP_ = new SparseMatrix01<UInt, Real>(ncols, 1);
-  
+
+    // As SparseMatrix::colMax: the first row with the max non-zero
+    cleanRows_.assign(ncols, 0);
+    cleanMax_.assign(ncols, kNoMax);
     for (UInt row = 0; row < nrows; ++row) {
-      vector<UInt> nz;
-      for (UInt col = 0; col < ncols; ++col) 
-        if (col_max[col].first == row)
-          nz.push_back(col);
-      cleanTableP_->addRow(UInt(nz.size()), nz.begin());
+      const UInt nnzr = tableP_->nNonZerosOnRow(row);
+      const UInt* ind = &*tableP_->row_nz_index_begin(row);
+      const Real* nz = &*tableP_->row_nz_value_begin(row);
+      for (UInt i = 0; i < nnzr; ++i) {
+        if (nz[i] > cleanMax_[ind[i]]) {
+          cleanRows_[ind[i]] = row;
+          cleanMax_[ind[i]] = nz[i];
+        }
+      }
     }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // rescan one column of the clean CPT
+  //////////////////////////////////////////////////////////////////////////////
+  void CondProbTable::rescanCleanColumn(const UInt& col)
+  {
+    UInt nrows = tableP_->nRows();
 
-    cleanTableValid_ = true;
+    cleanRows_[col] = 0;
+    cleanMax_[col] = kNoMax;
+    for (UInt row = 0; row < nrows; ++row) {
+      Real val = tableP_->get(row, col);
+      if (val != 0 && val > cleanMax_[col]) {
+        cleanRows_[col] = row;
+        cleanMax_[col] = val;
+      }
+    }
   }
 
   ////////////////////////////////////////////////////////////////////////////
@@ -297,8 +481,8 @@ namespace nupic {
       delete tableP_;
       tableP_ = nullptr;
     }
-
-    cleanTableValid_ = false;
+    cleanRows_.clear();
+    cleanMax_.clear();
 
     // -----------------------------------------------------------------
     // Get # of columns then read in the old matrix
@@ -346,6 +530,8 @@ namespace nupic {
           ++srcIter;
         }
       }
+
+      makeCleanCPT();
     }
  
     // Restore exceptions mask
@@ -26,7 +26,6 @@
 #define NTA_COND_PROB_TABLE_HPP
 
 #include <nupic/math/SparseMatrix.hpp>
-#include <nupic/math/SparseMatrix01.hpp>
 
 namespace nupic {
   
@@ -155,6 +154,25 @@ namespace nupic {
     void inferRow (std::vector<Real>::const_iterator distribution, 
                    std::vector<Real>::iterator outScores, inferType infer=inferMarginal);
   
+    /////////////////////////////////////////////////////////////////////////////////////
+    /// Batched form of inferRow: infers a block of distributions at once.
+    ///
+    /// The scores are exactly those inferRow returns for each distribution. The
+    /// distributions are processed in tiles of 16, so each non-zero of the table is
+    /// read once per tile rather than once per distribution, and the tiles are
+    /// split across threads.
+    ///
+    /// @param distributions  nDistributions distributions, row-major - numColumns()
+    ///                         elements each
+    /// @param nDistributions the number of distributions
+    /// @param outScores      the return probabilities, row-major - numRows() elements
+    ///                         per distribution
+    /// @param infer          the method to use, as for inferRow
+    /// @param nThreads       the number of threads, 0 for the hardware concurrency
+    ///////////////////////////////////////////////////////////////////////////////////
+    void inferRows (const Real* distributions, UInt nDistributions, Real* outScores,
+                    inferType infer=inferMarginal, UInt nThreads=1);
+
     /////////////////////////////////////////////////////////////////////////////////////
     /// Get a row of the table out. 
     ///
@@ -195,18 +213,42 @@ namespace nupic {
   
     /////////////////////////////////////////////////////////////////////////////////////
     /// Make a "clean CPT". This is a copy of the CPT table with only the max element 
-    /// in each column kept and all others set to 0. 
+    /// in each column kept, set to 1, and all others set to 0. It is stored as the
+    /// row of the max element of each column (the first one on ties, row 0 for
+    /// columns without non-zeros). updateRow() keeps it up to date, so this is
+    /// only needed when the whole table changes.
     ///
     ///////////////////////////////////////////////////////////////////////////////////
     void makeCleanCPT (void);
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    /// Find the max element of one column of the clean CPT again, after it
+    /// decreased. 
+    ///
+    /// @param col          which column to scan
+    ///////////////////////////////////////////////////////////////////////////////////
+    void rescanCleanColumn (const UInt& col);
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    /// Infer a tile of at most 16 distributions (see inferRows). 
+    ///
+    /// @param distributions  the first distribution of the tile
+    /// @param n              the number of distributions in the tile
+    /// @param outScores      the scores of the first distribution of the tile
+    /// @param infer          the method to use
+    /// @param buffer         scratch space, 16 * numColumns() elements
+    ///////////////////////////////////////////////////////////////////////////////////
+    void inferTile (const Real* distributions, UInt n, Real* outScores,
+                    inferType infer, Real* buffer) const;
   
     UInt hintNumCols_;
     UInt hintNumRows_;
     SparseMatrix<UInt, Real>* tableP_; 
-    SparseMatrix01<UInt, Real>* cleanTableP_;  // for inferViterbi
-    bool cleanTableValid_;
+    std::vector<UInt>   cleanRows_;  // for inferViterbi: the clean CPT
+    std::vector<Real>   cleanMax_;   // max element of each column of the CPT
     std::vector<Real>   rowSums_;
     std::vector<Real>   colSums_;
+    std::vector<Real>   rowBuffer_;
   };
 
 } // namespace nupic
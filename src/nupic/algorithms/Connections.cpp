@@ -66,6 +66,11 @@ void Connections::initialize(CellIdx numCells,
 
   iteration_ = 0;
   nextEventToken_ = 0;
+
+  batch_ = false;
+  batchAdds_.clear();
+  batchRemoves_.clear();
+  batchEvents_.clear();
 }
 
 UInt32 Connections::subscribe(ConnectionsEventHandler* handler)
@@ -110,10 +115,7 @@ Segment Connections::createSegment(CellIdx cell)
   segmentOrdinals_[segment] = nextSegmentOrdinal_++;
   cellData.segments.push_back(segment);
 
-  for (auto h : eventHandlers_)
-  {
-    h.second->onCreateSegment(segment);
-  }
+  notify_(CREATE_SEGMENT, segment.flatIdx);
 
   return segment;
 }
@@ -124,6 +126,7 @@ Synapse Connections::createSynapse(Segment segment,
 {
   NTA_CHECK(maxSynapsesPerSegment_ > 0);
   NTA_CHECK(permanence > 0);
+  permanence = roundPermanence(permanence);
   while (numSynapses(segment) >= maxSynapsesPerSegment_)
   {
     destroySynapse(minPermanenceSynapse_(segment));
@@ -151,13 +154,17 @@ Synapse Connections::createSynapse(Segment segment,
   synapseOrdinals_[synapse] = nextSynapseOrdinal_++;
   segmentData.synapses.push_back(synapse);
 
-  synapsesForPresynapticCell_[presynapticCell].push_back(synapse);
-
-  for (auto h : eventHandlers_)
+  if (batch_)
+  {
+    batchAdds_.emplace_back(presynapticCell, synapse.flatIdx);
+  }
+  else
   {
-    h.second->onCreateSynapse(synapse);
+    synapsesForPresynapticCell_[presynapticCell].push_back(synapse);
   }
 
+  notify_(CREATE_SYNAPSE, synapse.flatIdx);
+
   return synapse;
 }
 
@@ -180,6 +187,12 @@ bool Connections::synapseExists_(Synapse synapse) const
 void Connections::removeSynapseFromPresynapticMap_(Synapse synapse)
 {
   const SynapseData& synapseData = synapses_[synapse];
+  if (batch_)
+  {
+    batchRemoves_.emplace_back(synapseData.presynapticCell, synapse.flatIdx);
+    return;
+  }
+
   vector<Synapse>& presynapticSynapses =
     synapsesForPresynapticCell_.at(synapseData.presynapticCell);
 
@@ -197,10 +210,7 @@ void Connections::removeSynapseFromPresynapticMap_(Synapse synapse)
 void Connections::destroySegment(Segment segment)
 {
   NTA_ASSERT(segmentExists_(segment));
-  for (auto h : eventHandlers_)
-  {
-    h.second->onDestroySegment(segment);
-  }
+  notify_(DESTROY_SEGMENT, segment.flatIdx);
 
   SegmentData& segmentData = segments_[segment];
   for (Synapse synapse : segmentData.synapses)
@@ -232,10 +242,7 @@ void Connections::destroySegment(Segment segment)
 void Connections::destroySynapse(Synapse synapse)
 {
   NTA_ASSERT(synapseExists_(synapse));
-  for (auto h : eventHandlers_)
-  {
-    h.second->onDestroySynapse(synapse);
-  }
+  notify_(DESTROY_SYNAPSE, synapse.flatIdx);
 
   removeSynapseFromPresynapticMap_(synapse);
 
@@ -259,12 +266,205 @@ void Connections::destroySynapse(Synapse synapse)
 void Connections::updateSynapsePermanence(Synapse synapse,
                                           Permanence permanence)
 {
+  permanence = roundPermanence(permanence);
+  notify_(UPDATE_SYNAPSE_PERMANENCE, synapse.flatIdx, permanence);
+
+  synapses_[synapse].permanence = permanence;
+}
+
+void Connections::setPermanenceBits(UInt bits)
+{
+  quantizer_ = PermanenceQuantizer(bits);
+
+  for (const CellData& cellData : cells_)
+  {
+    for (Segment segment : cellData.segments)
+    {
+      for (Synapse synapse : segments_[segment].synapses)
+      {
+        SynapseData& synapseData = synapses_[synapse];
+        synapseData.permanence = roundPermanence(synapseData.permanence);
+      }
+    }
+  }
+}
+
+UInt Connections::getPermanenceBits() const
+{
+  return quantizer_.bits();
+}
+
+Permanence Connections::roundPermanence(Permanence permanence) const
+{
+  if (!quantizer_.enabled() || permanence <= 0)
+  {
+    return permanence;
+  }
+
+  return quantizer_.fromLevel(std::max(quantizer_.toLevel(permanence),
+                                       (UInt32) 1));
+}
+
+void Connections::notify_(BatchEventType_ type, UInt32 flatIdx,
+                          Permanence permanence)
+{
+  if (eventHandlers_.empty())
+  {
+    return;
+  }
+
+  if (batch_)
+  {
+    batchEvents_.push_back({type, flatIdx, permanence});
+    return;
+  }
+
   for (auto h : eventHandlers_)
   {
-    h.second->onUpdateSynapsePermanence(synapse, permanence);
+    switch (type)
+    {
+    case CREATE_SEGMENT:
+      h.second->onCreateSegment(Segment{flatIdx});
+      break;
+    case DESTROY_SEGMENT:
+      h.second->onDestroySegment(Segment{flatIdx});
+      break;
+    case CREATE_SYNAPSE:
+      h.second->onCreateSynapse(Synapse{flatIdx});
+      break;
+    case DESTROY_SYNAPSE:
+      h.second->onDestroySynapse(Synapse{flatIdx});
+      break;
+    case UPDATE_SYNAPSE_PERMANENCE:
+      h.second->onUpdateSynapsePermanence(Synapse{flatIdx}, permanence);
+      break;
+    }
+  }
+}
+
+void Connections::beginBatch()
+{
+  NTA_CHECK(!batch_) << "Connections batches don't nest.";
+  batch_ = true;
+}
+
+void Connections::commitBatch()
+{
+  NTA_CHECK(batch_) << "commitBatch() called without beginBatch().";
+  batch_ = false;
+
+  // Apply the additions first. A synapse can be destroyed and its flatIdx
+  // reused within the batch, so each removal below then has its matching
+  // entry in the index, whatever the order of the mutations.
+  std::stable_sort(batchAdds_.begin(), batchAdds_.end(),
+                   [](const std::pair<CellIdx, UInt32>& a,
+                      const std::pair<CellIdx, UInt32>& b)
+                   {
+                     return a.first < b.first;
+                   });
+  for (auto add = batchAdds_.begin(); add != batchAdds_.end();)
+  {
+    vector<Synapse>& presynapticSynapses =
+      synapsesForPresynapticCell_[add->first];
+    const CellIdx cell = add->first;
+    for (; add != batchAdds_.end() && add->first == cell; ++add)
+    {
+      presynapticSynapses.push_back(Synapse{add->second});
+    }
   }
 
-  synapses_[synapse].permanence = permanence;
+  // Then remove each cell's destroyed synapses in one pass over its list.
+  // Removing the oldest entry of a duplicated synapse keeps the list in the
+  // order that unbatched mutations would have left it in.
+  std::sort(batchRemoves_.begin(), batchRemoves_.end());
+  vector<bool> removed;
+  for (auto first = batchRemoves_.begin(); first != batchRemoves_.end();)
+  {
+    const CellIdx cell = first->first;
+    auto last = first;
+    while (last != batchRemoves_.end() && last->first == cell)
+    {
+      ++last;
+    }
+
+    const auto presynapticSynapses = synapsesForPresynapticCell_.find(cell);
+    NTA_ASSERT(presynapticSynapses != synapsesForPresynapticCell_.end());
+    vector<Synapse>& synapses = presynapticSynapses->second;
+
+    removed.assign(last - first, false);
+    const auto end = std::remove_if(
+      synapses.begin(), synapses.end(),
+      [&](Synapse synapse)
+      {
+        const std::pair<CellIdx, UInt32> key(cell, synapse.flatIdx);
+        auto it = std::lower_bound(first, last, key);
+        while (it != last && *it == key && removed[it - first])
+        {
+          ++it;
+        }
+        if (it == last || *it != key)
+        {
+          return false;
+        }
+        removed[it - first] = true;
+        return true;
+      });
+    NTA_ASSERT(synapses.end() - end == last - first);
+    synapses.erase(end, synapses.end());
+
+    if (synapses.empty())
+    {
+      synapsesForPresynapticCell_.erase(presynapticSynapses);
+    }
+
+    first = last;
+  }
+
+  batchAdds_.clear();
+  batchRemoves_.clear();
+
+  vector<BatchEvent_> events;
+  events.swap(batchEvents_);
+  for (const BatchEvent_& event : events)
+  {
+    notify_(event.type, event.flatIdx, event.permanence);
+  }
+}
+
+bool Connections::inBatch() const
+{
+  return batch_;
+}
+
+ConnectionsBatch::ConnectionsBatch(Connections& connections, bool enabled)
+  : connections_(enabled ? &connections : nullptr)
+{
+  if (connections_)
+  {
+    connections_->beginBatch();
+  }
+}
+
+ConnectionsBatch::~ConnectionsBatch()
+{
+  try
+  {
+    commit();
+  }
+  catch (std::exception& e)
+  {
+    NTA_WARN << e.what();
+  }
+}
+
+void ConnectionsBatch::commit()
+{
+  if (connections_)
+  {
+    Connections* connections = connections_;
+    connections_ = nullptr;
+    connections->commitBatch();
+  }
 }
 
 const vector<Segment>& Connections::segmentsForCell(CellIdx cell) const
@@ -333,6 +533,7 @@ bool Connections::compareSegments(Segment a, Segment b) const
 vector<Synapse> Connections::synapsesForPresynapticCell(
   CellIdx presynapticCell) const
 {
+  NTA_ASSERT(!batch_);
   if (synapsesForPresynapticCell_.find(presynapticCell) ==
       synapsesForPresynapticCell_.end())
     return vector<Synapse>{};
@@ -381,6 +582,7 @@ void Connections::computeActivity(
   CellIdx activePresynapticCell,
   Permanence connectedPermanence) const
 {
+  NTA_ASSERT(!batch_);
   NTA_ASSERT(numActiveConnectedSynapsesForSegment.size() == segments_.size());
   NTA_ASSERT(numActivePotentialSynapsesForSegment.size() == segments_.size());
 
@@ -407,14 +609,32 @@ void Connections::computeActivity(
   const vector<CellIdx>& activePresynapticCells,
   Permanence connectedPermanence) const
 {
+  NTA_ASSERT(!batch_);
   NTA_ASSERT(numActiveConnectedSynapsesForSegment.size() == segments_.size());
   NTA_ASSERT(numActivePotentialSynapsesForSegment.size() == segments_.size());
 
-  for (CellIdx cell : activePresynapticCells)
+  computeActivity(numActiveConnectedSynapsesForSegment.data(),
+                  numActivePotentialSynapsesForSegment.data(),
+                  activePresynapticCells.size(),
+                  activePresynapticCells.data(),
+                  connectedPermanence);
+}
+
+void Connections::computeActivity(
+  UInt32 numActiveConnectedSynapsesForSegment[],
+  UInt32 numActivePotentialSynapsesForSegment[],
+  size_t numActivePresynapticCells,
+  const CellIdx activePresynapticCells[],
+  Permanence connectedPermanence) const
+{
+  NTA_ASSERT(!batch_);
+  for (size_t i = 0; i < numActivePresynapticCells; i++)
   {
-    if (synapsesForPresynapticCell_.count(cell))
+    const auto it =
+      synapsesForPresynapticCell_.find(activePresynapticCells[i]);
+    if (it != synapsesForPresynapticCell_.end())
     {
-      for (Synapse synapse : synapsesForPresynapticCell_.at(cell))
+      for (Synapse synapse : it->second)
       {
         const SynapseData& synapseData = synapses_[synapse];
         ++numActivePotentialSynapsesForSegment[synapseData.segment];
@@ -429,6 +649,40 @@ void Connections::computeActivity(
   }
 }
 
+void Connections::computeActivity(
+  vector<UInt32>& numActiveConnectedSynapsesForSegment,
+  vector<UInt32>& numActivePotentialSynapsesForSegment,
+  vector<Segment>& touchedSegments,
+  const vector<CellIdx>& activePresynapticCells,
+  Permanence connectedPermanence) const
+{
+  NTA_ASSERT(!batch_);
+  NTA_ASSERT(numActiveConnectedSynapsesForSegment.size() == segments_.size());
+  NTA_ASSERT(numActivePotentialSynapsesForSegment.size() == segments_.size());
+
+  for (CellIdx cell : activePresynapticCells)
+  {
+    const auto it = synapsesForPresynapticCell_.find(cell);
+    if (it != synapsesForPresynapticCell_.end())
+    {
+      for (Synapse synapse : it->second)
+      {
+        const SynapseData& synapseData = synapses_[synapse];
+        if (numActivePotentialSynapsesForSegment[synapseData.segment]++ == 0)
+        {
+          touchedSegments.push_back(synapseData.segment);
+        }
+
+        NTA_ASSERT(synapseData.permanence > 0);
+        if (synapseData.permanence >= connectedPermanence - EPSILON)
+        {
+          ++numActiveConnectedSynapsesForSegment[synapseData.segment];
+        }
+      }
+    }
+  }
+}
+
 void Connections::recordSegmentActivity(Segment segment)
 {
   segments_[segment].lastUsedIteration = iteration_;
@@ -456,6 +710,7 @@ void Connections::save(std::ostream& outStream) const
   outStream << cells_.size() << " "
             << maxSegmentsPerCell_ << " "
             << maxSynapsesPerSegment_ << " "
+            << quantizer_.bits() << " "
             << endl;
 
   for (CellData cellData : cells_)
@@ -523,6 +778,7 @@ void Connections::write(ConnectionsProto::Builder& proto) const
   proto.setMaxSegmentsPerCell(maxSegmentsPerCell_);
   proto.setMaxSynapsesPerSegment(maxSynapsesPerSegment_);
   proto.setIteration(iteration_);
+  proto.setPermanenceBits(quantizer_.bits());
 }
 
 void Connections::load(std::istream& inStream)
@@ -545,6 +801,13 @@ void Connections::load(std::istream& inStream)
 
   initialize(numCells, maxSegmentsPerCell_, maxSynapsesPerSegment_);
 
+  UInt permanenceBits = 0;
+  if (version >= 3)
+  {
+    inStream >> permanenceBits;
+  }
+  quantizer_ = PermanenceQuantizer(permanenceBits);
+
   // This logic is complicated by the fact that old versions of the Connections
   // serialized "destroyed" segments and synapses, which we now ignore.
   cells_.resize(numCells);
@@ -628,6 +891,7 @@ void Connections::read(ConnectionsProto::Reader& proto)
   initialize(protoCells.size(),
              proto.getMaxSegmentsPerCell(),
              proto.getMaxSynapsesPerSegment());
+  quantizer_ = PermanenceQuantizer(proto.getPermanenceBits());
 
   for (CellIdx cell = 0; cell < protoCells.size(); ++cell)
   {
@@ -710,6 +974,7 @@ bool Connections::operator==(const Connections &other) const
 {
   if (maxSegmentsPerCell_ != other.maxSegmentsPerCell_) return false;
   if (maxSynapsesPerSegment_ != other.maxSynapsesPerSegment_) return false;
+  if (quantizer_.bits() != other.quantizer_.bits()) return false;
 
   if (cells_.size() != other.cells_.size()) return false;
 
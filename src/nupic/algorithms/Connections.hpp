@@ -31,6 +31,7 @@
 #include <utility>
 #include <vector>
 
+#include <nupic/algorithms/QuantizedPermanences.hpp>
 #include <nupic/types/Serializable.hpp>
 #include <nupic/types/Types.hpp>
 #include <nupic/math/Math.hpp>
@@ -223,13 +224,13 @@ namespace nupic
       class Connections : public Serializable<ConnectionsProto>
       {
       public:
-        static const UInt16 VERSION = 2;
+        static const UInt16 VERSION = 3;
 
         /**
          * Connections empty constructor.
          * (Does not call `initialize`.)
          */
-        Connections() {};
+        Connections() : batch_(false) {};
 
         /**
          * Connections constructor.
@@ -300,6 +301,70 @@ namespace nupic
         void updateSynapsePermanence(Synapse synapse,
                                      Permanence permanence);
 
+        /**
+         * Starts a batch of mutations.
+         *
+         * Until commitBatch(), createSegment, createSynapse, destroySegment,
+         * destroySynapse and updateSynapsePermanence still update the cell
+         * and segment lists immediately, so learning code can keep reading
+         * them. The presynaptic cell index and the ConnectionsEventHandler
+         * notifications are deferred to commitBatch().
+         *
+         * During a batch, don't call the methods that read the presynaptic
+         * index: computeActivity and synapsesForPresynapticCell. Batches
+         * don't nest.
+         */
+        void beginBatch();
+
+        /**
+         * Applies the deferred work of a batch. Index updates are grouped
+         * by presynaptic cell, so each cell's synapse list is visited once
+         * per batch rather than once per mutation. Event handlers are then
+         * notified in the order the mutations happened. They only get the
+         * segment or synapse, and its data may have changed since the
+         * mutation, e.g. a synapse destroyed and then reused in the batch.
+         */
+        void commitBatch();
+
+        /**
+         * @retval Whether a batch is in progress.
+         */
+        bool inBatch() const;
+
+        /**
+         * Sets the permanence resolution, and rounds the current
+         * permanences to it.
+         *
+         * With 8 or 16 bits, createSynapse and updateSynapsePermanence
+         * round permanences to 2^bits - 1 steps in [0, 1], so learning
+         * increments act as whole steps, see PermanenceQuantizer. A positive
+         * permanence never rounds to zero, so synapses keep a positive
+         * permanence. Permanences are still held as floats: a SynapseData
+         * takes 12 bytes either way because of alignment. The rounding gives
+         * the same learning behaviour as a SpatialPooler with fixed-point
+         * permanences, and permanences that an 8- or 16-bit store would hold
+         * exactly.
+         *
+         * @param bits 0 (float permanences), 8 or 16.
+         */
+        void setPermanenceBits(UInt bits);
+
+        /**
+         * @retval 0, 8 or 16, see setPermanenceBits.
+         */
+        UInt getPermanenceBits() const;
+
+        /**
+         * Rounds a permanence as createSynapse and updateSynapsePermanence
+         * would. Learning algorithms use it before checking whether an
+         * updated permanence is still positive.
+         *
+         * @param permanence Permanence in [0, 1].
+         *
+         * @retval The rounded permanence.
+         */
+        Permanence roundPermanence(Permanence permanence) const;
+
         /**
          * Gets the segments for a cell.
          *
@@ -429,6 +494,71 @@ namespace nupic
           const std::vector<CellIdx>& activePresynapticCells,
           Permanence connectedPermanence) const;
 
+        /**
+         * Compute the segment excitations for an array of active presynaptic
+         * cells, into caller-owned arrays. Same as the vector version, for
+         * callers that hold their data in other containers, e.g. the Python
+         * bindings with numpy arrays.
+         *
+         * @param numActiveConnectedSynapsesForSegment
+         * An output array for active connected synapse counts per segment,
+         * of the length returned by segmentFlatListLength().
+         *
+         * @param numActivePotentialSynapsesForSegment
+         * An output array for active potential synapse counts per segment,
+         * of the length returned by segmentFlatListLength().
+         *
+         * @param numActivePresynapticCells
+         * Number of active cells in the input.
+         *
+         * @param activePresynapticCells
+         * Active cells in the input.
+         *
+         * @param connectedPermanence
+         * Minimum permanence for a synapse to be "connected".
+         */
+        void computeActivity(
+          UInt32 numActiveConnectedSynapsesForSegment[],
+          UInt32 numActivePotentialSynapsesForSegment[],
+          size_t numActivePresynapticCells,
+          const CellIdx activePresynapticCells[],
+          Permanence connectedPermanence) const;
+
+        /**
+         * Compute the segment excitations for a vector of active presynaptic
+         * cells, and record which segments were touched.
+         *
+         * A segment is appended to touchedSegments the first time its
+         * potential synapse count goes up, so the counts of every segment
+         * passed in must be zero on entry. The caller can then reset and
+         * scan the counts in O(touched segments) rather than
+         * O(segmentFlatListLength()), which matters when activity is sparse
+         * and the segments are many.
+         *
+         * @param numActiveConnectedSynapsesForSegment
+         * An output vector for active connected synapse counts per segment.
+         *
+         * @param numActivePotentialSynapsesForSegment
+         * An output vector for active potential synapse counts per segment.
+         *
+         * @param touchedSegments
+         * An output vector, appended to, of the segments with at least one
+         * active potential synapse. Each segment appears once, in no
+         * particular order.
+         *
+         * @param activePresynapticCells
+         * Active cells in the input.
+         *
+         * @param connectedPermanence
+         * Minimum permanence for a synapse to be "connected".
+         */
+        void computeActivity(
+          std::vector<UInt32>& numActiveConnectedSynapsesForSegment,
+          std::vector<UInt32>& numActivePotentialSynapsesForSegment,
+          std::vector<Segment>& touchedSegments,
+          const std::vector<CellIdx>& activePresynapticCells,
+          Permanence connectedPermanence) const;
+
         /**
          * Compute the segment excitations for a single active presynaptic cell.
          *
@@ -613,6 +743,31 @@ namespace nupic
          */
         void removeSynapseFromPresynapticMap_(Synapse synapse);
 
+        /**
+         * Kinds of event deferred by a batch.
+         */
+        enum BatchEventType_
+        {
+          CREATE_SEGMENT,
+          DESTROY_SEGMENT,
+          CREATE_SYNAPSE,
+          DESTROY_SYNAPSE,
+          UPDATE_SYNAPSE_PERMANENCE
+        };
+
+        struct BatchEvent_
+        {
+          BatchEventType_ type;
+          UInt32 flatIdx;
+          Permanence permanence;
+        };
+
+        /**
+         * Notify the event handlers, now or at the end of the batch.
+         */
+        void notify_(BatchEventType_ type, UInt32 flatIdx,
+                     Permanence permanence = 0);
+
       private:
         std::vector<CellData> cells_;
         std::vector<SegmentData> segments_;
@@ -633,8 +788,51 @@ namespace nupic
         Iteration iteration_;
         UInt32 nextEventToken_;
         std::map<UInt32, ConnectionsEventHandler*> eventHandlers_;
+
+        // Work deferred by beginBatch(): (presynaptic cell, synapse flatIdx)
+        // pairs to add to and remove from synapsesForPresynapticCell_, and
+        // the handler notifications.
+        bool batch_;
+        std::vector<std::pair<CellIdx, UInt32> > batchAdds_;
+        std::vector<std::pair<CellIdx, UInt32> > batchRemoves_;
+        std::vector<BatchEvent_> batchEvents_;
+
+        PermanenceQuantizer quantizer_;
       }; // end class Connections
 
+      /**
+       * Scoped Connections batch.
+       *
+       * Begins a batch on construction and commits it on commit() or, if
+       * commit() wasn't reached, on destruction. The mutations of a batch
+       * are already in the cell and segment lists, so an exception thrown
+       * during the batch still commits, which keeps the presynaptic index
+       * in sync and the Connections usable. Errors from a commit in the
+       * destructor are logged rather than thrown.
+       */
+      class ConnectionsBatch
+      {
+      public:
+        /**
+         * @param connections The Connections to batch.
+         * @param enabled Whether to start a batch at all.
+         */
+        ConnectionsBatch(Connections& connections, bool enabled = true);
+
+        ~ConnectionsBatch();
+
+        /**
+         * Commit the batch now, if it is still open.
+         */
+        void commit();
+
+      private:
+        ConnectionsBatch(const ConnectionsBatch&);
+        ConnectionsBatch& operator=(const ConnectionsBatch&);
+
+        Connections* connections_;
+      };
+
     } // end namespace connections
 
   } // end namespace algorithms
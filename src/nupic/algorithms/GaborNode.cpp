@@ -44,6 +44,12 @@
 #include <nupic/utils/Log.hpp>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <nupic/utils/ParallelFor.hpp>
 
 
 // Enable debugging
@@ -2683,6 +2689,611 @@ void _zeroOutputs(const NUMPY_ARRAY * psOutput) {
 }
 
 
+//----------------------------------------------------------------------
+// Parallel implementation, used by gaborComputeParallel()
+//
+// The work is split into tasks of one filter (output plane) and one
+// band of GABOR_BAND_ROWS output rows, and the tasks are spread over
+// threads.  Each task keeps its own statistics, which are combined
+// once all the tasks are done, so the normalizers (and therefore the
+// outputs) are exactly those of the serial implementation.
+//
+// With NORMALIZE_METHOD_FIXED, the gains are known before convolving,
+// so each task post-processes its rows as soon as they are convolved,
+// from a one-row scratch buffer: the responses never go through
+// psBufferOut.
+#ifdef __cplusplus
+}
+#endif
+
+// Number of output rows per task
+#define GABOR_BAND_ROWS     16
+
+// On 64-bit Linux (gcc or clang), when the CPU supports AVX2, the
+// filter dot products are computed for GABOR_LANES adjacent output
+// locations at once, using the compiler's vector extensions.  (Built
+// for the baseline instruction set, the same loop is slower than the
+// scalar one, because 32-bit multiplies have to be emulated.)
+#if defined(NTA_OS_LINUX) && defined(NTA_ARCH_64) && defined(__GNUC__)
+#define GABOR_SIMD          1
+#define GABOR_LANES         8
+typedef int GABOR_VECTOR __attribute__((vector_size(GABOR_LANES * sizeof(int))));
+#endif
+
+namespace {
+
+  // Running statistics of one task: max/min responses for the
+  // max-based methods, sums of downshifted row sums for the mean-based
+  // methods.
+  struct GaborStats {
+    int nPos;
+    int nNeg;
+  };
+
+  // Gains of one output plane
+  struct GaborGains {
+    float fGainPos;
+    float fGainNeg;
+    int nDiscreteGainPos;
+    int nDiscreteGainNeg;
+  };
+
+  // Everything the tasks need, computed once per call
+  struct GaborPlan {
+    // Convolution
+    const int * pnInputBase;
+    int nInputRowStride;
+    const int * pnFilterBase;
+    int nFilterPlaneStride;
+    int nFilterDim;
+    int nNumFilters;
+    const float * pfAlphaBase;
+    int nAlphaRowStride;
+    int nShrinkageX;
+    int nShrinkageY;
+    int * pnBufferBase;
+    int nBufferRowStride;
+    int nBufferPlaneStride;
+    BBOX sInputBox;
+    BBOX sOutputBox;
+    unsigned int nStatFlags;
+
+    // Post-processing
+    float * pfOutputBase;
+    int nOutputRowStride;
+    int nOutputPlaneStride;
+    int nOutputRows;
+    int nOutputCols;
+    int nNumPlanes;
+    PHASE_MODE ePhaseMode;
+    POSTPROC_METHOD ePostProcMethod;
+    const float * pfPostProcLUT;
+    int nMaxLutBin;
+    unsigned int nOverflowMask;
+    std::vector<GaborGains> gains;
+  };
+
+  unsigned int _statFlags(NORMALIZE_METHOD eNormalizeMethod,
+                          PHASE_MODE ePhaseMode) {
+    switch (eNormalizeMethod) {
+    case NORMALIZE_METHOD_MAX:
+    case NORMALIZE_METHOD_MAXPOWER:
+      return ePhaseMode == PHASE_MODE_SINGLE ? STATS_MAX_ABS : STATS_MAX_MIN;
+    case NORMALIZE_METHOD_MEAN:
+    case NORMALIZE_METHOD_MEANPOWER:
+      return ePhaseMode == PHASE_MODE_SINGLE ? STATS_SUM_ABS : STATS_SUM_POS_NEG;
+    case NORMALIZE_METHOD_FIXED:
+      return STATS_NONE;
+    default:
+      NTA_ASSERT(false);
+      return STATS_NONE;
+    }
+  }
+
+  // Convolves output locations [i, nCols) of one row against one filter,
+  // four locations at a time so that each filter tap is loaded once per
+  // four products.
+  void _convolveRowScalar(const int * pnFilter,
+                          const int * pnInputRow,
+                          int nStride,
+                          int nDim,
+                          int i,
+                          int nCols,
+                          int * pnOutputRow) {
+    for (; i + 4 <= nCols; i += 4) {
+      int nResponse0 = 0, nResponse1 = 0, nResponse2 = 0, nResponse3 = 0;
+      const int * pnGaborPtr = pnFilter;
+      for (int jj = 0; jj < nDim; jj++) {
+        const int * pnInputPtr = pnInputRow + jj * nStride + i;
+        for (int ii = 0; ii < nDim; ii++) {
+          const int nGabor = *pnGaborPtr++;
+          nResponse0 += nGabor * pnInputPtr[ii];
+          nResponse1 += nGabor * pnInputPtr[ii + 1];
+          nResponse2 += nGabor * pnInputPtr[ii + 2];
+          nResponse3 += nGabor * pnInputPtr[ii + 3];
+        }
+      }
+      pnOutputRow[i] = nResponse0;
+      pnOutputRow[i + 1] = nResponse1;
+      pnOutputRow[i + 2] = nResponse2;
+      pnOutputRow[i + 3] = nResponse3;
+    }
+
+    for (; i < nCols; i++) {
+      int nResponse = 0;
+      const int * pnGaborPtr = pnFilter;
+      for (int jj = 0; jj < nDim; jj++) {
+        const int * pnInputPtr = pnInputRow + jj * nStride + i;
+        for (int ii = 0; ii < nDim; ii++)
+          nResponse += (*pnGaborPtr++) * pnInputPtr[ii];
+      }
+      pnOutputRow[i] = nResponse;
+    }
+  }
+
+#ifdef GABOR_SIMD
+  __attribute__((target("avx2")))
+  void _convolveRowAvx2(const int * pnFilter,
+                        const int * pnInputRow,
+                        int nStride,
+                        int nDim,
+                        int nCols,
+                        int * pnOutputRow) {
+    int i = 0;
+    for (; i + GABOR_LANES <= nCols; i += GABOR_LANES) {
+      GABOR_VECTOR vnResponse = {0, 0, 0, 0, 0, 0, 0, 0};
+      const int * pnGaborPtr = pnFilter;
+      for (int jj = 0; jj < nDim; jj++) {
+        const int * pnInputPtr = pnInputRow + jj * nStride + i;
+        for (int ii = 0; ii < nDim; ii++) {
+          GABOR_VECTOR vnInput;
+          memcpy(&vnInput, pnInputPtr + ii, sizeof(vnInput));
+          vnResponse += (*pnGaborPtr++) * vnInput;
+        }
+      }
+      memcpy(pnOutputRow + i, &vnResponse, sizeof(vnResponse));
+    }
+
+    _convolveRowScalar(pnFilter, pnInputRow, nStride, nDim, i, nCols,
+                       pnOutputRow);
+  }
+#endif // GABOR_SIMD
+
+  // Convolves one output row (within the output box) against one filter.
+  // pnInputRow is the upper-left corner of the receptive field of the
+  // row's first location.  Locations outside of the alpha channel (if
+  // any) get a zero response.
+  void _convolveRow(const GaborPlan & p,
+                    const int * pnFilter,
+                    const int * pnInputRow,
+                    const float * pfAlphaRow,
+                    int * pnOutputRow) {
+    const int nCols = p.sOutputBox.nRight - p.sOutputBox.nLeft;
+
+#ifdef GABOR_SIMD
+    static const bool bAvx2 = __builtin_cpu_supports("avx2");
+    if (bAvx2)
+      _convolveRowAvx2(pnFilter, pnInputRow, p.nInputRowStride,
+                       p.nFilterDim, nCols, pnOutputRow);
+    else
+#endif // GABOR_SIMD
+      _convolveRowScalar(pnFilter, pnInputRow, p.nInputRowStride,
+                         p.nFilterDim, 0, nCols, pnOutputRow);
+
+    if (pfAlphaRow) {
+      for (int i = 0; i < nCols; i++) {
+        if (!pfAlphaRow[i])
+          pnOutputRow[i] = 0;
+      }
+    }
+  }
+
+  // Updates the statistics with the responses of one row, skipping the
+  // locations outside of the alpha channel (if any).
+  void _accumulateStats(const GaborPlan & p,
+                        const int * pnRow,
+                        const float * pfAlphaRow,
+                        GaborStats & sStats) {
+    const int nCols = p.sOutputBox.nRight - p.sOutputBox.nLeft;
+    int nStatPosRow = 0;
+    int nStatNegRow = 0;
+
+    for (int i = 0; i < nCols; i++) {
+      if (pfAlphaRow && !pfAlphaRow[i])
+        continue;
+      const int nResponse = pnRow[i];
+      if (p.nStatFlags & STATS_MAX_ABS)
+        sStats.nPos = MAX(sStats.nPos, IABS32(nResponse));
+      else if (p.nStatFlags & STATS_MAX_MIN) {
+        if (nResponse >= 0)
+          sStats.nPos = MAX(sStats.nPos, nResponse);
+        else
+          sStats.nNeg = MIN(sStats.nNeg, nResponse);
+      }
+      else if (p.nStatFlags & STATS_SUM_ABS)
+        nStatPosRow += IABS32(nResponse);
+      else if (p.nStatFlags & STATS_SUM_POS_NEG) {
+        if (nResponse >= 0)
+          nStatPosRow += nResponse;
+        else
+          nStatNegRow -= nResponse;
+      }
+    }
+
+    // Same downshifting of the row sums as the serial implementation
+    if (p.nStatFlags & STATS_MEAN) {
+      sStats.nPos += (nStatPosRow >> 8);
+      sStats.nNeg += ((-nStatNegRow) >> 8);
+    }
+  }
+
+  // Fills a whole output row (and its dual-phase counterpart) with
+  // NULL_RESPONSE.
+  void _blankRow(const GaborPlan & p, float * pfPos, float * pfNeg) {
+    std::fill(pfPos, pfPos + p.nOutputCols, (float)NULL_RESPONSE);
+    if (pfNeg)
+      std::fill(pfNeg, pfNeg + p.nOutputCols, (float)NULL_RESPONSE);
+  }
+
+  // Rectifies, applies the gains and the post-processing LUT to the
+  // responses of one row (within the output box), and fills the rest of
+  // the output row with NULL_RESPONSE.  Same arithmetic as _postProcess().
+  void _postProcessRow(const GaborPlan & p,
+                       const GaborGains & g,
+                       const int * pnRow,
+                       float * pfPos,
+                       float * pfNeg) {
+    const int nLeft = p.sOutputBox.nLeft;
+    const int nCols = p.sOutputBox.nRight - nLeft;
+
+    std::fill(pfPos, pfPos + nLeft, (float)NULL_RESPONSE);
+    std::fill(pfPos + nLeft + nCols, pfPos + p.nOutputCols,
+              (float)NULL_RESPONSE);
+    pfPos += nLeft;
+    if (pfNeg) {
+      std::fill(pfNeg, pfNeg + nLeft, (float)NULL_RESPONSE);
+      std::fill(pfNeg + nLeft + nCols, pfNeg + p.nOutputCols,
+                (float)NULL_RESPONSE);
+      pfNeg += nLeft;
+    }
+
+    if (p.ePhaseMode == PHASE_MODE_SINGLE) {
+      if (p.ePostProcMethod == POSTPROC_METHOD_RAW) {
+        for (int i = 0; i < nCols; i++)
+          pfPos[i] = g.fGainPos * (float)(IABS32(pnRow[i]));
+      }
+      else {
+        for (int i = 0; i < nCols; i++) {
+          unsigned int nSingleBin =
+            (unsigned int)(IABS32(pnRow[i]) / g.nDiscreteGainPos);
+          if (nSingleBin & p.nOverflowMask)
+            nSingleBin = p.nMaxLutBin;
+          NTA_ASSERT(nSingleBin <= (unsigned int)p.nMaxLutBin);
+          pfPos[i] = p.pfPostProcLUT[nSingleBin];
+        }
+      }
+    }
+    else {
+      NTA_ASSERT(p.ePhaseMode == PHASE_MODE_DUAL);
+      if (p.ePostProcMethod == POSTPROC_METHOD_RAW) {
+        for (int i = 0; i < nCols; i++) {
+          const float fResponse = (float)(pnRow[i]);
+          if (fResponse >= 0.0f) {
+            pfPos[i] = fResponse * g.fGainPos;
+            pfNeg[i] = 0.0f;
+          }
+          else {
+            pfPos[i] = 0.0f;
+            pfNeg[i] = fResponse * g.fGainNeg;
+          }
+        }
+      }
+      else {
+        for (int i = 0; i < nCols; i++) {
+          int nDualBin = pnRow[i] / g.nDiscreteGainPos;
+          if (nDualBin >= 0) {
+            if (p.nOverflowMask && nDualBin > p.nMaxLutBin)
+              nDualBin = p.nMaxLutBin;
+            NTA_ASSERT(nDualBin <= p.nMaxLutBin);
+            pfPos[i] = p.pfPostProcLUT[nDualBin];
+            pfNeg[i] = 0.0f;
+          }
+          else {
+            pfPos[i] = 0.0f;
+            nDualBin = pnRow[i] / g.nDiscreteGainNeg;
+            if (p.nOverflowMask && nDualBin > p.nMaxLutBin)
+              nDualBin = p.nMaxLutBin;
+            NTA_ASSERT(nDualBin <= p.nMaxLutBin);
+            pfNeg[i] = p.pfPostProcLUT[nDualBin];
+          }
+        }
+      }
+    }
+  }
+
+  // Pointers to the start of output row nRow of plane nPlane (and of its
+  // dual-phase counterpart, or nullptr in single-phase mode).
+  void _outputRows(const GaborPlan & p, int nPlane, int nRow,
+                   float * & pfPos, float * & pfNeg) {
+    pfPos = p.pfOutputBase + nPlane * p.nOutputPlaneStride
+          + nRow * p.nOutputRowStride;
+    pfNeg = nullptr;
+    if (p.ePhaseMode == PHASE_MODE_DUAL)
+      pfNeg = pfPos + p.nNumPlanes * p.nOutputPlaneStride;
+  }
+
+  // Input row and alpha row for output row nRow (within the output box)
+  const int * _inputRow(const GaborPlan & p, int nRow) {
+    return p.pnInputBase
+         + p.nInputRowStride * (p.sInputBox.nTop + nRow - p.sOutputBox.nTop)
+         + p.sInputBox.nLeft;
+  }
+
+  const float * _alphaRow(const GaborPlan & p, int nRow) {
+    if (!p.pfAlphaBase)
+      return nullptr;
+    return p.pfAlphaBase + (nRow + p.nShrinkageY) * p.nAlphaRowStride
+         + p.sOutputBox.nLeft + p.nShrinkageX;
+  }
+
+  // Pass I: convolves each band of each filter into psBufferOut,
+  // keeping the statistics of each task.
+  void _convolveBands(const GaborPlan & p, int nThreads,
+                      std::vector<GaborStats> & tasksStats) {
+    const int nBoxRows = p.sOutputBox.nBottom - p.sOutputBox.nTop;
+    const int nNumBands = (nBoxRows + GABOR_BAND_ROWS - 1) / GABOR_BAND_ROWS;
+    const size_t nNumTasks = (size_t)nNumBands * p.nNumFilters;
+    GaborStats sZero = {0, 0};
+    tasksStats.assign(nNumTasks, sZero);
+
+    nupic::parallelForShards(nNumTasks,
+                             nupic::parallelThreads(nNumTasks, nThreads),
+                             [&](size_t nBegin, size_t nEnd) {
+      for (size_t t = nBegin; t != nEnd; ++t) {
+        const int nFilter = (int)(t / nNumBands);
+        const int nBand = (int)(t % nNumBands);
+        const int * pnFilter = p.pnFilterBase + nFilter * p.nFilterPlaneStride;
+        const int nRowBegin = p.sOutputBox.nTop + nBand * GABOR_BAND_ROWS;
+        const int nRowEnd = MIN(nRowBegin + GABOR_BAND_ROWS,
+                                p.sOutputBox.nBottom);
+
+        for (int nRow = nRowBegin; nRow < nRowEnd; nRow++) {
+          int * pnOutputRow = p.pnBufferBase + nFilter * p.nBufferPlaneStride
+                            + nRow * p.nBufferRowStride + p.sOutputBox.nLeft;
+          const float * pfAlphaRow = _alphaRow(p, nRow);
+          _convolveRow(p, pnFilter, _inputRow(p, nRow), pfAlphaRow,
+                       pnOutputRow);
+          if (p.nStatFlags != STATS_NONE)
+            _accumulateStats(p, pnOutputRow, pfAlphaRow, tasksStats[t]);
+        }
+      }
+    });
+  }
+
+  // Pass II: post-processes each band of each plane of psBufferOut into
+  // psOutput, including the rows and columns outside of the output box.
+  // If bFused, the responses are convolved on the fly instead of being
+  // read from psBufferOut.
+  void _postProcessBands(const GaborPlan & p, int nThreads, bool bFused) {
+    const int nNumBands =
+      (p.nOutputRows + GABOR_BAND_ROWS - 1) / GABOR_BAND_ROWS;
+    const size_t nNumTasks = (size_t)nNumBands * p.nNumPlanes;
+
+    nupic::parallelForShards(nNumTasks,
+                             nupic::parallelThreads(nNumTasks, nThreads),
+                             [&](size_t nBegin, size_t nEnd) {
+      std::vector<int> anScratch;
+      if (bFused)
+        anScratch.resize(p.sOutputBox.nRight - p.sOutputBox.nLeft + 1);
+
+      for (size_t t = nBegin; t != nEnd; ++t) {
+        const int nPlane = (int)(t / nNumBands);
+        const int nBand = (int)(t % nNumBands);
+        const int nRowBegin = nBand * GABOR_BAND_ROWS;
+        const int nRowEnd = MIN(nRowBegin + GABOR_BAND_ROWS, p.nOutputRows);
+        const GaborGains & g = p.gains[nPlane];
+
+        for (int nRow = nRowBegin; nRow < nRowEnd; nRow++) {
+          float * pfPos;
+          float * pfNeg;
+          _outputRows(p, nPlane, nRow, pfPos, pfNeg);
+
+          if (nRow < p.sOutputBox.nTop || nRow >= p.sOutputBox.nBottom) {
+            _blankRow(p, pfPos, pfNeg);
+            continue;
+          }
+
+          const int * pnRow;
+          if (bFused) {
+            _convolveRow(p, p.pnFilterBase + nPlane * p.nFilterPlaneStride,
+                         _inputRow(p, nRow), _alphaRow(p, nRow),
+                         anScratch.data());
+            pnRow = anScratch.data();
+          }
+          else
+            pnRow = p.pnBufferBase + nPlane * p.nBufferPlaneStride
+                  + nRow * p.nBufferRowStride + p.sOutputBox.nLeft;
+
+          _postProcessRow(p, g, pnRow, pfPos, pfNeg);
+        }
+      }
+    });
+  }
+
+  // Final normalizer of one set of combined statistics, stored the way
+  // _doConvolution() stores it.
+  void _storeNormalizers(GaborStats sStats,
+                         unsigned int nStatFlags,
+                         NORMALIZE_METHOD eNormalizeMethod,
+                         PHASE_MODE ePhaseMode,
+                         int nNumPixels,
+                         unsigned int & nStatPos,
+                         unsigned int & nStatNeg) {
+    _computeNormalizers(sStats.nPos, sStats.nNeg, nStatFlags,
+                        eNormalizeMethod, nNumPixels);
+    NTA_ASSERT(sStats.nPos >= 0);
+    nStatPos = (unsigned int)(sStats.nPos + 1);
+    if (ePhaseMode == PHASE_MODE_DUAL) {
+      sStats.nNeg = -sStats.nNeg;
+      NTA_ASSERT(sStats.nNeg >= 0);
+      nStatNeg = (unsigned int)(sStats.nNeg + 1);
+    }
+  }
+
+  void _combineStats(GaborStats & sTotal, const GaborStats & sTask,
+                     unsigned int nStatFlags) {
+    if (nStatFlags & STATS_MAX) {
+      sTotal.nPos = MAX(sTotal.nPos, sTask.nPos);
+      sTotal.nNeg = MIN(sTotal.nNeg, sTask.nNeg);
+    }
+    else if (nStatFlags & STATS_MEAN) {
+      sTotal.nPos += sTask.nPos;
+      sTotal.nNeg += sTask.nNeg;
+    }
+  }
+
+  // Parallel counterpart of _doConvolution() and _postProcess().
+  void _doConvolutionParallel(const NUMPY_ARRAY * psBufferIn,
+                              const NUMPY_ARRAY * psBufferOut,
+                              const NUMPY_ARRAY * psGaborBank,
+                              const NUMPY_ARRAY * psAlpha,
+                              const BBOX * psInputBox,
+                              const BBOX * psOutputBox,
+                              const NUMPY_ARRAY * psOutput,
+                              float fGainConstant,
+                              PHASE_MODE ePhaseMode,
+                              NORMALIZE_METHOD eNormalizeMethod,
+                              NORMALIZE_MODE eNormalizeMode,
+                              PHASENORM_MODE ePhaseNormMode,
+                              POSTPROC_METHOD ePostProcMethod,
+                              const NUMPY_ARRAY * psPostProcLUT,
+                              float fPostProcScalar,
+                              int nThreads) {
+    GaborPlan p;
+
+    p.pnInputBase = (const int *)psBufferIn->pData;
+    p.nInputRowStride = IMAGE_ROWSTRIDE(psBufferIn) / sizeof(int);
+    p.pnFilterBase = (const int *)psGaborBank->pData;
+    p.nFilterPlaneStride = IMAGESET_PLANESTRIDE(psGaborBank) / sizeof(int);
+    p.nFilterDim = IMAGESET_ROWS(psGaborBank);
+    p.nNumFilters = GABORSET_PLANES(psGaborBank);
+    p.pfAlphaBase = psAlpha ? (const float *)psAlpha->pData : nullptr;
+    p.nAlphaRowStride = psAlpha ? IMAGE_ROWSTRIDE(psAlpha) / sizeof(float) : 0;
+    p.nShrinkageX = (psInputBox->nRight - psOutputBox->nRight) >> 1;
+    p.nShrinkageY = (psInputBox->nBottom - psOutputBox->nBottom) >> 1;
+    p.pnBufferBase = (int *)psBufferOut->pData;
+    p.nBufferRowStride = IMAGESET_ROWSTRIDE(psBufferOut) / sizeof(int);
+    p.nBufferPlaneStride = IMAGESET_PLANESTRIDE(psBufferOut) / sizeof(int);
+    p.sInputBox = *psInputBox;
+    p.sOutputBox = *psOutputBox;
+    p.nStatFlags = _statFlags(eNormalizeMethod, ePhaseMode);
+
+    p.pfOutputBase = (float *)psOutput->pData;
+    p.nOutputRowStride = IMAGESET_ROWSTRIDE(psOutput) / sizeof(float);
+    p.nOutputPlaneStride = IMAGESET_PLANESTRIDE(psOutput) / sizeof(float);
+    p.nOutputRows = IMAGESET_ROWS(psOutput);
+    p.nOutputCols = IMAGESET_COLS(psOutput);
+    p.nNumPlanes = IMAGESET_PLANES(psBufferOut);
+    p.ePhaseMode = ePhaseMode;
+    p.ePostProcMethod = ePostProcMethod;
+    p.pfPostProcLUT = nullptr;
+    p.nMaxLutBin = 0;
+    p.nOverflowMask = 0x0;
+    if (ePostProcMethod != POSTPROC_METHOD_RAW) {
+      p.pfPostProcLUT = (const float *)psPostProcLUT->pData;
+      p.nMaxLutBin = VECTOR_PLANES(psPostProcLUT) - 1;
+      if (eNormalizeMethod == NORMALIZE_METHOD_MEAN)
+        p.nOverflowMask = ~p.nMaxLutBin;
+    }
+
+    NTA_ASSERT(p.nNumFilters <= MAXNUM_FILTERS);
+    unsigned int anStatPosGrand[MAXNUM_FILTERS] = {0};
+    unsigned int anStatNegGrand[MAXNUM_FILTERS] = {0};
+
+    // The fixed normalization doesn't depend on the responses, so the
+    // post-processing can be fused into the convolution
+    const bool bFused = (eNormalizeMethod == NORMALIZE_METHOD_FIXED &&
+                         p.nNumPlanes == p.nNumFilters);
+
+    if (bFused) {
+      GaborStats sZero = {0, 0};
+      for (int k = 0; k < p.nNumFilters; k++)
+        _storeNormalizers(sZero, STATS_NONE, eNormalizeMethod, ePhaseMode, 0,
+                          anStatPosGrand[k], anStatNegGrand[k]);
+    }
+    else {
+      std::vector<GaborStats> tasksStats;
+      _convolveBands(p, nThreads, tasksStats);
+
+      // Number of pixels for the mean-based methods, as counted by
+      // _doConvolution_bbox() or _doConvolution_alpha()
+      int nNumPixels = 0;
+      if (p.nStatFlags & STATS_MEAN) {
+        const int nBoxCols = psOutputBox->nRight - psOutputBox->nLeft;
+        if (!psAlpha)
+          nNumPixels = nBoxCols * (psOutputBox->nBottom - psOutputBox->nTop);
+        else if (eNormalizeMode == NORMALIZE_MODE_GLOBAL) {
+          for (int nRow = psOutputBox->nTop; nRow < psOutputBox->nBottom;
+               nRow++) {
+            const float * pfAlphaRow = _alphaRow(p, nRow);
+            for (int i = 0; i < nBoxCols; i++) {
+              if (pfAlphaRow[i])
+                nNumPixels++;
+            }
+          }
+        }
+        if (eNormalizeMode == NORMALIZE_MODE_GLOBAL)
+          nNumPixels *= p.nNumFilters;
+      }
+
+      const size_t nNumBands = tasksStats.size() / p.nNumFilters;
+      GaborStats sGrand = {0, 0};
+      for (int k = 0; k < p.nNumFilters; k++) {
+        GaborStats sFilter = {0, 0};
+        for (size_t b = 0; b < nNumBands; b++)
+          _combineStats(sFilter, tasksStats[k * nNumBands + b], p.nStatFlags);
+
+        if (eNormalizeMode == NORMALIZE_MODE_PERORIENT)
+          _storeNormalizers(sFilter, p.nStatFlags, eNormalizeMethod,
+                            ePhaseMode, nNumPixels,
+                            anStatPosGrand[k], anStatNegGrand[k]);
+        else
+          _combineStats(sGrand, sFilter, p.nStatFlags);
+      }
+      if (eNormalizeMode == NORMALIZE_MODE_GLOBAL)
+        _storeNormalizers(sGrand, p.nStatFlags, eNormalizeMethod, ePhaseMode,
+                          nNumPixels, anStatPosGrand[0], anStatNegGrand[0]);
+    }
+
+    // Gains of each plane, as in _postProcess()
+    const float fGain = fGainConstant / (float)(0x1 << GABOR_SCALING_SHIFT);
+    p.gains.resize(p.nNumPlanes);
+    for (int k = 0; k < p.nNumPlanes; k++) {
+      GaborGains & g = p.gains[k];
+      const int nStat = (eNormalizeMode == NORMALIZE_MODE_PERORIENT) ? k : 0;
+      g.fGainPos = 0.0f;
+      g.fGainNeg = 0.0f;
+      g.nDiscreteGainPos = 0;
+      g.nDiscreteGainNeg = 0;
+      _computeGains(fGain, anStatPosGrand[nStat], anStatNegGrand[nStat],
+                    ePhaseMode, ePhaseNormMode, g.fGainPos, g.fGainNeg);
+      if (ePostProcMethod != POSTPROC_METHOD_RAW) {
+        g.nDiscreteGainPos = int(1.0f / (fPostProcScalar * g.fGainPos));
+        if (ePhaseMode == PHASE_MODE_DUAL)
+          g.nDiscreteGainNeg = int(1.0f / (fPostProcScalar * g.fGainNeg));
+      }
+    }
+
+    _postProcessBands(p, nThreads, bFused);
+  }
+
+} // end namespace
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
 // FUNCTION: initFromPython()
 // PURPOSE: Initialize logging data structures when we are
 // being called from python via ctypes as a dynamically 
@@ -2695,10 +3306,9 @@ void initFromPython(unsigned long long refP) {
 }
 #endif // INIT_FROM_PYTHON
 
-// FUNCTION: gaborCompute()
-// PURPOSE: GaborNode implementation
-NTA_EXPORT
-int  gaborCompute(const NUMPY_ARRAY * psGaborBank,
+// FUNCTION: _gaborCompute()
+// PURPOSE: GaborNode implementation, serial or parallel
+int  _gaborCompute(const NUMPY_ARRAY * psGaborBank,
                   const NUMPY_ARRAY * psInput,
                   const NUMPY_ARRAY * psAlpha,
                   const NUMPY_ARRAY * psBBox,
@@ -2719,7 +3329,9 @@ int  gaborCompute(const NUMPY_ARRAY * psGaborBank,
                   const NUMPY_ARRAY * psBufferIn,
                   const NUMPY_ARRAY * psBufferOut,
                   const NUMPY_ARRAY * psPostProcLUT,
-                  float fPostProcScalar
+                  float fPostProcScalar,
+                  bool bParallel,
+                  int nThreads
                  ) {
 
   // Allocate a big chunk of storage on the stack for a temporary buffer
@@ -2860,6 +3472,29 @@ int  gaborCompute(const NUMPY_ARRAY * psGaborBank,
                   eEdgeMode,
                   fOffImageFillValue);
 
+    //-------------------------------------------
+    // Parallel path: both passes below, split into
+    // tasks of one filter and one band of rows.
+    if (bParallel) {
+      _doConvolutionParallel(psBufferIn,
+                             psBufferOut,
+                             psGaborBank,
+                             psAlpha,
+                             &sBoxInput,
+                             &sBoxOutput,
+                             psOutput,
+                             fGainConstant,
+                             ePhaseMode,
+                             eNormalizeMethod,
+                             eNormalizeMode,
+                             ePhaseNormMode,
+                             ePostProcMethod,
+                             psPostProcLUT,
+                             fPostProcScalar,
+                             nThreads);
+      return 0;
+    }
+
     //-------------------------------------------
     // Perform convolution:
     // 1. Convolve integerized input image (in bufferIn) against
@@ -2915,6 +3550,77 @@ int  gaborCompute(const NUMPY_ARRAY * psGaborBank,
   return 0;
 }
 
+// FUNCTION: gaborCompute()
+// PURPOSE: GaborNode implementation
+NTA_EXPORT
+int  gaborCompute(const NUMPY_ARRAY * psGaborBank,
+                  const NUMPY_ARRAY * psInput,
+                  const NUMPY_ARRAY * psAlpha,
+                  const NUMPY_ARRAY * psBBox,
+                  const NUMPY_ARRAY * psImageBox,
+                  const NUMPY_ARRAY * psOutput,
+                  float fGainConstant,
+                  EDGE_MODE eEdgeMode,
+                  float fOffImageFillValue,
+                  PHASE_MODE ePhaseMode,
+                  NORMALIZE_METHOD eNormalizeMethod, 
+                  NORMALIZE_MODE eNormalizeMode, 
+                  PHASENORM_MODE ePhaseNormMode, 
+                  POSTPROC_METHOD ePostProcMethod,
+                  float fPostProcSlope,
+                  float fPostProcMidpoint,
+                  float fPostProcMin,
+                  float fPostProcMax,
+                  const NUMPY_ARRAY * psBufferIn,
+                  const NUMPY_ARRAY * psBufferOut,
+                  const NUMPY_ARRAY * psPostProcLUT,
+                  float fPostProcScalar
+                 ) {
+  return _gaborCompute(psGaborBank, psInput, psAlpha, psBBox, psImageBox,
+                       psOutput, fGainConstant, eEdgeMode, fOffImageFillValue,
+                       ePhaseMode, eNormalizeMethod, eNormalizeMode,
+                       ePhaseNormMode, ePostProcMethod, fPostProcSlope,
+                       fPostProcMidpoint, fPostProcMin, fPostProcMax,
+                       psBufferIn, psBufferOut, psPostProcLUT, fPostProcScalar,
+                       false, 1);
+}
+
+// FUNCTION: gaborComputeParallel()
+// PURPOSE: Same as gaborCompute(), on nThreads threads
+NTA_EXPORT
+int  gaborComputeParallel(const NUMPY_ARRAY * psGaborBank,
+                          const NUMPY_ARRAY * psInput,
+                          const NUMPY_ARRAY * psAlpha,
+                          const NUMPY_ARRAY * psBBox,
+                          const NUMPY_ARRAY * psImageBox,
+                          const NUMPY_ARRAY * psOutput,
+                          float fGainConstant,
+                          EDGE_MODE eEdgeMode,
+                          float fOffImageFillValue,
+                          PHASE_MODE ePhaseMode,
+                          NORMALIZE_METHOD eNormalizeMethod,
+                          NORMALIZE_MODE eNormalizeMode,
+                          PHASENORM_MODE ePhaseNormMode,
+                          POSTPROC_METHOD ePostProcMethod,
+                          float fPostProcSlope,
+                          float fPostProcMidpoint,
+                          float fPostProcMin,
+                          float fPostProcMax,
+                          const NUMPY_ARRAY * psBufferIn,
+                          const NUMPY_ARRAY * psBufferOut,
+                          const NUMPY_ARRAY * psPostProcLUT,
+                          float fPostProcScalar,
+                          int nThreads
+                         ) {
+  return _gaborCompute(psGaborBank, psInput, psAlpha, psBBox, psImageBox,
+                       psOutput, fGainConstant, eEdgeMode, fOffImageFillValue,
+                       ePhaseMode, eNormalizeMethod, eNormalizeMode,
+                       ePhaseNormMode, ePostProcMethod, fPostProcSlope,
+                       fPostProcMidpoint, fPostProcMin, fPostProcMax,
+                       psBufferIn, psBufferOut, psPostProcLUT, fPostProcScalar,
+                       true, nThreads);
+}
+
 #ifdef __cplusplus
 }
 #endif 
@@ -126,6 +126,37 @@ int  gaborCompute(const NUMPY_ARRAY * psGaborBank,
                   const NUMPY_ARRAY * psPostProcLUT,
                   float fPostProcScalar);
 
+// FUNCTION: gaborComputeParallel()
+// PURPOSE: Same as gaborCompute(), with the work split across filters
+// and bands of output rows, on nThreads threads (0 for the hardware
+// concurrency).  The outputs are exactly those of gaborCompute().
+// With NORMALIZE_METHOD_FIXED, the post-processing is fused into
+// the convolution, and psBufferOut is not written.
+NTA_EXPORT
+int  gaborComputeParallel(const NUMPY_ARRAY * psGaborBank,
+                          const NUMPY_ARRAY * psInput,
+                          const NUMPY_ARRAY * psAlpha,
+                          const NUMPY_ARRAY * psBBox,
+                          const NUMPY_ARRAY * psImageBox,
+                          const NUMPY_ARRAY * psOutput,
+                          float fGainConstant,
+                          EDGE_MODE eEdgeMode,
+                          float fOffImageFillValue,
+                          PHASE_MODE ePhaseMode,
+                          NORMALIZE_METHOD eNormalizeMethod,
+                          NORMALIZE_MODE eNormalizeMode,
+                          PHASENORM_MODE ePhaseNormMode,
+                          POSTPROC_METHOD ePostProcMethod,
+                          float fPostProcSlope,
+                          float fPostProcMidpoint,
+                          float fPostProcMin,
+                          float fPostProcMax,
+                          const NUMPY_ARRAY * psBufferIn,
+                          const NUMPY_ARRAY * psBufferOut,
+                          const NUMPY_ARRAY * psPostProcLUT,
+                          float fPostProcScalar,
+                          int nThreads);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,105 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Implementation of fixed-point permanences
+ */
+
+#include <nupic/algorithms/QuantizedPermanences.hpp>
+#include <nupic/utils/Log.hpp>
+
+using namespace std;
+using namespace nupic;
+using namespace nupic::algorithms;
+
+PermanenceQuantizer::PermanenceQuantizer(UInt bits)
+  : bits_(bits),
+    maxLevel_(bits == 0 ? 1 : (1u << bits) - 1)
+{
+  NTA_CHECK(bits == 0 || bits == 8 || bits == 16)
+    << "Permanences can be quantized to 8 or 16 bits, not " << bits;
+}
+
+QuantizedPermanenceRows::QuantizedPermanenceRows(UInt bits)
+  : quantizer_(bits)
+{
+  NTA_CHECK(bits == 8 || bits == 16)
+    << "Quantized permanence rows take 8 or 16 bits, not " << bits;
+}
+
+void QuantizedPermanenceRows::resize(UInt nRows)
+{
+  if (quantizer_.bits() == 8)
+    rows8_.resize(nRows);
+  else
+    rows16_.resize(nRows);
+}
+
+void QuantizedPermanenceRows::setRow(UInt row, const vector<UInt>& indices,
+                                     const Real32 dense[])
+{
+  if (quantizer_.bits() == 8)
+  {
+    vector<unsigned char>& levels = rows8_[row];
+    levels.resize(indices.size());
+    levels.shrink_to_fit();
+    for (size_t i = 0; i < indices.size(); i++)
+      levels[i] = (unsigned char) quantizer_.toLevel(dense[indices[i]]);
+  }
+  else
+  {
+    vector<UInt16>& levels = rows16_[row];
+    levels.resize(indices.size());
+    levels.shrink_to_fit();
+    for (size_t i = 0; i < indices.size(); i++)
+      levels[i] = (UInt16) quantizer_.toLevel(dense[indices[i]]);
+  }
+}
+
+void QuantizedPermanenceRows::getRow(UInt row, const vector<UInt>& indices,
+                                     Real32 dense[]) const
+{
+  if (quantizer_.bits() == 8)
+  {
+    const vector<unsigned char>& levels = rows8_[row];
+    NTA_ASSERT(levels.size() == indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      dense[indices[i]] = quantizer_.fromLevel(levels[i]);
+  }
+  else
+  {
+    const vector<UInt16>& levels = rows16_[row];
+    NTA_ASSERT(levels.size() == indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      dense[indices[i]] = quantizer_.fromLevel(levels[i]);
+  }
+}
+
+size_t QuantizedPermanenceRows::nBytes() const
+{
+  size_t n = 0;
+  for (const auto& levels : rows8_)
+    n += levels.capacity() * sizeof(unsigned char);
+  for (const auto& levels : rows16_)
+    n += levels.capacity() * sizeof(UInt16);
+  return n;
+}
@@ -0,0 +1,158 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Definitions for fixed-point permanences
+ */
+
+#ifndef NTA_QUANTIZED_PERMANENCES_HPP
+#define NTA_QUANTIZED_PERMANENCES_HPP
+
+#include <vector>
+
+#include <nupic/types/Types.hpp>
+
+namespace nupic
+{
+
+  namespace algorithms
+  {
+
+    /**
+     * Rounds permanences in [0, 1] to a fixed-point grid of 2^bits - 1
+     * steps.
+     *
+     * @b Description
+     * A permanence p is stored as the level floor(p * maxLevel + 0.5),
+     * clamped to [0, maxLevel], and read back as level / maxLevel. The
+     * rounding is deterministic, so a model gives the same results on
+     * every platform. Rounding the grid's own values gives them back
+     * unchanged.
+     *
+     * Each permanence is then within half a step of its float value:
+     * 0.002 with 8 bits, 0.0000077 with 16 bits. An increment added to a
+     * value on the grid acts as that increment rounded to a whole number
+     * of steps. With 8 bits, the default SpatialPooler increments
+     * become 0.051 (synPermActiveInc 0.05), 0.0078 (synPermInactiveDec
+     * 0.008) and 0.0118 (synPermBelowStimulusInc 0.01). An increment
+     * under half a step has no effect, so 8 bits only suits increments
+     * of at least 0.002. With 16 bits, the increments are within
+     * 0.0000077 of their float values.
+     *
+     * With 0 bits, the quantizer is disabled and round() returns its
+     * argument.
+     */
+    class PermanenceQuantizer
+    {
+    public:
+      /**
+       * @param bits 0 (disabled), 8 or 16.
+       */
+      PermanenceQuantizer(UInt bits = 0);
+
+      UInt bits() const { return bits_; }
+
+      bool enabled() const { return bits_ != 0; }
+
+      /**
+       * @retval The grid level nearest to permanence, clamped to the grid.
+       */
+      UInt32 toLevel(Real32 permanence) const
+      {
+        if (permanence <= 0)
+          return 0;
+        if (permanence >= 1)
+          return maxLevel_;
+        return (UInt32) (permanence * maxLevel_ + 0.5f);
+      }
+
+      Real32 fromLevel(UInt32 level) const
+      {
+        return (Real32) level / maxLevel_;
+      }
+
+      /**
+       * @retval The nearest permanence on the grid, or permanence if the
+       * quantizer is disabled.
+       */
+      Real32 round(Real32 permanence) const
+      {
+        return enabled() ? fromLevel(toLevel(permanence)) : permanence;
+      }
+
+    private:
+      UInt bits_;
+      UInt32 maxLevel_;
+    };
+
+    /**
+     * Per-row fixed-point permanences, stored at the positions of a
+     * separate index list per row, e.g. a SpatialPooler column's potential
+     * pool.
+     *
+     * @b Description
+     * Each row stores one 8- or 16-bit level per index, zeros included, and
+     * no indices of its own. A SparseMatrix<UInt, Real32> row takes 8 bytes
+     * per nonzero, so rows whose permanences are mostly nonzero take 4
+     * (16 bits) to 8 (8 bits) times less memory.
+     */
+    class QuantizedPermanenceRows
+    {
+    public:
+      /**
+       * @param bits 8 or 16.
+       */
+      QuantizedPermanenceRows(UInt bits = 16);
+
+      const PermanenceQuantizer& quantizer() const { return quantizer_; }
+
+      void resize(UInt nRows);
+
+      /**
+       * Stores dense[indices[i]] for each i, rounded to the grid.
+       */
+      void setRow(UInt row, const std::vector<UInt>& indices,
+                  const Real32 dense[]);
+
+      /**
+       * Writes the row's permanences to dense[indices[i]]. The other
+       * elements of dense are left as they are.
+       */
+      void getRow(UInt row, const std::vector<UInt>& indices,
+                  Real32 dense[]) const;
+
+      /**
+       * @retval Bytes taken by the stored levels.
+       */
+      size_t nBytes() const;
+
+    private:
+      PermanenceQuantizer quantizer_;
+      std::vector<std::vector<unsigned char> > rows8_;
+      std::vector<std::vector<UInt16> > rows16_;
+    };
+
+  } // end namespace algorithms
+
+} // end namespace nupic
+
+#endif // NTA_QUANTIZED_PERMANENCES_HPP
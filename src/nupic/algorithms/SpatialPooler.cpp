@@ -24,15 +24,18 @@
  * Implementation of SpatialPooler
  */
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <nupic/algorithms/SpatialPooler.hpp>
 #include <nupic/math/Math.hpp>
 #include <nupic/math/Topology.hpp>
 #include <nupic/proto/SpatialPoolerProto.capnp.h>
+#include <nupic/utils/ParallelFor.hpp>
 
 using namespace std;
 using namespace nupic;
@@ -41,6 +44,92 @@ using namespace nupic::math::topology;
 
 static const Real PERMANENCE_EPSILON = 0.000001;
 
+static bool isLittleEndian_()
+{
+  const UInt32 one = 1;
+  Byte first;
+  ::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+// Converts one Stored element between host and little-endian order, like
+// capnp does for the rest of the message.
+template <typename Stored>
+static void swapToLittleEndian_(Byte* bytes)
+{
+  static const bool littleEndian = isLittleEndian_();
+  if (!littleEndian)
+    std::reverse(bytes, bytes + sizeof(Stored));
+}
+
+// Copies n values to a capnp Data array of little-endian Stored elements,
+// starting at element offset; in one step when the types match on a
+// little-endian host.
+template <typename Stored, typename T>
+static void writeData_(const T* values, size_t n, capnp::Data::Builder data,
+                       size_t offset = 0)
+{
+  NTA_ASSERT((offset + n) * sizeof(Stored) <= data.size());
+  Byte* out = (Byte*) data.begin() + offset * sizeof(Stored);
+  if (std::is_same<Stored, T>::value && isLittleEndian_())
+  {
+    ::memcpy(out, values, n * sizeof(Stored));
+    return;
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    const Stored value = (Stored) values[i];
+    ::memcpy(out + i * sizeof(Stored), &value, sizeof(Stored));
+    swapToLittleEndian_<Stored>(out + i * sizeof(Stored));
+  }
+}
+
+template <typename Stored, typename T>
+static void writeData_(const vector<T>& values, capnp::Data::Builder data)
+{
+  writeData_<Stored>(values.data(), values.size(), data);
+}
+
+// Copies n little-endian Stored elements of a capnp Data array, starting
+// at element offset, to values.
+template <typename Stored, typename T>
+static void readData_(capnp::Data::Reader data, size_t offset, size_t n,
+                      T* values)
+{
+  NTA_ASSERT((offset + n) * sizeof(Stored) <= data.size());
+  const Byte* in = (const Byte*) data.begin() + offset * sizeof(Stored);
+  if (std::is_same<Stored, T>::value && isLittleEndian_())
+  {
+    ::memcpy(values, in, n * sizeof(Stored));
+    return;
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    Byte bytes[sizeof(Stored)];
+    ::memcpy(bytes, in + i * sizeof(Stored), sizeof(Stored));
+    swapToLittleEndian_<Stored>(bytes);
+    Stored value;
+    ::memcpy(&value, bytes, sizeof(Stored));
+    values[i] = (T) value;
+  }
+}
+
+// Returns the number of Stored elements in a capnp Data array
+template <typename Stored>
+static size_t dataSize_(capnp::Data::Reader data)
+{
+  NTA_CHECK(data.size() % sizeof(Stored) == 0)
+    << "Invalid SpatialPooler data size " << data.size();
+  return data.size() / sizeof(Stored);
+}
+
+template <typename Stored, typename T>
+static void readData_(capnp::Data::Reader data, vector<T>& values)
+{
+  values.resize(dataSize_<Stored>(data));
+  readData_<Stored>(data, 0, values.size(), values.data());
+}
+
 // MSVC doesn't provide round() which only became standard in C99 or C++11
 #if defined(NTA_COMPILER_MSVC)
   template<typename T>
@@ -80,7 +169,7 @@ class CoordinateConverterND
 {
 
   public:
-    CoordinateConverterND(vector<UInt>& dimensions)
+    CoordinateConverterND(const vector<UInt>& dimensions)
     {
       dimensions_ = dimensions;
       UInt b = 1;
@@ -118,7 +207,13 @@ class CoordinateConverterND
 SpatialPooler::SpatialPooler()
 {
   // The current version number.
-  version_ = 2;
+  version_ = 3;
+  permanenceBits_ = 0;
+  initMode_ = initSerial;
+  initThreads_ = 0;
+  initSeed_ = 0;
+  numPendingColumns_ = 0;
+  inhibitionRadiusSet_ = false;
 }
 
 SpatialPooler::SpatialPooler(vector<UInt> inputDimensions,
@@ -246,12 +341,17 @@ void SpatialPooler::setStimulusThreshold(UInt stimulusThreshold)
 
 UInt SpatialPooler::getInhibitionRadius() const
 {
+  if (!inhibitionRadiusSet_)
+  {
+    checkInitialized_("getInhibitionRadius");
+  }
   return inhibitionRadius_;
 }
 
 void SpatialPooler::setInhibitionRadius(UInt inhibitionRadius)
 {
   inhibitionRadius_ = inhibitionRadius;
+  inhibitionRadiusSet_ = true;
 }
 
 UInt SpatialPooler::getDutyCyclePeriod() const
@@ -314,6 +414,49 @@ void SpatialPooler::setWrapAround(bool wrapAround)
   wrapAround_ = wrapAround;
 }
 
+UInt SpatialPooler::getPermanenceBits() const
+{
+  return permanenceBits_;
+}
+
+void SpatialPooler::setPermanenceBits(UInt bits)
+{
+  NTA_CHECK(bits == 0 || bits == 8 || bits == 16)
+    << "Permanences can be quantized to 8 or 16 bits, not " << bits;
+  initializeColumns();
+
+  vector<vector<Real> > perms(numColumns_, vector<Real>(numInputs_, 0));
+  for (UInt i = 0; i < numColumns_; i++)
+  {
+    getPermanenceRow_(i, perms[i].data());
+  }
+
+  permanenceBits_ = bits;
+  permanences_.resize(0, 0);
+  permanences_.resize(numColumns_, numInputs_);
+  quantizedPermanences_ = QuantizedPermanenceRows(bits ? bits : 16);
+  if (bits)
+  {
+    quantizedPermanences_.resize(numColumns_);
+  }
+
+  for (UInt i = 0; i < numColumns_; i++)
+  {
+    updatePermanencesForColumn_(perms[i], i, false);
+  }
+}
+
+void SpatialPooler::setInitMode(InitMode mode, UInt nThreads)
+{
+  initMode_ = mode;
+  initThreads_ = nThreads;
+}
+
+SpatialPooler::InitMode SpatialPooler::getInitMode() const
+{
+  return initMode_;
+}
+
 UInt SpatialPooler::getUpdatePeriod() const
 {
   return updatePeriod_;
@@ -442,24 +585,38 @@ void SpatialPooler::setMinOverlapDutyCycles(Real minOverlapDutyCycles[])
 void SpatialPooler::getPotential(UInt column, UInt potential[]) const
 {
   NTA_ASSERT(column < numColumns_);
+  checkInitialized_(column, "getPotential");
   potentialPools_.getRow(column, &potential[0], &potential[numInputs_]);
 }
 
 void SpatialPooler::setPotential(UInt column, UInt potential[])
 {
   NTA_ASSERT(column < numColumns_);
+  initializeColumn_(column);
+  if (permanenceBits_ == 0)
+  {
+    potentialPools_.rowFromDense(column, &potential[0], &potential[numInputs_]);
+    return;
+  }
+
+  // The fixed-point permanences are stored along the potential pool.
+  vector<Real> perm(numInputs_, 0);
+  getPermanenceRow_(column, perm.data());
   potentialPools_.rowFromDense(column, &potential[0], &potential[numInputs_]);
+  updatePermanencesForColumn_(perm, column, false);
 }
 
 void SpatialPooler::getPermanence(UInt column, Real permanences[]) const
 {
   NTA_ASSERT(column < numColumns_);
-  permanences_.getRowToDense(column, permanences);
+  checkInitialized_(column, "getPermanence");
+  getPermanenceRow_(column, permanences);
 }
 
 void SpatialPooler::setPermanence(UInt column, Real permanences[])
 {
   NTA_ASSERT(column < numColumns_);
+  initializeColumn_(column);
   vector<Real> perm;
   perm.assign(&permanences[0],&permanences[numInputs_]);
   updatePermanencesForColumn_(perm, column, false);
@@ -469,12 +626,14 @@ void SpatialPooler::getConnectedSynapses(
     UInt column, UInt connectedSynapses[]) const
 {
   NTA_ASSERT(column < numColumns_);
+  checkInitialized_(column, "getConnectedSynapses");
   connectedSynapses_.getRow(column,&connectedSynapses[0],
                             &connectedSynapses[numInputs_]);
 }
 
 void SpatialPooler::getConnectedCounts(UInt connectedCounts[]) const
 {
+  checkInitialized_("getConnectedCounts");
   copy(connectedCounts_.begin(), connectedCounts_.end(), connectedCounts);
 }
 
@@ -565,6 +724,10 @@ void SpatialPooler::initialize(vector<UInt> inputDimensions,
 
   potentialPools_.resize(numColumns_, numInputs_);
   permanences_.resize(numColumns_, numInputs_);
+  if (permanenceBits_)
+  {
+    quantizedPermanences_.resize(numColumns_);
+  }
   connectedSynapses_.resize(numColumns_, numInputs_);
   connectedCounts_.resize(numColumns_);
 
@@ -577,16 +740,33 @@ void SpatialPooler::initialize(vector<UInt> inputDimensions,
   boostedOverlaps_.resize(numColumns_);
 
   inhibitionRadius_ = 0;
+  inhibitionRadiusSet_ = false;
 
-  for (UInt i = 0; i < numColumns_; ++i)
+  pendingColumns_.clear();
+  numPendingColumns_ = 0;
+  if (initMode_ == initSerial)
   {
-    vector<UInt> potential = mapPotential_(i, wrapAround_);
-    vector<Real> perm = initPermanence_(potential, initConnectedPct_);
-    potentialPools_.rowFromDense(i,potential.begin(),potential.end());
-    updatePermanencesForColumn_(perm,i,true);
-  }
+    for (UInt i = 0; i < numColumns_; ++i)
+    {
+      vector<UInt> potential = mapPotential_(i, wrapAround_);
+      vector<Real> perm = initPermanence_(potential, initConnectedPct_);
+      potentialPools_.rowFromDense(i,potential.begin(),potential.end());
+      updatePermanencesForColumn_(perm,i,true);
+    }
 
-  updateInhibitionRadius_();
+    updateInhibitionRadius_();
+  }
+  else
+  {
+    // The inhibition radius is set once every column is created
+    initSeed_ = rng_.getUInt32();
+    pendingColumns_.assign(numColumns_, true);
+    numPendingColumns_ = numColumns_;
+    if (initMode_ == initParallel)
+    {
+      initializeColumns();
+    }
+  }
 
   if (spVerbosity_ > 0)
   {
@@ -598,6 +778,7 @@ void SpatialPooler::initialize(vector<UInt> inputDimensions,
 void SpatialPooler::compute(UInt inputArray[], bool learn,
                             UInt activeArray[])
 {
+  initializeColumns();
   updateBookeepingVars_(learn);
   calculateOverlap_(inputArray, overlaps_);
   calculateOverlapPct_(overlaps_, overlapsPct_);
@@ -628,6 +809,57 @@ void SpatialPooler::compute(UInt inputArray[], bool learn,
   }
 }
 
+void SpatialPooler::computeSparse(const UInt inputIndices[],
+                                  UInt nInputIndices, bool learn,
+                                  vector<UInt>& activeColumns)
+{
+  for (UInt i = 0; i < nInputIndices; i++)
+  {
+    NTA_CHECK(inputIndices[i] < numInputs_)
+      << "Invalid input index: " << inputIndices[i];
+  }
+
+  sparseInput_.resize(numInputs_, 0);
+  sparseOutput_.resize(numColumns_);
+  for (UInt i = 0; i < nInputIndices; i++)
+  {
+    sparseInput_[inputIndices[i]] = 1;
+  }
+
+  auto clearInput = [&]()
+  {
+    for (UInt i = 0; i < nInputIndices; i++)
+    {
+      sparseInput_[inputIndices[i]] = 0;
+    }
+  };
+  try
+  {
+    SpatialPooler::compute(sparseInput_.data(), learn, sparseOutput_.data());
+  }
+  catch (...)
+  {
+    clearInput();
+    throw;
+  }
+  clearInput();
+
+  activeColumns.assign(activeColumns_.begin(), activeColumns_.end());
+  std::sort(activeColumns.begin(), activeColumns.end());
+}
+
+void SpatialPooler::infer(UInt inputArray[], UInt activeArray[],
+                          SpatialPoolerState& state) const
+{
+  // Creating the pending columns here would race with other threads
+  // running infer()
+  checkInitialized_("infer");
+  calculateOverlap_(inputArray, state.overlaps);
+  state.boostedOverlaps.assign(state.overlaps.begin(), state.overlaps.end());
+  inhibitColumns_(state.boostedOverlaps, state.activeColumns);
+  toDense_(state.activeColumns, activeArray, numColumns_);
+}
+
 void SpatialPooler::stripUnlearnedColumns(UInt activeArray[]) const
 {
   for (UInt i = 0; i < numColumns_; i++)
@@ -642,7 +874,7 @@ void SpatialPooler::stripUnlearnedColumns(UInt activeArray[]) const
 
 void SpatialPooler::toDense_(vector<UInt>& sparse,
                             UInt dense[],
-                            UInt n)
+                            UInt n) const
 {
   std::fill(dense,dense+n, 0);
   for (auto & elem : sparse)
@@ -661,7 +893,7 @@ void SpatialPooler::boostOverlaps_(vector<UInt>& overlaps,
   }
 }
 
-UInt SpatialPooler::mapColumn_(UInt column)
+UInt SpatialPooler::mapColumn_(UInt column) const
 {
   vector<UInt> columnCoords;
   CoordinateConverterND columnConv(columnDimensions_);
@@ -683,6 +915,21 @@ UInt SpatialPooler::mapColumn_(UInt column)
 }
 
 vector<UInt> SpatialPooler::mapPotential_(UInt column, bool wrapAround)
+{
+  vector<UInt> pool;
+  samplePotential_(column, wrapAround, rng_, pool);
+
+  vector<UInt> potential(numInputs_, 0);
+  for (UInt input : pool)
+  {
+    potential[input] = 1;
+  }
+
+  return potential;
+}
+
+void SpatialPooler::samplePotential_(UInt column, bool wrapAround,
+                                     Random& rng, vector<UInt>& pool) const
 {
   const UInt centerInput = mapColumn_(column);
 
@@ -706,59 +953,80 @@ vector<UInt> SpatialPooler::mapPotential_(UInt column, bool wrapAround)
 
   UInt numPotential = round(columnInputs.size() * potentialPct_);
 
-  vector<UInt> selectedInputs(numPotential, 0);
-  rng_.sample(&columnInputs.front(), columnInputs.size(),
-              &selectedInputs.front(), numPotential);
-
-  vector<UInt> potential(numInputs_, 0);
-  for (UInt input : selectedInputs)
-  {
-    potential[input] = 1;
-  }
-
-  return potential;
+  pool.assign(numPotential, 0);
+  rng.sample(&columnInputs.front(), columnInputs.size(),
+             &pool.front(), numPotential);
+  sort(pool.begin(), pool.end());
 }
 
 Real SpatialPooler::initPermConnected_()
+{
+  return initPermConnected_(rng_);
+}
+
+Real SpatialPooler::initPermConnected_(Random& rng) const
 {
   Real p = synPermConnected_ +
-           (synPermMax_ - synPermConnected_)*rng_.getReal64();
+           (synPermMax_ - synPermConnected_)*rng.getReal64();
 
   return round5_(p);
 }
 
 Real SpatialPooler::initPermNonConnected_()
 {
-  Real p = synPermConnected_ * rng_.getReal64();
+  return initPermNonConnected_(rng_);
+}
+
+Real SpatialPooler::initPermNonConnected_(Random& rng) const
+{
+  Real p = synPermConnected_ * rng.getReal64();
   return round5_(p);
 }
 
 vector<Real> SpatialPooler::initPermanence_(vector<UInt>& potential,
                                             Real connectedPct)
 {
-  vector<Real> perm(numInputs_, 0);
+  vector<UInt> pool;
   for (UInt i = 0; i < numInputs_; i++)
   {
-    if (potential[i] < 1)
+    if (potential[i] >= 1)
     {
-      continue;
+      pool.push_back(i);
     }
+  }
+
+  vector<Real> values;
+  samplePermanences_(pool, connectedPct, rng_, values);
+
+  vector<Real> perm(numInputs_, 0);
+  for (UInt i = 0; i < pool.size(); i++)
+  {
+    perm[pool[i]] = values[i];
+  }
+
+  return perm;
+}
 
-    if (rng_.getReal64() <= connectedPct)
+void SpatialPooler::samplePermanences_(const vector<UInt>& pool,
+                                       Real connectedPct, Random& rng,
+                                       vector<Real>& perm) const
+{
+  perm.resize(pool.size());
+  for (auto & p : perm)
+  {
+    if (rng.getReal64() <= connectedPct)
     {
-      perm[i] = initPermConnected_();
+      p = initPermConnected_(rng);
     }
     else
     {
-      perm[i] = initPermNonConnected_();
+      p = initPermNonConnected_(rng);
     }
-    perm[i] = perm[i] < synPermTrimThreshold_ ? 0 : perm[i];
+    p = p < synPermTrimThreshold_ ? 0 : p;
   }
-
-  return perm;
 }
 
-void SpatialPooler::clip_(vector<Real>& perm, bool trim=false)
+void SpatialPooler::clip_(vector<Real>& perm, bool trim=false) const
 {
   Real minVal = trim ? synPermTrimThreshold_ : synPermMin_;
   for (auto & elem : perm)
@@ -773,35 +1041,221 @@ void SpatialPooler::updatePermanencesForColumn_(vector<Real>& perm,
                                                 UInt column,
                                                 bool raisePerm)
 {
+  const vector<UInt>& potential = potentialPools_.getSparseRow(column);
   vector<UInt> connectedSparse;
+  preparePermanences_(perm, potential, raisePerm, connectedSparse);
 
-  UInt numConnected;
+  connectedSynapses_.replaceSparseRow(column, connectedSparse.begin(),
+                                      connectedSparse.end());
+  if (permanenceBits_)
+  {
+    quantizedPermanences_.setRow(column, potential, perm.data());
+  }
+  else
+  {
+    permanences_.setRowFromDense(column, perm);
+  }
+  connectedCounts_[column] = connectedSparse.size();
+}
+
+void SpatialPooler::preparePermanences_(vector<Real>& perm,
+                                        const vector<UInt>& potential,
+                                        bool raisePerm,
+                                        vector<UInt>& connected) const
+{
   if (raisePerm)
   {
-    vector<UInt> potential;
-    potential.resize(numInputs_);
-    potential = potentialPools_.getSparseRow(column);
-    raisePermanencesToThreshold_(perm,potential);
+    raisePermanencesToThreshold_(perm, potential);
+  }
+
+  // Round to the fixed-point grid first, so that the connected synapses
+  // match the stored permanences. Only the potential pool is stored.
+  if (permanenceBits_)
+  {
+    const PermanenceQuantizer& quantizer = quantizedPermanences_.quantizer();
+    vector<Real> rounded(perm.size(), 0);
+    for (UInt index : potential)
+    {
+      rounded[index] = quantizer.round(perm[index]);
+    }
+    perm.swap(rounded);
   }
 
-  numConnected = 0;
+  connected.clear();
   for (UInt i = 0; i < perm.size(); ++i)
   {
     if (perm[i] >= synPermConnected_ - PERMANENCE_EPSILON)
     {
-      connectedSparse.push_back(i);
-      ++numConnected;
+      connected.push_back(i);
     }
   }
 
   clip_(perm, true);
-  connectedSynapses_.replaceSparseRow(column, connectedSparse.begin(),
-                                      connectedSparse.end());
-  permanences_.setRowFromDense(column, perm);
-  connectedCounts_[column] = numConnected;
 }
 
-UInt SpatialPooler::countConnected_(vector<Real>& perm)
+UInt32 SpatialPooler::columnSeed_(UInt column) const
+{
+  // A bijection of the column index, so that every column has its own
+  // stream. Random only uses seeds below its MAX32, and not 0.
+  UInt32 seed = (UInt32) column * 0x9E3779B1u;
+  seed ^= seed >> 16;
+  seed ^= initSeed_;
+  return seed == 0 || seed == Random::MAX32 ? 1 : seed;
+}
+
+void SpatialPooler::initColumn_(UInt column, ColumnInit_& init,
+                                vector<Real>& perm) const
+{
+  Random rng(columnSeed_(column));
+  samplePotential_(column, wrapAround_, rng, init.potential);
+  samplePermanences_(init.potential, initConnectedPct_, rng,
+                     init.permValues);
+
+  perm.assign(numInputs_, 0);
+  for (UInt i = 0; i < init.potential.size(); i++)
+  {
+    perm[init.potential[i]] = init.permValues[i];
+  }
+  preparePermanences_(perm, init.potential, true, init.connected);
+
+  // Only the potential pool has permanences
+  init.permIndices.clear();
+  init.permValues.clear();
+  for (UInt index : init.potential)
+  {
+    if (perm[index] != 0)
+    {
+      init.permIndices.push_back(index);
+      init.permValues.push_back(perm[index]);
+    }
+  }
+}
+
+void SpatialPooler::storeColumn_(UInt column, const ColumnInit_& init,
+                                 vector<Real>& perm)
+{
+  potentialPools_.replaceSparseRow(column, init.potential.begin(),
+                                   init.potential.end());
+  connectedSynapses_.replaceSparseRow(column, init.connected.begin(),
+                                      init.connected.end());
+  connectedCounts_[column] = init.connected.size();
+
+  if (permanenceBits_)
+  {
+    perm.assign(numInputs_, 0);
+    for (UInt i = 0; i < init.permIndices.size(); i++)
+    {
+      perm[init.permIndices[i]] = init.permValues[i];
+    }
+    quantizedPermanences_.setRow(column, init.potential, perm.data());
+  }
+  else
+  {
+    permanences_.setRowFromSparse(column, init.permIndices.begin(),
+                                  init.permIndices.end(),
+                                  init.permValues.begin());
+  }
+}
+
+void SpatialPooler::initializeColumns()
+{
+  if (numPendingColumns_ == 0)
+  {
+    return;
+  }
+
+  vector<UInt> columns;
+  columns.reserve(numPendingColumns_);
+  for (UInt i = 0; i < numColumns_; i++)
+  {
+    if (pendingColumns_[i])
+    {
+      columns.push_back(i);
+    }
+  }
+
+  // The columns are drawn on the worker threads a chunk at a time, and
+  // stored on this one.
+  const size_t nThreads = parallelThreads(columns.size(), initThreads_);
+  const size_t chunk = 256 * nThreads;
+  vector<ColumnInit_> inits(min(chunk, columns.size()));
+  vector<Real> perm;
+  for (size_t begin = 0; begin < columns.size(); begin += chunk)
+  {
+    const size_t n = min(chunk, columns.size() - begin);
+    parallelForShards(n, nThreads, [&](size_t first, size_t last)
+    {
+      vector<Real> scratch;
+      for (size_t i = first; i < last; i++)
+      {
+        initColumn_(columns[begin + i], inits[i], scratch);
+      }
+    });
+    for (size_t i = 0; i < n; i++)
+    {
+      storeColumn_(columns[begin + i], inits[i], perm);
+    }
+  }
+
+  pendingColumns_.clear();
+  numPendingColumns_ = 0;
+  if (!inhibitionRadiusSet_)
+  {
+    updateInhibitionRadius_();
+  }
+}
+
+void SpatialPooler::initializeColumn_(UInt column)
+{
+  if (numPendingColumns_ == 0 || !pendingColumns_[column])
+  {
+    return;
+  }
+
+  ColumnInit_ init;
+  vector<Real> perm;
+  initColumn_(column, init, perm);
+  storeColumn_(column, init, perm);
+  pendingColumns_[column] = false;
+  if (--numPendingColumns_ == 0)
+  {
+    pendingColumns_.clear();
+    if (!inhibitionRadiusSet_)
+    {
+      updateInhibitionRadius_();
+    }
+  }
+}
+
+void SpatialPooler::checkInitialized_(const char* method) const
+{
+  NTA_CHECK(numPendingColumns_ == 0)
+    << "SpatialPooler::" << method << ": " << numPendingColumns_
+    << " columns are still pending; call initializeColumns() first";
+}
+
+void SpatialPooler::checkInitialized_(UInt column, const char* method) const
+{
+  NTA_CHECK(numPendingColumns_ == 0 || !pendingColumns_[column])
+    << "SpatialPooler::" << method << ": column " << column
+    << " is still pending; call initializeColumns() first";
+}
+
+void SpatialPooler::getPermanenceRow_(UInt column, Real perm[]) const
+{
+  if (permanenceBits_)
+  {
+    std::fill(perm, perm + numInputs_, (Real) 0);
+    quantizedPermanences_.getRow(column, potentialPools_.getSparseRow(column),
+                                 perm);
+  }
+  else
+  {
+    permanences_.getRowToDense(column, perm);
+  }
+}
+
+UInt SpatialPooler::countConnected_(vector<Real>& perm) const
 {
   UInt numConnected = 0;
   for (auto & elem : perm)
@@ -814,8 +1268,8 @@ UInt SpatialPooler::countConnected_(vector<Real>& perm)
   return numConnected;
 }
 
-UInt SpatialPooler::raisePermanencesToThreshold_(vector<Real>& perm,
-                                                 vector<UInt>& potential)
+UInt SpatialPooler::raisePermanencesToThreshold_(
+  vector<Real>& perm, const vector<UInt>& potential) const
 {
   clip_(perm, false);
   UInt numConnected;
@@ -1043,7 +1497,7 @@ void SpatialPooler::adaptSynapses_(UInt inputVector[],
     vector <Real> perm(numInputs_, 0);
     potential.resize(potentialPools_.nNonZerosOnRow(i));
     potential = potentialPools_.getSparseRow(column);
-    permanences_.getRowToDense(column, perm);
+    getPermanenceRow_(column, perm.data());
     for (auto & elem : potential)
     {
         UInt index = elem;
@@ -1065,7 +1519,7 @@ void SpatialPooler::bumpUpWeakColumns_()
     vector<UInt> potential;
     potential.resize(potentialPools_.nNonZerosOnRow(i));
     potential = potentialPools_.getSparseRow(i);
-    permanences_.getRowToDense(i, perm);
+    getPermanenceRow_(i, perm.data());
     for (auto & elem : potential)
     {
       UInt index = elem;
@@ -1165,7 +1619,7 @@ void SpatialPooler::updateBookeepingVars_(bool learn)
 }
 
 void SpatialPooler::calculateOverlap_(UInt inputVector[],
-                                      vector<UInt>& overlaps)
+                                      vector<UInt>& overlaps) const
 {
   overlaps.assign(numColumns_,0);
   connectedSynapses_.rightVecSumAtNZ(inputVector,inputVector+numInputs_,
@@ -1193,7 +1647,7 @@ void SpatialPooler::calculateOverlapPct_(vector<UInt>& overlaps,
 
 void SpatialPooler::inhibitColumns_(
   const vector<Real>& overlaps,
-  vector<UInt>& activeColumns)
+  vector<UInt>& activeColumns) const
 {
   Real density = localAreaDensity_;
   if (numActiveColumnsPerInhArea_ > 0)
@@ -1218,7 +1672,7 @@ void SpatialPooler::inhibitColumns_(
 }
 
 bool SpatialPooler::isWinner_(Real score, vector<pair<UInt, Real> >& winners,
-                              UInt numWinners)
+                              UInt numWinners) const
 {
   if (score < stimulusThreshold_)
   {
@@ -1239,7 +1693,7 @@ bool SpatialPooler::isWinner_(Real score, vector<pair<UInt, Real> >& winners,
 }
 
 void SpatialPooler::addToWinners_(UInt index, Real score,
-                                  vector<pair<UInt, Real> >& winners)
+                                  vector<pair<UInt, Real> >& winners) const
 {
   pair<UInt, Real> val = make_pair(index, score);
   for (auto it = winners.begin();
@@ -1257,7 +1711,7 @@ void SpatialPooler::addToWinners_(UInt index, Real score,
 void SpatialPooler::inhibitColumnsGlobal_(
   const vector<Real>& overlaps,
   Real density,
-  vector<UInt>& activeColumns)
+  vector<UInt>& activeColumns) const
 {
   activeColumns.clear();
   const UInt numDesired = (UInt) (density * numColumns_);
@@ -1281,7 +1735,7 @@ void SpatialPooler::inhibitColumnsGlobal_(
 void SpatialPooler::inhibitColumnsLocal_(
   const vector<Real>& overlaps,
   Real density,
-  vector<UInt>& activeColumns)
+  vector<UInt>& activeColumns) const
 {
   activeColumns.clear();
 
@@ -1375,6 +1829,7 @@ static void saveFloat_(ostream& outStream, FloatType v)
 
 void SpatialPooler::save(ostream& outStream) const
 {
+  checkInitialized_("save");
   // Write a starting marker and version.
   outStream << "SpatialPooler" << endl;
   outStream << version_ << endl;
@@ -1413,6 +1868,7 @@ void SpatialPooler::save(ostream& outStream) const
   saveFloat_(outStream, minPctOverlapDutyCycles_);
 
   outStream << wrapAround_ << " "
+            << permanenceBits_ << " "
             << endl;
 
   // Store vectors.
@@ -1476,12 +1932,19 @@ void SpatialPooler::save(ostream& outStream) const
   }
   outStream << endl;
 
+  vector<Real> dense(numInputs_);
   for (UInt i = 0; i < numColumns_; i++)
   {
+    getPermanenceRow_(i, dense.data());
     vector<pair<UInt, Real> > perm;
-    perm.resize(permanences_.nNonZerosOnRow(i));
+    for (UInt j = 0; j < numInputs_; j++)
+    {
+      if (dense[j] != 0)
+      {
+        perm.push_back(make_pair(j, dense[j]));
+      }
+    }
     outStream << perm.size() << endl;
-    permanences_.getRowToSparse(i, perm.begin());
     for (auto & elem : perm)
     {
       outStream << elem.first << " ";
@@ -1502,7 +1965,10 @@ void SpatialPooler::save(ostream& outStream) const
 void SpatialPooler::load(istream& inStream)
 {
   // Current version
-  version_ = 2;
+  version_ = 3;
+  pendingColumns_.clear();
+  numPendingColumns_ = 0;
+  inhibitionRadiusSet_ = false;
 
   // Check the marker
   string marker;
@@ -1549,6 +2015,17 @@ void SpatialPooler::load(istream& inStream)
   {
     inStream >> wrapAround_;
   }
+  permanenceBits_ = 0;
+  if (version >= 3)
+  {
+    inStream >> permanenceBits_;
+    NTA_CHECK(permanenceBits_ == 0 || permanenceBits_ == 8 ||
+              permanenceBits_ == 16);
+  }
+  if (permanenceBits_)
+  {
+    quantizedPermanences_ = QuantizedPermanenceRows(permanenceBits_);
+  }
 
   // Retrieve vectors.
   UInt numInputDimensions;
@@ -1613,6 +2090,10 @@ void SpatialPooler::load(istream& inStream)
   }
 
   permanences_.resize(numColumns_, numInputs_);
+  if (permanenceBits_)
+  {
+    quantizedPermanences_.resize(numColumns_);
+  }
   connectedSynapses_.resize(numColumns_, numInputs_);
   connectedCounts_.resize(numColumns_);
   for (UInt i = 0; i < numColumns_; i++)
@@ -1645,6 +2126,7 @@ void SpatialPooler::load(istream& inStream)
 
 void SpatialPooler::write(SpatialPoolerProto::Builder& proto) const
 {
+  checkInitialized_("write");
   auto random = proto.initRandom();
   rng_.write(random);
   proto.setNumInputs(numInputs_);
@@ -1688,52 +2170,104 @@ void SpatialPooler::write(SpatialPoolerProto::Builder& proto) const
   proto.setIterationNum(iterationNum_);
   proto.setIterationLearnNum(iterationLearnNum_);
 
-  auto potentialPools = proto.initPotentialPools();
-  potentialPools.setNumRows(numColumns_);
-  potentialPools.setNumColumns(numInputs_);
-  auto potentialPoolIndices = potentialPools.initIndices(numColumns_);
+  proto.setPermanenceBits(permanenceBits_);
+  proto.setColumnsFormat(1);
+  auto columns = proto.initColumns();
+
+  // Each matrix is stored as row starts, then the indices and values of
+  // all rows, written in place one row at a time.
+  vector<UInt> rowStarts(numColumns_ + 1, 0);
   for (UInt i = 0; i < numColumns_; ++i)
   {
-    auto & pot = potentialPools_.getSparseRow(i);
-    auto indices = potentialPoolIndices.init(i, pot.size());
-    for (UInt j = 0; j < pot.size(); ++j)
-    {
-      indices.set(j, pot[j]);
-    }
+    rowStarts[i + 1] = rowStarts[i] + potentialPools_.getSparseRow(i).size();
   }
-
-  auto permanences = proto.initPermanences();
-  permanences_.write(permanences);
-
-  auto tieBreaker = proto.initTieBreaker(numColumns_);
+  writeData_<UInt32>(rowStarts, columns.initPotentialPoolRowStarts(
+                                  rowStarts.size() * sizeof(UInt32)));
+  auto potentialIndices = columns.initPotentialPoolIndices(
+    rowStarts.back() * sizeof(UInt32));
   for (UInt i = 0; i < numColumns_; ++i)
   {
-    tieBreaker.set(i, tieBreaker_[i]);
+    const vector<UInt>& pot = potentialPools_.getSparseRow(i);
+    writeData_<UInt32>(pot.data(), pot.size(), potentialIndices,
+                       rowStarts[i]);
   }
 
-  auto overlapDutyCycles = proto.initOverlapDutyCycles(numColumns_);
-  for (UInt i = 0; i < numColumns_; ++i)
+  if (permanenceBits_)
   {
-    overlapDutyCycles.set(i, overlapDutyCycles_[i]);
+    // Only the non-zero permanences of the potential pool are stored
+    vector<Real> perm(numInputs_);
+    for (UInt i = 0; i < numColumns_; ++i)
+    {
+      const vector<UInt>& pot = potentialPools_.getSparseRow(i);
+      quantizedPermanences_.getRow(i, pot, perm.data());
+      UInt n = 0;
+      for (UInt index : pot)
+      {
+        n += perm[index] != 0;
+      }
+      rowStarts[i + 1] = rowStarts[i] + n;
+    }
   }
-
-  auto activeDutyCycles = proto.initActiveDutyCycles(numColumns_);
-  for (UInt i = 0; i < numColumns_; ++i)
+  else
   {
-    activeDutyCycles.set(i, activeDutyCycles_[i]);
+    for (UInt i = 0; i < numColumns_; ++i)
+    {
+      rowStarts[i + 1] = rowStarts[i] + permanences_.nNonZerosOnRow(i);
+    }
   }
+  writeData_<UInt32>(rowStarts, columns.initPermanenceRowStarts(
+                                  rowStarts.size() * sizeof(UInt32)));
+  auto permanenceIndices = columns.initPermanenceIndices(
+    rowStarts.back() * sizeof(UInt32));
+  auto permanenceValues = columns.initPermanenceValues(
+    rowStarts.back() * sizeof(Real32));
 
-  auto minOverlapDutyCycles = proto.initMinOverlapDutyCycles(numColumns_);
-  for (UInt i = 0; i < numColumns_; ++i)
+  if (permanenceBits_)
   {
-    minOverlapDutyCycles.set(i, minOverlapDutyCycles_[i]);
+    vector<Real> perm(numInputs_);
+    vector<UInt> rowIndices;
+    vector<Real> rowValues;
+    for (UInt i = 0; i < numColumns_; ++i)
+    {
+      const vector<UInt>& pot = potentialPools_.getSparseRow(i);
+      quantizedPermanences_.getRow(i, pot, perm.data());
+      rowIndices.clear();
+      rowValues.clear();
+      for (UInt index : pot)
+      {
+        if (perm[index] != 0)
+        {
+          rowIndices.push_back(index);
+          rowValues.push_back(perm[index]);
+        }
+      }
+      writeData_<UInt32>(rowIndices.data(), rowIndices.size(),
+                         permanenceIndices, rowStarts[i]);
+      writeData_<Real32>(rowValues.data(), rowValues.size(),
+                         permanenceValues, rowStarts[i]);
+    }
   }
-
-  auto boostFactors = proto.initBoostFactors(numColumns_);
-  for (UInt i = 0; i < numColumns_; ++i)
+  else
   {
-    boostFactors.set(i, boostFactors_[i]);
+    for (UInt i = 0; i < numColumns_; ++i)
+    {
+      const UInt n = permanences_.nNonZerosOnRow(i);
+      writeData_<UInt32>(permanences_.row_nz_index_begin(i), n,
+                         permanenceIndices, rowStarts[i]);
+      writeData_<Real32>(permanences_.row_nz_value_begin(i), n,
+                         permanenceValues, rowStarts[i]);
+    }
   }
+
+  const UInt columnBytes = numColumns_ * sizeof(Real32);
+  writeData_<Real32>(tieBreaker_, columns.initTieBreaker(columnBytes));
+  writeData_<Real32>(overlapDutyCycles_,
+                      columns.initOverlapDutyCycles(columnBytes));
+  writeData_<Real32>(activeDutyCycles_,
+                      columns.initActiveDutyCycles(columnBytes));
+  writeData_<Real32>(minOverlapDutyCycles_,
+                      columns.initMinOverlapDutyCycles(columnBytes));
+  writeData_<Real32>(boostFactors_, columns.initBoostFactors(columnBytes));
 }
 
 // Implementation note: this method sets up the instance using data from
@@ -1741,6 +2275,9 @@ void SpatialPooler::write(SpatialPoolerProto::Builder& proto) const
 // that everything in initialize is handled properly here.
 void SpatialPooler::read(SpatialPoolerProto::Reader& proto)
 {
+  pendingColumns_.clear();
+  numPendingColumns_ = 0;
+  inhibitionRadiusSet_ = false;
   auto randomProto = proto.getRandom();
   rng_.read(randomProto);
   numInputs_ = proto.getNumInputs();
@@ -1785,12 +2322,43 @@ void SpatialPooler::read(SpatialPoolerProto::Reader& proto)
   iterationNum_ = proto.getIterationNum();
   iterationLearnNum_ = proto.getIterationLearnNum();
 
-  auto potentialPoolsProto = proto.getPotentialPools();
-  potentialPools_.read(potentialPoolsProto);
+  permanenceBits_ = proto.getPermanenceBits();
+  NTA_CHECK(permanenceBits_ == 0 || permanenceBits_ == 8 ||
+            permanenceBits_ == 16);
+  if (permanenceBits_)
+  {
+    quantizedPermanences_ = QuantizedPermanenceRows(permanenceBits_);
+    quantizedPermanences_.resize(numColumns_);
+  }
 
   connectedSynapses_.resize(numColumns_, numInputs_);
   connectedCounts_.resize(numColumns_);
 
+  switch (proto.getColumnsFormat())
+  {
+  case 0:
+    readColumnLists_(proto);
+    break;
+  case 1:
+    readColumns_(proto.getColumns());
+    break;
+  default:
+    NTA_THROW << "Unsupported SpatialPooler columns format "
+              << (UInt) proto.getColumnsFormat();
+  }
+
+  // Initialize ephemerals
+  overlaps_.resize(numColumns_);
+  overlapsPct_.resize(numColumns_);
+  boostedOverlaps_.resize(numColumns_);
+}
+
+// Reads the per-column data of the lists format (columnsFormat 0)
+void SpatialPooler::readColumnLists_(SpatialPoolerProto::Reader& proto)
+{
+  auto potentialPoolsProto = proto.getPotentialPools();
+  potentialPools_.read(potentialPoolsProto);
+
   // since updatePermanencesForColumn_, used below for initialization, is
   // used elsewhere and necessarily updates permanences_, there is no need
   // to additionally call the read function on permanences_
@@ -1836,11 +2404,107 @@ void SpatialPooler::read(SpatialPoolerProto::Reader& proto)
   {
     boostFactors_.push_back(value);
   }
+}
 
-  // Initialize ephemerals
-  overlaps_.resize(numColumns_);
-  overlapsPct_.resize(numColumns_);
-  boostedOverlaps_.resize(numColumns_);
+// Reads the per-column data of the arrays format (columnsFormat 1)
+void SpatialPooler::readColumns_(SpatialPoolerProto::Columns::Reader columns)
+{
+  // The rows are copied out one at a time, through these
+  vector<UInt> rowStarts, rowIndices, connected;
+  vector<Real> rowValues;
+
+  auto potentialIndices = columns.getPotentialPoolIndices();
+  readData_<UInt32>(columns.getPotentialPoolRowStarts(), rowStarts);
+  checkRowStarts_(rowStarts, dataSize_<UInt32>(potentialIndices));
+  potentialPools_.resize(numColumns_, numInputs_);
+  for (UInt i = 0; i < numColumns_; ++i)
+  {
+    rowIndices.resize(rowStarts[i + 1] - rowStarts[i]);
+    readData_<UInt32>(potentialIndices, rowStarts[i], rowIndices.size(),
+                      rowIndices.data());
+    for (UInt index : rowIndices)
+    {
+      NTA_CHECK(index < numInputs_);
+    }
+    potentialPools_.replaceSparseRow(i, rowIndices.begin(), rowIndices.end());
+  }
+
+  auto permanenceIndices = columns.getPermanenceIndices();
+  auto permanenceValues = columns.getPermanenceValues();
+  readData_<UInt32>(columns.getPermanenceRowStarts(), rowStarts);
+  checkRowStarts_(rowStarts, dataSize_<UInt32>(permanenceIndices));
+  NTA_CHECK(dataSize_<Real32>(permanenceValues) == rowStarts.back());
+
+  // The permanences were written from a spatial pooler, so they are
+  // already clipped (and on the grid with permanenceBits_): they are
+  // stored as they are.
+  permanences_.resize(numColumns_, numInputs_);
+  vector<Real> perm(permanenceBits_ ? numInputs_ : 0, 0);
+  for (UInt i = 0; i < numColumns_; ++i)
+  {
+    const UInt n = rowStarts[i + 1] - rowStarts[i];
+    rowIndices.resize(n);
+    rowValues.resize(n);
+    readData_<UInt32>(permanenceIndices, rowStarts[i], n, rowIndices.data());
+    readData_<Real32>(permanenceValues, rowStarts[i], n, rowValues.data());
+
+    connected.clear();
+    for (UInt j = 0; j < n; ++j)
+    {
+      NTA_CHECK(rowIndices[j] < numInputs_);
+      if (rowValues[j] >= synPermConnected_ - PERMANENCE_EPSILON)
+      {
+        connected.push_back(rowIndices[j]);
+      }
+    }
+    connectedSynapses_.replaceSparseRow(i, connected.begin(),
+                                        connected.end());
+    connectedCounts_[i] = connected.size();
+
+    if (permanenceBits_)
+    {
+      const vector<UInt>& pot = potentialPools_.getSparseRow(i);
+      for (UInt index : pot)
+      {
+        perm[index] = 0;
+      }
+      for (UInt j = 0; j < n; ++j)
+      {
+        perm[rowIndices[j]] = rowValues[j];
+      }
+      quantizedPermanences_.setRow(i, pot, perm.data());
+    }
+    else
+    {
+      permanences_.setRowFromSparse(i, rowIndices.begin(), rowIndices.end(),
+                                    rowValues.begin());
+    }
+  }
+
+  readData_<Real32>(columns.getTieBreaker(), tieBreaker_);
+  readData_<Real32>(columns.getOverlapDutyCycles(), overlapDutyCycles_);
+  readData_<Real32>(columns.getActiveDutyCycles(), activeDutyCycles_);
+  readData_<Real32>(columns.getMinOverlapDutyCycles(),
+                     minOverlapDutyCycles_);
+  readData_<Real32>(columns.getBoostFactors(), boostFactors_);
+  NTA_CHECK(tieBreaker_.size() == numColumns_ &&
+            overlapDutyCycles_.size() == numColumns_ &&
+            activeDutyCycles_.size() == numColumns_ &&
+            minOverlapDutyCycles_.size() == numColumns_ &&
+            boostFactors_.size() == numColumns_);
+}
+
+void SpatialPooler::checkRowStarts_(const vector<UInt>& rowStarts,
+                                    size_t nElements) const
+{
+  NTA_CHECK(rowStarts.size() == numColumns_ + 1 && rowStarts[0] == 0 &&
+            rowStarts.back() == nElements)
+    << "Invalid SpatialPooler row starts";
+  for (UInt i = 0; i < numColumns_; ++i)
+  {
+    NTA_CHECK(rowStarts[i] <= rowStarts[i + 1])
+      << "Invalid SpatialPooler row starts";
+  }
 }
 
 //----------------------------------------------------------------------
@@ -32,6 +32,7 @@
 #include <string>
 #include <vector>
 #include <capnp/message.h>
+#include <nupic/algorithms/QuantizedPermanences.hpp>
 #include <nupic/math/SparseBinaryMatrix.hpp>
 #include <nupic/math/SparseMatrix.hpp>
 #include <nupic/proto/SpatialPoolerProto.capnp.h>
@@ -47,6 +48,21 @@ namespace nupic
     namespace spatial_pooler
     {
 
+      /**
+       * The state of one input stream of a SpatialPooler that only does
+       * inference (see SpatialPooler::infer).
+       *
+       * After learning stops, only these vectors change from one input to
+       * the next. Many streams can share the same SpatialPooler, and run in
+       * parallel, each with a SpatialPoolerState of its own.
+       */
+      struct SpatialPoolerState
+      {
+        vector<UInt> overlaps;
+        vector<Real> boostedOverlaps;
+        vector<UInt> activeColumns;
+      };
+
       /**
        * CLA spatial pooler implementation in C++.
        *
@@ -268,6 +284,56 @@ namespace nupic
           virtual void compute(UInt inputVector[], bool learn,
                                UInt activeVector[]);
 
+          /**
+          Same as compute(), with the input and the output given as the
+          indices of their active bits. The input is scattered into a
+          scratch vector kept by the spatial pooler, and the output is
+          read from the inhibition result, so the caller needs no dense
+          arrays and no array is allocated once the scratch exists.
+
+          @param inputIndices The indices of the active input bits, each
+                less than getNumInputs(). They are checked before anything
+                is computed.
+
+          @param nInputIndices The number of indices in inputIndices.
+
+          @param learn As for compute().
+
+          @param activeColumns Receives the indices of the active columns,
+                in increasing order.
+           */
+          void computeSparse(const UInt inputIndices[], UInt nInputIndices,
+                             bool learn, vector<UInt>& activeColumns);
+
+          /**
+          Computes the active columns of an input without learning, as
+          compute() with learn set to false, but keeping the results in
+          state rather than in the spatial pooler.
+
+          The spatial pooler isn't modified, so any number of threads may
+          call infer() on the same spatial pooler at once, each with its
+          own state, as long as no thread calls compute() or changes the
+          spatial pooler meanwhile. Unlike compute(), infer() doesn't
+          count the iterations.
+
+          With initLazy, infer() doesn't create pending columns, since
+          that would modify the spatial pooler: call initializeColumns()
+          or compute() first.
+
+          @throws if columns are still pending with initLazy.
+
+          @param inputVector The input, as for compute().
+
+          @param activeVector The active columns, as for compute().
+
+          @param state The state of the input stream: its overlaps,
+                boosted overlaps and active columns, as given by
+                getOverlaps(), getBoostedOverlaps() and compute() for
+                the spatial pooler itself.
+           */
+          void infer(UInt inputVector[], UInt activeVector[],
+                     SpatialPoolerState& state) const;
+
           /**
            Removes the set of columns who have never been active from the set
            of active columns selected in the inhibition round. Such columns
@@ -534,6 +600,89 @@ namespace nupic
           */
           void setWrapAround(bool wrapAround);
 
+          /**
+          Returns the permanence resolution.
+
+          @returns 0 for float permanences, or 8 or 16 for fixed-point
+          permanences.
+          */
+          UInt getPermanenceBits() const;
+
+          /**
+          Sets the permanence resolution, converting the current
+          permanences. Fixed-point permanences are rounded to 2^bits - 1
+          steps in [0, 1], and stored as one 8- or 16-bit value per
+          potential synapse rather than a float and an index per nonzero
+          permanence. The permanence storage takes 4 (16 bits) to 8 (8 bits)
+          times less memory; the whole SpatialPooler about 2 times less.
+
+          The increments then act as rounded to whole steps, see
+          PermanenceQuantizer for the accuracy. Permanences outside the
+          potential pool aren't stored, so setPermanence drops them, and
+          setPotential zeroes the permanences of inputs leaving the pool.
+
+          @param bits 0, 8 or 16.
+          */
+          void setPermanenceBits(UInt bits);
+
+          /**
+          How initialize() creates the potential pools and permanences of
+          the columns.
+
+          initSerial draws every column from the pooler's random number
+          generator, one after the other, as earlier versions did.
+
+          initParallel draws each column from its own random stream,
+          seeded from the pooler's seed and the column index, on worker
+          threads. The columns don't depend on the number of threads.
+
+          initLazy creates the same columns as initParallel, but only when
+          they are first needed: setPotential() and setPermanence() create
+          their column, and setPermanenceBits() and compute(), on its
+          first call, create all the pending columns. The const methods reading the columns, such as
+          getPotential(), getPermanence(), getConnectedSynapses(),
+          getConnectedCounts(), getInhibitionRadius(), save(), write() and
+          infer(), never create them, since they may run on several
+          threads at once: they throw while the columns they read are
+          pending. Call initializeColumns() before using them.
+
+          A pending column is drawn with the parameters in effect when it
+          is created, so setters called after initialize(), such as
+          setPotentialRadius(), setPotentialPct(), setWrapAround(),
+          setStimulusThreshold(), setSynPermConnected() or setSynPermMax(),
+          change the columns still pending. The inhibition radius is
+          computed once every column is created, unless
+          setInhibitionRadius() was called in the meantime.
+          */
+          enum InitMode
+          {
+            initSerial,
+            initParallel,
+            initLazy
+          };
+
+          /**
+          Sets how the next initialize() creates the columns.
+
+          With initLazy, call initializeColumns() (or compute()) before
+          infer() and the const accessors of the columns.
+
+          @param mode The InitMode.
+          @param nThreads Worker threads for initParallel and initLazy, or
+          0 for the hardware concurrency.
+          */
+          void setInitMode(InitMode mode, UInt nThreads = 0);
+
+          InitMode getInitMode() const;
+
+          /**
+          Creates the columns still pending with initLazy, on worker
+          threads. compute() calls it on its first call. Call it before
+          infer(), the const accessors of the columns, save() and
+          write(), which throw while columns are pending.
+          */
+          void initializeColumns();
+
           /**
           Returns the update period.
 
@@ -794,7 +943,7 @@ namespace nupic
 
           void toDense_(vector<UInt>& sparse,
                         UInt dense[],
-                        UInt n);
+                        UInt n) const;
 
           void boostOverlaps_(vector<UInt>& overlaps,
                               vector<Real>& boostedOverlaps);
@@ -819,7 +968,7 @@ namespace nupic
             @param wrapAround  A boolean value indicating that boundaries should be
                                ignored.
           */
-          UInt mapColumn_(UInt column);
+          UInt mapColumn_(UInt column) const;
 
           /**
             Maps a column to its input bits.
@@ -852,6 +1001,15 @@ namespace nupic
           */
           vector<UInt> mapPotential_(UInt column, bool wrapAround);
 
+          /**
+          Samples the potential pool of a column from rng, as mapPotential_
+          does.
+
+          @param pool Set to the indices of the pool's inputs, ascending.
+          */
+          void samplePotential_(UInt column, bool wrapAround, Random& rng,
+                                vector<UInt>& pool) const;
+
           /**
           Returns a randomly generated permanence value for a synapses that is
           initialized in a connected state.
@@ -867,6 +1025,7 @@ namespace nupic
           initialized in a connected state.
           */
           Real initPermConnected_();
+          Real initPermConnected_(Random& rng) const;
           /**
               Returns a randomly generated permanence value for a synapses that is to be
               initialized in a non-connected state.
@@ -875,6 +1034,7 @@ namespace nupic
               initialized in a non-connected state.
           */
           Real initPermNonConnected_();
+          Real initPermNonConnected_(Random& rng) const;
 
 
           /**
@@ -893,7 +1053,17 @@ namespace nupic
           */
           vector<Real> initPermanence_(vector<UInt>& potential,
                                        Real connectedPct);
-          void clip_(vector<Real>& perm, bool trim);
+
+          /**
+          Samples the initial permanences of the inputs of a potential
+          pool from rng, as initPermanence_ does.
+
+          @param pool The indices of the pool's inputs, ascending.
+          @param perm Set to the permanence of each input of pool.
+          */
+          void samplePermanences_(const vector<UInt>& pool, Real connectedPct,
+                                  Random& rng, vector<Real>& perm) const;
+          void clip_(vector<Real>& perm, bool trim) const;
 
         /**
             This method updates the permanence matrix with a column's new permanence
@@ -926,9 +1096,75 @@ namespace nupic
         */
           void updatePermanencesForColumn_(vector<Real>& perm, UInt column,
                                            bool raisePerm=true);
-          UInt countConnected_(vector<Real>& perm);
+
+          /**
+          The part of updatePermanencesForColumn_ that doesn't store
+          anything: raises perm if raisePerm, rounds it to the fixed-point
+          grid if there is one, and clips it.
+
+          @param potential The potential pool of the column.
+          @param connected Set to the connected synapses of perm.
+          */
+          void preparePermanences_(vector<Real>& perm,
+                                   const vector<UInt>& potential,
+                                   bool raisePerm,
+                                   vector<UInt>& connected) const;
+
+          // A column drawn by initColumn_, ready to be stored
+          struct ColumnInit_
+          {
+            vector<UInt> potential;
+            vector<UInt> connected;
+            vector<UInt> permIndices;
+            vector<Real> permValues;
+          };
+
+          /**
+          Draws a column from its own random stream, for initParallel and
+          initLazy. Thread-safe.
+
+          @param perm Scratch of numInputs_ elements.
+          */
+          void initColumn_(UInt column, ColumnInit_& init,
+                           vector<Real>& perm) const;
+          void storeColumn_(UInt column, const ColumnInit_& init,
+                            vector<Real>& perm);
+          UInt32 columnSeed_(UInt column) const;
+
+          /**
+          Creates a column still pending with initLazy.
+          */
+          void initializeColumn_(UInt column);
+
+          /**
+          Throws if the columns (or column) read by a const method are
+          still pending with initLazy.
+          */
+          void checkInitialized_(const char* method) const;
+          void checkInitialized_(UInt column, const char* method) const;
+
+          /**
+          Read the per-column state (potential pools, permanences, tie
+          breakers, duty cycles and boost factors) written as capnp lists,
+          by versions before columnsFormat 1.
+          */
+          void readColumnLists_(SpatialPoolerProto::Reader& proto);
+
+          /**
+          Read the per-column state written as Data arrays.
+          */
+          void readColumns_(SpatialPoolerProto::Columns::Reader columns);
+          void checkRowStarts_(const vector<UInt>& rowStarts,
+                               size_t nElements) const;
+
+          /**
+          Reads a column's permanences into a dense array of numInputs_
+          elements, from whichever storage is in use.
+          */
+          void getPermanenceRow_(UInt column, Real perm[]) const;
+          UInt countConnected_(vector<Real>& perm) const;
           UInt raisePermanencesToThreshold_(vector<Real>& perm,
-                                            vector<UInt>& potential);
+                                            const vector<UInt>& potential) const;
 
           /**
              This function determines each column's overlap with the current
@@ -951,16 +1187,16 @@ namespace nupic
              input bits which are turned on.
           */
           void calculateOverlap_(UInt inputVector[],
-                                 vector<UInt>& overlap);
+                                 vector<UInt>& overlap) const;
           void calculateOverlapPct_(vector<UInt>& overlaps,
                                     vector<Real>& overlapPct);
 
 
           bool isWinner_(Real score, vector<pair<UInt, Real> >& winners,
-                         UInt numWinners);
+                         UInt numWinners) const;
 
           void addToWinners_(UInt index, Real score,
-                             vector<pair<UInt, Real> >& winners);
+                             vector<pair<UInt, Real> >& winners) const;
 
           /**
               Performs inhibition. This method calculates the necessary values needed to
@@ -977,7 +1213,7 @@ namespace nupic
           */
           void inhibitColumns_(
             const vector<Real>& overlaps,
-            vector<UInt>& activeColumns);
+            vector<UInt>& activeColumns) const;
 
           /**
              Perform global inhibition.
@@ -1003,7 +1239,7 @@ namespace nupic
           void inhibitColumnsGlobal_(
             const vector<Real>& overlaps,
             Real density,
-            vector<UInt>& activeColumns);
+            vector<UInt>& activeColumns) const;
 
           /**
              Performs local inhibition.
@@ -1034,7 +1270,7 @@ namespace nupic
           void inhibitColumnsLocal_(
             const vector<Real>& overlaps,
             Real density,
-            vector<UInt>& activeColumns);
+            vector<UInt>& activeColumns) const;
 
           /**
               The primary method in charge of learning.
@@ -1307,7 +1543,11 @@ namespace nupic
 
           Real minPctOverlapDutyCycles_;
 
+          // Float permanences, or fixed-point ones aligned with
+          // potentialPools_ when permanenceBits_ isn't 0.
           SparseMatrix<UInt,Real,Int,Real64> permanences_;
+          UInt permanenceBits_;
+          QuantizedPermanenceRows quantizedPermanences_;
           SparseBinaryMatrix<UInt, UInt> potentialPools_;
           SparseBinaryMatrix<UInt, UInt> connectedSynapses_;
           vector<UInt> connectedCounts_;
@@ -1318,9 +1558,25 @@ namespace nupic
           vector<UInt> activeColumns_;
           vector<Real> tieBreaker_;
 
+          // Dense input and output of computeSparse(). The input is all
+          // zeros between calls.
+          vector<UInt> sparseInput_;
+          vector<UInt> sparseOutput_;
+
           UInt version_;
           Random rng_;
 
+          InitMode initMode_;
+          UInt initThreads_;
+          // Seed of the columns' random streams
+          UInt32 initSeed_;
+          // Columns not created yet, with initLazy
+          vector<bool> pendingColumns_;
+          UInt numPendingColumns_;
+          // Set by setInhibitionRadius(), so that creating the pending
+          // columns doesn't override it
+          bool inhibitionRadiusSet_;
+
       };
 
     } // end namespace spatial_pooler
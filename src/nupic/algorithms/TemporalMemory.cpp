@@ -184,6 +184,9 @@ void TemporalMemory::initialize(
   winnerCells_.clear();
   activeSegments_.clear();
   matchingSegments_.clear();
+  numActiveConnectedSynapsesForSegment_.clear();
+  numActivePotentialSynapsesForSegment_.clear();
+  touchedSegments_.clear();
 }
 
 static CellIdx getLeastUsedCell(
@@ -260,6 +263,7 @@ static void adaptSegment(
 
     permanence = min(permanence, (Permanence)1.0);
     permanence = max(permanence, (Permanence)0.0);
+    permanence = connections.roundPermanence(permanence);
 
     if (permanence < EPSILON)
     {
@@ -483,6 +487,10 @@ void TemporalMemory::activateCells(
   const auto columnForSegment = [&](Segment segment)
     { return connections.cellForSegment(segment) / cellsPerColumn_; };
 
+  // Learning makes many small changes to the connections. Apply their index
+  // updates once per step rather than once per change.
+  ConnectionsBatch batch(connections, learn);
+
   for (auto& columnData : iterGroupBy(
          activeColumns, activeColumns + activeColumnsSize, identity<UInt>,
          activeSegments_.begin(), activeSegments_.end(), columnForSegment,
@@ -537,26 +545,38 @@ void TemporalMemory::activateCells(
       }
     }
   }
+
+  batch.commit();
 }
 
 void TemporalMemory::activateDendrites(bool learn)
 {
   const UInt32 length = connections.segmentFlatListLength();
 
-  numActiveConnectedSynapsesForSegment_.assign(length, 0);
-  numActivePotentialSynapsesForSegment_.assign(length, 0);
+  // Only the segments touched by the previous step have nonzero counts, so
+  // resetting them is enough. Segments created since then start at zero.
+  for (Segment segment : touchedSegments_)
+  {
+    numActiveConnectedSynapsesForSegment_[segment] = 0;
+    numActivePotentialSynapsesForSegment_[segment] = 0;
+  }
+  touchedSegments_.clear();
+  numActiveConnectedSynapsesForSegment_.resize(length, 0);
+  numActivePotentialSynapsesForSegment_.resize(length, 0);
+
   connections.computeActivity(numActiveConnectedSynapsesForSegment_,
                               numActivePotentialSynapsesForSegment_,
+                              touchedSegments_,
                               activeCells_,
                               connectedPermanence_);
 
   // Active segments, connected synapses.
   activeSegments_.clear();
-  for (size_t i = 0; i < numActiveConnectedSynapsesForSegment_.size(); i++)
+  for (Segment segment : touchedSegments_)
   {
-    if (numActiveConnectedSynapsesForSegment_[i] >= activationThreshold_)
+    if (numActiveConnectedSynapsesForSegment_[segment] >= activationThreshold_)
     {
-      activeSegments_.push_back(connections.segmentForFlatIdx(i));
+      activeSegments_.push_back(segment);
     }
   }
   std::sort(activeSegments_.begin(), activeSegments_.end(),
@@ -567,11 +587,11 @@ void TemporalMemory::activateDendrites(bool learn)
 
   // Matching segments, potential synapses.
   matchingSegments_.clear();
-  for (size_t i = 0; i < numActivePotentialSynapsesForSegment_.size(); i++)
+  for (Segment segment : touchedSegments_)
   {
-    if (numActivePotentialSynapsesForSegment_[i] >= minThreshold_)
+    if (numActivePotentialSynapsesForSegment_[segment] >= minThreshold_)
     {
-      matchingSegments_.push_back(connections.segmentForFlatIdx(i));
+      matchingSegments_.push_back(segment);
     }
   }
   std::sort(matchingSegments_.begin(), matchingSegments_.end(),
@@ -1064,6 +1084,11 @@ void TemporalMemory::read(TemporalMemoryProto::Reader& proto)
     matchingSegments_.push_back(segment);
     numActivePotentialSynapsesForSegment_[segment.flatIdx] = value.getOverlap();
   }
+
+  // The next step resets only the counts that were set here.
+  touchedSegments_ = activeSegments_;
+  touchedSegments_.insert(touchedSegments_.end(),
+                          matchingSegments_.begin(), matchingSegments_.end());
 }
 
 void TemporalMemory::load(istream& inStream)
@@ -1185,6 +1210,11 @@ void TemporalMemory::load(istream& inStream)
     }
   }
 
+  // The next step resets only the counts that were set here.
+  touchedSegments_ = activeSegments_;
+  touchedSegments_.insert(touchedSegments_.end(),
+                          matchingSegments_.begin(), matchingSegments_.end());
+
   if (version < 2)
   {
     UInt numMatchingCells;
@@ -453,6 +453,10 @@ namespace nupic {
         vector<UInt32> numActiveConnectedSynapsesForSegment_;
         vector<UInt32> numActivePotentialSynapsesForSegment_;
 
+        // Segments with nonzero counts above, so each step resets and scans
+        // only these rather than every segment.
+        vector<Segment> touchedSegments_;
+
         Random rng_;
 
       public:
@@ -118,6 +118,66 @@ using namespace nupic;
 #define CHECKSIZE(var) \
   NTA_ASSERT(PyArray_DESCR(var)->elsize == 4) << " elsize:" << PyArray_DESCR(var)->elsize
 
+// Returns the buffer of a numpy array, after checking that C++ can work on
+// it in place: C contiguous, aligned, of the given type and, for outputs,
+// writeable. The *ReleaseGIL methods check all their arguments with it
+// before they release the GIL.
+template <typename T>
+inline T* checkedArrayData(PyObject* py_a, int typenum, bool writeable,
+                           const char* name)
+{
+  NTA_CHECK(PyArray_Check(py_a)) << name << " must be a numpy array";
+  PyArrayObject* a = (PyArrayObject*) py_a;
+  NTA_CHECK(PyArray_EquivTypenums(PyArray_TYPE(a), typenum))
+    << name << " has the wrong dtype '" << PyArray_DESCR(a)->type << "'";
+  NTA_CHECK(PyArray_IS_C_CONTIGUOUS(a) && PyArray_ISALIGNED(a))
+    << name << " must be C contiguous and aligned";
+  NTA_CHECK(!writeable || PyArray_ISWRITEABLE(a))
+    << name << " must be writeable";
+  return (T*) PyArray_DATA(a);
+}
+
+inline size_t arraySize(PyObject* py_a)
+{
+  return PyArray_SIZE((PyArrayObject*) py_a);
+}
+
+// Copies indices into a uint32 numpy array and returns their number
+inline size_t copyIndicesInto(const vector<UInt32>& indices, PyObject* py_out)
+{
+  UInt32* out = checkedArrayData<UInt32>(py_out, NPY_UINT32, true, "out");
+  NTA_CHECK(indices.size() <= arraySize(py_out))
+    << "out has " << arraySize(py_out) << " elements, "
+    << indices.size() << " are needed";
+  std::copy(indices.begin(), indices.end(), out);
+  return indices.size();
+}
+
+// Copies a classifier result into a 2-D float64 numpy array, one row per
+// entry of the result in order: the actual values, then the bucket
+// likelihoods of each step in increasing order. Rows are zero-padded to the
+// width of the array. Returns the number of buckets.
+inline size_t copyClassifierResultInto(ClassifierResult& result,
+                                       PyObject* py_out)
+{
+  Real64* out = checkedArrayData<Real64>(py_out, NPY_FLOAT64, true, "out");
+  PyArrayObject* a = (PyArrayObject*) py_out;
+  NTA_CHECK(PyArray_NDIM(a) == 2) << "out must be 2-D";
+  const size_t nRows = PyArray_DIM(a, 0), nCols = PyArray_DIM(a, 1);
+
+  size_t row = 0, nBuckets = 0;
+  for (auto it = result.begin(); it != result.end(); ++it, ++row)
+  {
+    const vector<Real64>& values = *it->second;
+    NTA_CHECK(row < nRows && values.size() <= nCols)
+      << "out is " << nRows << "x" << nCols << ", too small for the result";
+    std::copy(values.begin(), values.end(), out + row * nCols);
+    std::fill(out + row * nCols + values.size(), out + (row + 1) * nCols, 0);
+    nBuckets = std::max(nBuckets, values.size());
+  }
+  return nBuckets;
+}
+
 %}
 
 
@@ -1107,6 +1167,49 @@ inline PyObject* generate2DGaussianSample(nupic::UInt32 nrows, nupic::UInt32 nco
     self->compute((nupic::UInt*) PyArray_DATA(x), (bool)learn, (nupic::UInt*) PyArray_DATA(y));
   }
 
+  // Same as compute, on numpy uint32 arrays used in place, without the
+  // GIL, so that Python threads can compute several SpatialPoolers at once.
+  // A SpatialPooler must not be computed from two threads at the same time.
+  inline void computeReleaseGIL(PyObject *py_x, bool learn, PyObject *py_y)
+  {
+    UInt* x = checkedArrayData<UInt>(py_x, NPY_UINT32, false, "inputVector");
+    UInt* y = checkedArrayData<UInt>(py_y, NPY_UINT32, true, "activeArray");
+    NTA_CHECK(arraySize(py_x) == self->getNumInputs())
+      << "inputVector has " << arraySize(py_x) << " elements, expected "
+      << self->getNumInputs();
+    NTA_CHECK(arraySize(py_y) == self->getNumColumns())
+      << "activeArray has " << arraySize(py_y) << " elements, expected "
+      << self->getNumColumns();
+
+    py::ReleaseGIL release;
+    self->compute(x, learn, y);
+  }
+
+  // Same as computeReleaseGIL, on the indices of the active input bits,
+  // through SpatialPooler::computeSparse. Returns the indices of the active
+  // columns, in increasing order, as a new numpy uint32 array: local
+  // inhibition doesn't bound their number, so no output array is passed in.
+  inline PyObject* computeSparseReleaseGIL(PyObject *py_inputIndices,
+                                           bool learn)
+  {
+    const UInt* inputIndices = checkedArrayData<UInt>(
+      py_inputIndices, NPY_UINT32, false, "inputIndices");
+    const size_t nInputIndices = arraySize(py_inputIndices);
+
+    vector<UInt> activeColumns;
+    {
+      py::ReleaseGIL release;
+      self->computeSparse(inputIndices, (UInt)nInputIndices, learn,
+                          activeColumns);
+    }
+
+    npy_intp dims[1] = {(npy_intp)activeColumns.size()};
+    PyObject* py_activeColumns = PyArray_SimpleNew(1, dims, NPY_UINT32);
+    std::copy(activeColumns.begin(), activeColumns.end(),
+              (UInt*)PyArray_DATA((PyArrayObject*)py_activeColumns));
+    return py_activeColumns;
+  }
+
   inline void stripUnlearnedColumns(PyObject *py_x)
   {
     PyArrayObject* x = (PyArrayObject*) py_x;
@@ -1417,6 +1520,33 @@ inline PyObject* generate2DGaussianSample(nupic::UInt32 nrows, nupic::UInt32 nco
     return py_s.close();
   }
 
+  // Same as convertedCompute, on a numpy uint32 array of active bits, without
+  // the GIL, so that Python threads can compute several classifiers at once.
+  // Writes the result into the float64 array out, with one row for the
+  // actual values, then one row per step, and returns the number of buckets.
+  // The bucket index and actual value are used as given: the Python-level
+  // category and None handling of compute() is left to the caller.
+  inline size_t computeReleaseGIL(UInt recordNum, PyObject* py_patternNZ,
+                                  UInt bucketIdx, Real64 actValue,
+                                  bool category, bool learn, bool infer,
+                                  PyObject* py_out)
+  {
+    const UInt* patternNZ = checkedArrayData<UInt>(
+      py_patternNZ, NPY_UINT32, false, "patternNZ");
+    const size_t nPatternNZ = arraySize(py_patternNZ);
+    if (infer)
+      checkedArrayData<Real64>(py_out, NPY_FLOAT64, true, "out");
+
+    ClassifierResult result;
+    {
+      py::ReleaseGIL release;
+      vector<UInt> pattern(patternNZ, patternNZ + nPatternNZ);
+      self->fastCompute(recordNum, pattern, bucketIdx, actValue, category,
+                            learn, infer, &result);
+    }
+    return infer ? copyClassifierResultInto(result, py_out) : 0;
+  }
+
   PyObject* convertedCompute(UInt recordNum, const vector<UInt>& patternNZ,
                              UInt bucketIdx, Real64 actValue, bool category,
                              bool learn, bool infer)
@@ -1581,6 +1711,33 @@ inline PyObject* generate2DGaussianSample(nupic::UInt32 nrows, nupic::UInt32 nco
     return py_s.close();
   }
 
+  // Same as convertedCompute, on a numpy uint32 array of active bits, without
+  // the GIL, so that Python threads can compute several classifiers at once.
+  // Writes the result into the float64 array out, with one row for the
+  // actual values, then one row per step, and returns the number of buckets.
+  // The bucket index and actual value are used as given: the Python-level
+  // category and None handling of compute() is left to the caller.
+  inline size_t computeReleaseGIL(UInt recordNum, PyObject* py_patternNZ,
+                                  UInt bucketIdx, Real64 actValue,
+                                  bool category, bool learn, bool infer,
+                                  PyObject* py_out)
+  {
+    const UInt* patternNZ = checkedArrayData<UInt>(
+      py_patternNZ, NPY_UINT32, false, "patternNZ");
+    const size_t nPatternNZ = arraySize(py_patternNZ);
+    if (infer)
+      checkedArrayData<Real64>(py_out, NPY_FLOAT64, true, "out");
+
+    ClassifierResult result;
+    {
+      py::ReleaseGIL release;
+      vector<UInt> pattern(patternNZ, patternNZ + nPatternNZ);
+      self->compute(recordNum, pattern, bucketIdx, actValue, category,
+                        learn, infer, &result);
+    }
+    return infer ? copyClassifierResultInto(result, py_out) : 0;
+  }
+
   PyObject* convertedCompute(UInt recordNum, const vector<UInt>& patternNZ,
                              UInt bucketIdx, Real64 actValue, bool category,
                              bool learn, bool infer)
@@ -1671,6 +1828,36 @@ inline PyObject* generate2DGaussianSample(nupic::UInt32 nrows, nupic::UInt32 nco
 
   %}
 
+  // Same as computeActivity, on numpy uint32 arrays used in place, without
+  // the GIL. The output arrays must have segmentFlatListLength() elements;
+  // they are added to, not cleared.
+  inline void computeActivityReleaseGIL(PyObject* py_numActiveConnected,
+                                        PyObject* py_numActivePotential,
+                                        PyObject* py_activeCells,
+                                        Permanence connectedPermanence)
+  {
+    UInt32* numActiveConnected = checkedArrayData<UInt32>(
+      py_numActiveConnected, NPY_UINT32, true, "numActiveConnected");
+    UInt32* numActivePotential = checkedArrayData<UInt32>(
+      py_numActivePotential, NPY_UINT32, true, "numActivePotential");
+    const CellIdx* activeCells = checkedArrayData<CellIdx>(
+      py_activeCells, NPY_UINT32, false, "activeCells");
+    NTA_CHECK(arraySize(py_numActiveConnected) ==
+              self->segmentFlatListLength() &&
+              arraySize(py_numActivePotential) ==
+              self->segmentFlatListLength())
+      << "The output arrays must have segmentFlatListLength() = "
+      << self->segmentFlatListLength() << " elements";
+    const size_t nActiveCells = arraySize(py_activeCells);
+    for (size_t i = 0; i < nActiveCells; i++)
+      NTA_CHECK(activeCells[i] < self->numCells())
+        << "Invalid active cell: " << activeCells[i];
+
+    py::ReleaseGIL release;
+    self->computeActivity(numActiveConnected, numActivePotential,
+                          nActiveCells, activeCells, connectedPermanence);
+  }
+
   inline void write(PyObject* pyBuilder) const
   {
 %#if !CAPNP_LITE
@@ -1878,6 +2065,43 @@ inline PyObject* generate2DGaussianSample(nupic::UInt32 nrows, nupic::UInt32 nco
     return vectorToList(cellIdxs);
   }
 
+  // Same as compute, on a sorted numpy uint32 array of active columns used
+  // in place, without the GIL, so that Python threads can compute several
+  // TemporalMemories at once.
+  inline void computeReleaseGIL(PyObject *py_activeColumns, bool learn)
+  {
+    const UInt32* activeColumns = checkedArrayData<UInt32>(
+      py_activeColumns, NPY_UINT32, false, "activeColumns");
+    const size_t nActiveColumns = arraySize(py_activeColumns);
+    for (size_t i = 0; i < nActiveColumns; i++)
+    {
+      NTA_CHECK(activeColumns[i] < self->numberOfColumns())
+        << "Invalid active column: " << activeColumns[i];
+      NTA_CHECK(i == 0 || activeColumns[i - 1] < activeColumns[i])
+        << "activeColumns must be sorted and unique";
+    }
+
+    py::ReleaseGIL release;
+    self->compute(nActiveColumns, activeColumns, learn);
+  }
+
+  // The get*Into methods write the cell indices into a numpy uint32 array,
+  // without building a list, and return their number.
+  inline size_t getActiveCellsInto(PyObject* py_out)
+  {
+    return copyIndicesInto(self->getActiveCells(), py_out);
+  }
+
+  inline size_t getPredictiveCellsInto(PyObject* py_out)
+  {
+    return copyIndicesInto(self->getPredictiveCells(), py_out);
+  }
+
+  inline size_t getWinnerCellsInto(PyObject* py_out)
+  {
+    return copyIndicesInto(self->getWinnerCells(), py_out);
+  }
+
   inline void convertedActivateCells(PyObject *py_activeColumns,
                                      bool learn)
   {
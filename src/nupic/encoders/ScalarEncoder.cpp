@@ -24,6 +24,7 @@
  * Implementations of the ScalarEncoder and PeriodicScalarEncoder
  */
 
+#include <algorithm> // max
 #include <cstring> // memset
 #include <cmath>
 #include <nupic/encoders/ScalarEncoder.hpp>
@@ -31,6 +32,20 @@
 
 namespace nupic
 {
+  void ScalarEncoderBase::encodeBatch(const Real64 inputs[], size_t count,
+                                      UInt32 indices[], Int32 buckets[])
+  {
+    const int w = getActiveBitCount();
+    for (size_t i = 0; i < count; i++)
+    {
+      const int iBucket = encodeIntoIndices(inputs[i], indices + i * w);
+      if (buckets != nullptr)
+      {
+        buckets[i] = iBucket;
+      }
+    }
+  }
+
   ScalarEncoder::ScalarEncoder(
     int w, double minValue, double maxValue, int n, double radius,
     double resolution, bool clipInput)
@@ -88,7 +103,7 @@ namespace nupic
   {
   }
 
-  int ScalarEncoder::encodeIntoArray(Real64 input, Real32 output[])
+  int ScalarEncoder::getBucketIndex_(Real64 input) const
   {
     if (input < minValue_)
     {
@@ -113,7 +128,12 @@ namespace nupic
       }
     }
 
-    const int iBucket = round((input - minValue_) / bucketWidth_);
+    return round((input - minValue_) / bucketWidth_);
+  }
+
+  int ScalarEncoder::encodeIntoArray(Real64 input, Real32 output[])
+  {
+    const int iBucket = getBucketIndex_(input);
 
     const int firstBit = iBucket;
 
@@ -126,6 +146,20 @@ namespace nupic
     return iBucket;
   }
 
+  int ScalarEncoder::encodeIntoIndices(Real64 input, UInt32 indices[])
+  {
+    const int iBucket = getBucketIndex_(input);
+
+    const int firstBit = iBucket;
+
+    for (int i = 0; i < w_; i++)
+    {
+      indices[i] = firstBit + i;
+    }
+
+    return iBucket;
+  }
+
   PeriodicScalarEncoder::PeriodicScalarEncoder(
     int w, double minValue, double maxValue, int n, double radius, double resolution)
     :w_(w),
@@ -178,7 +212,7 @@ namespace nupic
   {
   }
 
-  int PeriodicScalarEncoder::encodeIntoArray(Real64 input, Real32 output[])
+  int PeriodicScalarEncoder::getBucketIndex_(Real64 input) const
   {
     if (input < minValue_ || input >= maxValue_)
     {
@@ -186,7 +220,12 @@ namespace nupic
         ", " << maxValue_ << ")";
     }
 
-    const int iBucket = (int)((input - minValue_) / bucketWidth_);
+    return (int)((input - minValue_) / bucketWidth_);
+  }
+
+  int PeriodicScalarEncoder::encodeIntoArray(Real64 input, Real32 output[])
+  {
+    const int iBucket = getBucketIndex_(input);
 
     const int middleBit = iBucket;
     const double reach = (w_ - 1) / 2.0;
@@ -207,4 +246,28 @@ namespace nupic
 
     return iBucket;
   }
+
+  int PeriodicScalarEncoder::encodeIntoIndices(Real64 input, UInt32 indices[])
+  {
+    const int iBucket = getBucketIndex_(input);
+
+    const int middleBit = iBucket;
+    const double reach = (w_ - 1) / 2.0;
+    const int left = floor(reach);
+
+    // The block covers [firstBit, firstBit + w) modulo n. Emit the part that
+    // wraps around to the start of the output first to keep indices sorted.
+    const int firstBit = (middleBit - left + n_) % n_;
+    const int wrapped = std::max(0, firstBit + w_ - n_);
+    for (int i = 0; i < wrapped; i++)
+    {
+      indices[i] = i;
+    }
+    for (int i = wrapped; i < w_; i++)
+    {
+      indices[i] = firstBit + (i - wrapped);
+    }
+
+    return iBucket;
+  }
 } // end namespace nupic
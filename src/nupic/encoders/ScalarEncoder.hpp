@@ -54,10 +54,45 @@ namespace nupic
      */
     virtual int encodeIntoArray(Real64 input, Real32 output[]) = 0;
 
+    /**
+     * Encodes input as the indices of its active bits, and returns the bucket
+     * number for the encoding.
+     *
+     * This is equivalent to encodeIntoArray() followed by a scan for the
+     * nonzero bits, but costs O(getActiveBitCount()) rather than
+     * O(getOutputWidth()).
+     *
+     * @param input The value to encode
+     * @param indices Receives the getActiveBitCount() active bit indices, in
+     *   increasing order
+     */
+    virtual int encodeIntoIndices(Real64 input, UInt32 indices[]) = 0;
+
+    /**
+     * Encodes a column of values into a flat buffer of active bit indices.
+     *
+     * The active bits of inputs[i] are written, in increasing order, to
+     * indices[i * getActiveBitCount()] through
+     * indices[(i + 1) * getActiveBitCount() - 1].
+     *
+     * @param inputs The values to encode
+     * @param count The number of values
+     * @param indices Should have length of at least count * getActiveBitCount()
+     * @param buckets If not null, receives the bucket number of each value.
+     *   Should have length of at least count.
+     */
+    void encodeBatch(const Real64 inputs[], size_t count, UInt32 indices[],
+                     Int32 buckets[] = nullptr);
+
     /**
      * Returns the output width, in bits.
      */
     virtual int getOutputWidth() const = 0;
+
+    /**
+     * Returns the number of active bits in every encoding.
+     */
+    virtual int getActiveBitCount() const = 0;
   };
 
   /** Encodes a floating point number as a contiguous block of 1s.
@@ -107,9 +142,14 @@ namespace nupic
     ~ScalarEncoder() override;
 
     virtual int encodeIntoArray(Real64 input, Real32 output[]) override;
+    virtual int encodeIntoIndices(Real64 input, UInt32 indices[]) override;
     virtual int getOutputWidth() const override { return n_; }
+    virtual int getActiveBitCount() const override { return w_; }
 
   private:
+    // Validates or clips the input and returns its bucket
+    int getBucketIndex_(Real64 input) const;
+
     int w_;
     int n_;
     double minValue_;
@@ -165,9 +205,14 @@ namespace nupic
     virtual ~PeriodicScalarEncoder() override;
 
     virtual int encodeIntoArray(Real64 input, Real32 output[]) override;
+    virtual int encodeIntoIndices(Real64 input, UInt32 indices[]) override;
     virtual int getOutputWidth() const override { return n_; }
+    virtual int getActiveBitCount() const override { return w_; }
 
   private:
+    // Validates the input and returns its bucket
+    int getBucketIndex_(Real64 input) const;
+
     int w_;
     int n_;
     double minValue_;
@@ -24,6 +24,7 @@
  * Implementation of the ScalarSensor
  */
 
+#include <cstring> // memset
 #include <string>
 
 // Workaround windows.h collision:
@@ -94,7 +95,30 @@ namespace nupic
   void ScalarSensor::compute()
   {
     Real32* array = (Real32*)encodedOutput_->getData().getBuffer();
-    const Int32 iBucket = encoder_->encodeIntoArray(sensedValue_, array);
+    UInt32* activeBits = (UInt32*)activeBitsOutput_->getData().getBuffer();
+    const int w = encoder_->getActiveBitCount();
+
+    // Encoding throws on invalid input, which must leave the outputs and
+    // activeBits consistent
+    const Int32 iBucket = encoder_->encodeIntoIndices(sensedValue_,
+                                                      indices_.data());
+
+    // Only clear the bits of the previous encoding
+    if (hasActiveBits_)
+    {
+      for (int i = 0; i < w; i++)
+      {
+        array[activeBits[i]] = 0;
+      }
+    }
+
+    for (int i = 0; i < w; i++)
+    {
+      activeBits[i] = indices_[i];
+      array[indices_[i]] = 1;
+    }
+    hasActiveBits_ = true;
+
     ((Int32*)bucketOutput_->getData().getBuffer())[0] = iBucket;
   }
 
@@ -208,6 +232,16 @@ namespace nupic
         true // isDefaultOutput
         ));
 
+    ns->outputs.add(
+      "activeBits",
+      OutputSpec(
+        "Indices of the active bits of the encoded value, in increasing order",
+        NTA_BasicType_UInt32,
+        0, // elementCount
+        true, // isRegionLevel
+        false // isDefaultOutput
+        ));
+
     ns->outputs.add(
       "bucket",
       OutputSpec(
@@ -260,7 +294,13 @@ namespace nupic
   ScalarSensor::initialize()
   {
     encodedOutput_ = getOutput("encoded");
+    activeBitsOutput_ = getOutput("activeBits");
     bucketOutput_ = getOutput("bucket");
+
+    const Array& encoded = encodedOutput_->getData();
+    memset(encoded.getBuffer(), 0, encoded.getCount() * sizeof(Real32));
+    hasActiveBits_ = false;
+    indices_.resize(encoder_->getActiveBitCount());
   }
 
   size_t
@@ -270,6 +310,10 @@ namespace nupic
     {
       return encoder_->getOutputWidth();
     }
+    else if (outputName == "activeBits")
+    {
+      return encoder_->getActiveBitCount();
+    }
     else if (outputName == "bucket")
     {
       return 1;
@@ -49,6 +49,11 @@ namespace nupic
    * API. As a network runs, the client will specify new encoder inputs by
    * setting the "sensedValue" parameter. On each compute, the ScalarSensor will
    * encode its "sensedValue" to output.
+   *
+   * The "encoded" output holds the dense encoding, and the "activeBits"
+   * output holds the indices of its w active bits in increasing order. Each
+   * compute only touches the bits that change, so it costs O(w) rather than
+   * O(n).
    */
   class ScalarSensor : public RegionImpl
   {
@@ -86,7 +91,14 @@ namespace nupic
     Real64 sensedValue_;
     ScalarEncoderBase* encoder_;
     const Output* encodedOutput_;
+    const Output* activeBitsOutput_;
     const Output* bucketOutput_;
+
+    // Whether activeBitsOutput_ holds the bits set in encodedOutput_
+    bool hasActiveBits_;
+
+    // The new encoding, kept apart until it succeeds
+    std::vector<UInt32> indices_;
   };
 }
 
@@ -0,0 +1,116 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Implementation of the GatherPlan class
+ */
+
+#include <nupic/engine/GatherPlan.hpp>
+
+namespace nupic
+{
+  void GatherPlan::append(size_t offset)
+  {
+    count_++;
+
+    if (!runs_.empty())
+    {
+      GatherRun& last = runs_.back();
+      if (last.count == 1 && offset > last.offset)
+      {
+        last.stride = offset - last.offset;
+        last.count = 2;
+        return;
+      }
+      if (offset == last.offset + last.count * last.stride)
+      {
+        last.count++;
+        return;
+      }
+    }
+
+    GatherRun run = {offset, 1, 1};
+    runs_.push_back(run);
+  }
+
+  void GatherPlan::appendSpan(size_t offset, size_t count)
+  {
+    if (count == 0)
+      return;
+    if (count == 1)
+    {
+      append(offset);
+      return;
+    }
+
+    count_ += count;
+
+    if (!runs_.empty())
+    {
+      GatherRun& last = runs_.back();
+      if ((last.count == 1 || last.stride == 1) &&
+          offset == last.offset + last.count)
+      {
+        last.stride = 1;
+        last.count += count;
+        return;
+      }
+    }
+
+    GatherRun run = {offset, count, 1};
+    runs_.push_back(run);
+  }
+
+  void GatherPlan::appendPlan(const GatherPlan& plan, size_t shift)
+  {
+    for (const GatherRun& run : plan.runs_)
+    {
+      if (run.stride == 1)
+      {
+        appendSpan(run.offset + shift, run.count);
+      }
+      else
+      {
+        for (size_t i = 0; i < run.count; i++)
+          append(run.offset + shift + i * run.stride);
+      }
+    }
+  }
+
+  void GatherPlan::clear()
+  {
+    runs_.clear();
+    count_ = 0;
+  }
+
+  void GatherPlan::expand(std::vector<size_t>& indices) const
+  {
+    indices.reserve(indices.size() + count_);
+    for (const GatherRun& run : runs_)
+    {
+      for (size_t i = 0; i < run.count; i++)
+        indices.push_back(run.offset + i * run.stride);
+    }
+  }
+
+} // namespace nupic
@@ -0,0 +1,124 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Definition of the GatherPlan class
+ */
+
+#ifndef NTA_GATHER_PLAN_HPP
+#define NTA_GATHER_PLAN_HPP
+
+#include <cstring> // memcpy
+#include <vector>
+
+namespace nupic
+{
+  /**
+   * A run of equally spaced elements: count elements, the first at
+   * offset and each one stride elements after the previous one.
+   */
+  struct GatherRun
+  {
+    size_t offset;
+    size_t count;
+    size_t stride;
+  };
+
+  /**
+   * The elements of a buffer that make up one node's input, in order,
+   * compiled into runs.
+   *
+   * @b Description
+   * A splitter map lists a node's input elements one by one. A gather
+   * plan holds the same list as runs: a receptive field takes one run
+   * per contiguous span, however long the span is, and a contiguous
+   * run is gathered with a single memcpy.
+   *
+   * Elements are appended one at a time or a span at a time. An
+   * element that continues the last run extends it, so appending the
+   * elements of a splitter map in order compiles it.
+   */
+  class GatherPlan
+  {
+  public:
+    GatherPlan() : count_(0) {}
+
+    /**
+     * Appends one element.
+     */
+    void append(size_t offset);
+
+    /**
+     * Appends count contiguous elements, starting at offset.
+     */
+    void appendSpan(size_t offset, size_t count);
+
+    /**
+     * Appends the elements of another plan, shifted by shift.
+     */
+    void appendPlan(const GatherPlan& plan, size_t shift = 0);
+
+    void clear();
+
+    /**
+     * @returns The number of elements, i.e. the size of the node input.
+     */
+    size_t size() const { return count_; }
+
+    const std::vector<GatherRun>& getRuns() const { return runs_; }
+
+    /**
+     * Appends the offsets of the elements, one by one, to indices.
+     */
+    void expand(std::vector<size_t>& indices) const;
+
+    /**
+     * Copies the elements of src to dest[0 .. size()).
+     */
+    template <typename T>
+    void gather(const T* src, T* dest) const
+    {
+      for (const GatherRun& run : runs_)
+      {
+        const T* from = src + run.offset;
+        if (run.stride == 1)
+        {
+          ::memcpy(dest, from, run.count * sizeof(T));
+        }
+        else
+        {
+          for (size_t i = 0; i < run.count; i++, from += run.stride)
+            dest[i] = *from;
+        }
+        dest += run.count;
+      }
+    }
+
+  private:
+    std::vector<GatherRun> runs_;
+    size_t count_;
+  };
+
+} // namespace nupic
+
+#endif // NTA_GATHER_PLAN_HPP
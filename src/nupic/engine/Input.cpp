@@ -32,14 +32,17 @@
 #include <nupic/engine/Output.hpp>
 #include <nupic/engine/Link.hpp>
 #include <nupic/engine/Region.hpp>
+#include <nupic/engine/Spec.hpp>
 #include <nupic/types/BasicType.hpp>
+#include <nupic/utils/Tracer.hpp>
 
 namespace nupic
 {
 
 Input::Input(Region& region, NTA_BasicType dataType, bool isRegionLevel) :
   region_(region), isRegionLevel_(isRegionLevel),
-  initialized_(false),  data_(dataType), name_("Unnamed")
+  initialized_(false),  data_(dataType), padding_(0),
+  splitterMapBuilt_(false), name_("Unnamed")
 {
 }
 
@@ -133,6 +136,7 @@ Input::prepare()
 {
   // Each link copies data into its section of the overall input
   // TODO: initialization check?
+  NTA_TRACE_SPAN(span, "prepare", traceName_);
   for (auto & elem : links_)
   {
     (elem)->compute();
@@ -146,6 +150,14 @@ Input::getData() const
   return data_;
 }
 
+Array
+Input::getPaddedData() const
+{
+  NTA_CHECK(initialized_);
+  return Array(data_.getType(), data_.getBuffer(),
+               data_.getCount() + padding_);
+}
+
 Region&
 Input::getRegion()
 {
@@ -542,8 +554,14 @@ void Input::initialize()
   }
 
   // Later we may optimize with the zeroCopyEnabled_ flag but
-  // for now we always allocate our own buffer.
-  data_.allocateBuffer(count);
+  // for now we always allocate our own buffer. Inputs that require
+  // a splitter map get one more element for the sentinel.
+  const Spec * spec = region_.getSpec();
+  const bool requireSplitterMap = spec->inputs.contains(name_) &&
+    spec->inputs.getByName(name_).requireSplitterMap;
+  padding_ = requireSplitterMap ? 1 : 0;
+
+  data_.allocateBuffer(count, padding_);
 
   // Zero the inputs (required for inspectors)
   if (count != 0)
@@ -554,26 +572,32 @@ void Input::initialize()
   }
 
 
-  NTA_CHECK(splitterMap_.size() == 0);
+  NTA_CHECK(gatherPlans_.size() == 0);
 
-  // create the splitter map by getting the contributions
+  // create the gather plans by getting the contributions
   // from each link.
   if(isRegionLevel_)
   {
-    splitterMap_.resize(1);
+    gatherPlans_.resize(1);
   }
   else
   {
-    splitterMap_.resize(region_.getDimensions().getCount());
+    gatherPlans_.resize(region_.getDimensions().getCount());
   }
 
 
   for (std::vector<Link *>::const_iterator link = links_.begin();
        link != links_.end(); link++)
   {
-    (*link)->buildSplitterMap(splitterMap_);
+    (*link)->buildGatherPlans(gatherPlans_);
   }
 
+  // Regions that require the splitter map get it now, the others
+  // on demand (see getSplitterMap())
+  if (requireSplitterMap)
+    buildSplitterMap_();
+
+  traceName_ = region_.getName() + "." + name_;
 
   initialized_ = true;
 }
@@ -587,7 +611,9 @@ void Input::uninitialize()
 
   initialized_ = false;
   data_.releaseBuffer();
+  gatherPlans_.clear();
   splitterMap_.clear();
+  splitterMapBuilt_ = false;
 }
 
 bool Input::isInitialized()
@@ -605,31 +631,54 @@ const std::string& Input::getName() const
   return  name_;
 }
 
+const std::string& Input::getTraceName() const
+{
+  return traceName_;
+}
+
 const std::vector< std::vector<size_t> >& Input::getSplitterMap() const
 {
   NTA_CHECK(initialized_);
-  // Originally the splitter map was created on demand in this method.
-  // For now we have moved splitter map creation to initialize() because
-  // we have dual heap/libstdc++ allocation/deallocation problems if
-  // this method is called from a node DLL/.so (including pynode).
+
+  std::lock_guard<std::mutex> lock(splitterMapMutex_);
+  if (!splitterMapBuilt_)
+    buildSplitterMap_();
 
   return splitterMap_;
 }
 
+void Input::buildSplitterMap_() const
+{
+  splitterMap_.resize(gatherPlans_.size());
+  for (size_t node = 0; node < gatherPlans_.size(); node++)
+    gatherPlans_[node].expand(splitterMap_[node]);
+  splitterMapBuilt_ = true;
+}
 
-template <typename T> void Input::getInputForNode(size_t nodeIndex, std::vector<T>& input) const
+const GatherPlan& Input::getGatherPlan(size_t nodeIndex) const
 {
   NTA_CHECK(initialized_);
-  const SplitterMap& sm = getSplitterMap();
-  NTA_CHECK(nodeIndex < sm.size());
+  NTA_CHECK(nodeIndex < gatherPlans_.size());
+
+  return gatherPlans_[nodeIndex];
+}
 
-  const std::vector<size_t>& map = sm[nodeIndex];
-  //NTA_CHECK(map.size() > 0);
 
-  input.resize(map.size());
-  T* fullInput = (T*)(data_.getBuffer());
-  for (size_t i = 0; i < map.size(); i++)
-    input[i] = fullInput[map[i]];
+template <typename T> void Input::getInputForNode(size_t nodeIndex, std::vector<T>& input) const
+{
+  const GatherPlan& plan = getGatherPlan(nodeIndex);
+
+  input.resize(plan.size());
+  if (plan.size() != 0)
+    plan.gather((const T*)(data_.getBuffer()), &input[0]);
+}
+
+template <typename T> size_t Input::getInputForNode(size_t nodeIndex, T* input) const
+{
+  const GatherPlan& plan = getGatherPlan(nodeIndex);
+
+  plan.gather((const T*)(data_.getBuffer()), input);
+  return plan.size();
 }
 
 template void Input::getInputForNode(size_t nodeIndex, std::vector<Real64>& input) const;
@@ -640,5 +689,13 @@ template void Input::getInputForNode(size_t nodeIndex, std::vector<UInt64>& inpu
 template void Input::getInputForNode(size_t nodeIndex, std::vector<UInt32>& input) const;
 template void Input::getInputForNode(size_t nodeIndex, std::vector<Byte>& input) const;
 
+template size_t Input::getInputForNode(size_t nodeIndex, Real64* input) const;
+template size_t Input::getInputForNode(size_t nodeIndex, Real32* input) const;
+template size_t Input::getInputForNode(size_t nodeIndex, Int64* input) const;
+template size_t Input::getInputForNode(size_t nodeIndex, Int32* input) const;
+template size_t Input::getInputForNode(size_t nodeIndex, UInt64* input) const;
+template size_t Input::getInputForNode(size_t nodeIndex, UInt32* input) const;
+template size_t Input::getInputForNode(size_t nodeIndex, Byte* input) const;
+
 }
 
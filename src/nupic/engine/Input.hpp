@@ -34,9 +34,11 @@
 #endif
 
 
+#include <mutex>
 #include <vector>
 #include <nupic/types/Types.hpp>
 #include <nupic/ntypes/Array.hpp>
+#include <nupic/engine/GatherPlan.hpp>
 
 namespace nupic
 {
@@ -96,6 +98,12 @@ namespace nupic
      */
     const std::string& getName() const;
 
+    /**
+     * Get the name of the spans traced for this input, "region.input".
+     * Set by initialize(), so that tracing does not build it every time.
+     */
+    const std::string& getTraceName() const;
+
     /**
      * Create a new Link between this input and the @a srcOutput.
      * 
@@ -170,6 +178,20 @@ namespace nupic
      */
     const Array &
     getData() const;
+
+    /**
+     *
+     * Get the data of the input followed by its padding. Inputs whose spec
+     * requires a splitter map have one extra element after their data, set
+     * to 0 and never written by the links, that the splitter maps use as a
+     * sentinel. This lets a region hand out the input and its sentinel
+     * without copying. For the other inputs, this is the same as getData().
+     *
+     * @returns
+     *         An @c Array that views the padded data of the input
+     */
+    Array
+    getPaddedData() const;
     
     /**
      *
@@ -240,24 +262,54 @@ namespace nupic
     /* ------------ Methods normally called by the RegionImpl ------------- */
 
     /**
+     * A splitter map maps the full input of a region to the inputs of
+     * its nodes: `sm[i]` lists, in order, the offsets in the region input
+     * buffer (in elements) of the input of node i, so that
      *
-     * @see Link.buildSplitterMap() 
-     * 
+     *     nodeInput[elem] = regionInput[sm[i][elem]];
+     *
+     * Region-level inputs have a single row. See Link::buildGatherPlans()
+     * for the compiled form.
      */
     typedef std::vector< std::vector<size_t> > SplitterMap;
 
     /**
      * 
      * Get splitter map from an initialized input
+     *
+     * The map is expanded from the gather plans on the first call, or by
+     * initialize() if the input's spec sets requireSplitterMap.
      * 
      * @returns
      *         The splitter map
      */
     const SplitterMap& getSplitterMap() const;
 
+    /**
+     *
+     * Get the input elements of one node from an initialized input, as
+     * runs of the input buffer. This is the splitter map entry of the
+     * node, compiled.
+     *
+     * @returns
+     *         The gather plan of the node
+     */
+    const GatherPlan& getGatherPlan(size_t nodeIndex) const;
+
     /** explicitly instantiated for various types */
     template <typename T> void getInputForNode(size_t nodeIndex, std::vector<T>& input) const;
 
+    /**
+     * Copies the input of one node to input, which must have room for
+     * getGatherPlan(nodeIndex).size() elements. Does not allocate.
+     *
+     * Explicitly instantiated for various types.
+     *
+     * @returns
+     *         The number of elements copied
+     */
+    template <typename T> size_t getInputForNode(size_t nodeIndex, T* input) const;
+
   private:
     Region& region_;
     // buffer is concatenation of input buffers (after prepare), or, 
@@ -271,13 +323,23 @@ namespace nupic
     // volatile (non-serialized) state
     bool initialized_;
     Array data_;
+    // number of elements allocated after data_ for the sentinel
+    size_t padding_;
+
+    // one gather plan per node, built by initialize()
+    std::vector<GatherPlan> gatherPlans_;
 
-    /* 
-     * cached splitter map -- only created if requested
+    /*
+     * cached splitter map, expanded from the gather plans. Inputs whose
+     * spec requires a splitter map get it from initialize(); the others
+     * only when getSplitterMap() is first called, since most regions
+     * read their input through the gather plans and never need it.
      * mutable because getSplitterMap() is const and logically
      * getting the splitter map doesn't change the Input
      */
     mutable SplitterMap splitterMap_;
+    mutable bool splitterMapBuilt_;
+    mutable std::mutex splitterMapMutex_;
 
 
     /*
@@ -290,6 +352,7 @@ namespace nupic
 
     // Useful for us to know our own name
     std::string name_;
+    std::string traceName_;
 
     // Internal methods
     
@@ -303,6 +366,12 @@ namespace nupic
     void
     uninitialize();
 
+    /*
+     * Expands the gather plans into the splitter map.
+     */
+    void
+    buildSplitterMap_() const;
+
 
 
   };
@@ -35,6 +35,7 @@
 #include <nupic/ntypes/Array.hpp>
 #include <nupic/ntypes/ArrayRef.hpp>
 #include <nupic/types/BasicType.hpp>
+#include <nupic/utils/Tracer.hpp>
 
 namespace nupic
 {
@@ -161,6 +162,8 @@ void Link::initialize(size_t destinationOffset)
 
   destOffset_ = destinationOffset;
   impl_->initialize();
+  traceName_ = srcRegionName_ + "." + srcOutputName_ + " -> " +
+    destRegionName_ + "." + destInputName_;
   initialized_ = true;
 
 }
@@ -238,6 +241,11 @@ const std::string& Link::getDestInputName() const
   return destInputName_;
 }
 
+const std::string& Link::getTraceName() const
+{
+  return traceName_;
+}
+
 const std::string Link::toString() const
 {
   std::stringstream ss;
@@ -313,21 +321,49 @@ Link::buildSplitterMap(Input::SplitterMap& splitter)
 }
 
 void
-Link::compute()
+Link::buildGatherPlans(std::vector<GatherPlan>& plans)
 {
-  NTA_CHECK(initialized_);
+  // The link policy generates the plans at the element level of the
+  // source output; offset them into the destination input's buffer.
+  std::vector<GatherPlan> protoPlans;
+  protoPlans.resize(plans.size());
+  size_t nodeElementCount = src_->getNodeOutputElementCount();
+  impl_->setNodeOutputElementCount(nodeElementCount);
+  impl_->buildProtoGatherPlans(protoPlans);
 
+  for (size_t destNode = 0; destNode < plans.size(); destNode++)
+  {
+    plans[destNode].appendPlan(protoPlans[destNode], destOffset_);
+  }
+}
+
+void
+Link::compute()
+{
   // Copy data from source to destination.
   // TBD: with zero-copy optimization, we won't do anything,
   // but that isn't implemented yet.
-  const Array & src = src_->getData();
-  const Array & dest = dest_->getData();
+  const char* src;
+  char* dest;
+  size_t srcSize = getCopyRange(src, dest);
+  NTA_TRACE_SPAN(span, "link", traceName_);
+  NTA_TRACE_BYTES(span, srcSize);
+  ::memcpy(dest, src, srcSize);
+}
+
+size_t
+Link::getCopyRange(const char*& src, char*& dest) const
+{
+  NTA_CHECK(initialized_);
+
+  const Array & srcArray = src_->getData();
+  const Array & destArray = dest_->getData();
 
   // TBD: use src offset and src size (only for certain types of links)
-  size_t typeSize = BasicType::getSize(src.getType());
-  size_t srcSize = src.getCount() * typeSize;
-  size_t destByteOffset = destOffset_ * typeSize;
-  ::memcpy((char*)(dest.getBuffer()) + destByteOffset, src.getBuffer(), srcSize);
+  size_t typeSize = BasicType::getSize(srcArray.getType());
+  src = (const char*)srcArray.getBuffer();
+  dest = (char*)destArray.getBuffer() + destOffset_ * typeSize;
+  return srcArray.getCount() * typeSize;
 }
 
 void Link::write(LinkProto::Builder& proto) const
@@ -243,6 +243,13 @@ namespace nupic
      */
     const std::string& getDestInputName() const;
 
+    /**
+     * Get the name of the spans traced for this link,
+     * "srcRegion.srcOutput -> destRegion.destInput". Set by initialize(),
+     * so that tracing does not build it every time.
+     */
+    const std::string& getTraceName() const;
+
     /**
      * @}
      *
@@ -283,6 +290,26 @@ namespace nupic
     void
     compute();
 
+    /**
+     * Get the copy that compute() does, as raw byte ranges.
+     *
+     * Network resolves these once it is initialized, so that run() copies
+     * the links' data without going through Input and Link.
+     *
+     * @param[out] src
+     *            The start of the source Output's buffer
+     * @param[out] dest
+     *            The start of this link's section of the destination
+     *            Input's buffer
+     *
+     * @returns
+     *         The number of bytes compute() copies
+     *
+     * @note This method must be called on a fully initialized link(all 4 phases).
+     */
+    size_t
+    getCopyRange(const char*& src, char*& dest) const;
+
     /**
      * Build a splitter map from the link.
      *
@@ -330,14 +357,29 @@ namespace nupic
      *
      * ### Splitter map ownership
      *
-     * The splitter map is owned by the containing Input. Each Link
-     * in the input contributes a portion to the splitter map, through
-     * the buildSplitterMap method.
+     * The splitter map is owned by the containing Input, which expands
+     * it from the gather plans of its links (see buildGatherPlans).
+     * This method builds the same rows directly from the link policy.
      *
      */
     void
     buildSplitterMap(Input::SplitterMap& splitter);
 
+    /**
+     * Build gather plans from the link.
+     *
+     * @param[in,out] plans
+     *            One GatherPlan per node of the destination region
+     *
+     * The gather plans hold the splitter map (see Input::SplitterMap)
+     * compiled into runs of elements (see GatherPlan). Each link of an
+     * input contributes a contiguous block of the region input, so this
+     * method appends this link's contribution to each node's plan,
+     * offset by the link's destination offset.
+     */
+    void
+    buildGatherPlans(std::vector<GatherPlan>& plans);
+
     /**
      * Convert the Link to a human-readable string.
      *
@@ -447,6 +489,7 @@ namespace nupic
     std::string destRegionName_;
     std::string srcOutputName_;
     std::string destInputName_;
+    std::string traceName_;
 
     // We store the values given to use. Use these for
     // serialization instead of serializing the LinkPolicy
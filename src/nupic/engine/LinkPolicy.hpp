@@ -63,6 +63,20 @@ namespace nupic
     //
     virtual void buildProtoSplitterMap(Input::SplitterMap& splitter) const = 0;
 
+    // The protoSplitterMap compiled into one GatherPlan per dest node
+    // (see GatherPlan). Policies that know their receptive fields are
+    // contiguous spans override this to build the runs directly.
+    virtual void buildProtoGatherPlans(std::vector<GatherPlan>& plans) const
+    {
+      Input::SplitterMap splitter(plans.size());
+      buildProtoSplitterMap(splitter);
+      for (size_t node = 0; node < plans.size(); node++)
+      {
+        for (auto & elem : splitter[node])
+          plans[node].append(elem);
+      }
+    }
+
   };
 
 
@@ -24,6 +24,7 @@
 Implementation of the Network class
 */
 
+#include <cstring>
 #include <limits>
 #include <iostream>
 #include <sstream>
@@ -34,6 +35,7 @@ Implementation of the Network class
 #include <kj/std/iostream.h>
 
 #include <nupic/engine/Network.hpp>
+#include <nupic/engine/NetworkCheckpointer.hpp>
 #include <nupic/engine/Region.hpp>
 #include <nupic/engine/Spec.hpp>
 #include <nupic/engine/Link.hpp>
@@ -42,6 +44,7 @@ Implementation of the Network class
 #include <nupic/proto/RegionProto.capnp.h>
 #include <nupic/utils/Log.hpp>
 #include <nupic/utils/StringUtils.hpp>
+#include <nupic/utils/Tracer.hpp>
 #include <nupic/engine/NuPIC.hpp> // for register/unregister
 #include <nupic/os/FStream.hpp>
 #include <nupic/os/Path.hpp>
@@ -68,12 +71,48 @@ Network::Network(const std::string& path)
   NuPIC::registerNetwork(this);
 }
 
+Network::Network(const Network& other) :
+  initialized_(other.initialized_),
+  regions_(other.regions_),
+  minEnabledPhase_(other.minEnabledPhase_),
+  maxEnabledPhase_(other.maxEnabledPhase_),
+  phaseInfo_(other.phaseInfo_),
+  planCompiled_(other.planCompiled_),
+  planRegions_(other.planRegions_),
+  planInputs_(other.planInputs_),
+  planCopies_(other.planCopies_),
+  callbacks_(other.callbacks_),
+  iteration_(other.iteration_)
+{
+}
+
+Network& Network::operator=(const Network& other)
+{
+  if (this == &other)
+    return *this;
+
+  initialized_ = other.initialized_;
+  regions_ = other.regions_;
+  minEnabledPhase_ = other.minEnabledPhase_;
+  maxEnabledPhase_ = other.maxEnabledPhase_;
+  phaseInfo_ = other.phaseInfo_;
+  planCompiled_ = other.planCompiled_;
+  planRegions_ = other.planRegions_;
+  planInputs_ = other.planInputs_;
+  planCopies_ = other.planCopies_;
+  callbacks_ = other.callbacks_;
+  iteration_ = other.iteration_;
+  checkpointer_.reset();
+  return *this;
+}
+
 void Network::commonInit()
 {
   initialized_ = false;
   iteration_ = 0;
   minEnabledPhase_ = 0;
   maxEnabledPhase_ = 0;
+  planCompiled_ = false;
   // automatic initialization of NuPIC, so users don't
   // have to call NuPIC::initialize
   NuPIC::init();
@@ -89,7 +128,11 @@ Network::~Network()
    * - unitialize all regions because otherwise we won't be able to disconnect them
    * - remove all links, because we can't delete connected regions
    * - delete the regions themselves.
+   *
+   * An in-flight checkpoint only holds its own snapshot, but finish
+   * writing it before the network goes away.
    */
+  checkpointer_.reset();
 
   // 1. uninitialize
   for (size_t i = 0; i < regions_.getCount(); i++)
@@ -242,6 +285,7 @@ Network::resetEnabledPhases_()
   // min/max enabled phases based on what is in the network
   minEnabledPhase_ = getMinPhase();
   maxEnabledPhase_ = getMaxPhase();
+  planCompiled_ = false;
 }
 
 
@@ -363,6 +407,7 @@ Network::link(const std::string& srcRegionName, const std::string& destRegionNam
 
   // Create the link itself
   destInput->addLink(linkType, linkParams, srcOutput);
+  planCompiled_ = false;
 
 }
 
@@ -408,6 +453,7 @@ Network::removeLink(const std::string& srcRegionName, const std::string& destReg
 
   // Finally, remove the link
   destInput->removeLink(link);
+  planCompiled_ = false;
 
 }
 
@@ -426,22 +472,40 @@ Network::run(int n)
 
   for(int iter = 0; iter < n; iter++)
   {
+    // Callbacks may change phases or remove regions, which invalidates
+    // the plan of the previous iteration
+    if (!planCompiled_)
+      compilePlan_();
+
     iteration_++;
+    NTA_TRACE_SPAN(iterationSpan, "network", "iteration");
+    NTA_TRACE_ITERATION(iterationSpan, iteration_);
 
-    // compute on all enabled regions in phase order
-    for (UInt32 phase = minEnabledPhase_; phase <= maxEnabledPhase_; phase++)
+    // compute on all enabled regions in phase order, after copying
+    // their inputs as Region::prepareInputs() would
+    size_t input = 0, copy = 0;
+    for (const auto & step : planRegions_)
     {
-      for (auto r : phaseInfo_[phase])
+      for (; input < step.inputsEnd; input++)
       {
-
-        r->prepareInputs();
-        r->compute();
+        const PlanInput_& in = planInputs_[input];
+        NTA_TRACE_SPAN(prepareSpan, "prepare", in.input->getTraceName());
+        for (; copy < in.copiesEnd; copy++)
+        {
+          const PlanCopy_& c = planCopies_[copy];
+          NTA_TRACE_SPAN(linkSpan, "link", c.link->getTraceName());
+          NTA_TRACE_BYTES(linkSpan, c.bytes);
+          ::memcpy(c.dest, c.src, c.bytes);
+        }
       }
+      step.region->compute();
     }
     // invoke callbacks
     for (UInt32 i = 0; i < callbacks_.getCount(); i++)
     {
       std::pair<std::string, callbackItem>& callback = callbacks_.getByIndex(i);
+      NTA_TRACE_SPAN(callbackSpan, "callback", callback.first);
+      NTA_TRACE_ITERATION(callbackSpan, iteration_);
       callback.second.first(this, iteration_, callback.second.second);
     }
 
@@ -451,6 +515,42 @@ Network::run(int n)
 }
 
 
+void
+Network::compilePlan_()
+{
+  planRegions_.clear();
+  planInputs_.clear();
+  planCopies_.clear();
+
+  // A region in several enabled phases computes once per phase. Buffers
+  // are allocated by initialize() and stay put until the regions are
+  // uninitialized, which only happens along with a change of phases.
+  for (UInt32 phase = minEnabledPhase_; phase <= maxEnabledPhase_; phase++)
+  {
+    for (auto r : phaseInfo_[phase])
+    {
+      for (const auto & elem : r->getInputs())
+      {
+        Input* in = elem.second;
+        for (auto link : in->getLinks())
+        {
+          PlanCopy_ c;
+          c.bytes = link->getCopyRange(c.src, c.dest);
+          c.link = link;
+          planCopies_.push_back(c);
+        }
+        PlanInput_ pi = {in, planCopies_.size()};
+        planInputs_.push_back(pi);
+      }
+      PlanRegion_ pr = {r, planInputs_.size()};
+      planRegions_.push_back(pr);
+    }
+  }
+
+  planCompiled_ = true;
+}
+
+
 void
 Network::initialize()
 {
@@ -627,6 +727,7 @@ Network::setMinEnabledPhase(UInt32 minPhase)
               << " which is larger than the highest phase in the network - "
               << phaseInfo_.size() - 1;
   minEnabledPhase_ = minPhase;
+  planCompiled_ = false;
 }
 
 void
@@ -637,6 +738,7 @@ Network::setMaxEnabledPhase(UInt32 maxPhase)
               << " which is larger than the highest phase in the network - "
               << phaseInfo_.size() - 1;
   maxEnabledPhase_ = maxPhase;
+  planCompiled_ = false;
 }
 
 UInt32
@@ -786,9 +888,12 @@ void Network::load(const std::string& path)
   } else if (StringUtils::endsWith(path, ".nta"))
   {
     loadFromBundle(path);
+  } else if (StringUtils::endsWith(path, ".ckpt"))
+  {
+    loadFromCheckpoint(path);
   } else {
     NTA_THROW << "Network::save -- unknown file extension for '" << path
-              << "'. Supported extensions are  .tgz and .nta";
+              << "'. Supported extensions are  .tgz, .nta and .ckpt";
   }
 
 }
@@ -992,6 +1097,117 @@ void Network::loadFromBundle(const std::string& name)
 
 }
 
+void Network::checkpoint(const std::string& name)
+{
+  if (! StringUtils::endsWith(name, ".ckpt"))
+    NTA_THROW << "Network::checkpoint -- checkpoint extension must be \".ckpt\"";
+
+  if (checkpointer_ == nullptr)
+    checkpointer_.reset(new NetworkCheckpointer());
+
+  std::string fullPath = Path::normalize(Path::makeAbsolute(name));
+  checkpointer_->checkpoint(fullPath, regions_);
+}
+
+void Network::waitForCheckpoint()
+{
+  if (checkpointer_ != nullptr)
+    checkpointer_->wait();
+}
+
+void Network::loadFromCheckpoint(const std::string& name)
+{
+  std::string fullPath = Path::normalize(Path::makeAbsolute(name));
+
+  std::string manifestFilename =
+    Path::join(fullPath, NetworkCheckpointer::manifestName);
+  if (! Path::exists(manifestFilename))
+    NTA_THROW << "Path " << fullPath << " is not a network checkpoint";
+
+  IFStream f(manifestFilename.c_str());
+  YAML::Parser parser(f);
+  YAML::Node doc;
+  if (! parser.GetNextDocument(doc) || doc.Type() != YAML::NodeType::Map)
+    NTA_THROW << "Invalid checkpoint manifest " << manifestFilename;
+
+  const YAML::Node *node = doc.FindValue("Version");
+  if (node == nullptr)
+    NTA_THROW << "Invalid checkpoint manifest -- no version";
+  UInt32 version;
+  *node >> version;
+  if (version != NetworkCheckpointer::formatVersion)
+    NTA_THROW << "Invalid checkpoint manifest -- only version "
+              << NetworkCheckpointer::formatVersion << " supported";
+
+  const YAML::Node *regions = doc.FindValue("Regions");
+  if (regions == nullptr || regions->Type() != YAML::NodeType::Sequence)
+    NTA_THROW << "Invalid checkpoint manifest -- no list of regions";
+
+  // Region state can be much larger than capnp's default traversal limit
+  capnp::ReaderOptions options;
+  options.traversalLimitInWords = std::numeric_limits<uint64_t>::max();
+
+  for (YAML::Iterator region = regions->begin(); region != regions->end(); region++)
+  {
+    node = (*region).FindValue("name");
+    if (node == nullptr)
+      NTA_THROW << "Invalid checkpoint manifest -- region has no name";
+    std::string name;
+    *node >> name;
+
+    node = (*region).FindValue("file");
+    if (node == nullptr)
+      NTA_THROW << "Invalid checkpoint manifest -- region "
+                << name << " has no file";
+    std::string file;
+    *node >> file;
+
+    IFStream regionFile(Path::join(fullPath, file).c_str(),
+                        std::ios_base::in | std::ios_base::binary);
+    kj::std::StdInputStream in(regionFile);
+    capnp::InputStreamMessageReader message(in, options);
+    RegionProto::Reader proto = message.getRoot<RegionProto>();
+
+    Region *r = addRegionFromProto(name, proto);
+    std::set<UInt32> phases;
+    for (auto phase : proto.getPhases())
+    {
+      phases.insert(phase);
+    }
+    setPhases_(r, phases);
+  }
+
+  const YAML::Node *links = doc.FindValue("Links");
+  if (links == nullptr || links->Type() != YAML::NodeType::Sequence)
+    NTA_THROW << "Invalid checkpoint manifest -- no list of links";
+
+  for (YAML::Iterator link = links->begin(); link != links->end(); link++)
+  {
+    std::string linkType, params, srcRegionName, srcOutputName,
+      destRegionName, destInputName;
+    (*link)["type"] >> linkType;
+    (*link)["params"] >> params;
+    (*link)["srcRegion"] >> srcRegionName;
+    (*link)["srcOutput"] >> srcOutputName;
+    (*link)["destRegion"] >> destRegionName;
+    (*link)["destInput"] >> destInputName;
+
+    if (!regions_.contains(srcRegionName))
+      NTA_THROW << "Invalid checkpoint manifest -- link specifies source region '" << srcRegionName << "' but no such region exists";
+    Output* srcOutput = regions_.getByName(srcRegionName)->getOutput(srcOutputName);
+    if (srcOutput == nullptr)
+      NTA_THROW << "Invalid checkpoint manifest -- link specifies source output '" << srcOutputName << "' but no such name exists";
+
+    if (!regions_.contains(destRegionName))
+      NTA_THROW << "Invalid checkpoint manifest -- link specifies destination region '" << destRegionName << "' but no such region exists";
+    Input* destInput = regions_.getByName(destRegionName)->getInput(destInputName);
+    if (destInput == nullptr)
+      NTA_THROW << "Invalid checkpoint manifest -- link specifies destination input '" << destInputName << "' but no such name exists";
+
+    destInput->addLink(linkType, params, srcOutput);
+  }
+}
+
 void Network::write(NetworkProto::Builder& proto) const
 {
   // Aggregate links from all of the regions
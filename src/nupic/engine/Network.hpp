@@ -30,6 +30,7 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -44,8 +45,11 @@ namespace nupic
 {
 
   class Region;
+  class Input;
+  class Link;
   class Dimensions;
   class GenericRegisteredRegionImpl;
+  class NetworkCheckpointer;
 
 
   /**
@@ -71,11 +75,12 @@ namespace nupic
     Network();
 
     /**
-     * Create a Network by loading previously saved bundle,
+     * Create a Network by loading previously saved bundle or checkpoint,
      * and register it to NuPIC.
      *
      * @param path The path to the previously saved bundle file, currently only
-     * support files with `.nta` extension.
+     * support files with `.nta` extension, or to a checkpoint written by
+     * checkpoint() (extension `.ckpt`).
      *
      * @note Creating a Network will auto-initialize NuPIC.
      */
@@ -94,6 +99,14 @@ namespace nupic
      */
     ~Network();
 
+    /**
+     * Copy the network member by member, as the implicit copy did: the
+     * copy shares the regions of @a other. It has no checkpointer of its
+     * own until its first checkpoint().
+     */
+    Network(const Network& other);
+    Network& operator=(const Network& other);
+
     /**
      * Initialize all elements of a network so that it can run.
      *
@@ -121,6 +134,35 @@ namespace nupic
      */
     void save(const std::string& name);
 
+    /**
+     * Write a checkpoint of the network (extension `.ckpt`) in the
+     * background.
+     *
+     * The state of the regions is snapshotted into in-memory Cap'n Proto
+     * messages before this method returns, and written to disk on a
+     * background thread, so the network can keep running. Repeated
+     * checkpoints to the same path are incremental: only regions that
+     * changed since the previous checkpoint are written again. Running a
+     * region changes it (see Region::getModificationCount()), so this
+     * saves the regions that did not run in between, e.g. those in
+     * disabled phases.
+     *
+     * A checkpoint can be loaded with Network(path).
+     *
+     * @param name
+     *        Name of the checkpoint directory
+     *
+     * @note Errors of the background write are reported by the next call to
+     * checkpoint() or waitForCheckpoint().
+     */
+    void checkpoint(const std::string& name);
+
+    /**
+     * Block until the checkpoint started by checkpoint(), if any, is
+     * completely written.
+     */
+    void waitForCheckpoint();
+
     /**
      * @}
      *
@@ -331,6 +373,11 @@ namespace nupic
      *
      * For each iteration, Region.compute() is called.
      *
+     * The order of the regions, their inputs and the copies their links do
+     * are compiled into an execution plan the first time run() is called
+     * after the network is initialized or its phases change, so that each
+     * iteration only copies memory and calls compute().
+     *
      * @param n Number of iterations
      */
     void
@@ -429,6 +476,8 @@ namespace nupic
 
     void loadFromBundle(const std::string& path);
 
+    void loadFromCheckpoint(const std::string& path);
+
     // save() always calls this internal method, which creates
     // a .nta bundle
     void saveToBundle(const std::string& bundleName);
@@ -445,6 +494,32 @@ namespace nupic
     // the network
     void resetEnabledPhases_();
 
+    // flattens the enabled phases into the execution plan below
+    void compilePlan_();
+
+    // the copy a link does when its destination input is prepared
+    struct PlanCopy_
+    {
+      const char* src;
+      char* dest;
+      size_t bytes;
+      Link* link;
+    };
+
+    // an input and the end of its copies in planCopies_
+    struct PlanInput_
+    {
+      Input* input;
+      size_t copiesEnd;
+    };
+
+    // a region to compute and the end of its inputs in planInputs_
+    struct PlanRegion_
+    {
+      Region* region;
+      size_t inputsEnd;
+    };
+
     bool initialized_;
     Collection<Region*> regions_;
 
@@ -455,11 +530,21 @@ namespace nupic
     // network computation
     std::vector< std::set<Region*> > phaseInfo_;
 
+    // The execution plan run() follows, in phase order. It is cleared
+    // whenever the regions or the enabled phases change.
+    bool planCompiled_;
+    std::vector<PlanRegion_> planRegions_;
+    std::vector<PlanInput_> planInputs_;
+    std::vector<PlanCopy_> planCopies_;
+
     // we invoke these callbacks at every iteration
     Collection<callbackItem> callbacks_;
 
     //number of elapsed iterations
     UInt64 iteration_;
+
+    // created by the first call to checkpoint()
+    std::unique_ptr<NetworkCheckpointer> checkpointer_;
   };
 
 } // namespace nupic
@@ -0,0 +1,307 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Implementation of the NetworkCheckpointer class
+ */
+
+#include <exception>
+#include <functional>
+
+#include <capnp/serialize.h>
+#include <kj/std/iostream.h>
+#include <yaml-cpp/yaml.h>
+
+#include <nupic/engine/NetworkCheckpointer.hpp>
+#include <nupic/engine/Input.hpp>
+#include <nupic/engine/Link.hpp>
+#include <nupic/engine/Region.hpp>
+#include <nupic/os/Directory.hpp>
+#include <nupic/os/FStream.hpp>
+#include <nupic/os/Path.hpp>
+#include <nupic/proto/RegionProto.capnp.h>
+#include <nupic/utils/Log.hpp>
+#include <nupic/utils/StringUtils.hpp>
+
+namespace nupic
+{
+
+  const std::string NetworkCheckpointer::manifestName("network.yaml");
+  const UInt32 NetworkCheckpointer::formatVersion = 1;
+
+  NetworkCheckpointer::NetworkCheckpointer() :
+    generation_(0),
+    lastWrittenRegionCount_(0)
+  {
+  }
+
+  NetworkCheckpointer::~NetworkCheckpointer()
+  {
+    try
+    {
+      join_();
+    }
+    catch (std::exception& e)
+    {
+      NTA_WARN << e.what();
+    }
+  }
+
+  void NetworkCheckpointer::checkpoint(const std::string& path,
+                                       const Collection<Region*>& regions)
+  {
+    std::string manifestPath = Path::join(path, manifestName);
+    bool incremental = (path == lastPath_);
+
+    if (!incremental)
+    {
+      // A full checkpoint may overwrite a checkpoint written by another
+      // network or process; nothing to overlap with, so finish the
+      // in-flight write before looking at the directory.
+      join_();
+
+      if (Path::exists(path) &&
+          (!Path::isDirectory(path) || !Path::exists(manifestPath)))
+      {
+        NTA_THROW << "Existing filesystem entry " << path
+                  << " is not a network checkpoint -- refusing to overwrite";
+      }
+      records_.clear();
+    }
+
+    Job job;
+    job.path = path;
+
+    UInt64 generation = generation_ + 1;
+    if (!incremental)
+      scanExisting_(path, generation, job.obsoleteFiles);
+
+    // 1. Snapshot every region that changed since the last checkpoint.
+    // Records are keyed by Region::getInstanceId() so that a region removed
+    // and re-added under the same name is always written again.
+    std::map<UInt64, RegionRecord> records;
+    std::vector<std::string> regionFiles;
+    for (size_t i = 0; i < regions.getCount(); i++)
+    {
+      Region* r = regions.getByIndex(i).second;
+
+      auto previous = records_.find(r->getInstanceId());
+      if (previous != records_.end() &&
+          previous->second.modificationCount == r->getModificationCount())
+      {
+        records[r->getInstanceId()] = previous->second;
+        regionFiles.push_back(previous->second.file);
+        continue;
+      }
+
+      RegionRecord& record = records[r->getInstanceId()];
+      record.modificationCount = r->getModificationCount();
+      record.file = std::string("R") + StringUtils::fromInt(i) + "-" +
+        StringUtils::fromInt(generation) + ".capnp";
+      regionFiles.push_back(record.file);
+
+      auto message = std::make_shared<capnp::MallocMessageBuilder>();
+      RegionProto::Builder proto = message->initRoot<RegionProto>();
+      r->write(proto);
+      job.files.push_back(std::make_pair(record.file, message));
+
+      if (previous != records_.end())
+        job.obsoleteFiles.push_back(previous->second.file);
+    }
+
+    // Files of regions that were removed from the network
+    for (const auto& previous : records_)
+    {
+      if (records.find(previous.first) == records.end())
+        job.obsoleteFiles.push_back(previous.second.file);
+    }
+
+    // 2. Describe the network structure
+    YAML::Emitter out;
+    out << YAML::BeginMap;
+    out << YAML::Key << "Version" << YAML::Value << formatVersion;
+    out << YAML::Key << "Generation" << YAML::Value << generation;
+    out << YAML::Key << "Regions" << YAML::Value << YAML::BeginSeq;
+    for (size_t i = 0; i < regions.getCount(); i++)
+    {
+      const std::string& name = regions.getByIndex(i).first;
+      out << YAML::BeginMap;
+      out << YAML::Key << "name" << YAML::Value << name;
+      out << YAML::Key << "file" << YAML::Value << regionFiles[i];
+      out << YAML::EndMap;
+    }
+    out << YAML::EndSeq;
+
+    out << YAML::Key << "Links" << YAML::Value << YAML::BeginSeq;
+    for (size_t i = 0; i < regions.getCount(); i++)
+    {
+      Region* r = regions.getByIndex(i).second;
+      for (const auto& input : r->getInputs())
+      {
+        for (const auto& link : input.second->getLinks())
+        {
+          out << YAML::BeginMap;
+          out << YAML::Key << "type" << YAML::Value << link->getLinkType();
+          out << YAML::Key << "params" << YAML::Value << link->getLinkParams();
+          out << YAML::Key << "srcRegion" << YAML::Value << link->getSrcRegionName();
+          out << YAML::Key << "srcOutput" << YAML::Value << link->getSrcOutputName();
+          out << YAML::Key << "destRegion" << YAML::Value << link->getDestRegionName();
+          out << YAML::Key << "destInput" << YAML::Value << link->getDestInputName();
+          out << YAML::EndMap;
+        }
+      }
+    }
+    out << YAML::EndSeq;
+    out << YAML::EndMap;
+    job.manifest = out.c_str();
+
+    // 3. The snapshot is complete; hand it to the writer once the previous
+    // checkpoint is on disk.
+    join_();
+
+    lastWrittenRegionCount_ = job.files.size();
+    records_.swap(records);
+    generation_ = generation;
+    lastPath_ = path;
+    inFlightPath_ = path;
+    writer_ = std::thread(&NetworkCheckpointer::write_, std::move(job),
+                          std::ref(error_));
+  }
+
+  void NetworkCheckpointer::wait()
+  {
+    join_();
+  }
+
+  size_t NetworkCheckpointer::getLastWrittenRegionCount() const
+  {
+    return lastWrittenRegionCount_;
+  }
+
+  void NetworkCheckpointer::join_()
+  {
+    if (!writer_.joinable())
+      return;
+
+    writer_.join();
+    if (!error_.empty())
+    {
+      // The checkpoint on disk no longer matches our records, so the next
+      // checkpoint must be a full one.
+      std::string error;
+      error.swap(error_);
+      lastPath_.clear();
+      records_.clear();
+      NTA_THROW << "Checkpoint to " << inFlightPath_ << " failed: " << error;
+    }
+  }
+
+  void NetworkCheckpointer::scanExisting_(const std::string& path,
+                                          UInt64& generation,
+                                          std::vector<std::string>& files) const
+  {
+    std::string manifestPath = Path::join(path, manifestName);
+    if (!Path::exists(manifestPath))
+      return;
+
+    IFStream f(manifestPath.c_str());
+    YAML::Parser parser(f);
+    YAML::Node doc;
+    if (!parser.GetNextDocument(doc) || doc.Type() != YAML::NodeType::Map)
+      return;
+
+    // Keep generations increasing so that new files never clobber files
+    // that the existing manifest refers to.
+    const YAML::Node* node = doc.FindValue("Generation");
+    if (node != nullptr)
+    {
+      UInt64 existing;
+      *node >> existing;
+      if (existing >= generation)
+        generation = existing + 1;
+    }
+
+    const YAML::Node* regions = doc.FindValue("Regions");
+    if (regions == nullptr || regions->Type() != YAML::NodeType::Sequence)
+      return;
+
+    for (YAML::Iterator region = regions->begin(); region != regions->end(); region++)
+    {
+      node = (*region).FindValue("file");
+      if (node == nullptr)
+        continue;
+      std::string file;
+      *node >> file;
+      files.push_back(file);
+    }
+  }
+
+  void NetworkCheckpointer::write_(const Job& job, std::string& error)
+  {
+    try
+    {
+      if (!Path::exists(job.path))
+        Directory::create(job.path, false, true);
+
+      for (const auto& file : job.files)
+      {
+        std::string filePath = Path::join(job.path, file.first);
+        std::string tmpPath = filePath + ".tmp";
+        OFStream f(tmpPath.c_str(), std::ios_base::out | std::ios_base::binary);
+        {
+          kj::std::StdOutputStream out(f);
+          capnp::writeMessage(out, *file.second);
+        }
+        f.close();
+        if (f.fail())
+          NTA_THROW << "Unable to write " << tmpPath;
+        Path::rename(tmpPath, filePath);
+      }
+
+      // Committing the manifest switches the checkpoint to the new generation
+      std::string manifestPath = Path::join(job.path, manifestName);
+      std::string tmpPath = manifestPath + ".tmp";
+      OFStream f(tmpPath.c_str());
+      f << job.manifest;
+      f.close();
+      if (f.fail())
+        NTA_THROW << "Unable to write " << tmpPath;
+#if defined(NTA_OS_WINDOWS)
+      // MoveFile does not replace an existing file
+      Path::remove(manifestPath);
+#endif
+      Path::rename(tmpPath, manifestPath);
+
+      for (const auto& file : job.obsoleteFiles)
+        Path::remove(Path::join(job.path, file));
+    }
+    catch (std::exception& e)
+    {
+      error = e.what();
+    }
+    catch (...)
+    {
+      error = "unknown error";
+    }
+  }
+
+} // namespace nupic
@@ -0,0 +1,158 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Interface for the NetworkCheckpointer class
+ */
+
+#ifndef NTA_NETWORK_CHECKPOINTER_HPP
+#define NTA_NETWORK_CHECKPOINTER_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <capnp/message.h>
+
+#include <nupic/ntypes/Collection.hpp>
+#include <nupic/types/Types.hpp>
+
+namespace nupic
+{
+
+  class Region;
+
+  /**
+   * Writes asynchronous, incremental checkpoints of a Network.
+   *
+   * A checkpoint is a directory (extension `.ckpt`) containing a
+   * `network.yaml` manifest and one Cap'n Proto RegionProto message per
+   * region. checkpoint() snapshots the state of every region that changed
+   * since the previous checkpoint into an in-memory message builder and
+   * returns; the messages and the manifest are written to disk on a
+   * background thread while the network keeps running.
+   *
+   * Region files are named after the checkpoint generation that wrote them,
+   * and the manifest is replaced atomically once all new region files are on
+   * disk, so an interrupted checkpoint leaves the previous one intact.
+   * Consecutive checkpoints to the same path only write the regions that
+   * were added or whose Region::getModificationCount() changed; unchanged
+   * regions keep pointing at the files written by an earlier generation.
+   * Every compute() changes the count, so only regions that did not run
+   * since the previous checkpoint are skipped.
+   * Regions are identified by Region::getInstanceId(), not by name.
+   *
+   * At most one checkpoint is in flight: a new checkpoint takes its snapshot
+   * first and then waits for the previous write to finish, so snapshotting
+   * overlaps with the previous write.
+   *
+   * @b Constraints
+   *
+   * checkpoint() and wait() must be called from the thread that runs the
+   * network.
+   */
+  class NetworkCheckpointer
+  {
+  public:
+    NetworkCheckpointer();
+
+    /**
+     * Waits for any in-flight write. Errors from that write are logged
+     * rather than thrown.
+     */
+    ~NetworkCheckpointer();
+
+    /**
+     * Snapshot the regions and start writing the checkpoint.
+     *
+     * @param path Absolute, normalized path of the checkpoint directory
+     * @param regions The regions of the network, in network order
+     *
+     * @throws if the previous checkpoint failed, or if @a path exists and
+     * is not a checkpoint directory.
+     */
+    void checkpoint(const std::string& path,
+                    const Collection<Region*>& regions);
+
+    /**
+     * Block until the in-flight checkpoint, if any, is on disk.
+     *
+     * @throws if the in-flight checkpoint failed.
+     */
+    void wait();
+
+    /**
+     * @returns The number of region files written by the most recent call
+     * to checkpoint(). Useful to check how incremental a checkpoint was.
+     */
+    size_t getLastWrittenRegionCount() const;
+
+    // Name of the manifest file inside a checkpoint directory
+    static const std::string manifestName;
+
+    // Version of the checkpoint manifest format
+    static const UInt32 formatVersion;
+
+  private:
+    // Checkpoint state recorded for a region in the last checkpoint
+    struct RegionRecord
+    {
+      UInt64 modificationCount;
+      std::string file;
+    };
+
+    // Everything the background thread needs to write one checkpoint
+    struct Job
+    {
+      std::string path;
+      std::string manifest;
+      std::vector<std::pair<std::string,
+                  std::shared_ptr<capnp::MallocMessageBuilder> > > files;
+      std::vector<std::string> obsoleteFiles;
+    };
+
+    // Read the generation and region files of an existing checkpoint
+    void scanExisting_(const std::string& path, UInt64& generation,
+                       std::vector<std::string>& files) const;
+
+    // Join the writer thread and rethrow its error, if any
+    void join_();
+
+    // Runs on the writer thread
+    static void write_(const Job& job, std::string& error);
+
+    std::thread writer_;
+    std::string error_;
+    std::string inFlightPath_;
+
+    std::string lastPath_;
+    UInt64 generation_;
+    // Keyed by Region::getInstanceId()
+    std::map<UInt64, RegionRecord> records_;
+    size_t lastWrittenRegionCount_;
+  };
+
+} // namespace nupic
+
+#endif // NTA_NETWORK_CHECKPOINTER_HPP
@@ -21,6 +21,7 @@
  */
 
 #include <iostream>
+#include <sstream>
 #include <string>
 
 #include <nupic/engine/Network.hpp>
@@ -41,18 +42,231 @@ namespace nupic
 
   Network NetworkFactory::createNetwork(const std::string& path)
   { 
+    return createNetwork(getDescription(path));
+  }
+
+  Network NetworkFactory::createNetwork(
+    const std::string& path,
+    const std::map<std::string, std::string>& paramDeltas)
+  {
+    return createNetwork(getDescription(path), paramDeltas);
+  }
+
+  const NetworkDescription& NetworkFactory::getDescription(const std::string& path)
+  {
     std::string fullPath = Path::normalize(Path::makeAbsolute(path));
+    auto it = descriptions_.find(fullPath);
+    if (it != descriptions_.end())
+      return it->second;
+
     if (! Path::exists(fullPath)) 
     {
       NTA_THROW << "Path " << fullPath << " does not exist";
     }
     std::ifstream f(fullPath.c_str());
     YAML::Parser parser(f);
-    return createNetworkFromYAML(parser);
+    NetworkDescription description = parseYAML(parser);
+    return descriptions_[fullPath] = description;
+  }
+
+  void NetworkFactory::clearDescriptions()
+  {
+    descriptions_.clear();
   }
 
-   
   Network NetworkFactory::createNetworkFromYAML(YAML::Parser& parser)
+  { 
+    return createNetwork(parseYAML(parser));
+  }
+
+  // Parses a yaml dictionary of parameters; returns false if it is empty
+  static bool parseParams(const std::string& params, YAML::Node& doc)
+  {
+    if (params.empty())
+      return false;
+
+    // yaml-cpp bug: append a space if it is only one character
+    std::stringstream s(params.size() < 2 ? params + " " : params);
+    YAML::Parser parser(s);
+    if (!parser.GetNextDocument(doc))
+      return false;
+    if (doc.Type() != YAML::NodeType::Map)
+    {
+      NTA_THROW << "Parameters '" << params
+                << "' do not specify a dictionary of key-value pairs";
+    }
+    return true;
+  }
+
+  // Writes a yaml node in flow style, with the scalars double-quoted.
+  // This is much faster than YAML::Emitter, which checks for each scalar
+  // whether it must be quoted.
+  static void writeNode(const YAML::Node& node, std::ostream& out)
+  {
+    switch (node.Type())
+    {
+    case YAML::NodeType::Scalar:
+    {
+      std::string value;
+      node >> value;
+      out << '"';
+      for (char c : value)
+      {
+        if (c == '"' || c == '\\')
+          out << '\\' << c;
+        else if (c == '\n')
+          out << "\\n";
+        else
+          out << c;
+      }
+      out << '"';
+      break;
+    }
+    case YAML::NodeType::Sequence:
+    {
+      out << '[';
+      for (YAML::Iterator i = node.begin(); i != node.end(); i++)
+      {
+        if (i != node.begin())
+          out << ", ";
+        writeNode(*i, out);
+      }
+      out << ']';
+      break;
+    }
+    case YAML::NodeType::Map:
+    {
+      out << '{';
+      for (YAML::Iterator i = node.begin(); i != node.end(); i++)
+      {
+        if (i != node.begin())
+          out << ", ";
+        writeNode(i.first(), out);
+        out << ": ";
+        writeNode(i.second(), out);
+      }
+      out << '}';
+      break;
+    }
+    default:
+      out << '~';
+    }
+  }
+
+  std::string NetworkFactory::mergeParams(const std::string& nodeParams,
+                                          const std::string& delta)
+  {
+    YAML::Node base, changes;
+    bool hasBase = parseParams(nodeParams, base);
+    bool hasChanges = parseParams(delta, changes);
+    if (!hasChanges)
+      return nodeParams;
+
+    std::stringstream out;
+    out << '{';
+    bool first = true;
+    if (hasBase)
+    {
+      for (YAML::Iterator i = base.begin(); i != base.end(); i++)
+      {
+        const std::string key = i.first().to<std::string>();
+        const YAML::Node* value = changes.FindValue(key);
+        out << (first ? "" : ", ");
+        writeNode(i.first(), out);
+        out << ": ";
+        writeNode(value != nullptr ? *value : i.second(), out);
+        first = false;
+      }
+    }
+    for (YAML::Iterator i = changes.begin(); i != changes.end(); i++)
+    {
+      const std::string key = i.first().to<std::string>();
+      if (!hasBase || base.FindValue(key) == nullptr)
+      {
+        out << (first ? "" : ", ");
+        writeNode(i.first(), out);
+        out << ": ";
+        writeNode(i.second(), out);
+        first = false;
+      }
+    }
+    out << '}';
+    return out.str();
+  }
+
+  Network NetworkFactory::createNetwork(
+    const NetworkDescription& description,
+    const std::map<std::string, std::string>& paramDeltas)
+  {
+    Network n; // Network to be instantiated by the description.
+
+    size_t nDeltas = 0;
+    for (const auto & region : description.regions)
+    {
+      auto delta = paramDeltas.find(region.name);
+      if (delta == paramDeltas.end())
+      {
+        n.addRegion(region.name, region.nodeType, region.nodeParams);
+      }
+      else
+      {
+        n.addRegion(region.name, region.nodeType,
+                    mergeParams(region.nodeParams, delta->second));
+        nDeltas++;
+      }
+    }
+
+    if (nDeltas != paramDeltas.size())
+    {
+      for (const auto & delta : paramDeltas)
+      {
+        if (!n.getRegions().contains(delta.first))
+        {
+          NTA_THROW << "Parameters specified for region '" << delta.first
+                    << "' but no such region exists";
+        }
+      }
+    }
+
+    const Collection<Region*> regionList = n.getRegions(); // regions in the network.
+
+    for (const auto & link : description.links)
+    {
+      if (!regionList.contains(link.srcRegion))
+      {
+        NTA_THROW << "Invalid network structure file -- link specifies source region '" << link.srcRegion << "' but no such region exists";
+      }
+
+      Region* srcRegion = regionList.getByName(link.srcRegion);
+
+      if (!regionList.contains(link.destRegion))
+      {
+        NTA_THROW << "Invalid network structure file -- link specifies destination region '" << link.destRegion << "' but no such region exists";
+      }
+
+      Region* destRegion = regionList.getByName(link.destRegion);
+
+      Output* srcOutput = srcRegion->getOutput(link.srcOutput);
+      if (srcOutput == nullptr)
+      {
+        NTA_THROW << "Invalid network structure file -- link specifies source output '" << link.srcOutput << "' but no such name exists";
+      }
+
+      Input* destInput = destRegion->getInput(link.destInput);
+      if (destInput == nullptr)
+      {
+        NTA_THROW << "Invalid network structure file -- link specifies destination input '" << link.destInput << "' but no such name exists";
+      }
+
+      // Create the link itself
+
+      n.link(link.srcRegion, link.destRegion, link.type, link.params,
+             link.srcOutput, link.destInput);
+    }
+    return n;
+  }
+
+  NetworkDescription NetworkFactory::parseYAML(YAML::Parser& parser)
   { 
     YAML::Node doc;
     bool success = parser.GetNextDocument(doc);
@@ -86,7 +300,7 @@ namespace nupic
       NTA_THROW << "Invalid network structure file -- regions element is not a list";
     }
 
-    Network n; // Network to be instantiated by the yaml file.
+    NetworkDescription description;
 
     for (YAML::Iterator region = regions->begin(); region != regions->end(); region++)
     {
@@ -108,7 +322,8 @@ namespace nupic
         NTA_THROW << "Invalid network structure file -- region has no name";
       }
 
-      std::string name;
+      RegionDescription regionDescription;
+      std::string& name = regionDescription.name;
       *node >> name;
 
       // 2. nodeType
@@ -119,8 +334,7 @@ namespace nupic
                   << name << " has no node type";
       }
        
-      std::string nodeType;
-      *node >> nodeType;
+      *node >> regionDescription.nodeType;
 
       // 3. nodeParams
       node = (*region).FindValue("nodeParams");
@@ -130,15 +344,13 @@ namespace nupic
                   << name << "has no nodeParams";
       }
 
-      std::string nodeParams;
-      *node >> nodeParams;
+      *node >> regionDescription.nodeParams;
       
       // add the region specifed by a map of 3 strings in the sequence.
-      n.addRegion(name, nodeType, nodeParams);
+      description.regions.push_back(regionDescription);
     }
 
     const YAML::Node *links = doc.FindValue("Links");
-    const Collection<Region*> regionList = n.getRegions(); // regions in the network.
 
     if (links == nullptr)
     {  
@@ -169,8 +381,8 @@ namespace nupic
       {
         NTA_THROW << "Invalid network structure file -- link does not have a type";
       }
-      std::string linkType;
-      *node >> linkType;
+      LinkDescription linkDescription;
+      *node >> linkDescription.type;
 
       // 2. params
       node = (*link).FindValue("params");
@@ -179,8 +391,7 @@ namespace nupic
         NTA_THROW << "Invalid network structure file -- link does not have params";
       }
 
-      std::string params;
-      *node >> params;
+      *node >> linkDescription.params;
 
       // 3. srcRegion (name)
       node = (*link).FindValue("srcRegion");
@@ -189,8 +400,7 @@ namespace nupic
         NTA_THROW << "Invalid network structure file -- link does not have a srcRegion";
       }
 
-      std::string srcRegionName;
-      *node >> srcRegionName;
+      *node >> linkDescription.srcRegion;
 
       // 4. srcOutput
       node = (*link).FindValue("srcOutput");
@@ -199,8 +409,7 @@ namespace nupic
         NTA_THROW << "Invalid network structure file -- link does not have a srcOutput";
       }
 
-      std::string srcOutputName;
-      *node >> srcOutputName;
+      *node >> linkDescription.srcOutput;
 
       // 5. destRegion
       node = (*link).FindValue("destRegion");
@@ -209,8 +418,7 @@ namespace nupic
         NTA_THROW << "Invalid network structure file -- link does not have a destRegion";
       }
 
-      std::string destRegionName;
-      *node >> destRegionName;
+      *node >> linkDescription.destRegion;
 
       // 6. destInput
       node = (*link).FindValue("destInput");
@@ -219,39 +427,10 @@ namespace nupic
         NTA_THROW << "Invalid network structure file -- link does not have a destInput";
       }
 
-      std::string destInputName;
-      *node >> destInputName;
-
-      if (!regionList.contains(srcRegionName))
-      {
-        NTA_THROW << "Invalid network structure file -- link specifies source region '" << srcRegionName << "' but no such region exists";
-      }
-
-      Region* srcRegion = regionList.getByName(srcRegionName);
-
-      if (!regionList.contains(destRegionName))
-      {
-        NTA_THROW << "Invalid network structure file -- link specifies destination region '" << destRegionName << "' but no such region exists";
-      }
-
-      Region* destRegion = regionList.getByName(destRegionName);
-
-      Output* srcOutput = srcRegion->getOutput(srcOutputName);
-      if (srcOutput == nullptr)
-      {
-        NTA_THROW << "Invalid network structure file -- link specifies source output '" << srcOutputName << "' but no such name exists";
-      }
-
-      Input* destInput = destRegion->getInput(destInputName);
-      if (destInput == nullptr)
-      {
-        NTA_THROW << "Invalid network structure file -- link specifies destination input '" << destInputName << "' but no such name exists";
-      }
+      *node >> linkDescription.destInput;
 
-      // Create the link itself
-
-      n.link(srcRegionName, destRegionName, linkType, params, srcOutputName, destInputName);
+      description.links.push_back(linkDescription);
     }
-    return n;
+    return description;
   }
 } // namespace nupic
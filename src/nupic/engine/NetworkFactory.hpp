@@ -27,12 +27,41 @@
 #ifndef NTA_NETWORK_FACTORY_HPP
 #define NTA_NETWORK_FACTORY_HPP
 
-#include <iosfwd>  // for string
+#include <map>
+#include <string>
+#include <vector>
+
 namespace YAML { class Parser; }
 
 namespace nupic
 {
   class Network;
+
+  /** A region of a NetworkDescription, as given to Network::addRegion. */
+  struct RegionDescription
+  {
+    std::string name;
+    std::string nodeType;
+    std::string nodeParams;
+  };
+
+  /** A link of a NetworkDescription, as given to Network::link. */
+  struct LinkDescription
+  {
+    std::string srcRegion;
+    std::string destRegion;
+    std::string type;
+    std::string params;
+    std::string srcOutput;
+    std::string destInput;
+  };
+
+  /** The structure of a Network, as read from a yaml file. */
+  struct NetworkDescription
+  {
+    std::vector<RegionDescription> regions;
+    std::vector<LinkDescription> links;
+  };
   
   /** Factory for creating Network instances from YAML files.
    *
@@ -50,8 +79,8 @@ namespace nupic
 
     /** Create a Network instance based on the yaml file passed in. 
      *
-     *  Calls createNetworkFromYaml after ensuring the path has a yaml extension and
-     *  exists.
+     *  Creates the network from getDescription(path), so the file is parsed
+     *  only the first time a NetworkFactory creates it.
      *
      *  the file specified by path is expected to be a .yaml file with the outer
      *  most element a map of two elements (Regions and Links).
@@ -74,6 +103,32 @@ namespace nupic
      */
     Network createNetwork(const std::string& path);
 
+    /** Create a Network instance based on the yaml file passed in, with
+     *  some of the region parameters replaced.
+     *
+     *  The file is read once per NetworkFactory (see getDescription), so
+     *  the same network can be instantiated many times without parsing
+     *  it again.
+     *
+     * @param path the .yaml file path
+     * @param paramDeltas maps region names to yaml dictionaries of the
+     *        parameters that replace, or are added to, the nodeParams of
+     *        these regions
+     * @retval A pointer to the Network object specified by the yaml.
+     */
+    Network createNetwork(const std::string& path,
+                          const std::map<std::string, std::string>& paramDeltas);
+
+    /** Create a Network instance from a description.
+     *
+     * @param description the regions and links of the network
+     * @param paramDeltas as for createNetwork
+     * @retval A pointer to the Network object specified by the description.
+     */
+    Network createNetwork(const NetworkDescription& description,
+                          const std::map<std::string, std::string>& paramDeltas =
+                            std::map<std::string, std::string>());
+
     /** Internal method to parse the yaml and return the Network Instance.
      *
      * @param parser - parser of the .yaml
@@ -81,8 +136,35 @@ namespace nupic
      */
     Network createNetworkFromYAML(YAML::Parser& p);
 
+    /** Parse the yaml and return the description of the network.
+     *
+     * @param parser - parser of the .yaml
+     * @retval - the regions and links specified by the yaml.
+     */
+    NetworkDescription parseYAML(YAML::Parser& p);
+
+    /** Returns the description of the network in a .yaml file. The file
+     *  is parsed on the first call for each path only: the later calls
+     *  return the same description, even if the file changed.
+     *
+     * @param path the .yaml file path
+     * @retval the regions and links specified by the yaml.
+     */
+    const NetworkDescription& getDescription(const std::string& path);
+
+    /** Forgets the descriptions returned by getDescription. */
+    void clearDescriptions();
+
+    /** Returns the yaml dictionary nodeParams with the parameters of the
+     *  yaml dictionary delta replaced or added.
+     */
+    static std::string mergeParams(const std::string& nodeParams,
+                                   const std::string& delta);
+
   private:
 
+    // Descriptions by absolute path
+    std::map<std::string, NetworkDescription> descriptions_;
   };
 
 } // namespace nupic
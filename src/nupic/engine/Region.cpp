@@ -42,6 +42,7 @@ Methods related to inputs and outputs are in Region_io.cpp
 #include <nupic/engine/Link.hpp>
 #include <nupic/ntypes/NodeSet.hpp>
 #include <nupic/os/Timer.hpp>
+#include <nupic/utils/Tracer.hpp>
 #include <nupic/proto/RegionProto.capnp.h>
 
 namespace nupic
@@ -49,6 +50,8 @@ namespace nupic
 
   class GenericRegisteredRegionImpl;
 
+  std::atomic<UInt64> Region::nextInstanceId_(1);
+
   // Create region from parameter spec
   Region::Region(std::string name,
                  const std::string& nodeType,
@@ -59,7 +62,9 @@ namespace nupic
     initialized_(false),
     enabledNodes_(nullptr),
     network_(network),
-    profilingEnabled_(false)
+    profilingEnabled_(false),
+    modificationCount_(0),
+    instanceId_(nextInstanceId_++)
   {
     // Set region info before creating the RegionImpl so that the
     // Impl has access to the region info in its constructor.
@@ -89,7 +94,9 @@ namespace nupic
     initialized_(false),
     enabledNodes_(nullptr),
     network_(network),
-    profilingEnabled_(false)
+    profilingEnabled_(false),
+    modificationCount_(0),
+    instanceId_(nextInstanceId_++)
   {
     // Set region info before creating the RegionImpl so that the
     // Impl has access to the region info in its constructor.
@@ -119,7 +126,9 @@ namespace nupic
     initialized_(false),
     enabledNodes_(nullptr),
     network_(network),
-    profilingEnabled_(false)
+    profilingEnabled_(false),
+    modificationCount_(0),
+    instanceId_(nextInstanceId_++)
   {
     read(proto);
     createInputsAndOutputs_();
@@ -206,6 +215,7 @@ namespace nupic
 
     impl_->initialize();
     initialized_ = true;
+    modificationCount_++;
   }
 
   bool
@@ -296,6 +306,7 @@ namespace nupic
       executeTimer_.start();
 
     retVal = impl_->executeCommand(args, (UInt64)(-1));
+    modificationCount_++;
 
     if (profilingEnabled_)
       executeTimer_.stop();
@@ -310,10 +321,13 @@ namespace nupic
     if (!initialized_)
       NTA_THROW << "Region " << getName() << " unable to compute because not initialized";
 
+    NTA_TRACE_SPAN(span, "compute", getName());
+
     if (profilingEnabled_)
       computeTimer_.start();
 
     impl_->compute();
+    modificationCount_++;
 
     if (profilingEnabled_)
       computeTimer_.stop();
@@ -446,7 +460,7 @@ namespace nupic
 
     // can only create the enabled node set after we know the number of dimensions
     setupEnabledNodeSet();
-
+    modificationCount_++;
   }
 
   void Region::setupEnabledNodeSet()
@@ -512,6 +526,7 @@ namespace nupic
   Region::setPhases(std::set<UInt32>& phases)
   {
     phases_ = phases;
+    modificationCount_++;
   }
 
   std::set<UInt32>&
@@ -520,6 +535,18 @@ namespace nupic
     return phases_;
   }
 
+  UInt64
+  Region::getModificationCount() const
+  {
+    return modificationCount_;
+  }
+
+  UInt64
+  Region::getInstanceId() const
+  {
+    return instanceId_;
+  }
+
   void
   Region::serializeImpl(BundleIO& bundle)
   {
@@ -563,6 +590,7 @@ namespace nupic
     spec_ = factory.getSpec(type_);
     impl_ = factory.deserializeRegionImpl(
         proto.getNodeType().cStr(), implProto, this);
+    modificationCount_++;
   }
 
   void
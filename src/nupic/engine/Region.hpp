@@ -30,6 +30,7 @@
 #ifndef NTA_REGION_HPP
 #define NTA_REGION_HPP
 
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
@@ -403,6 +404,17 @@ namespace nupic
     void
     getParameterArray(const std::string& name, Array & array) const;
 
+    /**
+     * Get the number of elements of an array parameter.
+     *
+     * @param name
+     *        The name of the parameter
+     *
+     * @returns The number of elements getParameterArray() would copy
+     */
+    size_t
+    getParameterArrayCount(const std::string& name) const;
+
     /**
      * Set the parameter to an @c Array value.
      *
@@ -749,6 +761,22 @@ namespace nupic
     std::set<UInt32>&
     getPhases();
 
+    // Incremented whenever the region's state may have changed: on
+    // initialize, compute, executeCommand, parameter or phase changes and
+    // deserialization. Every compute counts, learning or not: inference
+    // changes state too (sequence memory, sensor positions, iteration
+    // counters). Used by NetworkCheckpointer to skip regions that did not
+    // change, so incremental checkpoints only save the regions that did not
+    // run since the previous checkpoint.
+    UInt64
+    getModificationCount() const;
+
+    // Unique among all regions created by this process, so a region that is
+    // removed and re-added under the same name is not mistaken for the old
+    // one.
+    UInt64
+    getInstanceId() const;
+
     // Called by Network for serialization
     void
     serializeImpl(BundleIO& bundle);
@@ -809,6 +837,11 @@ namespace nupic
     bool profilingEnabled_;
     Timer computeTimer_;
     Timer executeTimer_;
+
+    UInt64 modificationCount_;
+    const UInt64 instanceId_;
+
+    static std::atomic<UInt64> nextInstanceId_;
   };
 
 } // namespace nupic
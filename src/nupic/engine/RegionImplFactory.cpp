@@ -333,18 +333,47 @@ static RegionImpl * deserializePyNode(DynamicPythonLibrary * pyLib,
   return nullptr;
 }
 
+// Bound on the number of parameter sets RegionImplFactory keeps
+static const size_t maxCachedParameters = 1024;
+
+ValueMap RegionImplFactory::getParameters_(const std::string& nodeType,
+                                           const std::string& nodeParams,
+                                           const std::string& regionName)
+{
+  auto key = std::make_pair(nodeType, nodeParams);
+  auto cached = parametersCache_.find(key);
+  if (cached == parametersCache_.end())
+  {
+    boost::shared_ptr<ValueMap>& defaults = defaultsCache_[nodeType];
+    if (!defaults)
+      defaults.reset(new ValueMap(
+        YAMLUtils::toDefaultValueMap(getSpec(nodeType)->parameters)));
+
+    boost::shared_ptr<ValueMap> vm(new ValueMap(YAMLUtils::toValueMap(
+      nodeParams.c_str(),
+      getSpec(nodeType)->parameters,
+      *defaults,
+      nodeType,
+      regionName)));
+
+    if (parametersCache_.size() >= maxCachedParameters)
+      parametersCache_.clear();
+    cached = parametersCache_.insert(std::make_pair(key, vm)).first;
+  }
+
+  ValueMap vm;
+  for (const auto & item : *cached->second)
+    vm.add(item.first, item.second->clone());
+  return vm;
+}
+
 RegionImpl* RegionImplFactory::createRegionImpl(const std::string nodeType,
                                                 const std::string nodeParams,
                                                 Region* region)
 {
 
   RegionImpl *impl = nullptr;
-  Spec *ns = getSpec(nodeType);
-  ValueMap vm = YAMLUtils::toValueMap(
-    nodeParams.c_str(),
-    ns->parameters,
-    nodeType,
-    region->getName());
+  ValueMap vm = getParameters_(nodeType, nodeParams, region->getName());
 
   if (cppRegions.find(nodeType) != cppRegions.end())
   {
@@ -500,6 +529,8 @@ void RegionImplFactory::cleanup()
   }
 
   nodespecCache_.clear();
+  defaultsCache_.clear();
+  parametersCache_.clear();
 
   // destroy all RegisteredRegionImpls
   for (auto rri = cppRegions.begin(); rri != cppRegions.end(); rri++)
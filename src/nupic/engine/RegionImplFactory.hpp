@@ -35,6 +35,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 
 #include <boost/shared_ptr.hpp>
 #include <capnp/any.h>
@@ -100,6 +101,12 @@ namespace nupic
     RegionImplFactory() {};
     RegionImplFactory(const RegionImplFactory &);
 
+    // Converts nodeParams to the ValueMap given to a new RegionImpl,
+    // reusing the conversions of previous calls.
+    ValueMap getParameters_(const std::string& nodeType,
+                            const std::string& nodeParams,
+                            const std::string& regionName);
+
     // TODO: implement locking for thread safety for this global data structure
     // TODO: implement cleanup
 
@@ -107,6 +114,16 @@ namespace nupic
     // should not be cleaned up until those references have disappeared.
     std::map<std::string, Spec*> nodespecCache_;
 
+    // The default parameter values of each node type, converted once.
+    std::map<std::string, boost::shared_ptr<ValueMap> > defaultsCache_;
+
+    // The parameters of each (node type, nodeParams) already created,
+    // so regions created again with the same nodeParams (e.g. by
+    // instantiating a network description many times) skip the YAML
+    // parser. The values are copied for each RegionImpl.
+    std::map<std::pair<std::string, std::string>,
+             boost::shared_ptr<ValueMap> > parametersCache_;
+
     // Using shared_ptr here to ensure the dynamic python library object
     // is deleted when the factory goes away. Can't use scoped_ptr
     // because it is not initialized in the constructor.
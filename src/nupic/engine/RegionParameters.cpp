@@ -40,41 +40,49 @@ namespace nupic
 void Region::setParameterInt32(const std::string& name, Int32 value)
 {
   impl_->setParameterInt32(name, (Int64)-1, value);
+  modificationCount_++;
 }
 
 void Region::setParameterUInt32(const std::string& name, UInt32 value)
 {
   impl_->setParameterUInt32(name, (Int64)-1, value);
+  modificationCount_++;
 }
 
 void Region::setParameterInt64(const std::string& name, Int64 value)
 {
   impl_->setParameterInt64(name, (Int64)-1, value);
+  modificationCount_++;
 }
 
 void Region::setParameterUInt64(const std::string& name, UInt64 value)
 {
   impl_->setParameterUInt64(name, (Int64)-1, value);
+  modificationCount_++;
 }
 
 void Region::setParameterReal32(const std::string& name, Real32 value)
 {
   impl_->setParameterReal32(name, (Int64)-1, value);
+  modificationCount_++;
 }
 
 void Region::setParameterReal64(const std::string& name, Real64 value)
 {
   impl_->setParameterReal64(name, (Int64)-1, value);
+  modificationCount_++;
 }
 
 void Region::setParameterHandle(const std::string& name, Handle value)
 {
   impl_->setParameterHandle(name, (Int64)-1, value);
+  modificationCount_++;
 }
 
 void Region::setParameterBool(const std::string& name, bool value)
 {
   impl_->setParameterBool(name, (Int64)-1, value);
+  modificationCount_++;
 }
 
 
@@ -146,6 +154,12 @@ Region::getParameterArray(const std::string& name, Array & array) const
 
 }
 
+size_t
+Region::getParameterArrayCount(const std::string& name) const
+{
+  return impl_->getParameterArrayCount(name, (Int64)(-1));
+}
+
 
 void
 Region::setParameterArray(const std::string& name, const Array & array)
@@ -155,12 +169,14 @@ Region::setParameterArray(const std::string& name, const Array & array)
   // and only usable in the rare case that the nodespec specified
   // a fixed size. Instead, the implementation can check the size. 
   impl_->setParameterArray(name, (Int64)-1, array);
+  modificationCount_++;
 }
 
 void
 Region::setParameterString(const std::string& name, const std::string& s)
 {
   impl_->setParameterString(name, (Int64)-1, s);
+  modificationCount_++;
 }
     
 std::string
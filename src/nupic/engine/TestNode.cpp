@@ -40,6 +40,7 @@
 #include <nupic/engine/Spec.hpp>
 #include <nupic/engine/Region.hpp>
 #include <nupic/utils/Log.hpp>
+#include <nupic/utils/StringUtils.hpp>
 #include <nupic/ntypes/ObjectModel.hpp> // IWrite/ReadBuffer
 #include <nupic/ntypes/Array.hpp>
 #include <nupic/ntypes/Value.hpp>
@@ -109,14 +110,16 @@ namespace nupic
   }
 
   TestNode::TestNode(BundleIO& bundle, Region* region) :
-    RegionImpl(region)
+    RegionImpl(region),
+    computeCallback_(nullptr)
   {
     deserialize(bundle);
   }
 
 
   TestNode::TestNode(AnyPointer::Reader& proto, Region* region) :
-    RegionImpl(region)
+    RegionImpl(region),
+    computeCallback_(nullptr)
   {
     read(proto);
   }
@@ -353,7 +356,10 @@ namespace nupic
         ));
 
     /* ----- commands ------ */
-    // commands TBD
+    ns->commands.add(
+      "resizeInt64ArrayParam",
+      CommandSpec("Resize int64ArrayParam; element i is i*64. "
+                  "Argument: the new count"));
 
     return ns;
   }
@@ -595,6 +601,15 @@ namespace nupic
 
   std::string TestNode::executeCommand(const std::vector<std::string>& args, Int64 index)
   {
+    if (args[0] == "resizeInt64ArrayParam")
+    {
+      NTA_CHECK(args.size() == 2) << "resizeInt64ArrayParam takes a count";
+      int64ArrayParam_.resize(StringUtils::toUInt32(args[1], true));
+      for (size_t i = 0; i < int64ArrayParam_.size(); i++)
+      {
+        int64ArrayParam_[i] = i * 64;
+      }
+    }
     return "";
   }
 
@@ -1213,7 +1213,7 @@ UniformLinkPolicy::getInputBoundsForNode(size_t nodeIndex,
 }
 
 void UniformLinkPolicy::getInputForNode(Coordinate nodeCoordinate,
-                                        std::vector<size_t>& input) const
+                                        GatherPlan& input) const
 {
   // ---
   // We need to get the input bounds for our node in each dimension.
@@ -1244,14 +1244,28 @@ void UniformLinkPolicy::getInputForNode(Coordinate nodeCoordinate,
   populateInputElements(input,orthotopeBounds,subCoordinate);
 }
 
+void UniformLinkPolicy::getInputForNode(Coordinate nodeCoordinate,
+                                        std::vector<size_t>& input) const
+{
+  GatherPlan plan;
+  getInputForNode(nodeCoordinate, plan);
+  plan.expand(input);
+}
+
 void UniformLinkPolicy::getInputForNode(size_t nodeIndex,
                                         std::vector<size_t>& input) const
 {
   getInputForNode(destDimensions_.getCoordinate(nodeIndex), input);
 }
 
+void UniformLinkPolicy::getInputForNode(size_t nodeIndex,
+                                        GatherPlan& input) const
+{
+  getInputForNode(destDimensions_.getCoordinate(nodeIndex), input);
+}
+
 void UniformLinkPolicy::populateInputElements(
-  std::vector<size_t>& input,
+  GatherPlan& input,
   std::vector<std::pair<Fraction,Fraction> > orthotopeBounds,
   std::vector<Fraction>& subCoordinate) const
 {
@@ -1540,9 +1554,10 @@ void UniformLinkPolicy::populateInputElements(
 
       size_t elementIndex = srcDimensions_.getIndex(nodeCoordinate);
         
-      for(size_t x = elementOffset.first; x < elementOffset.second; x++)
+      if(elementOffset.first < elementOffset.second)
       {
-        input.push_back(elementIndex * elementCount_ + x);
+        input.appendSpan(elementIndex * elementCount_ + elementOffset.first,
+                         elementOffset.second - elementOffset.first);
       }
     }
 
@@ -1573,6 +1588,25 @@ void UniformLinkPolicy::buildProtoSplitterMap(
   }
 }
 
+void UniformLinkPolicy::buildProtoGatherPlans(
+  std::vector<GatherPlan>& plans) const
+{
+  NTA_CHECK(isInitialized());
+
+  size_t numDestNodes = 1;
+  for(size_t i = 0; i < destDimensions_.size(); i++)
+  {
+    numDestNodes *= destDimensions_[i];
+  }
+
+  NTA_CHECK(plans.size() == numDestNodes);
+
+  for(size_t i = 0; i < plans.size(); i++)
+  {
+    getInputForNode(i, plans[i]);
+  }
+}
+
 void UniformLinkPolicy::initialize()
 {
   // ---
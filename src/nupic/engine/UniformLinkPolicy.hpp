@@ -81,6 +81,7 @@ namespace nupic
     const Dimensions& getDestDimensions() const override;
     void setNodeOutputElementCount(size_t elementCount) override;
     void buildProtoSplitterMap(Input::SplitterMap& splitter) const override;
+    void buildProtoGatherPlans(std::vector<GatherPlan>& plans) const override;
     void initialize() override;
     bool isInitialized() const override;
 
@@ -172,7 +173,7 @@ namespace nupic
     // ---
     // Calculates the entire set of bounds for a destination node's
     // receptive field, and then utilizes populateInputElements() to fill
-    // in the splitter map.
+    // in the gather plan (or, expanded, the splitter map).
     // ---
     void getInputForNode(size_t nodeIndex,
                          std::vector<size_t>& input) const;
@@ -180,9 +181,15 @@ namespace nupic
     void getInputForNode(Coordinate nodeCoordinate,
                          std::vector<size_t>& input) const;
 
+    void getInputForNode(size_t nodeIndex,
+                         GatherPlan& input) const;
+
+    void getInputForNode(Coordinate nodeCoordinate,
+                         GatherPlan& input) const;
+
     // ---
     // Recursive method which walks the entire set of bounds and populates the
-    // vector "input" (the splitter map) accordingly.
+    // gather plan "input" accordingly, one span of elements per source node.
     //
     // For a uniform linkage, the set of bounds defines an "orthotope" -
     // the generalization of a rectangle to n-dimensions.  That is, the
@@ -190,7 +197,7 @@ namespace nupic
     // dimension, which correspond to the edges of an n-dimensional box.
     // ---
     void populateInputElements(
-           std::vector<size_t>& input,
+           GatherPlan& input,
            std::vector<std::pair<Fraction,Fraction> > orthotopeBounds,
            std::vector<Fraction>& subCoordinate) const;
 
@@ -213,16 +213,16 @@ Value toValue(const std::string& yamlstring, NTA_BasicType dataType)
   return v;
 }
 
-/* 
- * For converting param specs for Regions and LinkPolicies
+/*
+ * Converts the parameters specified in a YAML string, without the
+ * default values
  */
-ValueMap toValueMap(const char* yamlstring, 
-                               Collection<ParameterSpec>& parameters,
-                               const std::string & nodeType,
-                               const std::string & regionName)
+static void _toValueMap(const char* yamlstring,
+                        Collection<ParameterSpec>& parameters,
+                        const std::string & nodeType,
+                        const std::string & regionName,
+                        ValueMap& vm)
 {
-    
-  ValueMap vm;
 
   // yaml-cpp bug: append a space if it is only one character
   // This is very inefficient, but should be ok since it is 
@@ -306,8 +306,14 @@ ValueMap toValueMap(const char* yamlstring,
       NTA_THROW << "Unable to set parameter '" << key << "'. " << e.what();
     }
   }
+}
 
-  // Populate ValueMap with default values if they were not specified in the YAML dictionary.
+/*
+ * Adds the default values of the parameters missing from vm
+ */
+static void _addDefaultValues(Collection<ParameterSpec>& parameters,
+                              ValueMap& vm)
+{
   for (size_t i = 0; i < parameters.getCount(); i++)
   {
     std::pair<std::string, ParameterSpec>& item = parameters.getByIndex(i);
@@ -340,10 +346,58 @@ ValueMap toValueMap(const char* yamlstring,
       }
     }
   }
+}
+
+/* 
+ * For converting param specs for Regions and LinkPolicies
+ */
+ValueMap toValueMap(const char* yamlstring, 
+                               Collection<ParameterSpec>& parameters,
+                               const std::string & nodeType,
+                               const std::string & regionName)
+{
+    
+  ValueMap vm;
+  _toValueMap(yamlstring, parameters, nodeType, regionName, vm);
+
+  // Populate ValueMap with default values if they were not specified in the YAML dictionary.
+  _addDefaultValues(parameters, vm);
+
+  return vm;
+}
+
+/*
+ * For converting param specs with default values converted beforehand
+ */
+ValueMap toValueMap(const char* yamlstring,
+                    Collection<ParameterSpec>& parameters,
+                    const ValueMap& defaults,
+                    const std::string & nodeType,
+                    const std::string & regionName)
+{
+  ValueMap vm;
+  _toValueMap(yamlstring, parameters, nodeType, regionName, vm);
+
+  for (const auto & item : defaults)
+  {
+    if (!vm.contains(item.first))
+      vm.add(item.first, item.second->clone());
+  }
+
+  return vm;
+}
 
+/*
+ * For converting the default values of param specs
+ */
+ValueMap toDefaultValueMap(Collection<ParameterSpec>& parameters)
+{
+  ValueMap vm;
+  _addDefaultValues(parameters, vm);
   return vm;
 }
 
+
 } // end of YAMLUtils namespace
 
 } // end of namespace nupic
@@ -48,6 +48,24 @@ namespace nupic
       const std::string & regionName = ""
       );
 
+    /*
+     * As above, with the default values given already converted by
+     * toDefaultValueMap. The defaults are copied into the result, so
+     * they can be reused for any number of calls.
+     */
+    ValueMap toValueMap(
+      const char* yamlstring,
+      Collection<ParameterSpec>& parameters,
+      const ValueMap& defaults,
+      const std::string & nodeType = "",
+      const std::string & regionName = ""
+      );
+
+    /*
+     * For converting the default values of param specs
+     */
+    ValueMap toDefaultValueMap(Collection<ParameterSpec>& parameters);
+
 
   } // namespace YAMLUtils
 } // namespace nupic
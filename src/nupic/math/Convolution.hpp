@@ -27,6 +27,18 @@
 #ifndef NTA_CONVOLUTION_HPP
 #define NTA_CONVOLUTION_HPP
 
+#include <algorithm>
+#include <vector>
+
+#include <nupic/utils/ParallelFor.hpp>
+
+template <typename T> struct SeparableConvolution2D;
+
+template <typename T>
+void computeSeparableConvolutions(
+  size_t n, const SeparableConvolution2D<T>* const* convolutions,
+  const T* const* data, T* const* convolved, size_t nThreads =0);
+
 //--------------------------------------------------------------------------------
 /**
  * Computes convolutions in 2D, for separable kernels.
@@ -81,10 +93,17 @@ struct SeparableConvolution2D
     f2_ = f2;
     f1_end_ = f1 + f1_size;
     f2_end_ = f2 + f2_size;
-    buffer_ = new T[nrows*ncols];
+
+    // Re-initializing with an image of the same size or smaller keeps the
+    // buffer.
+    if (nrows*ncols > buffer_size_) {
+      delete [] buffer_;
+      buffer_ = new T[nrows*ncols];
+      buffer_size_ = nrows*ncols;
+    }
   }
 
-  inline SeparableConvolution2D() : buffer_(NULL)
+  inline SeparableConvolution2D() : buffer_(NULL), buffer_size_(0)
   {
   }
 
@@ -98,34 +117,141 @@ struct SeparableConvolution2D
    * Computes the convolution of an image in data with the two 1D
    * filters f1 and f2, and puts the result in convolved.
    *
+   * The horizontal pass goes to buffer_, whose columns outside of the
+   * filter's reach are zeroed. The vertical pass writes rows
+   * [f2_middle_, f2_middle_ + f2_end_i_) of convolved; the other rows are
+   * left as they are.
+   *
    * Down-sampling?
    */
   inline void compute(T* data, T* convolved, bool rotated45 =false)
+  {
+    computeWithBuffer(data, convolved, buffer_);
+  }
+
+  /**
+   * Same as compute, with buffer (nrows*ncols elements) in place of
+   * buffer_. Several threads can call this at the same time, each with
+   * its own buffer.
+   */
+  inline void computeWithBuffer(const T* data, T* convolved, T* buffer) const
+  {
+    horizontal_(data, buffer);
+    vertical_(buffer, convolved);
+  }
+
+  /**
+   * Convolves n images, data[k] into convolved[k], on nThreads threads
+   * (0 for the hardware concurrency). Each thread has its own scratch
+   * buffer, and buffer_ is not used. The results are the same as
+   * calling compute on each image.
+   */
+  inline void computeBatch(size_type n, const T* const* data,
+                           T* const* convolved, size_type nThreads =0) const
+  {
+    std::vector<const SeparableConvolution2D*> convolutions(n, this);
+    computeSeparableConvolutions(n, convolutions.data(), data, convolved,
+                                 nThreads);
+  }
+
+private:
+  // Both passes compute lanes_ outputs at a time in a local accumulator,
+  // adding the filter taps in the same order as a plain dot product, so
+  // the results don't depend on the blocking. The compiler turns the
+  // fixed-size lane loops into SIMD instructions. The vertical pass reads
+  // rows of the buffer, tile_ columns at a time, so that the f2_size_
+  // rows it reads stay in cache from one output row to the next.
+  enum { lanes_ = 8, tile_ = 256 };
+
+  size_type buffer_size_;
+
+  inline void horizontal_(const T* data, T* buffer) const
   {
     for (size_type i = 0; i != nrows_; ++i) {
-      T* b = buffer_ + i*ncols_ + f1_middle_, *d_row = data + i*ncols_;
-      for (size_type j = 0; j != f1_end_j_; ++j) {
-	register T dot = 0, *f = f1_, *d = d_row + j;
-	while (f != f1_end_) 
-	  dot += *f++ * *d++;
-	*b++ = dot;
+      const T* d_row = data + i*ncols_;
+      T* b_row = buffer + i*ncols_;
+      T* b = b_row + f1_middle_;
+
+      std::fill(b_row, b, T(0));
+      std::fill(b + f1_end_j_, b_row + ncols_, T(0));
+
+      size_type j = 0;
+      for (; j + lanes_ <= f1_end_j_; j += lanes_) {
+        T acc[lanes_] = {};
+        for (size_type k = 0; k != f1_size_; ++k) {
+          const T f = f1_[k];
+          const T* d = d_row + j + k;
+          for (size_type l = 0; l != lanes_; ++l)
+            acc[l] += f * d[l];
+        }
+        std::copy(acc, acc + lanes_, b + j);
+      }
+      for (; j != f1_end_j_; ++j) {
+        T dot = 0;
+        for (size_type k = 0; k != f1_size_; ++k)
+          dot += f1_[k] * d_row[j + k];
+        b[j] = dot;
       }
     }
+  }
+
+  inline void vertical_(const T* buffer, T* convolved) const
+  {
+    for (size_type j0 = 0; j0 < ncols_; j0 += tile_) {
+      const size_type j1 = std::min(j0 + (size_type)tile_, ncols_);
+      for (size_type i = 0; i != f2_end_i_; ++i) {
+        T* c = convolved + (i + f2_middle_)*ncols_;
+        const T* b_row = buffer + i*ncols_;
 
-    for (size_type i = 0; i != f2_end_i_; ++i) {
-      T* c = convolved + (i + f2_middle_)*ncols_, *b_row = buffer_ + i*ncols_;
-      for (size_type j = 0; j != ncols_; ++j) {
-	register T dot = 0, *f = f2_, *b = b_row + j;
-	while (f != f2_end_) {
-	  dot += *f++ * *b;
-	  b += ncols_;
-	}
-	*c++ = dot;
+        size_type j = j0;
+        for (; j + lanes_ <= j1; j += lanes_) {
+          T acc[lanes_] = {};
+          for (size_type k = 0; k != f2_size_; ++k) {
+            const T f = f2_[k];
+            const T* b = b_row + k*ncols_ + j;
+            for (size_type l = 0; l != lanes_; ++l)
+              acc[l] += f * b[l];
+          }
+          std::copy(acc, acc + lanes_, c + j);
+        }
+        for (; j != j1; ++j) {
+          T dot = 0;
+          for (size_type k = 0; k != f2_size_; ++k)
+            dot += f2_[k] * b_row[k*ncols_ + j];
+          c[j] = dot;
+        }
       }
     }
   }
 };
 
+//--------------------------------------------------------------------------------
+/**
+ * Runs n convolutions, each with its own filters and image size:
+ * convolutions[k] convolves data[k] into convolved[k]. The same
+ * convolution can appear several times. The convolutions are spread over
+ * nThreads threads (0 for the hardware concurrency), each with its own
+ * scratch buffer, and their buffer_ is not used.
+ */
+template <typename T>
+inline void computeSeparableConvolutions(
+  size_t n, const SeparableConvolution2D<T>* const* convolutions,
+  const T* const* data, T* const* convolved, size_t nThreads)
+{
+  nThreads = nupic::parallelThreads(n, nThreads);
+
+  nupic::parallelForShards(n, nThreads, [&](size_t begin, size_t end) {
+    std::vector<T> scratch;
+    for (size_t k = begin; k != end; ++k) {
+      const SeparableConvolution2D<T>& convolution = *convolutions[k];
+      const size_t size = convolution.nrows_ * convolution.ncols_;
+      if (scratch.size() < size)
+        scratch.resize(size);
+      convolution.computeWithBuffer(data[k], convolved[k], scratch.data());
+    }
+  });
+}
+
 //--------------------------------------------------------------------------------
 #endif //NTA_CONVOLUTION_HPP
 
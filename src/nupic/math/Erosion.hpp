@@ -27,6 +27,11 @@
 #ifndef NTA_EROSION_HPP
 #define NTA_EROSION_HPP
 
+#include <algorithm>
+#include <vector>
+
+#include <nupic/utils/ParallelFor.hpp>
+
 /*
  * Python bindings are used used in GaborNode
  */
@@ -55,10 +60,17 @@ struct Erosion
   {
     nrows_ = nrows;
     ncols_ = ncols;
-    buffer_ = new T[nrows*ncols];
+
+    // Re-initializing with an image of the same size or smaller keeps the
+    // buffer.
+    if (nrows*ncols > buffer_size_) {
+      delete [] buffer_;
+      buffer_ = new T[nrows*ncols];
+      buffer_size_ = nrows*ncols;
+    }
   }
 
-  inline Erosion() : buffer_(NULL)
+  inline Erosion() : buffer_(NULL), buffer_size_(0)
   {
   }
 
@@ -72,78 +84,124 @@ struct Erosion
    * Erodes (or dilates) the image by convolving with a 3x3 min (or max) filter.
    * Number of iterations is the radius of the erosion/dilation.
    * Does the convolution separably.
-   */  
-   inline void compute(T* data, T* eroded, size_type iterations,
-                       bool dilate=false)
-   {
-     for (size_type iter = 0; iter != iterations; ++iter) {
-       T* in;
-       if (!iter) {
-         in = data;  // First pass - read from the input buffer
-       } else {
-         in = eroded;  // Subsequent pass - read from the output buffer
-       }
-       // Rows (ignoring the first and last column)
-       for (size_type i = 0; i != nrows_; ++i) {
-         T* b = buffer_ + i*ncols_ + 1;  // Write to b in the buffer
-         T* d = in + i*ncols_;  // Start reading from one to the left of b
-         while (b != (buffer_ + (i + 1)*ncols_ - 1)) {
-           if (dilate) {
-             *b = max(max(*d, *(d+1)), *(d+2));
-           } else {
-             *b = min(min(*d, *(d+1)), *(d+2));
-           }
-           b++;
-           d++;
-         }
-       }
-       if (dilate) {
-         // Need to fill the first and last column, which were ignored     
-         for (size_type row = 0; row < nrows_; row++) {
-           buffer_[row * ncols_] =
-             max(in[row * ncols_], in[row * ncols_ + 1]);
-           buffer_[(row+1) * ncols_ - 1] = 
-             max(in[(row+1) * ncols_ - 2], in[(row+1) * ncols_ - 1]);
-         }
-       } else {
-         // Zero out the first and last column (they are always eroded away)
-         for (size_type row = 0; row < nrows_; row++) {
-           buffer_[row * ncols_] = 0;
-           buffer_[(row + 1) * ncols_ - 1] = 0;
-         }
-       }
-       
-       // Columns (ignoring the first and last row)
-       for (size_type i = 0; i != ncols_; ++i) {
-         T* b = eroded + i + ncols_;  // Write to b in the output
-         T* d = buffer_ + i;  // Start reading from one above b
-         while (b != (eroded + i + ncols_*(nrows_ - 1))) {
-           if (dilate) {
-             *b = max(max(*d, *(d + ncols_)), *(d + ncols_*2));
-           } else {
-             *b = min(min(*d, *(d + ncols_)), *(d + ncols_*2));
-           }
-           b += ncols_;
-           d += ncols_;
-         }
-       }
-       if (dilate) {
-         // Need to fill the first and last row, which were ignored     
-         for (size_type col = 0; col < ncols_; col++) {
-           eroded[col] = max(buffer_[col], buffer_[col + ncols_]);
-           eroded[(nrows_ - 1) * ncols_ + col] = 
-             max(buffer_[(nrows_ - 1) * ncols_ + col],
-                 buffer_[(nrows_ - 2) * ncols_ + col]);
-         }
-       } else {
-         // Zero out the first and last row (they are always eroded away)
-         for (size_type col = 0; col < ncols_; col++) {
-           eroded[col] = 0;
-           eroded[(nrows_ - 1) * ncols_ + col] = 0;
-         }
-       }
-     }
-   }
+   */
+  inline void compute(T* data, T* eroded, size_type iterations,
+                      bool dilate=false)
+  {
+    computeWithBuffer(data, eroded, iterations, dilate, buffer_);
+  }
+
+  /**
+   * Same as compute, with buffer (nrows*ncols elements) in place of
+   * buffer_. Several threads can call this at the same time, each with
+   * its own buffer.
+   */
+  inline void computeWithBuffer(const T* data, T* eroded, size_type iterations,
+                                bool dilate, T* buffer) const
+  {
+    if (dilate)
+      compute_<true>(data, eroded, iterations, buffer);
+    else
+      compute_<false>(data, eroded, iterations, buffer);
+  }
+
+  /**
+   * Erodes (or dilates) n images, data[k] into eroded[k], on nThreads
+   * threads (0 for the hardware concurrency). Each thread has its own
+   * scratch buffer, and buffer_ is not used.
+   */
+  inline void computeBatch(size_type n, const T* const* data,
+                           T* const* eroded, size_type iterations,
+                           bool dilate=false, size_type nThreads=0) const
+  {
+    nThreads = nupic::parallelThreads(n, nThreads);
+
+    nupic::parallelForShards(n, nThreads, [&](size_type begin, size_type end) {
+      std::vector<T> scratch(nrows_ * ncols_);
+      for (size_type k = begin; k != end; ++k)
+        computeWithBuffer(data[k], eroded[k], iterations, dilate,
+                          scratch.data());
+    });
+  }
+
+private:
+  // Both passes combine three contiguous rows (shifted copies of one row
+  // for the horizontal pass, neighbouring rows for the vertical pass)
+  // lanes_ elements at a time into a local array, which the compiler
+  // turns into SIMD min/max instructions.
+  enum { lanes_ = 8 };
+
+  size_type buffer_size_;
+
+  template <bool dilate>
+  static inline T op_(T a, T b)
+  {
+    return dilate ? max(a, b) : min(a, b);
+  }
+
+  template <bool dilate>
+  static inline void combine3_(const T* a, const T* b, const T* c, T* out,
+                               size_type n)
+  {
+    size_type j = 0;
+    for (; j + lanes_ <= n; j += lanes_) {
+      T r[lanes_];
+      for (size_type l = 0; l != lanes_; ++l)
+        r[l] = op_<dilate>(op_<dilate>(a[j+l], b[j+l]), c[j+l]);
+      std::copy(r, r + lanes_, out + j);
+    }
+    for (; j != n; ++j)
+      out[j] = op_<dilate>(op_<dilate>(a[j], b[j]), c[j]);
+  }
+
+  template <bool dilate>
+  inline void compute_(const T* data, T* eroded, size_type iterations,
+                       T* buffer) const
+  {
+    for (size_type iter = 0; iter != iterations; ++iter) {
+      // First pass reads from the input, subsequent passes from the output
+      const T* in = iter ? eroded : data;
+
+      // Rows (ignoring the first and last column)
+      for (size_type i = 0; i != nrows_; ++i) {
+        const T* d = in + i*ncols_;
+        T* b = buffer + i*ncols_;
+        combine3_<dilate>(d, d + 1, d + 2, b + 1, ncols_ - 2);
+        if (dilate) {
+          // Need to fill the first and last column, which were ignored
+          b[0] = max(d[0], d[1]);
+          b[ncols_ - 1] = max(d[ncols_ - 2], d[ncols_ - 1]);
+        } else {
+          // Zero out the first and last column (they are always eroded away)
+          b[0] = 0;
+          b[ncols_ - 1] = 0;
+        }
+      }
+
+      // Columns (ignoring the first and last row), a row at a time
+      for (size_type i = 1; i + 1 < nrows_; ++i) {
+        const T* b = buffer + (i - 1)*ncols_;
+        combine3_<dilate>(b, b + ncols_, b + 2*ncols_, eroded + i*ncols_,
+                          ncols_);
+      }
+
+      T* first = eroded;
+      T* last = eroded + (nrows_ - 1)*ncols_;
+      if (dilate) {
+        // Need to fill the first and last row, which were ignored
+        const T* b_last = buffer + (nrows_ - 1)*ncols_;
+        const T* b_prev = b_last - ncols_;
+        for (size_type col = 0; col < ncols_; col++) {
+          first[col] = max(buffer[col], buffer[col + ncols_]);
+          last[col] = max(b_last[col], b_prev[col]);
+        }
+      } else {
+        // Zero out the first and last row (they are always eroded away)
+        std::fill(first, first + ncols_, T(0));
+        std::fill(last, last + ncols_, T(0));
+      }
+    }
+  }
 
 };
 
@@ -27,6 +27,9 @@
 #ifndef NTA_NEAREST_NEIGHBOR_HPP
 #define NTA_NEAREST_NEIGHBOR_HPP
 
+#include <algorithm>
+#include <vector>
+
 #include <nupic/math/SparseMatrix.hpp>
 #include <nupic/math/ArrayAlgo.hpp>
 
@@ -108,7 +111,12 @@ namespace nupic {
      * Copies the given NearestNeighbor into this one.
      */
     inline NearestNeighbor(const NearestNeighbor& other)
-      : parent_type(other)
+      : parent_type(other),
+        inv_offsets_(other.inv_offsets_),
+        inv_rows_(other.inv_rows_),
+        rows_by_size_(other.rows_by_size_),
+        inv_nrows_(other.inv_nrows_),
+        inv_nnz_(other.inv_nnz_)
     {}
 
     //--------------------------------------------------------------------------------
@@ -118,6 +126,11 @@ namespace nupic {
     inline NearestNeighbor& operator=(const NearestNeighbor& other)
     {
       parent_type::operator=(other);
+      inv_offsets_ = other.inv_offsets_;
+      inv_rows_ = other.inv_rows_;
+      rows_by_size_ = other.rows_by_size_;
+      inv_nrows_ = other.inv_nrows_;
+      inv_nnz_ = other.inv_nnz_;
       return *this;
     }
 
@@ -902,6 +915,476 @@ namespace nupic {
       LpNearest(p, x.begin(), nn, k, take_root);
     }
 
+    //--------------------------------------------------------------------------------
+    // BATCHED AND INDEXED K-NEAREST
+    //--------------------------------------------------------------------------------
+    /**
+     * A nearest neighbor candidate: (row index, distance).
+     */
+    typedef std::pair<size_type, value_type> neighbor_type;
+
+  private:
+    /**
+     * Strict order on candidates used by the bounded top-k heaps: smaller
+     * distance first, ties broken on the row index, so that the results don't
+     * depend on how the work was split between threads.
+     */
+    struct closer_
+    {
+      inline bool operator()(const neighbor_type& a, const neighbor_type& b) const
+      {
+        return a.second < b.second
+          || (a.second == b.second && a.first < b.first);
+      }
+    };
+
+    /**
+     * Same as closer_, but larger values (overlaps) first.
+     */
+    struct larger_
+    {
+      inline bool operator()(const neighbor_type& a, const neighbor_type& b) const
+      {
+        return a.second > b.second
+          || (a.second == b.second && a.first < b.first);
+      }
+    };
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Offers c to a heap that keeps the k best candidates according to order,
+     * with the worst of them at the front. Returns false if c was rejected.
+     */
+    template <typename Order>
+    static inline bool
+    push_bounded_(std::vector<neighbor_type>& heap, size_type k,
+                  const neighbor_type& c, Order order)
+    {
+      if (heap.size() < k) {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end(), order);
+        return true;
+      }
+
+      if (!order(c, heap.front()))
+        return false;
+
+      std::pop_heap(heap.begin(), heap.end(), order);
+      heap.back() = c;
+      std::push_heap(heap.begin(), heap.end(), order);
+      return true;
+    }
+
+    // Thread helpers shared with the row-parallel SparseMatrix kernels
+    using parent_type::num_threads_;
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Writes the k best candidates of each query to nn, merging the heaps that
+     * each of the nThreads threads kept for it (heaps[t*nx + q]).
+     */
+    template <typename OutputIterator, typename Order, typename F>
+    static inline void
+    merge_heaps_(size_type nx, size_type k, size_type nThreads,
+                 std::vector<std::vector<neighbor_type> >& heaps,
+                 OutputIterator nn, Order order, F finalize)
+    {
+      std::vector<neighbor_type> all;
+
+      for (size_type q = 0; q != nx; ++q) {
+        all.clear();
+        for (size_type t = 0; t != nThreads; ++t) {
+          const std::vector<neighbor_type>& heap = heaps[t * nx + q];
+          all.insert(all.end(), heap.begin(), heap.end());
+        }
+        std::sort(all.begin(), all.end(), order);
+        for (size_type i = 0; i != k; ++i, ++nn)
+          *nn = neighbor_type(all[i].first, finalize(all[i].second));
+      }
+    }
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Batched version of k_nearest_. The stored rows are split in nThreads
+     * contiguous shards, and each thread keeps a bounded top-k heap per query
+     * for its shard. Within a shard, rows are visited in blocks, and each
+     * block is matched against all the queries while it is still in cache.
+     * The powers of each x are computed once per batch, in a buffer of their
+     * own rather than in nzb_, so that threads don't share any mutable state.
+     */
+    template <typename InputIterator, typename OutputIterator, typename F>
+    inline void
+    k_nearest_batch_(size_type nx, InputIterator X, OutputIterator nn, F f,
+                     size_type k, bool take_root, size_type nThreads) const
+    {
+      const size_type nrows = this->nRows(), ncols = this->nCols();
+      const size_type blockSize = 256;
+
+      std::vector<value_type> Sp_x(nx), p_x(nx * ncols);
+      for (size_type q = 0; q != nx; ++q)
+        const_cast<self_type*>(this)->compute_powers_(Sp_x[q], &p_x[q * ncols],
+                                                     X + q * ncols, f);
+
+      nThreads = num_threads_(nThreads, nx * (this->nNonZeros() + nrows), nrows);
+      std::vector<std::vector<neighbor_type> > heaps(nThreads * nx);
+
+      parallelFor(nThreads, [&](size_t t) {
+          const size_type begin = t * nrows / nThreads;
+          const size_type end = (t + 1) * nrows / nThreads;
+
+          for (size_type block = begin; block < end; block += blockSize) {
+            const size_type blockEnd = std::min(block + blockSize, end);
+            for (size_type q = 0; q != nx; ++q) {
+              std::vector<neighbor_type>& heap = heaps[t * nx + q];
+              InputIterator x = X + q * ncols;
+              for (size_type row = block; row != blockEnd; ++row) {
+                value_type d = sum_of_p_diff_(row, x, Sp_x[q],
+                                              &p_x[q * ncols], f);
+                push_bounded_(heap, k, neighbor_type(row, d), closer_());
+              }
+            }
+          }
+        });
+
+      merge_heaps_(nx, k, nThreads, heaps, nn, closer_(),
+                   [&](value_type d) { return take_root ? f.root(d) : d; });
+    }
+
+  public:
+    //--------------------------------------------------------------------------------
+    /**
+     * Batched LpNearest: finds the k nearest rows to each of nx vectors.
+     *
+     * The rows of this NearestNeighbor are sharded across threads, and each
+     * thread keeps a bounded top-k heap per query, so no distance vector of
+     * size nrows is allocated per query. Neighbors are returned by increasing
+     * distance, and rows at the same distance by increasing row index,
+     * whatever the number of threads.
+     *
+     * Non-mutating, O(nx*(ncols + nnz + nrows*log(k))) divided between threads.
+     *
+     * @param p [value_type >= 0] the norm to use
+     * @param nx [size_type > 0] number of query vectors
+     * @param X [InputIterator<value_type>] nx dense vectors of size ncols,
+     *  one after the other
+     * @param nn [OutputIterator<neighbor_type>] receives k (index, distance)
+     *  pairs for each query, query after query
+     * @param k [0 < size_type <= nrows, (1)] the number of nearest rows to
+     *  retrieve per query
+     * @param take_root [bool (false)] whether to return the p-th root of the
+     *  distances, as in LpNearest
+     * @param nThreads [size_type (0)] maximum number of threads to use, 0 for
+     *  the hardware concurrency. Small batches use fewer threads.
+     *
+     * @b Exceptions:
+     *  @li If p < 0.
+     *  @li If k < 1 or k > nrows.
+     */
+    template <typename InputIterator, typename OutputIterator>
+    inline void
+    LpNearestBatch(value_type p, size_type nx, InputIterator X, OutputIterator nn,
+                   size_type k =1, bool take_root =false,
+                   size_type nThreads =0) const
+    {
+      { // Pre-conditions
+        NTA_ASSERT(this->nRows() > 0)
+          << "NearestNeighbor::LpNearestBatch(): "
+          << "No vector stored yet";
+
+        NTA_ASSERT(p >= (value_type)0.0)
+          << "NearestNeighbor::LpNearestBatch():"
+          << "Invalid value for parameter p: " << p
+          << " - Only positive values (p >= 0) are supported";
+
+        NTA_CHECK(1 <= k && k <= this->nRows())
+          << "NearestNeighbor::LpNearestBatch():"
+          << "Invalid number of nearest rows: " << k
+          << " - Should be >= 1 and <= nrows = " << this->nRows();
+      } // End pre-conditions
+
+      if (nx == 0)
+        return;
+
+      if (p == (value_type)0.0)
+        k_nearest_batch_(nx, X, nn, Lp0<value_type>(), k, false, nThreads);
+      else if (p == (value_type)1.0)
+        k_nearest_batch_(nx, X, nn, Lp1<value_type>(), k, false, nThreads);
+      else if (p == (value_type)2.0)
+        k_nearest_batch_(nx, X, nn, Lp2<value_type>(), k, take_root, nThreads);
+      else
+        k_nearest_batch_(nx, X, nn, Lp<value_type>(p), k, take_root, nThreads);
+    }
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Builds an inverted index of the rows of this NearestNeighbor: for each
+     * column, the rows that have a non-zero in that column. The rows need to
+     * be binary (all non-zeros equal to 1). The index is what makes
+     * L0NearestIndexed and overlapNearestIndexed cost time in proportion
+     * to the number of non-zeros the queries share with the stored rows,
+     * rather than to nnz.
+     *
+     * The index is not updated when the matrix changes: call this method again
+     * after adding, removing or modifying rows.
+     *
+     * Mutating, O(nnz + nrows*log(nrows))
+     *
+     * @b Exceptions:
+     *  @li If a non-zero is not 1.
+     */
+    inline void buildInvertedIndex()
+    {
+      const size_type nrows = this->nRows(), ncols = this->nCols();
+
+      inv_offsets_.assign(ncols + 1, 0);
+      for (size_type row = 0; row != nrows; ++row) {
+        size_type *ind = this->ind_[row], *ind_end = ind + this->nnzr_[row];
+        value_type *nz = this->nz_[row];
+        for (; ind != ind_end; ++ind, ++nz) {
+          NTA_CHECK(*nz == (value_type) 1)
+            << "NearestNeighbor::buildInvertedIndex(): "
+            << "Row " << row << " has value " << *nz
+            << " at column " << *ind << " - Only binary rows can be indexed";
+          ++inv_offsets_[*ind + 1];
+        }
+      }
+
+      for (size_type j = 0; j != ncols; ++j)
+        inv_offsets_[j + 1] += inv_offsets_[j];
+
+      std::vector<size_type> next(inv_offsets_.begin(), inv_offsets_.end() - 1);
+      inv_rows_.resize(inv_offsets_[ncols]);
+      for (size_type row = 0; row != nrows; ++row) {
+        size_type *ind = this->ind_[row], *ind_end = ind + this->nnzr_[row];
+        for (; ind != ind_end; ++ind)
+          inv_rows_[next[*ind]++] = row;
+      }
+
+      // Rows by increasing number of non-zeros, then index: the order in
+      // which rows that share nothing with a query get closer to it
+      rows_by_size_.resize(nrows);
+      for (size_type row = 0; row != nrows; ++row)
+        rows_by_size_[row] = row;
+      std::stable_sort(rows_by_size_.begin(), rows_by_size_.end(),
+                       [this](size_type a, size_type b) {
+                         return this->nnzr_[a] < this->nnzr_[b];
+                       });
+
+      inv_nrows_ = nrows;
+      inv_nnz_ = inv_offsets_[ncols];
+    }
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Whether the inverted index was built and still matches the shape of
+     * the matrix.
+     */
+    inline bool hasInvertedIndex() const
+    {
+      return !inv_offsets_.empty()
+        && inv_offsets_.size() == this->nCols() + 1
+        && inv_nrows_ == this->nRows()
+        && inv_nnz_ == this->nNonZeros();
+    }
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Releases the memory used by the inverted index.
+     */
+    inline void clearInvertedIndex()
+    {
+      std::vector<size_type>().swap(inv_offsets_);
+      std::vector<size_type>().swap(inv_rows_);
+      std::vector<size_type>().swap(rows_by_size_);
+      inv_nrows_ = inv_nnz_ = 0;
+    }
+
+  private:
+    //--------------------------------------------------------------------------------
+    /**
+     * Runs the indexed queries: counts, for each query, the overlap of each
+     * row that shares at least one non-zero with it, then lets select(q,
+     * nx_q, overlap, touched, heap) fill the heap of the query. The queries
+     * are split between threads, each with its own overlap counters.
+     */
+    template <typename InputIterator1, typename InputIterator2,
+              typename OutputIterator, typename Order, typename Select>
+    inline void
+    indexed_nearest_(const char* where, size_type nx,
+                     InputIterator1 x_offsets, InputIterator2 x_ind,
+                     OutputIterator nn, size_type k, size_type nThreads,
+                     Order order, Select select) const
+    {
+      NTA_CHECK(hasInvertedIndex())
+        << "NearestNeighbor::" << where << "(): "
+        << "The inverted index is missing or out of date"
+        << " - Call buildInvertedIndex() first";
+
+      NTA_CHECK(1 <= k && k <= this->nRows())
+        << "NearestNeighbor::" << where << "(): "
+        << "Invalid number of nearest rows: " << k
+        << " - Should be >= 1 and <= nrows = " << this->nRows();
+
+      if (nx == 0)
+        return;
+
+      const size_type nrows = this->nRows(), ncols = this->nCols();
+      const size_type nxnz = (size_type) (x_offsets[nx] - x_offsets[0]);
+
+      // Checked here rather than in the threads, where it couldn't throw
+      for (InputIterator2 it = x_ind + x_offsets[0]; it != x_ind + x_offsets[nx];
+           ++it)
+        NTA_CHECK((size_type) *it < ncols)
+          << "NearestNeighbor::" << where << "(): "
+          << "Invalid column index: " << *it
+          << " - Should be < ncols = " << ncols;
+
+      const size_type work = nxnz * (inv_nnz_ / ncols + 1) + nx * k;
+
+      nThreads = num_threads_(nThreads, work, nx);
+      std::vector<std::vector<neighbor_type> > heaps(nx);
+
+      parallelFor(nThreads, [&](size_t t) {
+          std::vector<size_type> overlap(nrows, 0), touched;
+
+          for (size_type q = t; q < nx; q += nThreads) {
+            InputIterator2 it = x_ind + x_offsets[q];
+            InputIterator2 it_end = x_ind + x_offsets[q + 1];
+
+            for (; it != it_end; ++it) {
+              const size_type j = (size_type) *it;
+              const size_type *r = &inv_rows_[0] + inv_offsets_[j];
+              const size_type *r_end = &inv_rows_[0] + inv_offsets_[j + 1];
+              for (; r != r_end; ++r)
+                if (overlap[*r]++ == 0)
+                  touched.push_back(*r);
+            }
+
+            select((size_type) (x_offsets[q + 1] - x_offsets[q]),
+                   overlap, touched, heaps[q]);
+
+            for (size_type row : touched)
+              overlap[row] = 0;
+            touched.clear();
+          }
+        });
+
+      merge_heaps_(nx, k, 1, heaps, nn, order,
+                   [](value_type d) { return d; });
+    }
+
+  public:
+    //--------------------------------------------------------------------------------
+    /**
+     * Batched L0Nearest for sparse binary queries, using the inverted index
+     * (see buildInvertedIndex). The L0 distance between binary vectors is
+     * nnzr + nnz(x) - 2*overlap, so only the rows that share a non-zero with
+     * x are visited, and then the rows that share nothing with it are taken
+     * by increasing number of non-zeros until no such row can be closer than
+     * the current k nearest.
+     *
+     * Returns the same rows and distances as L0Nearest on the dense version of
+     * each query, with ties broken by increasing row index. The queries are
+     * split between threads.
+     *
+     * Non-mutating, O(sum over queries of the lengths of the posting lists
+     * of their non-zeros), plus O(nrows) memory per thread.
+     *
+     * @param nx [size_type] number of queries
+     * @param x_offsets [InputIterator1<size_type>] nx+1 offsets into x_ind:
+     *  query q is x_ind[x_offsets[q]..x_offsets[q+1])
+     * @param x_ind [InputIterator2<size_type>] indices of the non-zeros
+     *  (ones) of the queries, without duplicates
+     * @param nn [OutputIterator<neighbor_type>] receives k (index, distance)
+     *  pairs for each query, query after query
+     * @param k [0 < size_type <= nrows, (1)] the number of nearest rows to
+     *  retrieve per query
+     * @param nThreads [size_type (0)] maximum number of threads to use, 0 for
+     *  the hardware concurrency
+     *
+     * @b Exceptions:
+     *  @li If the inverted index is missing or out of date.
+     *  @li If k < 1 or k > nrows.
+     */
+    template <typename InputIterator1, typename InputIterator2,
+              typename OutputIterator>
+    inline void
+    L0NearestIndexed(size_type nx, InputIterator1 x_offsets, InputIterator2 x_ind,
+                     OutputIterator nn, size_type k =1,
+                     size_type nThreads =0) const
+    {
+      indexed_nearest_("L0NearestIndexed", nx, x_offsets, x_ind, nn, k,
+                       nThreads, closer_(),
+        [&](size_type nx_q, const std::vector<size_type>& overlap,
+            const std::vector<size_type>& touched,
+            std::vector<neighbor_type>& heap) {
+          for (size_type row : touched) {
+            value_type d = (value_type)
+              (this->nnzr_[row] + nx_q - 2 * overlap[row]);
+            push_bounded_(heap, k, neighbor_type(row, d), closer_());
+          }
+          for (size_type row : rows_by_size_) {
+            if (overlap[row] != 0)
+              continue;
+            value_type d = (value_type) (this->nnzr_[row] + nx_q);
+            if (!push_bounded_(heap, k, neighbor_type(row, d), closer_()))
+              break;
+          }
+        });
+    }
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Finds the k rows that have the largest overlap (number of shared
+     * non-zeros) with each of nx sparse binary queries, using the inverted
+     * index (see buildInvertedIndex). Rows are returned by decreasing overlap,
+     * and rows with the same overlap by increasing row index. The overlap of
+     * binary vectors is also their dot product, so this is the batched and
+     * indexed version of dotNearest for binary data.
+     *
+     * Non-mutating, same complexity as L0NearestIndexed.
+     *
+     * @param nx [size_type] number of queries
+     * @param x_offsets [InputIterator1<size_type>] nx+1 offsets into x_ind
+     * @param x_ind [InputIterator2<size_type>] indices of the non-zeros
+     *  (ones) of the queries, without duplicates
+     * @param nn [OutputIterator<neighbor_type>] receives k (index, overlap)
+     *  pairs for each query, query after query
+     * @param k [0 < size_type <= nrows, (1)] the number of rows to retrieve
+     *  per query
+     * @param nThreads [size_type (0)] maximum number of threads to use, 0 for
+     *  the hardware concurrency
+     *
+     * @b Exceptions:
+     *  @li If the inverted index is missing or out of date.
+     *  @li If k < 1 or k > nrows.
+     */
+    template <typename InputIterator1, typename InputIterator2,
+              typename OutputIterator>
+    inline void
+    overlapNearestIndexed(size_type nx, InputIterator1 x_offsets,
+                          InputIterator2 x_ind, OutputIterator nn,
+                          size_type k =1, size_type nThreads =0) const
+    {
+      const size_type nrows = this->nRows();
+
+      indexed_nearest_("overlapNearestIndexed", nx, x_offsets, x_ind, nn, k,
+                       nThreads, larger_(),
+        [&](size_type, const std::vector<size_type>& overlap,
+            const std::vector<size_type>& touched,
+            std::vector<neighbor_type>& heap) {
+          for (size_type row : touched)
+            push_bounded_(heap, k, neighbor_type(row, (value_type) overlap[row]),
+                          larger_());
+          for (size_type row = 0; row != nrows; ++row) {
+            if (overlap[row] != 0)
+              continue;
+            if (!push_bounded_(heap, k, neighbor_type(row, 0), larger_()))
+              break;
+          }
+        });
+    }
+
     //--------------------------------------------------------------------------------  
     /**
      * Computes the "nearest-dot" distance between vector x
@@ -1181,6 +1664,15 @@ namespace nupic {
       range_exp(k, out_begin, out_begin + this->nRows());
     }
 
+  private:
+    // Inverted index: the rows with a non-zero in column j are
+    // inv_rows_[inv_offsets_[j]..inv_offsets_[j+1])
+    std::vector<size_type> inv_offsets_;
+    std::vector<size_type> inv_rows_;
+    std::vector<size_type> rows_by_size_;
+    size_type inv_nrows_ = 0;
+    size_type inv_nnz_ = 0;
+
   }; // end class NearestNeighbor
 
   //--------------------------------------------------------------------------------
@@ -27,6 +27,12 @@
 #ifndef NTA_ROTATION_HPP
 #define NTA_ROTATION_HPP
 
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <nupic/utils/ParallelFor.hpp>
+
 /*
  * Used in GaborFilter
  */
@@ -46,14 +52,76 @@ struct Rotation45
     return floor(x + 0.5);
   }
 
+  inline Rotation45() : nrows_(0), ncols_(0), z_(0)
+  {
+  }
+
   /** 
    * Rotate counter-clockwise by 45 degrees.
    * Fill in pixels in the larger, rotated version of the image.
    */
   inline void rotate(T* original, T* rotated, size_t nrows, size_t ncols,
     size_t z)
+  {
+    plan_(nrows, ncols, z);
+    gather_(rotateMap_, original, rotated);
+  }
+
+  /** 
+   * Rotate clockwise by 45 degrees.
+   * Start with the larger, rotated image, and fill in the smaller image
+   * of the original size.
+   */
+  inline void unrotate(T* unrotated, T* rotated, size_t nrows, size_t ncols,
+    size_t z)
+  {
+    plan_(nrows, ncols, z);
+    gather_(unrotateMap_, rotated, unrotated);
+  }
+
+  /**
+   * Rotates n images, originals[k] into rotateds[k], on nThreads threads
+   * (0 for the hardware concurrency).
+   */
+  inline void rotateBatch(size_t n, const T* const* originals,
+    T* const* rotateds, size_t nrows, size_t ncols, size_t z,
+    size_t nThreads =0)
+  {
+    plan_(nrows, ncols, z);
+    gatherBatch_(rotateMap_, n, originals, rotateds, nThreads);
+  }
+
+  /**
+   * Unrotates n images, rotateds[k] into unrotateds[k], on nThreads threads
+   * (0 for the hardware concurrency).
+   */
+  inline void unrotateBatch(size_t n, T* const* unrotateds,
+    const T* const* rotateds, size_t nrows, size_t ncols, size_t z,
+    size_t nThreads =0)
+  {
+    plan_(nrows, ncols, z);
+    gatherBatch_(unrotateMap_, n, rotateds, unrotateds, nThreads);
+  }
+
+private:
+  // (destination, source) pixel pairs of each direction, for the image
+  // size of the last call. Images of the same size reuse them, so the
+  // rotation is a plain copy through an index table.
+  typedef std::vector<std::pair<size_t, size_t> > Map_;
+
+  size_t nrows_;
+  size_t ncols_;
+  size_t z_;
+  Map_ rotateMap_;
+  Map_ unrotateMap_;
+
+  inline void plan_(size_t nrows, size_t ncols, size_t z)
   {
     offset_ = size_t(T(ncols) * cos45);  // Vertical offset
+    if (nrows == nrows_ && ncols == ncols_ && z == z_)
+      return;
+
+    rotateMap_.clear();
     for (int j = -1 * offset_; j != int(z - offset_); j++) {
       for (int i = 0; i != int(z); i++) {
         // Compute the nearest source pixel for this destination pixel
@@ -61,35 +129,45 @@ struct Rotation45
         srow_ = int(round(cos45 * T(j) + cos45 * T(i)));
         scol_ = int(round(-1 * cos45 * T(j) + cos45 * T(i)));
         if (0 <= srow_ && srow_ < int(nrows) && 0 <= scol_ && scol_ < int(ncols)) {
-          // Copy the source pixel to the destination pixel
-          rotated[size_t(j + offset_) * z + i] = original[srow_ * ncols + scol_];
+          rotateMap_.push_back(std::make_pair(size_t(j + offset_) * z + i,
+                                              size_t(srow_) * ncols + scol_));
         }
       }
     }
-  }
 
-  /** 
-   * Rotate clockwise by 45 degrees.
-   * Start with the larger, rotated image, and fill in the smaller image
-   * of the original size.
-   */
-  inline void unrotate(T* unrotated, T* rotated, size_t nrows, size_t ncols,
-    size_t z)
-  {
-    offset_ = size_t(T(ncols) * cos45);  // Vertical offset
+    unrotateMap_.clear();
     for (size_t j = 0; j != nrows; j++) {
       for (size_t i = 0; i != ncols; i++) {
-        // Compute the nearest source pixel for this destination pixel
-        // Multiply the destination pixel by the rotation matrix
         srow_ = int(round(cos45 * T(j) + -1 * cos45 * T(i)));
         scol_ = int(round(cos45 * T(j) + cos45 * T(i)));
         srow_ += int(offset_);
         if (0 <= srow_ && srow_ < int(z) && 0 <= scol_ && scol_ < int(z)) {
-          // Copy the source pixel to the destination pixel
-          unrotated[j * ncols + i] = rotated[srow_ * z + scol_];
+          unrotateMap_.push_back(std::make_pair(j * ncols + i,
+                                                size_t(srow_) * z + scol_));
         }
       }
     }
+
+    nrows_ = nrows;
+    ncols_ = ncols;
+    z_ = z;
+  }
+
+  static inline void gather_(const Map_& map, const T* from, T* to)
+  {
+    for (const std::pair<size_t, size_t>& p : map)
+      to[p.first] = from[p.second];
+  }
+
+  static inline void gatherBatch_(const Map_& map, size_t n,
+    const T* const* from, T* const* to, size_t nThreads)
+  {
+    nThreads = nupic::parallelThreads(n, nThreads);
+
+    nupic::parallelForShards(n, nThreads, [&](size_t begin, size_t end) {
+      for (size_t k = begin; k != end; ++k)
+        gather_(map, from[k], to[k]);
+    });
   }
 
 };
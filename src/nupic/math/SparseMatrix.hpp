@@ -29,6 +29,7 @@
 
 //----------------------------------------------------------------------
 
+#include <algorithm>
 #include <cstdio> // sprintf
 #include <iomanip>
 #include <vector>
@@ -43,6 +44,7 @@
 #include <nupic/ntypes/MemStream.hpp>
 #include <nupic/proto/SparseMatrixProto.capnp.h>
 #include <nupic/types/Serializable.hpp>
+#include <nupic/utils/ParallelFor.hpp>
 
 namespace nupic {
 
@@ -1077,6 +1079,36 @@ protected:
     nnzr_[row] = nnzr;
   }
 
+  // THREADS
+
+  /**
+   * Number of threads to use for a kernel: nThreads if > 0, else the
+   * hardware concurrency, but never so many that a thread gets less
+   * than a few tens of thousands of operations, or more than n.
+   */
+  static inline size_type num_threads_(size_type nThreads, size_type work,
+                                       size_type n) {
+    return (size_type)parallelThreads(n, nThreads, work, 1 << 15);
+  }
+
+  /**
+   * Calls f(begin_row, end_row) on contiguous shards of the rows, one per
+   * thread. With nThreads == 1, or when the matrix is too small to be worth
+   * splitting, this is simply f(0, nrows) on the calling thread. f must only
+   * touch the rows of its own shard.
+   */
+  template <typename F>
+  inline void parallel_rows_(size_type nThreads, F f) const {
+    const size_type nrows = nRows();
+
+    if (nThreads != 1)
+      nThreads = num_threads_(nThreads, nNonZeros() + nrows, nrows);
+
+    parallelForShards(nrows, nThreads, [&](size_t begin, size_t end) {
+      f((size_type)begin, (size_type)end);
+    });
+  }
+
 public:
   // CONSTRUCTORS
 
@@ -7347,13 +7379,18 @@ public:
    *  for row,col in [0,nrows) X [0,ncols) s.t. this[row,col] != 0
    *
    * @param thresold [value_type] the threshold to apply
+   * @param nThreads [size_type (1)] the number of threads the rows are split
+   *  across, 0 for the hardware concurrency
    *
    * @b Exceptions:
    *  @li None.
    */
-  inline void threshold(const value_type &threshold = nupic::Epsilon) {
-    filter(std::bind(std::greater_equal<value_type>(),
-                     std::placeholders::_1, threshold));
+  inline void threshold(const value_type &threshold = nupic::Epsilon,
+                        size_type nThreads = 1) {
+    parallel_rows_(nThreads, [&](size_type begin, size_type end) {
+      for (size_type row = begin; row != end; ++row)
+        thresholdRow(row, threshold);
+    });
   }
 
   template <typename OutputIterator1, typename OutputIterator2>
@@ -8047,15 +8084,22 @@ public:
 
   /**
    * Finds the row-wise maxima of this sparse matrix, for all rows
-   * simultaneously.
+   * simultaneously. With nThreads != 1, the rows are split across nThreads
+   * threads (0 for the hardware concurrency), and indices and values need
+   * to be random access iterators.
    */
   template <typename OutputIterator1, typename OutputIterator2>
-  inline void rowMax(OutputIterator1 indices, OutputIterator2 values) const {
-    ITERATE_ON_ALL_ROWS {
-      rowMax(row, *indices, *values);
-      ++indices;
-      ++values;
-    }
+  inline void rowMax(OutputIterator1 indices, OutputIterator2 values,
+                     size_type nThreads = 1) const {
+    parallel_rows_(nThreads, [&](size_type begin, size_type end) {
+      OutputIterator1 row_index = indices + begin;
+      OutputIterator2 row_value = values + begin;
+      for (size_type row = begin; row != end; ++row) {
+        rowMax(row, *row_index, *row_value);
+        ++row_index;
+        ++row_value;
+      }
+    });
   }
 
   /**
@@ -8496,17 +8540,22 @@ public:
    * @param val [value_type != 0 (=1)] the value to use in the normalization
    * @param exact [bool (false)]: whether to make the rows exactly sum to val
    *  after normalization or not
+   * @param nThreads [size_type (1)] the number of threads the rows are split
+   *  across, 0 for the hardware concurrency
    *
    * @b Exceptions:
    *  @li None
    */
-  inline void normalizeRows(const value_type &val = 1.0, bool exact = false) {
+  inline void normalizeRows(const value_type &val = 1.0, bool exact = false,
+                            size_type nThreads = 1) {
     { // Pre-conditions
       assert_not_zero_value_(val, "normalizeRows");
     } // End pre-conditions
 
-    ITERATE_ON_ALL_ROWS
-    normalizeRow(row, val, exact);
+    parallel_rows_(nThreads, [&](size_type begin, size_type end) {
+      for (size_type row = begin; row != end; ++row)
+        normalizeRow(row, val, exact);
+    });
   }
 
   /**
@@ -9702,16 +9751,20 @@ public:
    * @param x [InputIterator<value_type>] input vector (size = number of
    * columns)
    * @param y [OutputIterator<value_type>] result (size = number of rows)
+   * @param nThreads [size_type (1)] the number of threads the rows are split
+   *  across, 0 for the hardware concurrency
    *
    * @b Exceptions:
    *  @li None
    */
   template <typename InputIterator, typename OutputIterator>
-  inline void rightVecProd(InputIterator x, OutputIterator y) const {
-    ITERATE_ON_ALL_ROWS {
-      *y = rightVecProd(row, x);
-      ++y;
-    }
+  inline void rightVecProd(InputIterator x, OutputIterator y,
+                           size_type nThreads = 1) const {
+    parallel_rows_(nThreads, [&](size_type begin, size_type end) {
+      OutputIterator y_row = y + begin;
+      for (size_type row = begin; row != end; ++row, ++y_row)
+        *y_row = rightVecProd(row, x);
+    });
   }
 
   /**
@@ -10109,27 +10162,33 @@ public:
    * @param x [InputIterator<value_type>] input vector (size = number of
    * columns)
    * @param y [OutputIterator<value_type>] output vector (size = number of rows)
+   * @param nThreads [size_type (1)] the number of threads the rows are split
+   *  across, 0 for the hardware concurrency
    *
    * @b Exceptions:
    *  @li None
    */
   template <typename InputIterator, typename OutputIterator>
-  inline void rightVecSumAtNZ(InputIterator x, OutputIterator y) const {
-    ITERATE_ON_ALL_ROWS {
+  inline void rightVecSumAtNZ(InputIterator x, OutputIterator y,
+                              size_type nThreads = 1) const {
+    parallel_rows_(nThreads, [&](size_type begin, size_type end) {
+      OutputIterator y_row = y + begin;
+      for (size_type row = begin; row != end; ++row) {
 
-      size_type nnzr = nnzr_[row];
-      size_type *ind = ind_[row];
-      size_type *end1 = ind + 4 * (nnzr / 4), *end2 = ind + nnzr;
-      value_type val = 0.0;
+        size_type nnzr = nnzr_[row];
+        size_type *ind = ind_[row];
+        size_type *end1 = ind + 4 * (nnzr / 4), *end2 = ind + nnzr;
+        value_type val = 0.0;
 
-      for (; ind != end1; ind += 4)
-        val += x[*ind] + x[*(ind + 1)] + x[*(ind + 2)] + x[*(ind + 3)];
+        for (; ind != end1; ind += 4)
+          val += x[*ind] + x[*(ind + 1)] + x[*(ind + 2)] + x[*(ind + 3)];
 
-      while (ind != end2)
-        val += x[*ind++];
+        while (ind != end2)
+          val += x[*ind++];
 
-      *y++ = val;
-    }
+        *y_row++ = val;
+      }
+    });
   }
 
   /**
@@ -10139,20 +10198,24 @@ public:
    */
   template <typename InputIterator, typename OutputIterator>
   inline void rightVecSumAtNZGtThreshold(InputIterator x, OutputIterator y,
-                                         value_type threshold) const {
-    ITERATE_ON_ALL_ROWS {
-
-      size_type nnzr = nnzr_[row];
-      size_type *ind = ind_[row];
-      value_type *nz = nz_[row];
-      value_type val = 0.0;
+                                         value_type threshold,
+                                         size_type nThreads = 1) const {
+    parallel_rows_(nThreads, [&](size_type begin, size_type end) {
+      OutputIterator y_row = y + begin;
+      for (size_type row = begin; row != end; ++row) {
+
+        size_type nnzr = nnzr_[row];
+        size_type *ind = ind_[row];
+        value_type *nz = nz_[row];
+        value_type val = 0.0;
 
-      for (size_type i = 0; i != nnzr; ++i)
-        if (nz[i] > threshold)
-          val += x[ind[i]];
+        for (size_type i = 0; i != nnzr; ++i)
+          if (nz[i] > threshold)
+            val += x[ind[i]];
 
-      *y++ = val;
-    }
+        *y_row++ = val;
+      }
+    });
   }
 
   /**
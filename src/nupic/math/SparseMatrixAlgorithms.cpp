@@ -24,19 +24,56 @@
  * External algorithms for operating on a sparse matrix.
  */
 
+#include <map>
+#include <mutex>
+#include <tuple>
+
 #include <nupic/math/SparseMatrix.hpp>
 #include <nupic/math/SparseMatrixAlgorithms.hpp>
 
 /**
- * This file contains the declarations for the two static tables that we compute
- * to speed-up log sum and log diff.
+ * This file contains the registry of the tables that we compute to speed-up
+ * log sum and log diff.
  */
 
 namespace nupic {
 
-  // The two tables used when approximating logSum and logDiff.
-  std::vector<LogSumApprox::value_type> LogSumApprox::table;
-  std::vector<LogDiffApprox::value_type> LogDiffApprox::table;
+  typedef std::tuple<int, int, LogApproxTables::value_type,
+                     LogApproxTables::value_type, bool> LogApproxKey;
 
-} // end namespace nupic
+  static std::mutex logApproxMutex;
+
+  static std::map<LogApproxKey, LogApproxTables::table_ptr>& logApproxTables()
+  {
+    static std::map<LogApproxKey, LogApproxTables::table_ptr> tables;
+    return tables;
+  }
+
+  LogApproxTables::table_ptr
+  LogApproxTables::get(Function function, int n,
+                       value_type min_a, value_type max_a, bool interpolated,
+                       const std::function<void(table_type&)>& compute)
+  {
+    // The lock is held while computing, so that concurrent first uses
+    // compute the table only once.
+    std::lock_guard<std::mutex> lock(logApproxMutex);
+
+    table_ptr& table = logApproxTables()[
+      std::make_tuple((int) function, n, min_a, max_a, interpolated)];
 
+    if (!table) {
+      std::shared_ptr<table_type> values = std::make_shared<table_type>();
+      compute(*values);
+      table = values;
+    }
+
+    return table;
+  }
+
+  size_t LogApproxTables::size()
+  {
+    std::lock_guard<std::mutex> lock(logApproxMutex);
+    return logApproxTables().size();
+  }
+
+} // end namespace nupic
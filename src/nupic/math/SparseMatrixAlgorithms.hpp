@@ -27,6 +27,8 @@
 #ifndef NTA_SM_ALGORITHMS_HPP
 #define NTA_SM_ALGORITHMS_HPP
 
+#include <functional>
+#include <memory>
 #include <vector>
 #include <nupic/utils/Random.hpp>
 
@@ -1748,11 +1750,66 @@ namespace nupic {
   // - when computing the index in the table for a given (x,y), use float for the step, 
   // otherwise the speed is halved. This float precision is enough when evaluating the index.
   //
+  // Interpolated tables:
+  // ===================
+  //
+  // Instead of a step function over millions of entries, the tables can store n+1 knots 
+  // and interpolate linearly between them. One more knot past max_a gives the last 
+  // interval a right end, so that a - b = max_a, or a position that float rounding 
+  // puts on the last knot, stays inside the table. The error of linear interpolation with step h 
+  // is bounded by h^2/8 * max|f''|. For logSum, f(a,0) = log(1 + exp(a)) has 
+  // f'' = s(a)(1 - s(a)) <= 1/4, where s is the sigmoid, so the error is <= h^2/32: 
+  // 5.8e-6 for 4096 knots on [-28,28], about the error of the 5,000,000 entries step table. 
+  // For logDiff, f(a,0) = log(exp(a) - 1) has an unbounded second derivative near 0, so 
+  // the table stores g(a) = log((exp(a) - 1)/a) instead, and log(a) is added back when 
+  // evaluating. g'' is in ]0,1/12], so the error is <= h^2/96: 2e-6 for 4096 knots on 
+  // ]0,28], plus the error of logf. In float, both are also subject to the rounding of the 
+  // final sum with b, a few ulps of the result.
+  //
+  // Sharing the tables:
+  // ==================
+  //
+  // The tables are kept in LogApproxTables, one per set of parameters, and are computed 
+  // the first time an instance needs them. Instances with the same parameters share the 
+  // same read-only table, which can be used concurrently.
+  //
+  //--------------------------------------------------------------------------------
+  /**
+   * Registry of the tables used by LogSumApprox and LogDiffApprox. There is one 
+   * table per (function, domain, resolution, interpolation), computed the first 
+   * time it is asked for, and kept until the program exits. get() can be called 
+   * from several threads: the first caller for a set of parameters computes the 
+   * table while the others wait for it.
+   */
+  class LogApproxTables {
+
+  public:
+    typedef float value_type;
+    typedef std::vector<value_type> table_type;
+    typedef std::shared_ptr<const table_type> table_ptr;
+
+    enum Function { LogSum, LogDiff };
+
+    /**
+     * Returns the table for the given parameters, calling compute on an empty 
+     * table to fill it if it doesn't exist yet.
+     */
+    static table_ptr get(Function function, int n,
+                         value_type min_a, value_type max_a, bool interpolated,
+                         const std::function<void(table_type&)>& compute);
+
+    /**
+     * Number of tables computed so far.
+     */
+    static size_t size();
+  };
+
   //--------------------------------------------------------------------------------
   /**
    * Approximates a sum of logs operation we have in LBP with a table for speed.
    * A table of values (step function) is computed once, then accessed on subsequent 
-   * calls. The values are used directly, rather than using interpolation.
+   * calls. The values are used directly, unless the table is interpolated, in which 
+   * case far fewer values are needed (see the implementation notes above).
    *
    * TODO: use asymptotes to reduce the size of the table
    */
@@ -1765,7 +1822,9 @@ namespace nupic {
   private:
     value_type min_a, max_a;              // bounds of domain
     value_type step_a;                    // step along side of domain
-    static std::vector<value_type> table; // table of approximant step function
+    bool interpolated;                    // knots rather than a step function
+    LogApproxTables::table_ptr table;     // table of approximant function
+    const value_type *tab;                // values of table
 
     // Various constants used in the function
     value_type minFloor, minExp, logOfZero;
@@ -1795,12 +1854,17 @@ namespace nupic {
      * On Windows:
      * Sum of logs table: 20000000 -28 28 2.8e-006 76MB
      * abs=3.41339533527e-006 rel=0.00028832192106
+     *
+     * With interpolated_ = true, the table holds n+2 knots instead, and n = 4096
+     * gives an absolute error of about 1e-5 on [-28,28] in 16KB, most of it 
+     * from computing the position in the table in float. 
      */
     inline LogSumApprox(int n_ = 5000000, 
                         value_type min_a_ =-28, value_type max_a_ =28,
-                        bool trace_ =false)
+                        bool trace_ =false, bool interpolated_ =false)
       : min_a(min_a_), max_a(max_a_),
         step_a((value_type)((max_a - min_a)/n_)),
+        interpolated(interpolated_),
         minFloor((value_type)(1.1 * 1e-6)),
         minExp(logf(std::numeric_limits<value_type>::epsilon())),
         logOfZero(((value_type)-1.0)/std::numeric_limits<value_type>::epsilon()),
@@ -1812,18 +1876,31 @@ namespace nupic {
         NTA_ASSERT(0 < step_a);
       } // End pre-conditions
 
-      if (table.empty()) {
-        table.resize(n_);
-        compute_table();
-      }
+      table = LogApproxTables::get(LogApproxTables::LogSum, n_, min_a, max_a,
+                                   interpolated,
+                                   [&](LogApproxTables::table_type& t) {
+                                     t.resize(interpolated ? n_ + 2 : n_);
+                                     compute_table(t);
+                                   });
+      tab = table->data();
 
       if (trace)
-        std::cout << "Sum of logs table: " << table.size() << " "
+        std::cout << "Sum of logs table: " << table->size() << " "
                   << min_a << " " << max_a << " " << step_a << " "
-                  << (4*table.size()/(1024*1024)) << "MB" << std::endl;
+                  << (4*table->size()/(1024*1024)) << "MB" << std::endl;
+    }
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Computes the index corresponding to a,b in the table.
+     */
+    inline int index(value_type a, value_type b) const
+    {
+      return (int)((a - (b + min_a)) / step_a);
     }
 
     //--------------------------------------------------------------------------------
+  private:
     /**
      * This function computes the slice of sum_of_logs(a,b) for b = 0, but when
      * the function will be called later, it will always be called with a and b
@@ -1833,25 +1910,30 @@ namespace nupic {
      * wouldn't pass for b = 0. The step needs to be a double, or it gets out of sync 
      * to compute the intervals of the table.
      */
-    inline void compute_table()
+    inline void compute_table(LogApproxTables::table_type& t) const
     {
       double a = min_a, step = step_a;
       
-      for (size_t ia = 0; ia < table.size(); ++ia, a += step) 
-        table[ia] = sum_of_logs_f((value_type)a,(value_type)0);
+      for (size_t ia = 0; ia < t.size(); ++ia, a += step) 
+        t[ia] = sum_of_logs_f((value_type)a,(value_type)0);
     }
 
     //--------------------------------------------------------------------------------
     /**
-     * Computes the index corresponding to a,b in the table.
+     * Value of the table for (a,b), without b added, read directly or interpolated
+     * between the two closest knots.
      */
-    inline int index(value_type a, value_type b) const
+    inline value_type lookup(value_type a, value_type b) const
     {
-      return (int)((a - (b + min_a)) / step_a);
+      if (!interpolated)
+        return tab[index(a,b)];
+
+      value_type x = (a - (b + min_a)) / step_a;
+      int i = (int) x;
+      return tab[i] + (x - i) * (tab[i+1] - tab[i]);
     }
 
     //--------------------------------------------------------------------------------
-  private:
     /**
      * This is the exact function we approximate. It's of the form z = f(a,b).
      * Note that in real applications, a and b will be far from minFloor. 
@@ -1886,7 +1968,7 @@ namespace nupic {
         NTA_ASSERT(minFloor <= fabs(b)) << b;
       } // End pre-conditions
 
-      value_type val = table[index(a,b)] + b;  
+      value_type val = lookup(a,b) + b;  
 
       if (fabs(val) < minFloor)
         val = minFloor;
@@ -1894,6 +1976,61 @@ namespace nupic {
       return val;
     }    
 
+    //--------------------------------------------------------------------------------
+    /**
+     * fast_sum_of_logs on n pairs of values: y[i] = sum_of_logs(a[i],b[i]). The loop 
+     * has no other branch than the clamping to minFloor, so that the compiler can 
+     * vectorize it where the target has gather instructions. y can be a or b.
+     * Will crash if some (a[i],b[i]) is outside of the domain.
+     */
+    inline void fastLogSum(const value_type* a, const value_type* b, value_type* y,
+                           size_t n) const
+    {
+      { // Pre-conditions
+#ifdef NTA_ASSERTIONS_ON
+        for (size_t i = 0; i != n; ++i) {
+          NTA_ASSERT(minFloor <= fabs(a[i])) << a[i];
+          NTA_ASSERT(minFloor <= fabs(b[i])) << b[i];
+        }
+#endif
+      } // End pre-conditions
+
+      for (size_t i = 0; i != n; ++i) {
+        value_type val = lookup(a[i], b[i]) + b[i];
+        y[i] = fabs(val) < minFloor ? minFloor : val;
+      }
+    }
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Binary functor for SparseMatrix::elementRowNZApply: fast_sum_of_logs(a,b).
+     */
+    struct FastSumOfLogs
+    {
+      const LogSumApprox* approx;
+
+      inline FastSumOfLogs(const LogSumApprox* a) : approx(a) {}
+
+      inline value_type operator()(value_type a, value_type b) const
+      {
+        return approx->fast_sum_of_logs(a, b);
+      }
+    };
+
+    //--------------------------------------------------------------------------------
+    /**
+     * fast_sum_of_logs between the non-zeros of a row of a SparseMatrix and the 
+     * values of dense vector x at the same columns: 
+     * A[row,col] = sum_of_logs(A[row,col], x[col]) for the non-zeros of row.
+     */
+    template <typename SM>
+    inline void fastLogSumRow(SM& A, typename SM::size_type row,
+                              const value_type* x) const
+    {
+      // Results are clamped to minFloor, so no non-zero is removed
+      A.elementRowNZApply(row, FastSumOfLogs(this), x);
+    }
+
     //--------------------------------------------------------------------------------
     /**
      * Works with illimited range, but slower.
@@ -2020,7 +2157,9 @@ namespace nupic {
   private:
     value_type min_a, max_a;              // bounds of domain
     value_type step_a;                    // step along side of domain
-    static std::vector<value_type> table; // the approximating values themselves 
+    bool interpolated;                    // knots rather than a step function
+    LogApproxTables::table_ptr table;     // the approximating values themselves 
+    const value_type *tab;                // values of table
 
     // Various constants used in the function
     value_type minFloor, minExp, logOfZero;
@@ -2040,13 +2179,17 @@ namespace nupic {
      * parameters are the bounds of the domain. n*n values are computed once
      * and stored in a table.
      *
+     * With interpolated_ = true, the table holds n+2 knots instead, and n = 4096
+     * gives an absolute error of about 5e-6 on ]0,28] in 16KB. 
+     *
      * TODO: use asymptotes to reduce the size of the table
      */
     inline LogDiffApprox(int n_ = 5000000, 
                          value_type min_a_ =1e-10, value_type max_a_ =28,
-                         bool trace_ =false)
+                         bool trace_ =false, bool interpolated_ =false)
       : min_a(min_a_), max_a(max_a_),
         step_a((value_type)((max_a - min_a)/n_)),
+        interpolated(interpolated_),
         minFloor((value_type)(1.1 * 1e-6)),
         minExp(logf(std::numeric_limits<value_type>::epsilon())),
         logOfZero(((value_type)-1.0)/std::numeric_limits<value_type>::epsilon()),
@@ -2058,39 +2201,64 @@ namespace nupic {
         NTA_ASSERT(0 < step_a);
       } // End pre-conditions
 
-      if (table.empty()) {
-        table.resize(n_);
-        compute_table();
-      }
+      table = LogApproxTables::get(LogApproxTables::LogDiff, n_, min_a, max_a,
+                                   interpolated,
+                                   [&](LogApproxTables::table_type& t) {
+                                     t.resize(interpolated ? n_ + 2 : n_);
+                                     compute_table(t);
+                                   });
+      tab = table->data();
 
       if (trace)
-        std::cout << "Diff of logs table: " << table.size() << " "
+        std::cout << "Diff of logs table: " << table->size() << " "
                   << min_a << " " << max_a << " " << step_a << " "
-                  << (4*table.size()/(1024*1024)) << "MB" << std::endl;
+                  << (4*table->size()/(1024*1024)) << "MB" << std::endl;
     }
 
     //--------------------------------------------------------------------------------
     /**
-     * See comments for LogSumApprox::compute_table().
+     * Computes the index corresponding to a,b in the table.
      */
-    inline void compute_table()
+    inline int index(value_type a, value_type b) const
+    {
+      return (int)((a - (b + min_a)) / step_a);
+    }
+
+  private:
+    //--------------------------------------------------------------------------------
+    /**
+     * See comments for LogSumApprox::compute_table(). Interpolated tables store 
+     * log((exp(a) - 1)/a) rather than log(exp(a) - 1), which is smooth at 0.
+     */
+    inline void compute_table(LogApproxTables::table_type& t) const
     {
       double a = min_a, step = step_a;
       
-      for (size_t ia = 0; ia < table.size(); ++ia, a += step) 
-        table[ia] = diff_of_logs_f((value_type)a,(value_type)0);
+      if (interpolated) {
+        for (size_t ia = 0; ia < t.size(); ++ia, a += step) 
+          t[ia] = (value_type) log(expm1(a) / a);
+      } else {
+        for (size_t ia = 0; ia < t.size(); ++ia, a += step) 
+          t[ia] = diff_of_logs_f((value_type)a,(value_type)0);
+      }
     }
 
     //--------------------------------------------------------------------------------
     /**
-     * Computes the index corresponding to a,b in the table.
+     * Value of the table for (a,b), without b added, read directly or interpolated
+     * between the two closest knots.
      */
-    inline int index(value_type a, value_type b) const
+    inline value_type lookup(value_type a, value_type b) const
     {
-      return (int)((a - (b + min_a)) / step_a);
+      if (!interpolated)
+        return tab[index(a,b)];
+
+      value_type d = a - b;
+      value_type x = (d - min_a) / step_a;
+      int i = (int) x;
+      return tab[i] + (x - i) * (tab[i+1] - tab[i]) + logf(d);
     }
 
-  private:
     //--------------------------------------------------------------------------------
     /**
      * This is the exact function we approximate. It's of the form z = f(a,b).
@@ -2127,7 +2295,7 @@ namespace nupic {
         NTA_ASSERT(minFloor <= fabs(b)) << b;
       } // End pre-conditions
 
-      value_type val = table[index(a,b)] + b;  
+      value_type val = lookup(a,b) + b;  
 
       if (fabs(val) < minFloor)
         val = minFloor;
@@ -2135,6 +2303,60 @@ namespace nupic {
       return val;
     }    
 
+    //--------------------------------------------------------------------------------
+    /**
+     * fast_diff_of_logs on n pairs of values: y[i] = diff_of_logs(a[i],b[i]), 
+     * with b[i] < a[i]. See LogSumApprox::fastLogSum.
+     */
+    inline void fastLogDiff(const value_type* a, const value_type* b, value_type* y,
+                            size_t n) const
+    {
+      { // Pre-conditions
+#ifdef NTA_ASSERTIONS_ON
+        for (size_t i = 0; i != n; ++i) {
+          NTA_ASSERT(b[i] < a[i]);
+          NTA_ASSERT(minFloor <= fabs(a[i])) << a[i];
+          NTA_ASSERT(minFloor <= fabs(b[i])) << b[i];
+        }
+#endif
+      } // End pre-conditions
+
+      for (size_t i = 0; i != n; ++i) {
+        value_type val = lookup(a[i], b[i]) + b[i];
+        y[i] = fabs(val) < minFloor ? minFloor : val;
+      }
+    }
+
+    //--------------------------------------------------------------------------------
+    /**
+     * Binary functor for SparseMatrix::elementRowNZApply: fast_diff_of_logs(a,b).
+     */
+    struct FastDiffOfLogs
+    {
+      const LogDiffApprox* approx;
+
+      inline FastDiffOfLogs(const LogDiffApprox* a) : approx(a) {}
+
+      inline value_type operator()(value_type a, value_type b) const
+      {
+        return approx->fast_diff_of_logs(a, b);
+      }
+    };
+
+    //--------------------------------------------------------------------------------
+    /**
+     * fast_diff_of_logs between the non-zeros of a row of a SparseMatrix and the 
+     * values of dense vector x at the same columns: 
+     * A[row,col] = diff_of_logs(A[row,col], x[col]) for the non-zeros of row.
+     */
+    template <typename SM>
+    inline void fastLogDiffRow(SM& A, typename SM::size_type row,
+                               const value_type* x) const
+    {
+      // Results are clamped to minFloor, so no non-zero is removed
+      A.elementRowNZApply(row, FastDiffOfLogs(this), x);
+    }
+
     //--------------------------------------------------------------------------------
     /**
      * Will fall back on calling function if (a,b) outside domain (slower).
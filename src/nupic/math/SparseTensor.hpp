@@ -32,25 +32,7 @@
 #include <nupic/math/ArrayAlgo.hpp>
 #include <nupic/math/StlIo.hpp>
 #include <nupic/math/Domain.hpp>
-
-
-//----------------------------------------------------------------------
-
-
-/* FAST TENSOR */
-/*
-#include <ext/hash_map>
-#include <nupic/math/GPL_Hash2.hpp>
-
-template <typename Index>
-struct HashIndex
-{
-  inline size_t operator()(const Index& idx) const
-  {
-    return 1543 * idx[1] + idx[0];
-  }
-};
-*/
+#include <nupic/math/SparseTensorStorage.hpp>
 
 //----------------------------------------------------------------------
 
@@ -76,8 +58,17 @@ namespace nupic {
    * It doesn't work with complex numbers yet (have to modify nearlyZero_
    * to look at the modulus).
    *
-   * The implementation relies on a Unique, Sorted Associative NZ,
-   * that is map (rather than hash_map, we need the Indices to be sorted).
+   * The non-zeros are kept in a container chosen by the third template
+   * parameter, Storage (see SparseTensorStorage.hpp):
+   *  - SparseTensorMapStorage (default): a std::map,
+   *  - SparseTensorSortedStorage: a flat array of (Index, Float) sorted by
+   *    Index, faster to iterate and search, and to build in bulk,
+   *  - SparseTensorHashStorage: an open-addressing hash table, for the
+   *    workloads dominated by random get/set/update. Its iteration order
+   *    is unspecified, so toList, toIdxVal, toStream and the intersection
+   *    and union of non-zeros don't return the indices in order with it.
+   * The operations between tensors (element_apply, factor_apply...) take
+   * tensors with the same Storage.
    *
    * Examples:
    * 1) SparseTensor<Index<UInt, 2>, float>:
@@ -91,6 +82,10 @@ namespace nupic {
    * 3) SparseTensor<Index<UInt, 4> double>:
    *  defines a sparse tensor of rank 4 (4 dimensions), storing doubles.
    *
+   * 4) SparseTensor<Index<UInt, 3>, float, SparseTensorSortedStorage>:
+   *  defines a sparse tensor of rank 3 that stores its non-zeros in a
+   *  sorted array.
+   *
    * @b Responsibility
    *  An efficient multi-dimensional sparse data structure
    *
@@ -115,15 +110,14 @@ namespace nupic {
    *  or non-zeros.
    * 
    */
-  template <typename Index, typename Float>
+  template <typename Index, typename Float,
+            template <typename, typename> class Storage = SparseTensorMapStorage>
   class SparseTensor
   {
   public:
     typedef Index TensorIndex;
     typedef typename Index::value_type UInt;
-    typedef std::map<Index, Float> NZ; 
-    //typedef __gnu_cxx::hash_map<Index, Float, HashIndex<Index> > NZ;
-    //typedef hash_map<Index, Float, HashIndex<Index> > NZ;
+    typedef Storage<Index, Float> NZ;
     typedef typename NZ::iterator iterator;
     typedef typename NZ::const_iterator const_iterator;
 
@@ -191,9 +185,9 @@ namespace nupic {
      * The two tensors need to have the same rank, but they don't
      * need to have the same dimensions.
      * 
-     * @param B [SparseTensor<Index, Float>] the tensor to swap with
+     * @param B [SparseTensor<Index, Float, Storage>] the tensor to swap with
      */
-    inline void swap(SparseTensor<Index, Float>& B)
+    inline void swap(SparseTensor<Index, Float, Storage>& B)
     {
       {
         NTA_ASSERT(B.getRank() == getRank());
@@ -395,11 +389,11 @@ namespace nupic {
      *   per column of A, and B is a vector of size 13.
      *
      * @param dims [Index2] the dimensions along which to count the non-zeros
-     * @param B [SparseTensor<IndexB, Float>] the sparse tensor of the number
+     * @param B [SparseTensor<IndexB, Float, Storage>] the sparse tensor of the number
      *  of non-zeros per sub-space
      */
     template <typename Index2, typename IndexB>
-    inline void getNNonZeros(const Index2& dims, SparseTensor<IndexB, Float>& B) const
+    inline void getNNonZeros(const Index2& dims, SparseTensor<IndexB, Float, Storage>& B) const
     {
       {
         NTA_ASSERT(dims.size() + B.getRank() == getRank());
@@ -410,11 +404,15 @@ namespace nupic {
       IndexB compDims = B.getNewIndex(), idxB = B.getNewIndex();
       complement(dims, compDims);
       
+      std::vector<std::pair<IndexB, Float> > updates;
+      updates.reserve(getNNonZeros());
       const_iterator it, e;
       for (it = begin(), e = end(); it != e; ++it) {
         project(compDims, it->first, idxB);
-        B.update(idxB, (Float)1, std::plus<Float>());
+        updates.push_back(std::make_pair(idxB, (Float)1));
       }
+      B.updateFromIdxVal((UInt)updates.size(), updates.begin(),
+                         std::plus<Float>());
     }
 
     /**
@@ -422,7 +420,7 @@ namespace nupic {
      * this sparse tensor. See getNNonZeros doc.
      */
     template <typename Index2, typename IndexB>
-    inline void getNZeros(const Index2& dims, SparseTensor<IndexB, Float>& B) const
+    inline void getNZeros(const Index2& dims, SparseTensor<IndexB, Float, Storage>& B) const
     {
       {
         NTA_ASSERT(dims.size() + B.getRank() == getRank());
@@ -433,11 +431,15 @@ namespace nupic {
       
       B.setAll((Float)getSizeElts(dims));
 
+      std::vector<std::pair<IndexB, Float> > updates;
+      updates.reserve(getNNonZeros());
       const_iterator it, e;
       for (it = begin(), e = end(); it != e; ++it) {
         project(compDims, it->first, idxB);
-        B.update(idxB, (Float)1, std::minus<Float>());
+        updates.push_back(std::make_pair(idxB, (Float)1));
       }
+      B.updateFromIdxVal((UInt)updates.size(), updates.begin(),
+                         std::minus<Float>());
     }
 
     /**
@@ -549,7 +551,7 @@ namespace nupic {
      * Returns the fill rate for sub-spaces of this sparse tensor.
      */
     template <typename Index2, typename IndexB>
-    inline void getFillRate(const Index2& dims, SparseTensor<IndexB, Float>& B) const
+    inline void getFillRate(const Index2& dims, SparseTensor<IndexB, Float, Storage>& B) const
     {
       getNNonZeros(dims, B);
       B.element_apply_fast(bind2nd(std::divides<Float>(), (Float)getSizeElts(dims)));
@@ -868,16 +870,9 @@ namespace nupic {
           << " - Should be included in: " << getDomain();
       }
 
-      iterator it = begin(), d, e = end();
-      while (it != e) {
-        if (dom.includes(it->first)) {
-          d = it;
-          ++it; // increment before erase
-          nz_.erase(d);
-        } else {
-          ++it;
-        }
-      }
+      nz_.erase_if([&dom](const typename NZ::value_type& nz) {
+          return dom.includes(nz.first);
+        });
     }
 
     /**
@@ -1175,17 +1170,17 @@ namespace nupic {
           ind_v[*i] = j;
       }
       
-      NZ keep;
+      std::vector<std::pair<Index, Float> > keep;
 
       iterator i, e;
       for (i = begin(), e = end(); i != e; ++i) 
         if (ind.find(i->first[dim]) != ind.end()) {
           Index idx = i->first;
           idx[dim] = ind_v[idx[dim]]; 
-          keep[idx] = i->second;
+          keep.push_back(std::make_pair(idx, i->second));
         }
 
-      nz_ = keep;
+      nz_.assign(keep.begin(), keep.end());
 
       Index bounds = getNewIndex();
       bounds[dim] = (UInt)ind.size();
@@ -1216,14 +1211,14 @@ namespace nupic {
      *
      * @param range [Domain<UInt>] the range to extract from this 
      *  tensor.
-     * @param B [SparseTensor<IndexB, Float>] the resulting 
+     * @param B [SparseTensor<IndexB, Float, Storage>] the resulting 
      *  slice
      * @param clearYesNo [bool] whether to clear B before 
      *  slicing or not
      */
     template <typename IndexB>
     inline void getSlice(const Domain<UInt>& range, 
-                         SparseTensor<IndexB, Float>& B) const
+                         SparseTensor<IndexB, Float, Storage>& B) const
     {
       { 
         NTA_ASSERT(range.rank() == getRank());
@@ -1256,7 +1251,7 @@ namespace nupic {
 
     template <typename IndexB>
     inline void setSlice(const Domain<UInt>& range, 
-                         const SparseTensor<IndexB, Float>& B)
+                         const SparseTensor<IndexB, Float, Storage>& B)
     {
       { 
         NTA_ASSERT(range.rank() == getRank());
@@ -1282,16 +1277,19 @@ namespace nupic {
         if (range[i].empty())
           idx[range[i].getDim()] = range[i].getLB();
       range.getOpenDims(openDims);
-      typename SparseTensor<IndexB, Float>::const_iterator it, e;
+      typename SparseTensor<IndexB, Float, Storage>::const_iterator it, e;
       it = B.begin();
       e = B.end(); 
 
+      std::vector<std::pair<Index, Float> > values;
+      values.reserve(B.getNNonZeros());
       for (; it != e; ++it)  {
         embed(openDims, it->first, idx);
         for (UInt k = 0; k < B.getRank(); ++k)
-          idx[k] += range[openDims[k]].getLB();
-        set(idx, it->second);
+          idx[openDims[k]] += range[openDims[k]].getLB();
+        values.push_back(std::make_pair(idx, it->second));
       }
+      setFromIdxVal_(values);
     }
 
     template <typename OutputIterator1, typename OutputIterator2>
@@ -1403,8 +1401,11 @@ namespace nupic {
       if (clearYesNo)
         clear();
 
+      std::vector<std::pair<Index, Float> > values;
+      values.reserve(nz);
       for (UInt i = 0; i < nz; ++i, ++iv)
-        set(iv->first, iv->second);
+        values.push_back(std::make_pair(iv->first, iv->second));
+      setFromIdxVal_(values);
     } 
 
     /**
@@ -1418,20 +1419,40 @@ namespace nupic {
       if (clearYesNo)
         clear();
 
-      for (UInt i = 0; i < nz; ++i, ++iv)
-        setNonZero(iv->first, iv->second);
+      std::vector<std::pair<Index, Float> > values;
+      values.reserve(nz);
+      for (UInt i = 0; i < nz; ++i, ++iv) {
+        NTA_ASSERT(!nearlyZero_(iv->second))
+          << "SparseTensor::fromIdxVal_nz(): "
+          << "Invalid zero value: " << iv->second
+          << " at index: " << iv->first;
+        values.push_back(std::make_pair(iv->first, iv->second));
+      }
+      setFromIdxVal_(values);
     } 
 
     /**
      * Updates some of the values in this sparse tensor, the indices and 
      * values to use for the update being passed in the input iterator. 
-     * Uses binary functor f to carry out the update. 
+     * Uses binary functor f to carry out the update, in order, as 
+     * update(index, value, f) would.
+     *
+     * The updates are applied in bulk, which is faster than calling update 
+     * for each of them, in particular with SparseTensorSortedStorage.
      */
     template <typename InIter, typename binary_functor>
     inline void updateFromIdxVal(const UInt& nz, InIter iv, binary_functor f)
     {
-      for (UInt i = 0; i < nz; ++i, ++iv)
-        update(iv->first, iv->second, f);
+      std::vector<std::pair<Index, Float> > values;
+      values.reserve(nz);
+      for (UInt i = 0; i < nz; ++i, ++iv) {
+        NTA_ASSERT(positiveInBounds(iv->first, getBounds()))
+          << "SparseTensor::updateFromIdxVal(): "
+          << "Invalid index: " << iv->first
+          << " - Should be >= 0 and strictly less than: " << bounds_;
+        values.push_back(std::make_pair(iv->first, iv->second));
+      }
+      nz_.merge(values.begin(), values.end(), f, IsNearlyZero_());
     }
 
     /**
@@ -1546,15 +1567,16 @@ namespace nupic {
       Index idx = getNewIndex(), newBounds = getNewIndex();
       nupic::permute(ind, bounds_, newBounds);
 
-      NZ newMap;
+      std::vector<std::pair<Index, Float> > permuted;
+      permuted.reserve(getNNonZeros());
       
       const_iterator it, e;
       for (it = begin(), e = end(); it != e; ++it) {
         nupic::permute(ind, it->first, idx);
-        newMap[idx] = it->second;
+        permuted.push_back(std::make_pair(idx, it->second));
       }
 
-      nz_ = newMap;
+      nz_.assign(permuted.begin(), permuted.end());
       bounds_ = newBounds;
     }
 
@@ -1571,15 +1593,10 @@ namespace nupic {
         if (newBounds[i] < bounds_[i])
           shrink = true;
 
-      if (shrink) {
-        const_iterator it, e;
-        for (it = begin(), e = end(); it != e; ++it) 
-          if (!positiveInBounds(it->first, newBounds)) {
-            const_iterator d = it;
-            ++it;
-            nz_.erase(d->first);
-          }
-      }
+      if (shrink)
+        nz_.erase_if([&newBounds](const typename NZ::value_type& nz) {
+            return !positiveInBounds(nz.first, newBounds);
+          });
 
       bounds_ = newBounds;
     }
@@ -1604,11 +1621,11 @@ namespace nupic {
      * 
      * Complexity: O(number of non-zeros)
      *
-     * @parameter B [SparseTensor<IndexB, Float>] the target
+     * @parameter B [SparseTensor<IndexB, Float, Storage>] the target
      *  sparse tensor
      */
     template <typename IndexB>
-    inline void reshape(SparseTensor<IndexB, Float>& B) const
+    inline void reshape(SparseTensor<IndexB, Float, Storage>& B) const
     {
       {
         NTA_ASSERT(indexGtZero(B.getBounds()));
@@ -1688,6 +1705,15 @@ namespace nupic {
     {
       inter.clear();
 
+      if (!NZ::sorted) {
+        const SparseTensor& small = getNNonZeros() <= B.getNNonZeros() ? *this : B;
+        const SparseTensor& large = &small == this ? B : *this;
+        for (const_iterator it = small.begin(); it != small.end(); ++it)
+          if (large.nz_.find(it->first) != large.end())
+            inter.push_back(it->first);
+        return;
+      }
+
       const_iterator it1 = begin(), end1 = end();
       const_iterator it2 = B.begin(), end2 = B.end();
       
@@ -1711,7 +1737,7 @@ namespace nupic {
      */
     template <typename IndexB>
     inline void nz_intersection(const IndexB& dims,
-                                const SparseTensor<IndexB, Float>& B,
+                                const SparseTensor<IndexB, Float, Storage>& B,
                                 NonZeros<Index, IndexB>& inter) const
     {
       {
@@ -1744,6 +1770,15 @@ namespace nupic {
     inline void nz_union(const SparseTensor& B, std::vector<Index>& u) const
     {
       u.clear();
+
+      if (!NZ::sorted) {
+        for (const_iterator it = begin(); it != end(); ++it)
+          u.push_back(it->first);
+        for (const_iterator it = B.begin(); it != B.end(); ++it)
+          if (nz_.find(it->first) == end())
+            u.push_back(it->first);
+        return;
+      }
       
       const_iterator it1 = begin(), end1 = end();
       const_iterator it2 = B.begin(), end2 = B.end();
@@ -1778,7 +1813,7 @@ namespace nupic {
      */
     template <typename IndexB>
     inline void nz_union(const IndexB& dims,
-                         const SparseTensor<IndexB, Float>& B,
+                         const SparseTensor<IndexB, Float, Storage>& B,
                          NonZeros<Index, IndexB>& u) const
     {
       {
@@ -1847,20 +1882,18 @@ namespace nupic {
       // Can introduce new zeros! if we know nothing about 
       // the functor      
 
-      iterator it, d, e;
-      it = begin(); e = end();
-      while (it != e) {
-        Float val = f(it->second);
-        if (nearlyZero_(val)) { // check zero _after_ applying functor
-          d = it;
-          ++it; // increment before erasing!
-          nz_.erase(d);
-        }
-        else {
-          it->second = val;
-          ++it;
-        }
+      iterator it, e;
+      bool zeros = false;
+      for (it = begin(), e = end(); it != e; ++it) {
+        it->second = f(it->second);
+        zeros = zeros || nearlyZero_(it->second);
       }
+
+      // check zero _after_ applying functor
+      if (zeros)
+        nz_.erase_if([](const typename NZ::value_type& nz) {
+            return nearlyZero(nz.second);
+          });
     }   
 
     /**
@@ -1919,9 +1952,25 @@ namespace nupic {
           << "Binary functor should do: f(x, 0) == f(0, x) == 0 for all x";
       }
 
+      if (&C == this || &C == &B) {
+        SparseTensor D(C);
+        element_apply_fast(B, D, f, clearYesNo);
+        C.swap(D);
+        return;
+      }
+
       if (clearYesNo)
         C.clear();
 
+      if (!NZ::sorted) {
+        for (const_iterator it = begin(); it != end(); ++it) {
+          const_iterator b = B.nz_.find(it->first);
+          if (b != B.end())
+            C.set(it->first, f(it->second, b->second));
+        }
+        return;
+      }
+
       const_iterator it1, end1, it2, end2;
       it1 = begin(); end1 = end();
       it2 = B.begin(); end2 = B.end();
@@ -1971,9 +2020,25 @@ namespace nupic {
           << "Binary functor should do: f(0, 0) == 0";
       }
 
+      if (&C == this || &C == &B) {
+        SparseTensor D(C);
+        element_apply_nz(B, D, f, clearYesNo);
+        C.swap(D);
+        return;
+      }
+
       if (clearYesNo)
         C.clear();
 
+      if (!NZ::sorted) {
+        for (const_iterator it = begin(); it != end(); ++it)
+          C.set(it->first, f(it->second, B.get(it->first)));
+        for (const_iterator it = B.begin(); it != B.end(); ++it)
+          if (nz_.find(it->first) == end())
+            C.set(it->first, f(0, it->second));
+        return;
+      }
+
       const_iterator 
         it1 = begin(), it2 = B.begin(), 
         end1 = end(), end2 = B.end();
@@ -2047,7 +2112,7 @@ namespace nupic {
      */
     template <typename IndexB, typename binary_functor>
     inline void factor_apply_fast(const IndexB& dims, 
-                                  const SparseTensor<IndexB, Float>& B,
+                                  const SparseTensor<IndexB, Float, Storage>& B,
                                   binary_functor f) 
     {
       {
@@ -2090,7 +2155,7 @@ namespace nupic {
      */
     template <typename IndexB, typename binary_functor>
     inline void factor_apply_nz(const IndexB& dims,
-                                const SparseTensor<IndexB, Float>& B, 
+                                const SparseTensor<IndexB, Float, Storage>& B, 
                                 binary_functor f) 
     {
       {
@@ -2120,10 +2185,14 @@ namespace nupic {
       NonZeros<Index, IndexB> u;
       nz_union(dims, B, u);
 
-      // Calling set because f(a, b) can fall below nupic::Epsilon
+      // Set in bulk, dropping the f(a, b) that fall below nupic::Epsilon
+      std::vector<std::pair<Index, Float> > values;
+      values.reserve(u.size());
       typename NonZeros<Index, IndexB>::const_iterator it, e;
       for (it = u.begin(), e = u.end(); it != e; ++it) 
-        set(it->getIndexA(), f(it->getValA(), it->getValB()));
+        values.push_back(std::make_pair(it->getIndexA(),
+                                        f(it->getValA(), it->getValB())));
+      setFromIdxVal_(values);
     }
 
     /**
@@ -2139,8 +2208,8 @@ namespace nupic {
      */
     template <typename IndexB, typename binary_functor>
     inline void factor_apply_fast(const IndexB& dims,
-                                  const SparseTensor<IndexB, Float>& B, 
-                                  SparseTensor<Index, Float>& C, 
+                                  const SparseTensor<IndexB, Float, Storage>& B, 
+                                  SparseTensor<Index, Float, Storage>& C, 
                                   binary_functor f, 
                                   bool clearYesNo =true) const
     {
@@ -2189,8 +2258,8 @@ namespace nupic {
      */
     template <typename IndexB, typename binary_functor>
     inline void factor_apply_nz(const IndexB& dims,
-                                const SparseTensor<IndexB, Float>& B, 
-                                SparseTensor<Index, Float>& C, 
+                                const SparseTensor<IndexB, Float, Storage>& B, 
+                                SparseTensor<Index, Float, Storage>& C, 
                                 binary_functor f,
                                 bool clearYesNo =true) const
     {
@@ -2245,8 +2314,8 @@ namespace nupic {
      */
     template <typename IndexB, typename binary_functor>
     inline void factor_apply(const IndexB& dims,
-                             const SparseTensor<IndexB, Float>& B, 
-                             SparseTensor<Index, Float>& C, 
+                             const SparseTensor<IndexB, Float, Storage>& B, 
+                             SparseTensor<Index, Float, Storage>& C, 
                              binary_functor f) const
     {
       {
@@ -2296,7 +2365,7 @@ namespace nupic {
      */
     template <typename Index2, typename IndexB, typename binary_functor>
     inline void accumulate_nz(const Index2& dims,
-                              SparseTensor<IndexB, Float>& B, 
+                              SparseTensor<IndexB, Float, Storage>& B, 
                               binary_functor f, const Float& init =0) const
     {
       {
@@ -2314,11 +2383,14 @@ namespace nupic {
       IndexB compDims = B.getNewIndex(), idxB = B.getNewIndex();
       complement(dims, compDims);
       
+      std::vector<std::pair<IndexB, Float> > updates;
+      updates.reserve(getNNonZeros());
       const_iterator it, e;
       for (it = begin(), e = end(); it != e; ++it) {
         project(compDims, it->first, idxB);
-        B.update(idxB, it->second, f);
+        updates.push_back(std::make_pair(idxB, it->second));
       }
+      B.updateFromIdxVal((UInt)updates.size(), updates.begin(), f);
     }
 
     /**
@@ -2335,7 +2407,7 @@ namespace nupic {
      */
     template <typename Index2, typename IndexB, typename binary_functor>
     inline void accumulate(const Index2& dims,
-                           SparseTensor<IndexB, Float>& B, 
+                           SparseTensor<IndexB, Float, Storage>& B, 
                            binary_functor f, const Float& init =0) const
     {
       {
@@ -2382,7 +2454,7 @@ namespace nupic {
       std::vector<UInt> compBounds(getRank() - dims.size());
       project(compDims, getBounds(), compBounds);
 
-      SparseTensor<std::vector<UInt>, Float> C(compBounds);
+      SparseTensor<std::vector<UInt>, Float, Storage> C(compBounds);
 
       accumulate_nz(dims, C, std::plus<Float>(), 0);
       // factor_apply_fast works only on the non-zeros, so it won't attempt
@@ -2403,8 +2475,8 @@ namespace nupic {
      * Complexity: O(square of total number of non-zeros)
      */
     template <typename IndexB, typename IndexC, typename binary_functor>
-    inline void outer_product_nz(const SparseTensor<IndexB, Float>& B,
-                                 SparseTensor<IndexC, Float>& C,
+    inline void outer_product_nz(const SparseTensor<IndexB, Float, Storage>& B,
+                                 SparseTensor<IndexC, Float, Storage>& C,
                                  binary_functor f) const
     {
       {
@@ -2418,7 +2490,7 @@ namespace nupic {
       C.clear();
       
       const_iterator it1, end1;
-      typename SparseTensor<IndexB, Float>::const_iterator it2, end2;
+      typename SparseTensor<IndexB, Float, Storage>::const_iterator it2, end2;
       
       end1 = end(); end2 = B.end();
       
@@ -2438,8 +2510,8 @@ namespace nupic {
      * Complexity: O(square of product of bounds)
      */
     template <typename IndexB, typename IndexC, typename binary_functor>
-    inline void outer_product(const SparseTensor<IndexB, Float>& B,
-                              SparseTensor<IndexC, Float>& C,
+    inline void outer_product(const SparseTensor<IndexB, Float, Storage>& B,
+                              SparseTensor<IndexC, Float, Storage>& C,
                               binary_functor f) const
     {
       {
@@ -2473,7 +2545,7 @@ namespace nupic {
      */
     template <typename IndexB, typename binary_functor>
     inline void contract_nz(const UInt dim1, const UInt dim2,
-                            SparseTensor<IndexB, Float>& B,
+                            SparseTensor<IndexB, Float, Storage>& B,
                             binary_functor f, const Float& init =0) const
     {
       { // Pre-conditions
@@ -2542,7 +2614,7 @@ namespace nupic {
      */
     template <typename IndexB, typename binary_functor>
     inline void contract(const UInt dim1, const UInt dim2, 
-                         SparseTensor<IndexB, Float>& B,
+                         SparseTensor<IndexB, Float, Storage>& B,
                          binary_functor f, const Float& init =0) const
     {
       {
@@ -2596,8 +2668,8 @@ namespace nupic {
     template <typename IndexB, typename IndexC, 
               typename binary_functor1, typename binary_functor2>
     inline void inner_product_nz(const UInt dim1, const UInt dim2,
-                                 const SparseTensor<IndexB, Float>& B,
-                                 SparseTensor<IndexC, Float>& C,
+                                 const SparseTensor<IndexB, Float, Storage>& B,
+                                 SparseTensor<IndexC, Float, Storage>& C,
                                  binary_functor1 f, binary_functor2 g, 
                                  const Float& init =0) const
     {
@@ -2640,7 +2712,7 @@ namespace nupic {
       C.clear();
       
       const_iterator it1, e1;
-      typename SparseTensor<IndexB, Float>::const_iterator it2, e2;
+      typename SparseTensor<IndexB, Float, Storage>::const_iterator it2, e2;
 
       for (it1 = begin(), e1 = end(); it1 != e1; ++it1)
         for (it2 = B.begin(), e2 = B.end(); it2 != e2; ++it2) {
@@ -2673,8 +2745,8 @@ namespace nupic {
     template <typename IndexB, typename IndexC,
               typename binary_functor1, typename binary_functor2>
     inline void inner_product(const UInt dim1, const UInt dim2,
-                              const SparseTensor<IndexB, Float>& B,
-                              SparseTensor<IndexC, Float>& C,
+                              const SparseTensor<IndexB, Float, Storage>& B,
+                              SparseTensor<IndexC, Float, Storage>& C,
                               binary_functor1 f, binary_functor2 g, 
                               const Float& init =0) const
     {
@@ -2737,8 +2809,8 @@ namespace nupic {
     template <typename Index1A, typename IndexB, typename IndexC,
               typename binary_functor1, typename binary_functor2>
     inline void product3(const Index1A& dimsA, const Index1A& dimsB,
-                         const SparseTensor<IndexB, Float>& B,
-                         SparseTensor<IndexC, Float>& C,
+                         const SparseTensor<IndexB, Float, Storage>& B,
+                         SparseTensor<IndexC, Float, Storage>& C,
                          binary_functor1 f) const
     {
       {
@@ -2767,7 +2839,7 @@ namespace nupic {
       project(dimsSliceB, B.getBounds(), boundsSliceB);
       boundsRes = concatenate(boundsSliceA, boundsSliceB);
       
-      SparseTensor<std::vector<UInt>, Float> 
+      SparseTensor<std::vector<UInt>, Float, Storage> 
         sliceA(boundsSliceA), 
         sliceB(boundsSliceB),
         res(boundsRes);
@@ -2805,8 +2877,8 @@ namespace nupic {
      * Streaming operator.
      * See print().
      */
-    template <typename I, typename F>
-    NTA_HIDDEN friend std::ostream& operator<<(std::ostream&, const SparseTensor<I, F>&);
+    template <typename I, typename F, template <typename, typename> class S>
+    NTA_HIDDEN friend std::ostream& operator<<(std::ostream&, const SparseTensor<I, F, S>&);
 
     /**
      * Whether two sparse tensors are equal or not.
@@ -2814,15 +2886,15 @@ namespace nupic {
      * the same size along each dimensions, and the same non-zeros.
      * Equality of floating point numbers is controlled by nupic::Epsilon.
      */
-    template <typename I, typename F>
-    NTA_HIDDEN friend bool operator==(const SparseTensor<I, F>&, const SparseTensor<I, F>&);
+    template <typename I, typename F, template <typename, typename> class S>
+    NTA_HIDDEN friend bool operator==(const SparseTensor<I, F, S>&, const SparseTensor<I, F, S>&);
 
     /**
      * Whether two sparse tensors are different or not.
      * See operator==.
      */
-    template <typename I, typename F>
-    NTA_HIDDEN friend bool operator!=(const SparseTensor<I, F>&, const SparseTensor<I, F>&);
+    template <typename I, typename F, template <typename, typename> class S>
+    NTA_HIDDEN friend bool operator!=(const SparseTensor<I, F, S>&, const SparseTensor<I, F, S>&);
 
     /**
      * Prints out this tensor to a stream.
@@ -2883,7 +2955,7 @@ namespace nupic {
      *   in the correspondin element of s1. s1 has size 4.
      */
     template <typename Index2, typename IndexB>
-    inline void max(const Index2& dims, SparseTensor<IndexB, Float>& B) const
+    inline void max(const Index2& dims, SparseTensor<IndexB, Float, Storage>& B) const
     {
       accumulate_nz(dims, B, nupic::Max<Float>(), 0);
     }
@@ -2925,7 +2997,7 @@ namespace nupic {
      * Wrapper for accumulate with plus.
      */
     template <typename Index2, typename IndexB>
-    inline void sum(const Index2& dims, SparseTensor<IndexB, Float>& B) const
+    inline void sum(const Index2& dims, SparseTensor<IndexB, Float, Storage>& B) const
     {
       accumulate_nz(dims, B, std::plus<Float>()); 
     }
@@ -2954,6 +3026,11 @@ namespace nupic {
     inline void axby(const Float& a, const SparseTensor& B, const Float& b,
                      SparseTensor& C) const
     {
+      if (&C == this || &C == &B || !NZ::sorted) {
+        element_apply_nz(B, C, [a, b](Float x, Float y) { return a*x + b*y; });
+        return;
+      }
+
       C.clear();
 
       const_iterator 
@@ -2984,7 +3061,7 @@ namespace nupic {
       if (B.isZero())
         return;
 
-      element_apply_nz(B, *this, std::plus<Float>(), false);
+      nz_.merge(B.begin(), B.end(), std::plus<Float>(), IsNearlyZero_());
     }
 
     /**
@@ -3020,21 +3097,21 @@ namespace nupic {
 
     template <typename IndexB>
     inline void factor_multiply(const IndexB& dims,
-                                const SparseTensor<IndexB, Float>& B, 
-                                SparseTensor<Index, Float>& C) const
+                                const SparseTensor<IndexB, Float, Storage>& B, 
+                                SparseTensor<Index, Float, Storage>& C) const
     {
       factor_apply_fast(dims, B, C, std::multiplies<Float>(), true);
     }
 
     template <typename IndexB, typename IndexC>
-    inline void outer_multiply(const SparseTensor<IndexB, Float> B,
-                               SparseTensor<IndexC, Float>& C) const
+    inline void outer_multiply(const SparseTensor<IndexB, Float, Storage> B,
+                               SparseTensor<IndexC, Float, Storage>& C) const
     {
       outer_product_nz(B, C, std::multiplies<Float>());
     }
 
     template <typename Index2, typename IndexB>
-    inline void marginalize(const Index2& dims, SparseTensor<IndexB, Float>& B) const
+    inline void marginalize(const Index2& dims, SparseTensor<IndexB, Float, Storage>& B) const
     {
       accumulate_nz(dims, B, std::plus<Float>(), Float(0));
     }
@@ -3064,6 +3141,30 @@ namespace nupic {
       return nearlyZero(val); 
     }
 
+    // nearlyZero_ for the bulk operations of the storage
+    struct IsNearlyZero_
+    {
+      inline bool operator()(const Float& val) const { return nearlyZero(val); }
+    };
+
+    // The update that set(idx, val) does
+    struct Replace_
+    {
+      inline Float operator()(const Float&, const Float& val) const { return val; }
+    };
+
+    // Calls set(idx, val) for each pair in values, in bulk
+    inline void setFromIdxVal_(const std::vector<std::pair<Index, Float> >& values)
+    {
+      for (size_t i = 0; i != values.size(); ++i)
+        NTA_ASSERT(positiveInBounds(values[i].first, getBounds()))
+          << "SparseTensor::set(idx, val): "
+          << "Invalid index: " << values[i].first
+          << " - Should be >= 0 and strictly less than: " << bounds_;
+
+      nz_.merge(values.begin(), values.end(), Replace_(), IsNearlyZero_());
+    }
+
     // I need at least the bounds at construction time
     SparseTensor();
 
@@ -3071,15 +3172,15 @@ namespace nupic {
   };
 
   //--------------------------------------------------------------------------------
-  template <typename I, typename F>
-  inline std::ostream& operator<<(std::ostream& outStream, const SparseTensor<I, F>& s)
+  template <typename I, typename F, template <typename, typename> class S>
+  inline std::ostream& operator<<(std::ostream& outStream, const SparseTensor<I, F, S>& s)
   {
     s.print(outStream);
     return outStream;
   }
 
-  template <typename I, typename F>
-  inline bool operator==(const SparseTensor<I, F>& A, const SparseTensor<I, F>& B)
+  template <typename I, typename F, template <typename, typename> class S>
+  inline bool operator==(const SparseTensor<I, F, S>& A, const SparseTensor<I, F, S>& B)
   {
     if (A.getBounds() != B.getBounds())
       return false;
@@ -3087,7 +3188,19 @@ namespace nupic {
     if (A.getNNonZeros() != B.getNNonZeros())
       return false;
     
-    typename SparseTensor<I, F>::const_iterator it1, it2;
+    typename SparseTensor<I, F, S>::const_iterator it1, it2;
+
+    if (!SparseTensor<I, F, S>::NZ::sorted) {
+      for (it1 = A.begin(); it1 != A.end(); ++it1) {
+        std::pair<typename SparseTensor<I, F, S>::const_iterator,
+                  typename SparseTensor<I, F, S>::const_iterator>
+          r = B.equal_range(it1->first);
+        if (r.first == r.second || !nearlyEqual(it1->second, r.first->second))
+          return false;
+      }
+      return true;
+    }
+
     for (it1 = A.begin(), it2 = B.begin(); it1 != A.end(); ++it1, ++it2)
       if (!nearlyEqual(it1->second, it2->second))
         return false;
@@ -3095,8 +3208,8 @@ namespace nupic {
     return true;
   }
 
-  template <typename I, typename F>
-  inline bool operator!=(const SparseTensor<I, F>& A, const SparseTensor<I, F>& B)
+  template <typename I, typename F, template <typename, typename> class S>
+  inline bool operator!=(const SparseTensor<I, F, S>& A, const SparseTensor<I, F, S>& B)
   {
     return ! (A == B);
   }
@@ -0,0 +1,531 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Storage policies for the non-zeros of SparseTensor
+ */
+
+#ifndef NTA_SPARSE_TENSOR_STORAGE_HPP
+#define NTA_SPARSE_TENSOR_STORAGE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------
+namespace nupic {
+
+  /**
+   * @b Description
+   * The storage policies are the containers SparseTensor keeps its non-zeros
+   * in, selected by its third template parameter. They all provide the
+   * subset of the std::map interface that SparseTensor uses:
+   *
+   *  - begin(), end(), size(), empty(), clear(), swap(),
+   *  - find(), equal_range(), operator[], insert(pair), erase(iterator),
+   *    which returns the iterator that follows the erased element,
+   *
+   * and three bulk operations:
+   *
+   *  - assign(begin, end): replaces the contents with (Index, Float) pairs
+   *    of distinct indices, in any order,
+   *  - merge(begin, end, f, isZero): for each (idx, val) pair in order,
+   *    this[idx] = f(this[idx], val), where a missing element counts as 0,
+   *    and the elements for which isZero(value) holds are dropped,
+   *  - erase_if(pred): erases the elements for which pred(element) holds.
+   *
+   * The constant 'sorted' tells whether iteration visits the indices in
+   * increasing order. SparseTensor merges two sorted tensors in one pass,
+   * and looks up the elements of one tensor in the other otherwise.
+   *
+   * Iterators are invalidated as for the underlying container: inserting
+   * into SparseTensorSortedStorage or SparseTensorHashStorage can invalidate
+   * all the iterators, erasing invalidates only the erased element's in
+   * SparseTensorHashStorage, and the following ones in
+   * SparseTensorSortedStorage.
+   */
+
+  //--------------------------------------------------------------------------------
+  /**
+   * The default storage: a std::map. Logarithmic insertion and retrieval,
+   * sorted iteration, one node allocation per non-zero.
+   */
+  template <typename Index, typename Float>
+  class SparseTensorMapStorage : public std::map<Index, Float>
+  {
+  public:
+    typedef std::map<Index, Float> parent_type;
+    typedef typename parent_type::iterator iterator;
+    typedef typename parent_type::const_iterator const_iterator;
+
+    static const bool sorted = true;
+
+    template <typename InputIterator>
+    inline void assign(InputIterator begin, InputIterator end)
+    {
+      this->clear();
+      for (; begin != end; ++begin)
+        this->insert(this->end(), *begin);
+    }
+
+    template <typename InputIterator, typename F, typename Z>
+    inline void merge(InputIterator begin, InputIterator end, F f, Z isZero)
+    {
+      for (; begin != end; ++begin) {
+        iterator it = this->lower_bound(begin->first);
+        if (it != this->end() && !(begin->first < it->first)) {
+          it->second = f(it->second, begin->second);
+          if (isZero(it->second))
+            this->erase(it);
+        } else {
+          Float val = f(Float(0), begin->second);
+          if (!isZero(val))
+            this->insert(it, std::make_pair(begin->first, val));
+        }
+      }
+    }
+
+    template <typename Predicate>
+    inline void erase_if(Predicate pred)
+    {
+      iterator it = this->begin();
+      while (it != this->end())
+        if (pred(*it))
+          this->erase(it++);
+        else
+          ++it;
+    }
+  };
+
+  //--------------------------------------------------------------------------------
+  /**
+   * A flat array of (Index, Float) pairs sorted by index, the coordinate
+   * (COO) format. Retrieval is a binary search over contiguous memory, and
+   * iteration is a linear scan. Inserting in increasing index order, as most
+   * SparseTensor operations do when their inputs are sorted, is amortized
+   * constant time. Inserting elsewhere moves the elements that follow, so
+   * out-of-order construction goes through assign() and merge(), which sort
+   * their input and merge it in one pass.
+   */
+  template <typename Index, typename Float>
+  class SparseTensorSortedStorage
+  {
+  public:
+    typedef Index key_type;
+    typedef Float mapped_type;
+    typedef std::pair<Index, Float> value_type;
+    typedef std::vector<value_type> container_type;
+    typedef typename container_type::iterator iterator;
+    typedef typename container_type::const_iterator const_iterator;
+    typedef typename container_type::size_type size_type;
+
+    static const bool sorted = true;
+
+    inline iterator begin() { return nz_.begin(); }
+    inline iterator end() { return nz_.end(); }
+    inline const_iterator begin() const { return nz_.begin(); }
+    inline const_iterator end() const { return nz_.end(); }
+    inline size_type size() const { return nz_.size(); }
+    inline bool empty() const { return nz_.empty(); }
+    inline void clear() { nz_.clear(); }
+    inline void reserve(size_type n) { nz_.reserve(n); }
+    inline void swap(SparseTensorSortedStorage& other) { nz_.swap(other.nz_); }
+
+    inline iterator lower_bound(const Index& idx)
+    {
+      if (nz_.empty() || nz_.back().first < idx)
+        return nz_.end();
+      return std::lower_bound(nz_.begin(), nz_.end(), idx, less_());
+    }
+
+    inline const_iterator lower_bound(const Index& idx) const
+    {
+      return const_cast<SparseTensorSortedStorage*>(this)->lower_bound(idx);
+    }
+
+    inline iterator find(const Index& idx)
+    {
+      iterator it = lower_bound(idx);
+      return it != nz_.end() && !(idx < it->first) ? it : nz_.end();
+    }
+
+    inline const_iterator find(const Index& idx) const
+    {
+      return const_cast<SparseTensorSortedStorage*>(this)->find(idx);
+    }
+
+    inline std::pair<iterator, iterator> equal_range(const Index& idx)
+    {
+      iterator it = find(idx);
+      return std::make_pair(it, it == nz_.end() ? it : it + 1);
+    }
+
+    inline std::pair<const_iterator, const_iterator>
+    equal_range(const Index& idx) const
+    {
+      const_iterator it = find(idx);
+      return std::make_pair(it, it == nz_.end() ? it : it + 1);
+    }
+
+    inline std::pair<iterator, bool> insert(const value_type& v)
+    {
+      iterator it = lower_bound(v.first);
+      if (it != nz_.end() && !(v.first < it->first))
+        return std::make_pair(it, false);
+      return std::make_pair(nz_.insert(it, v), true);
+    }
+
+    inline Float& operator[](const Index& idx)
+    {
+      return insert(value_type(idx, Float(0))).first->second;
+    }
+
+    inline iterator erase(iterator it) { return nz_.erase(it); }
+
+    template <typename InputIterator>
+    inline void assign(InputIterator begin, InputIterator end)
+    {
+      nz_.assign(begin, end);
+      std::sort(nz_.begin(), nz_.end(), less_());
+    }
+
+    template <typename InputIterator, typename F, typename Z>
+    inline void merge(InputIterator begin, InputIterator end, F f, Z isZero)
+    {
+      container_type batch(begin, end);
+      if (batch.empty())
+        return;
+
+      // Stable, so that f sees the values of an index in input order
+      if (!std::is_sorted(batch.begin(), batch.end(), less_()))
+        std::stable_sort(batch.begin(), batch.end(), less_());
+
+      container_type merged;
+      merged.reserve(nz_.size() + batch.size());
+
+      iterator it = nz_.begin();
+      typename container_type::const_iterator b = batch.begin();
+      while (b != batch.end()) {
+        for (; it != nz_.end() && it->first < b->first; ++it)
+          merged.push_back(*it);
+
+        Float val = Float(0);
+        if (it != nz_.end() && !(b->first < it->first))
+          val = (it++)->second;
+
+        const Index& idx = b->first;
+        for (; b != batch.end() && !(idx < b->first); ++b)
+          val = f(val, b->second);
+
+        if (!isZero(val))
+          merged.push_back(value_type(idx, val));
+      }
+      merged.insert(merged.end(), it, nz_.end());
+
+      nz_.swap(merged);
+    }
+
+    template <typename Predicate>
+    inline void erase_if(Predicate pred)
+    {
+      nz_.erase(std::remove_if(nz_.begin(), nz_.end(), pred), nz_.end());
+    }
+
+  private:
+    struct less_
+    {
+      inline bool operator()(const value_type& a, const value_type& b) const
+      { return a.first < b.first; }
+      inline bool operator()(const value_type& a, const Index& b) const
+      { return a.first < b; }
+    };
+
+    container_type nz_;
+  };
+
+  //--------------------------------------------------------------------------------
+  /**
+   * An open-addressing hash table with linear probing. Retrieval and
+   * insertion are constant time on average, with no allocation per
+   * non-zero, but iteration is in no particular order. Erased slots are
+   * marked rather than emptied, so erasing doesn't move the other elements.
+   * The table doubles when it is more than half full, counting erased
+   * slots, and is cleaned up of the erased slots at the same time.
+   */
+  template <typename Index, typename Float>
+  class SparseTensorHashStorage
+  {
+    enum { EMPTY = 0, FULL = 1, ERASED = 2 };
+
+  public:
+    typedef Index key_type;
+    typedef Float mapped_type;
+    typedef std::pair<Index, Float> value_type;
+    typedef size_t size_type;
+
+    static const bool sorted = false;
+
+    template <typename T, typename Table>
+    class iterator_t : public std::iterator<std::forward_iterator_tag, T>
+    {
+    public:
+      inline iterator_t() : table_(nullptr), slot_(0) {}
+
+      inline iterator_t(Table* table, size_type slot)
+        : table_(table), slot_(slot)
+      {
+        skip_();
+      }
+
+      // iterator to const_iterator
+      template <typename T2, typename Table2>
+      inline iterator_t(const iterator_t<T2, Table2>& other)
+        : table_(other.table_), slot_(other.slot_)
+      {}
+
+      inline T& operator*() const { return table_->slots_[slot_]; }
+      inline T* operator->() const { return &table_->slots_[slot_]; }
+
+      inline iterator_t& operator++()
+      {
+        ++slot_;
+        skip_();
+        return *this;
+      }
+
+      inline iterator_t operator++(int)
+      {
+        iterator_t it(*this);
+        ++*this;
+        return it;
+      }
+
+      template <typename T2, typename Table2>
+      inline bool operator==(const iterator_t<T2, Table2>& other) const
+      { return slot_ == other.slot_; }
+
+      template <typename T2, typename Table2>
+      inline bool operator!=(const iterator_t<T2, Table2>& other) const
+      { return slot_ != other.slot_; }
+
+    private:
+      template <typename T2, typename Table2> friend class iterator_t;
+      friend class SparseTensorHashStorage;
+
+      inline void skip_()
+      {
+        const size_type n = table_ ? table_->state_.size() : 0;
+        while (slot_ < n && table_->state_[slot_] != FULL)
+          ++slot_;
+      }
+
+      Table* table_;
+      size_type slot_;
+    };
+
+    typedef iterator_t<value_type, SparseTensorHashStorage> iterator;
+    typedef iterator_t<const value_type,
+                       const SparseTensorHashStorage> const_iterator;
+
+    inline SparseTensorHashStorage()
+      : size_(0), erased_(0)
+    {}
+
+    inline iterator begin() { return iterator(this, 0); }
+    inline iterator end() { return iterator(this, state_.size()); }
+    inline const_iterator begin() const { return const_iterator(this, 0); }
+    inline const_iterator end() const
+    { return const_iterator(this, state_.size()); }
+    inline size_type size() const { return size_; }
+    inline bool empty() const { return size_ == 0; }
+
+    inline void clear()
+    {
+      std::fill(state_.begin(), state_.end(), (unsigned char) EMPTY);
+      size_ = erased_ = 0;
+    }
+
+    inline void reserve(size_type n)
+    {
+      if (2 * n > state_.size())
+        rehash_(n);
+    }
+
+    inline void swap(SparseTensorHashStorage& other)
+    {
+      slots_.swap(other.slots_);
+      state_.swap(other.state_);
+      std::swap(size_, other.size_);
+      std::swap(erased_, other.erased_);
+    }
+
+    inline iterator find(const Index& idx)
+    {
+      return iterator(this, find_(idx));
+    }
+
+    inline const_iterator find(const Index& idx) const
+    {
+      return const_iterator(this, find_(idx));
+    }
+
+    inline std::pair<iterator, iterator> equal_range(const Index& idx)
+    {
+      iterator it = find(idx), next = it;
+      return std::make_pair(it, it == end() ? it : ++next);
+    }
+
+    inline std::pair<const_iterator, const_iterator>
+    equal_range(const Index& idx) const
+    {
+      const_iterator it = find(idx), next = it;
+      return std::make_pair(it, it == end() ? it : ++next);
+    }
+
+    inline std::pair<iterator, bool> insert(const value_type& v)
+    {
+      size_type slot = find_(v.first);
+      if (slot != state_.size())
+        return std::make_pair(iterator(this, slot), false);
+
+      if (2 * (size_ + erased_ + 1) > state_.size())
+        rehash_(size_ + 1);
+
+      // The first slot that is not FULL along the probe sequence: v.first
+      // is not in the table, so there is no FULL slot with it further on
+      const size_type mask = state_.size() - 1;
+      slot = hash_(v.first) & mask;
+      while (state_[slot] == FULL)
+        slot = (slot + 1) & mask;
+
+      if (state_[slot] == ERASED)
+        --erased_;
+      slots_[slot] = v;
+      state_[slot] = FULL;
+      ++size_;
+      return std::make_pair(iterator(this, slot), true);
+    }
+
+    inline Float& operator[](const Index& idx)
+    {
+      return insert(value_type(idx, Float(0))).first->second;
+    }
+
+    inline iterator erase(iterator it)
+    {
+      state_[it.slot_] = ERASED;
+      --size_;
+      ++erased_;
+      return ++it;
+    }
+
+    template <typename InputIterator>
+    inline void assign(InputIterator begin, InputIterator end)
+    {
+      clear();
+      for (; begin != end; ++begin)
+        insert(*begin);
+    }
+
+    template <typename InputIterator, typename F, typename Z>
+    inline void merge(InputIterator begin, InputIterator end, F f, Z isZero)
+    {
+      for (; begin != end; ++begin) {
+        size_type slot = find_(begin->first);
+        if (slot != state_.size()) {
+          Float& val = slots_[slot].second;
+          val = f(val, begin->second);
+          if (isZero(val))
+            erase(iterator(this, slot));
+        } else {
+          Float val = f(Float(0), begin->second);
+          if (!isZero(val))
+            insert(value_type(begin->first, val));
+        }
+      }
+    }
+
+    template <typename Predicate>
+    inline void erase_if(Predicate pred)
+    {
+      for (iterator it = begin(); it != end(); )
+        if (pred(*it))
+          it = erase(it);
+        else
+          ++it;
+    }
+
+  private:
+    // Mixes the coordinates of the index, whatever its type
+    static inline size_t hash_(const Index& idx)
+    {
+      unsigned long long h = 0;
+      for (size_t k = 0; k != (size_t) idx.size(); ++k)
+        h = (h ^ (unsigned long long) idx[k]) * 0x9E3779B97F4A7C15ULL;
+      return (size_t) (h ^ (h >> 32));
+    }
+
+    // Slot of idx, or state_.size() if it is not in the table
+    inline size_type find_(const Index& idx) const
+    {
+      const size_type n = state_.size();
+      if (size_ == 0)
+        return n;
+
+      const size_type mask = n - 1;
+      for (size_type slot = hash_(idx) & mask; state_[slot] != EMPTY;
+           slot = (slot + 1) & mask)
+        if (state_[slot] == FULL && slots_[slot].first == idx)
+          return slot;
+      return n;
+    }
+
+    // Reallocates for at least n elements, dropping the erased slots
+    inline void rehash_(size_type n)
+    {
+      size_type capacity = 16;
+      while (capacity < 2 * n || capacity < 2 * size_)
+        capacity *= 2;
+
+      std::vector<value_type> slots(capacity);
+      std::vector<unsigned char> state(capacity, (unsigned char) EMPTY);
+      slots.swap(slots_);
+      state.swap(state_);
+      size_ = erased_ = 0;
+
+      for (size_type i = 0; i != state.size(); ++i)
+        if (state[i] == FULL)
+          insert(slots[i]);
+    }
+
+    std::vector<value_type> slots_;
+    std::vector<unsigned char> state_;
+    size_type size_;
+    size_type erased_;
+  };
+
+} // end namespace nupic
+
+#endif // NTA_SPARSE_TENSOR_STORAGE_HPP
@@ -24,6 +24,8 @@
  * Implementation of the ArrayBase class
  */
 
+#include <cstring> // memset
+
 #include <nupic/types/Types.hpp>
 #include <nupic/types/BasicType.hpp>
 #include <nupic/ntypes/ArrayBase.hpp>
@@ -72,7 +74,7 @@ ArrayBase::~ArrayBase()
  * Ask ArrayBase to allocate its buffer
  */
 void
-ArrayBase::allocateBuffer(size_t count)
+ArrayBase::allocateBuffer(size_t count, size_t padding)
 {
   if (buffer_ != nullptr)
   {
@@ -84,8 +86,12 @@ ArrayBase::allocateBuffer(size_t count)
   //a non-NULL value which is safe to delete.  This allows us to
   //disambiguate uninitialized ArrayBases and ArrayBases initialized with
   //size zero.
-  buffer_ = new char[count_ * BasicType::getSize(type_)];
+  const size_t itemSize = BasicType::getSize(type_);
+  buffer_ = new char[(count_ + padding) * itemSize];
   own_ = true;
+
+  if (padding != 0)
+    ::memset(buffer_ + count_ * itemSize, 0, padding * itemSize);
 }
   
 void
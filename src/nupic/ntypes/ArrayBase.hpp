@@ -70,10 +70,12 @@ namespace nupic
 
 
     /**
-     * Ask ArrayBase to allocate its buffer
+     * Ask ArrayBase to allocate its buffer. The buffer has room for
+     * padding more elements after the count elements of the array,
+     * set to 0, that are not part of the array.
      */
     void 
-    allocateBuffer(size_t count);
+    allocateBuffer(size_t count, size_t padding = 0);
   
     void 
     setBuffer(void *buffer, size_t count);
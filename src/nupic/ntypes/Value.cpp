@@ -25,6 +25,8 @@
  */
 
 
+#include <cstring> // memcpy
+
 #include <nupic/ntypes/Value.hpp>
 #include <nupic/utils/Log.hpp>
 
@@ -130,6 +132,32 @@ const std::string Value::getDescription() const
   return "NOT REACHED";
 }
 
+Value Value::clone() const
+{
+  switch(category_)
+  {
+  case scalarCategory:
+  {
+    boost::shared_ptr<Scalar> s(new Scalar(*scalar_));
+    return Value(s);
+  }
+  case arrayCategory:
+  {
+    boost::shared_ptr<Array> a(new Array(array_->getType()));
+    a->allocateBuffer(array_->getCount());
+    if (array_->getCount() > 0)
+      ::memcpy(a->getBuffer(), array_->getBuffer(),
+               array_->getCount() * BasicType::getSize(array_->getType()));
+    return Value(a);
+  }
+  default:
+  {
+    boost::shared_ptr<std::string> str(new std::string(*string_));
+    return Value(str);
+  }
+  }
+}
+
 void ValueMap::add(const std::string& key, const Value& value)
 {
   if (map_.find(key) != map_.end())
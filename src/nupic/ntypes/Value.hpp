@@ -86,6 +86,9 @@ namespace nupic
     
     const std::string getDescription() const;
 
+    // A copy that shares no Scalar, Array or string with this Value
+    Value clone() const;
+
   private:
     // Default constructor would not be useful
     Value(); 
@@ -86,6 +86,10 @@
 //   Types for working with the Python object system. Module is for importing
 //   modules. Class is for invoking class methods and Instance is for 
 //   instantiating objects and invoking their methods.
+//
+// ReleaseGIL:
+//   Releases the global interpreter lock for the duration of a scope, so
+//   that other Python threads run while C++ computes.
 // ===
 
 // Nested namespace nupic::py
@@ -96,6 +100,23 @@ namespace nupic { namespace py
   
   void checkPyError(int lineno);
 
+  // A RAII class to release the GIL. The GIL is released on construction
+  // and reacquired on destruction, including when an exception unwinds
+  // the scope. No Python object may be touched while it is released:
+  // check arguments and extract their buffers first.
+  class ReleaseGIL
+  {
+  public:
+    ReleaseGIL() : state_(PyEval_SaveThread()) {}
+    ~ReleaseGIL() { PyEval_RestoreThread(state_); }
+
+  private:
+    ReleaseGIL(const ReleaseGIL&);
+    ReleaseGIL& operator=(const ReleaseGIL&);
+
+    PyThreadState * state_;
+  };
+
   // A RAII class to hold a PyObject *
   // It decrements the refCount when it 
   // is destroyed.
@@ -400,14 +400,6 @@ PyRegion::PyRegion(const char * module,
 
 PyRegion::~PyRegion()
 {
-  for (std::map<std::string, Array*>::iterator i = inputArrays_.begin();
-       i != inputArrays_.end();
-       i++)
-  {
-    delete i->second;
-    i->second = NULL;
-  }
-
 }
 
 void PyRegion::serialize(BundleIO& bundle)
@@ -903,93 +895,13 @@ std::string PyRegion::executeCommand(const std::vector<std::string>& args, Int64
 
 void PyRegion::compute()
 {
-  const Spec & ns = getSpec();
-  // Prepare the inputs dict
-  py::Dict inputs;
-  for (size_t i = 0; i < ns.inputs.getCount(); ++i)
-  {
-    // Get the current InputSpec object
-    const std::pair<std::string, InputSpec> & p =
-      ns.inputs.getByIndex(i);
-
-    // Get the corresponding input buffer
-    Input * inp = region_->getInput(p.first);
-    NTA_CHECK(inp);
-
-    // Set pa to point to the original input array
-    const Array * pa = &(inp->getData());
-
-    // Skip unlinked inputs of size 0
-    if (pa->getCount() == 0)
-      continue;
-
-    // If the input requires a splitter map then
-    // Copy the original input array to the stored input array, which is larger
-    // by one element and put 0 in the extra element. This is needed for splitter map
-    // access.
-    if (p.second.requireSplitterMap)
-    {
-      // Verify that this input has a stored input array
-      NTA_ASSERT(inputArrays_.find(p.first) != inputArrays_.end());
-      Array & a = *(inputArrays_[p.first]);
-
-      // Verify that the stored input array is larger by 1  then the original input
-      NTA_ASSERT(a.getCount() == pa->getCount() + 1);
-
-      // Work at the char * level because there is no good way
-      // to work with the actual data type of the input (since the buffer is void *)
-      size_t itemSize = BasicType::getSize(p.second.dataType);
-      char * begin1 = (char *)pa->getBuffer();
-      char * end1 = begin1 + pa->getCount() * itemSize;
-      char * begin2 = (char *)a.getBuffer();
-      char * end2 = begin2 + a.getCount() * itemSize;
-
-      // Copy the original input array to the stored array
-      std::copy(begin1, end1, begin2);
-
-      // Put 0 in the last item (the sentinel value)
-      std::fill(end2 - itemSize, end2, 0);
-
-      // Change pa to point to the stored input array (with the sentinel)
-      pa = &a;
-    }
-
-    // Create a numpy array from pa, which wil be either
-    // the original input array or a stored input array
-    // (if a splitter map is needed)
-    py::Ptr numpyArray(array2numpy(*pa));
-    inputs.setItem(p.first, numpyArray);
-  }
-
-  // Prepare the outputs dict
-  py::Dict outputs;
-  for (size_t i = 0; i < ns.outputs.getCount(); ++i)
-  {
-    // Get the current OutputSpec object
-    const std::pair<std::string, OutputSpec> & p =
-      ns.outputs.getByIndex(i);
-
-    // Get the corresponding output buffer
-    Output * out = region_->getOutput(p.first);
-    // Skip optional outputs
-    if (!out)
-      continue;
-
-    const Array & data = out->getData();
+  NTA_CHECK(computeArgs_.getCount() == 2)
+    << "PyRegion::compute() called before initialize()";
 
-    py::Ptr numpyArray(array2numpy(data));
-
-    // Insert the buffer to the outputs py::Dict
-    outputs.setItem(p.first, numpyArray);
-  }
-
-  // Call the Python compute() method
-  py::Tuple args(2);
-  args.setItem(0, inputs);
-  args.setItem(1, outputs);
+  // Call the Python compute() method with the dicts made by initialize()
 
   // Need to put the None result in py::Ptr to decrement the ref count
-  py::Ptr none(node_.invoke("guardedCompute", args));
+  py::Ptr none(node_.invoke("guardedCompute", computeArgs_));
 }
 
 
@@ -1341,16 +1253,6 @@ void PyRegion::initialize()
     Input * inp = region_->getInput(p.first);
     NTA_CHECK(inp);
 
-
-    NTA_CHECK(inputArrays_.find(p.first) == inputArrays_.end());
-
-    // Create an input array for inputs that require a splitter map
-    // The input array must be larger by one element than the actual input
-    // to hold the sentinel value for the splitter map
-    inputArrays_[p.first] = new Array(p.second.dataType);
-    Array & a = *(inputArrays_[p.first]);
-    a.allocateBuffer(inp->getData().getCount() + 1);
-
     const nupic::Input::SplitterMap & sm = inp->getSplitterMap();
     size_t rawSize = getMaxInputCount(sm);
 
@@ -1407,6 +1309,8 @@ void PyRegion::initialize()
     splitterMaps.setItem(p.first.c_str(), shaped);
   }
 
+  prepareComputeArgs_();
+
   // Call the Python initialize() method
   py::Tuple args(2);
   args.setItem(0, dims);
@@ -1425,5 +1329,62 @@ void PyRegion::initialize()
   py::Ptr none(node_.invoke("initialize", args));
 }
 
+void PyRegion::prepareComputeArgs_()
+{
+  const Spec & ns = getSpec();
+
+  // Prepare the inputs dict
+  py::Dict inputs;
+  for (size_t i = 0; i < ns.inputs.getCount(); ++i)
+  {
+    // Get the current InputSpec object
+    const std::pair<std::string, InputSpec> & p =
+      ns.inputs.getByIndex(i);
+
+    // Get the corresponding input buffer
+    Input * inp = region_->getInput(p.first);
+    NTA_CHECK(inp);
+
+    // Skip unlinked inputs of size 0
+    if (inp->getData().getCount() == 0)
+      continue;
+
+    // If the input requires a splitter map, the numpy array also covers
+    // the sentinel element that the Input keeps after its data, at the
+    // index that the splitter map uses for padding.
+    const Array a = inp->getPaddedData();
+    NTA_ASSERT(!p.second.requireSplitterMap ||
+               a.getCount() == inp->getData().getCount() + 1);
+
+    py::Ptr numpyArray(array2numpy(a));
+    inputs.setItem(p.first, numpyArray);
+  }
+
+  // Prepare the outputs dict
+  py::Dict outputs;
+  for (size_t i = 0; i < ns.outputs.getCount(); ++i)
+  {
+    // Get the current OutputSpec object
+    const std::pair<std::string, OutputSpec> & p =
+      ns.outputs.getByIndex(i);
+
+    // Get the corresponding output buffer
+    Output * out = region_->getOutput(p.first);
+    // Skip optional outputs
+    if (!out)
+      continue;
+
+    py::Ptr numpyArray(array2numpy(out->getData()));
+
+    // Insert the buffer to the outputs py::Dict
+    outputs.setItem(p.first, numpyArray);
+  }
+
+  py::Tuple args(2);
+  args.setItem(0, inputs);
+  args.setItem(1, outputs);
+  computeArgs_.assign(args);
+}
+
 
 } // end namespace nupic
@@ -157,15 +157,19 @@ namespace nupic
     PyRegion();
     PyRegion(const Region &);
 
+    // Creates computeArgs_ from the initialized inputs and outputs
+    void prepareComputeArgs_();
+
   private:
     static SpecMap specs_;
     std::string module_;
     std::string className_;
     py::Instance node_;
     std::set<boost::shared_ptr<PyArray<UInt64> > > splitterMaps_;
-    // pointers rather than objects because Array doesnt
-    // have a default constructor
-    std::map<std::string, Array*> inputArrays_;
+    // (inputs, outputs) passed to the Python compute(), created by
+    // initialize(). The numpy arrays in the dicts are views of the
+    // input and output buffers, so they don't change between calls.
+    py::Tuple computeArgs_;
   };
 }
 
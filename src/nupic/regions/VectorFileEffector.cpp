@@ -24,6 +24,7 @@
  * Implementation for VectorFileEffector class
  */
 
+#include <cstring>
 #include <stdexcept>
 #include <string>
 #include <iostream>
@@ -38,28 +39,64 @@
 #include <nupic/utils/Log.hpp>
 #include <nupic/os/FStream.hpp>
 #include <nupic/ntypes/Value.hpp>
+#include <nupic/os/Path.hpp>
 
 namespace nupic
 {
 
+const char VectorFileEffector::binaryMagic[8] =
+  {'N', 'T', 'A', 'V', 'E', 'C', 'T', 'R'};
+const UInt32 VectorFileEffector::binaryVersion = 1;
+
+static VectorFileEffector::OutputFormat parseOutputFormat(const std::string& s)
+{
+  if (s == "text")
+    return VectorFileEffector::textOutput;
+  if (s == "binary")
+    return VectorFileEffector::binaryOutput;
+  if (s == "sparse")
+    return VectorFileEffector::sparseOutput;
+  NTA_THROW << "VectorFileEffector -- unknown outputFormat '" << s
+            << "', expected text, binary or sparse";
+}
+
+static std::string outputFormatName(VectorFileEffector::OutputFormat format)
+{
+  switch (format)
+  {
+  case VectorFileEffector::binaryOutput:
+    return "binary";
+  case VectorFileEffector::sparseOutput:
+    return "sparse";
+  default:
+    return "text";
+  }
+}
+
 VectorFileEffector::VectorFileEffector(const ValueMap& params, Region* region) :
   RegionImpl(region),
   dataIn_(NTA_BasicType_Real32),
   filename_(""),
-  outFile_(nullptr)
+  outFile_(nullptr),
+  format_(textOutput),
+  writer_(nullptr)
 {
   if (params.contains("outputFile"))
     filename_ = *params.getString("outputFile");
   else
     filename_ = "";
 
+  if (params.contains("outputFormat"))
+    format_ = parseOutputFormat(*params.getString("outputFormat"));
 }
 
 VectorFileEffector::VectorFileEffector(BundleIO& bundle, Region* region) :
   RegionImpl(region),
   dataIn_(NTA_BasicType_Real32),
   filename_(""),
-  outFile_(nullptr)
+  outFile_(nullptr),
+  format_(textOutput),
+  writer_(nullptr)
 {
 }
 
@@ -68,7 +105,9 @@ VectorFileEffector::VectorFileEffector(
   RegionImpl(region),
   dataIn_(NTA_BasicType_Real32),
   filename_(""),
-  outFile_(nullptr)
+  outFile_(nullptr),
+  format_(textOutput),
+  writer_(nullptr)
 {
   read(proto);
 }
@@ -76,7 +115,14 @@ VectorFileEffector::VectorFileEffector(
 
 VectorFileEffector::~VectorFileEffector()
 {
-  closeFile();
+  try
+  {
+    closeFile();
+  }
+  catch (std::exception& e)
+  {
+    NTA_WARN << "VectorFileEffector: " << e.what();
+  }
 }
 
 
@@ -108,6 +154,39 @@ void VectorFileEffector::compute()
     return;
   }
 
+  Real32 *inputVec = (Real32*)(dataIn_.getBuffer());
+  NTA_CHECK(inputVec != nullptr);
+  const UInt32 count = (UInt32) dataIn_.getCount();
+
+  // The writer thread owns the stream, and reports its errors
+  if (format_ == binaryOutput)
+  {
+    Byte *record = writer_->reserve(sizeof(UInt32) + count * sizeof(Real32));
+    ::memcpy(record, &count, sizeof(UInt32));
+    ::memcpy(record + sizeof(UInt32), inputVec, count * sizeof(Real32));
+    writer_->commit(sizeof(UInt32) + count * sizeof(Real32));
+    return;
+  }
+  if (format_ == sparseOutput)
+  {
+    Byte *record = writer_->reserve(2 * sizeof(UInt32) +
+                                    count * sizeof(UInt32));
+    Byte *indices = record + 2 * sizeof(UInt32);
+    UInt32 nonZeros = 0;
+    for (UInt32 i = 0; i < count; ++i)
+    {
+      if (inputVec[i] != 0)
+      {
+        ::memcpy(indices + nonZeros * sizeof(UInt32), &i, sizeof(UInt32));
+        ++nonZeros;
+      }
+    }
+    ::memcpy(record, &count, sizeof(UInt32));
+    ::memcpy(record + sizeof(UInt32), &nonZeros, sizeof(UInt32));
+    writer_->commit((2 + nonZeros) * sizeof(UInt32));
+    return;
+  }
+
   // Ensure we can write to it
   if ( outFile_->fail() )
   {
@@ -115,8 +194,6 @@ void VectorFileEffector::compute()
               << filename_.c_str() << "\n";
   }
 
-  Real *inputVec = (Real*)(dataIn_.getBuffer());
-  NTA_CHECK(inputVec != nullptr);
   OFStream &outFile = *outFile_;
   for(Size offset = 0; offset < dataIn_.getCount(); ++offset)
   {
@@ -131,9 +208,27 @@ void VectorFileEffector::closeFile()
 {
   if (outFile_)
   {
+    // Close the file even if the writer failed, then report it
+    std::string error;
+    if (writer_)
+    {
+      try
+      {
+        writer_->close();
+      }
+      catch (std::exception& e)
+      {
+        error = e.what();
+      }
+      delete writer_;
+      writer_ = nullptr;
+    }
     outFile_->close();
+    delete outFile_;
     outFile_ = nullptr;
     filename_ = "";
+    if (!error.empty())
+      NTA_THROW << "VectorFileEffector: " << error;
   }
 }
 
@@ -145,7 +240,16 @@ void VectorFileEffector::openFile(const std::string& filename)
   if (filename == "")
     return;
 
-  outFile_ = new OFStream(filename.c_str(), std::ios::app);
+  if (format_ == textOutput)
+  {
+    outFile_ = new OFStream(filename.c_str(), std::ios::app);
+  }
+  else
+  {
+    checkBinaryHeader(filename);
+    outFile_ = new OFStream(filename.c_str(),
+                            std::ios::app | std::ios::binary);
+  }
   if (outFile_->fail())
   {
     delete outFile_;
@@ -153,6 +257,45 @@ void VectorFileEffector::openFile(const std::string& filename)
     NTA_THROW << "VectorFileEffector::openFile -- unable to create or open file: " << filename.c_str();
   }
   filename_ = filename;
+
+  if (format_ != textOutput)
+  {
+    writer_ = new AsyncBufferWriter(*outFile_);
+    if (Path::getFileSize(filename) == 0)
+      writeBinaryHeader();
+  }
+}
+
+
+void VectorFileEffector::writeBinaryHeader()
+{
+  const UInt32 recordFormat = format_ == binaryOutput ? 1 : 2;
+  writer_->append(binaryMagic, sizeof(binaryMagic));
+  writer_->append(&binaryVersion, sizeof(UInt32));
+  writer_->append(&recordFormat, sizeof(UInt32));
+}
+
+
+// Records can only be appended to a file with the same record format
+void VectorFileEffector::checkBinaryHeader(const std::string& filename)
+{
+  if (!Path::exists(filename) || Path::getFileSize(filename) == 0)
+    return;
+
+  char magic[sizeof(binaryMagic)];
+  UInt32 version = 0, recordFormat = 0;
+  IFStream in(filename.c_str(), std::ios::in | std::ios::binary);
+  in.read(magic, sizeof(magic));
+  in.read((char*) &version, sizeof(UInt32));
+  in.read((char*) &recordFormat, sizeof(UInt32));
+  if (!in || ::memcmp(magic, binaryMagic, sizeof(magic)) != 0 ||
+      version != binaryVersion ||
+      recordFormat != (format_ == binaryOutput ? 1u : 2u))
+  {
+    NTA_THROW << "VectorFileEffector::openFile -- " << filename
+              << " is not a " << outputFormatName(format_)
+              << " vector file, and cannot be appended to";
+  }
 }
 
 
@@ -165,6 +308,14 @@ void VectorFileEffector::setParameterString(const std::string& paramName, Int64
     if (outFile_)
       closeFile();
     openFile(s);
+  } else if (paramName == "outputFormat") {
+    OutputFormat format = parseOutputFormat(s);
+    if (format != format_ && outFile_)
+    {
+      NTA_THROW << "VectorFileEffector -- outputFormat cannot change while "
+                << filename_ << " is open";
+    }
+    format_ = format;
   } else {
     NTA_THROW << "VectorFileEffector -- Unknown string parameter " << paramName;
   }
@@ -175,6 +326,8 @@ std::string VectorFileEffector::getParameterString(const std::string& paramName,
 {
   if (paramName == "outputFile") {
     return filename_;
+  } else if (paramName == "outputFormat") {
+    return outputFormatName(format_);
   } else {
     NTA_THROW << "VectorFileEffector -- unknown parameter " << paramName;
   }
@@ -187,7 +340,11 @@ std::string VectorFileEffector::executeCommand(const std::vector<std::string>& a
   if (args[0] == "flushFile")
   {
     // Ensure we have a valid file before flushing, otherwise fail silently.
-    if (!((outFile_ == nullptr) || (outFile_->fail())))
+    if (writer_)
+    {
+      writer_->flush();
+    }
+    else if (!((outFile_ == nullptr) || (outFile_->fail())))
     {
       outFile_->flush();
     }
@@ -201,6 +358,11 @@ std::string VectorFileEffector::executeCommand(const std::vector<std::string>& a
     {
       NTA_THROW << "VectorFileEffector: echo command failed because there is no file open";
     }
+    if (format_ != textOutput)
+    {
+      NTA_THROW << "VectorFileEffector: echo command is only supported with "
+                << "the text outputFormat";
+    }
 
     for (size_t i = 1; i < args.size(); i++)
     {
@@ -226,7 +388,9 @@ Spec* VectorFileEffector::createSpec()
         "input vectors to a text file. The target filename is specified\n"
         "using the 'outputFile' parameter at run time. On each\n"
         "compute, the current input vector is written (but not flushed)\n"
-        "to the file.\n";
+        "to the file. The 'outputFormat' parameter selects binary records\n"
+        "of the vector or of its nonzero indices instead, which are\n"
+        "buffered and written by a background thread.\n";
 
   ns->inputs.add(
     "dataIn",
@@ -254,6 +418,21 @@ Spec* VectorFileEffector::createSpec()
       ParameterSpec::ReadWriteAccess
       ));
 
+  ns->parameters.add(
+    "outputFormat",
+    ParameterSpec(
+      "Format of the output file: 'text' writes each vector as a line of\n"
+      "numbers, 'binary' as a record of its elements, and 'sparse' as a\n"
+      "record of the indices of its nonzero elements. Binary and sparse\n"
+      "records are written by a background thread. Must be set before\n"
+      "outputFile.\n",
+      NTA_BasicType_Byte,
+      0,  // elementCount
+      "enumeration:text, binary, sparse", // constraints
+      "text", // defaultValue
+      ParameterSpec::ReadWriteAccess
+      ));
+
   ns->commands.add(
     "flushFile",
     CommandSpec("Flush file data to disk"));
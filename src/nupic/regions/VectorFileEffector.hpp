@@ -38,6 +38,7 @@
 #include <nupic/engine/RegionImpl.hpp>
 #include <nupic/ntypes/Array.hpp>
 #include <nupic/ntypes/ArrayRef.hpp>
+#include <nupic/utils/AsyncBufferWriter.hpp>
 
 namespace nupic
 {
@@ -59,6 +60,19 @@ namespace nupic
    *           :
    *        eM1 eM2 eM3 ... eMN
    *
+   *  With outputFormat "binary" or "sparse", the vectors are instead
+   *  appended to a buffer in memory, which a background thread writes to
+   *  the file, so compute() does no formatting or system calls. The file
+   *  starts with the 8 byte magic "NTAVECTR", a 32-bit format version and
+   *  a 32-bit record format (1 for binary, 2 for sparse). Each vector is
+   *  then one record, in host byte order:
+   *
+   *        binary: UInt32 N, then the N Real32 elements
+   *        sparse: UInt32 N, UInt32 K, then the K UInt32 indices of the
+   *                nonzero elements, ascending
+   *
+   *  Appending to an existing file requires the same record format.
+   *
    *  VectorFileEffector implements the execute() commands as defined in the
    *  nodeSpec.
    *
@@ -67,6 +81,16 @@ namespace nupic
   {
   public:
 
+    enum OutputFormat
+    {
+      textOutput,
+      binaryOutput,
+      sparseOutput
+    };
+
+    static const char binaryMagic[8];
+    static const UInt32 binaryVersion;
+
     static Spec* createSpec();
     size_t getNodeOutputElementCount(const std::string& outputName) override;
     void getParameterFromBuffer(const std::string& name, Int64 index, IWriteBuffer& value) override;
@@ -113,10 +137,14 @@ namespace nupic
 
     void closeFile();
     void openFile(const std::string& filename);
+    void writeBinaryHeader();
+    void checkBinaryHeader(const std::string& filename);
 
     ArrayRef dataIn_;
     std::string filename_;          // Name of the output file
     nupic::OFStream *outFile_;        // Handle to current file
+    OutputFormat format_;
+    AsyncBufferWriter *writer_;       // Writes outFile_ unless format_ is text
 
     /// Disable unsupported default constructors
     VectorFileEffector(const VectorFileEffector&);
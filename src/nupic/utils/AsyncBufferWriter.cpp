@@ -0,0 +1,200 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Implementation of AsyncBufferWriter
+ */
+
+#include <cstring>
+#include <exception>
+#include <ostream>
+
+#include <nupic/utils/AsyncBufferWriter.hpp>
+#include <nupic/utils/Log.hpp>
+
+namespace nupic
+{
+  AsyncBufferWriter::AsyncBufferWriter(std::ostream& out, size_t bufferSize,
+                                       size_t capacity, Sink sink) :
+    out_(out),
+    bufferSize_(bufferSize),
+    capacity_(capacity),
+    sink_(std::move(sink)),
+    buffer_(std::vector<Byte>(bufferSize), 0),
+    busy_(false),
+    stopping_(false)
+  {
+    NTA_CHECK(bufferSize_ > 0 && capacity_ > 0);
+    thread_ = std::thread(&AsyncBufferWriter::run_, this);
+  }
+
+  AsyncBufferWriter::~AsyncBufferWriter()
+  {
+    try
+    {
+      close();
+    }
+    catch (std::exception& e)
+    {
+      NTA_WARN << "Buffer writer: " << e.what();
+    }
+  }
+
+  Byte* AsyncBufferWriter::reserve(size_t n)
+  {
+    std::vector<Byte>& bytes = buffer_.first;
+    if (bytes.size() < buffer_.second + n)
+      bytes.resize(buffer_.second + n);
+    return bytes.data() + buffer_.second;
+  }
+
+  void AsyncBufferWriter::commit(size_t n)
+  {
+    NTA_ASSERT(buffer_.second + n <= buffer_.first.size());
+    buffer_.second += n;
+    if (buffer_.second >= bufferSize_)
+      push_();
+  }
+
+  void AsyncBufferWriter::append(const void* data, size_t n)
+  {
+    ::memcpy(reserve(n), data, n);
+    commit(n);
+  }
+
+  // Hands the buffer to the writer thread, and takes a spare one
+  void AsyncBufferWriter::push_()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    NTA_CHECK(!stopping_) << "Buffer writer is closed";
+    notFull_.wait(lock, [this] { return queue_.size() < capacity_; });
+    checkError_();
+    if (buffer_.second == 0)
+      return;
+
+    queue_.push_back(std::move(buffer_));
+    buffer_.second = 0;
+    if (!spare_.empty())
+    {
+      buffer_.first.swap(spare_.back());
+      spare_.pop_back();
+    }
+    else
+    {
+      buffer_.first.assign(bufferSize_, 0);
+    }
+    notEmpty_.notify_one();
+  }
+
+  void AsyncBufferWriter::flush()
+  {
+    push_();
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return queue_.empty() && !busy_; });
+    checkError_();
+    out_.flush();
+  }
+
+  void AsyncBufferWriter::close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_)
+        return;
+    }
+    try
+    {
+      push_();
+    }
+    catch (std::exception&)
+    {
+      // An earlier write failed; it is reported below
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    notEmpty_.notify_one();
+    thread_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkError_();
+    out_.flush();
+  }
+
+  // Called with mutex_ held
+  void AsyncBufferWriter::checkError_()
+  {
+    if (!error_.empty())
+      NTA_THROW << "Buffered write failed: " << error_;
+  }
+
+  void AsyncBufferWriter::run_()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+      notEmpty_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+      if (queue_.empty())
+        break;
+
+      Buffer buffer = std::move(queue_.front());
+      queue_.pop_front();
+      busy_ = true;
+      lock.unlock();
+      notFull_.notify_one();
+
+      if (error_.empty())
+      {
+        std::string error;
+        try
+        {
+          if (sink_)
+            sink_(buffer.first.data(), buffer.second);
+          else
+            out_.write((const char*) buffer.first.data(), buffer.second);
+          if (!out_)
+            error = "stream error";
+        }
+        catch (std::exception& e)
+        {
+          error = e.what();
+        }
+        if (!error.empty())
+        {
+          lock.lock();
+          error_ = error;
+          lock.unlock();
+        }
+      }
+
+      lock.lock();
+      busy_ = false;
+      spare_.push_back(std::move(buffer.first));
+      if (queue_.empty())
+        idle_.notify_all();
+    }
+    idle_.notify_all();
+  }
+
+} // namespace nupic
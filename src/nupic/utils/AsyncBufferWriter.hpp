@@ -0,0 +1,159 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Definitions for AsyncBufferWriter, which writes buffered bytes to a
+ * stream on a background thread.
+ */
+
+#ifndef NTA_ASYNC_BUFFER_WRITER_HPP
+#define NTA_ASYNC_BUFFER_WRITER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <nupic/types/Types.hpp>
+
+namespace nupic
+{
+  /**
+   * Writes bytes to a stream on a background thread.
+   *
+   * @b Description
+   * Bytes are appended to a buffer in memory. Once it holds bufferSize
+   * bytes, it is handed to the writer thread and appending goes on in a
+   * recycled buffer, so the caller only pays for a memcpy. At most
+   * capacity full buffers wait for the writer; appending blocks while
+   * they do, so a slow disk slows the caller down rather than growing
+   * memory without bound.
+   *
+   * A sink can be given to process the buffers on the writer thread
+   * instead of writing them as they are, e.g. to format records that
+   * the caller only copied.
+   *
+   * Sample usage:
+   *
+   * AsyncBufferWriter writer(out);
+   * Byte* p = writer.reserve(n);
+   * ... write up to n bytes at p ...
+   * writer.commit(n);
+   * writer.flush();
+   *
+   * @b Constraints
+   *
+   * All methods must be called from one thread.
+   */
+  class AsyncBufferWriter
+  {
+  public:
+    /**
+     * Called on the writer thread with the bytes of each buffer. A buffer
+     * only holds whole commits. Exceptions are reported as write errors.
+     */
+    typedef std::function<void(const Byte* data, size_t n)> Sink;
+
+    /**
+     * @param out Stream to write to, and to flush. Must outlive the writer.
+     * @param bufferSize Bytes buffered before they are handed to the
+     *        writer thread.
+     * @param capacity Maximum number of full buffers waiting.
+     * @param sink If set, called with each buffer instead of writing it
+     *        to out. It should write to out.
+     */
+    AsyncBufferWriter(std::ostream& out, size_t bufferSize = 1 << 20,
+                      size_t capacity = 4, Sink sink = Sink());
+
+    /**
+     * Writes what is buffered. Errors are logged rather than thrown.
+     */
+    ~AsyncBufferWriter();
+
+    /**
+     * Returns room for n bytes at the end of the buffer. The bytes are
+     * written once they are committed.
+     */
+    Byte* reserve(size_t n);
+
+    /**
+     * Appends the first n bytes of the last reservation.
+     *
+     * @throws if an earlier write failed.
+     */
+    void commit(size_t n);
+
+    void append(const void* data, size_t n);
+
+    /**
+     * Blocks until everything appended is written, then flushes the
+     * stream.
+     *
+     * @throws if a write failed.
+     */
+    void flush();
+
+    /**
+     * Writes what is buffered and stops the writer thread. Idempotent.
+     *
+     * @throws if a write failed.
+     */
+    void close();
+
+  private:
+    // A buffer and the number of bytes used in it
+    typedef std::pair<std::vector<Byte>, size_t> Buffer;
+
+    void push_();
+    void run_();
+    void checkError_();
+
+    std::ostream& out_;
+    size_t bufferSize_;
+    size_t capacity_;
+    Sink sink_;
+
+    // The buffer being appended to
+    Buffer buffer_;
+
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::condition_variable idle_;
+    std::deque<Buffer> queue_;
+    std::vector<std::vector<Byte> > spare_;
+    bool busy_;
+    bool stopping_;
+    std::string error_;
+
+    std::thread thread_;
+  };
+
+} // namespace nupic
+
+#endif // NTA_ASYNC_BUFFER_WRITER_HPP
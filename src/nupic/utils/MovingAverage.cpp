@@ -33,31 +33,41 @@ using namespace nupic::util;
 
 
 MovingAverage::MovingAverage(UInt wSize, const vector<Real32>& historicalValues)
-    : windowSize_(wSize)
+    : windowSize_(wSize), firstIndex_(0)
 {
-  if (historicalValues.size() != 0)
-  {
-    copy(
-      historicalValues.begin() + historicalValues.size() - wSize,
-      historicalValues.end(),
-      back_inserter(slidingWindow_));
-  }
+  NTA_CHECK(wSize > 0) << "MovingAverage window size must be positive";
+  const size_t count = min((size_t) wSize, historicalValues.size());
+  slidingWindow_.reserve(wSize);
+  copy(
+    historicalValues.end() - count,
+    historicalValues.end(),
+    back_inserter(slidingWindow_));
   total_ = Real32(accumulate(slidingWindow_.begin(), slidingWindow_.end(), 0));
 }
 
 
-MovingAverage::MovingAverage(UInt wSize) : windowSize_(wSize), total_(0) {}
+MovingAverage::MovingAverage(UInt wSize)
+    : windowSize_(wSize), firstIndex_(0), total_(0)
+{
+  NTA_CHECK(wSize > 0) << "MovingAverage window size must be positive";
+  slidingWindow_.reserve(wSize);
+}
 
 
 Real32 MovingAverage::compute(Real32 newVal)
 {
   if (windowSize_ == slidingWindow_.size())
   {
-    total_ -= slidingWindow_.front();
-    slidingWindow_.erase(slidingWindow_.begin()); // pop front element
+    // Overwrite the oldest value
+    total_ -= slidingWindow_[firstIndex_];
+    slidingWindow_[firstIndex_] = newVal;
+    firstIndex_ = (firstIndex_ + 1) % windowSize_;
+  }
+  else
+  {
+    slidingWindow_.push_back(newVal);
   }
 
-  slidingWindow_.push_back(newVal);
   total_ += newVal;
   return getCurrentAvg();
 }
@@ -65,7 +75,12 @@ Real32 MovingAverage::compute(Real32 newVal)
 
 std::vector<Real32> MovingAverage::getSlidingWindow() const
 {
-  return slidingWindow_;
+  // Oldest value first
+  vector<Real32> window(slidingWindow_.begin() + firstIndex_,
+                        slidingWindow_.end());
+  window.insert(window.end(), slidingWindow_.begin(),
+                slidingWindow_.begin() + firstIndex_);
+  return window;
 }
 
 
@@ -78,7 +93,7 @@ Real32 MovingAverage::getCurrentAvg() const
 bool MovingAverage::operator==(const MovingAverage& r2) const
 {
   return (windowSize_ == r2.windowSize_ &&
-          slidingWindow_ == r2.slidingWindow_ &&
+          getSlidingWindow() == r2.getSlidingWindow() &&
           total_ == r2.total_);
 }
 
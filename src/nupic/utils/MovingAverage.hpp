@@ -47,7 +47,9 @@ namespace nupic
       bool operator!=(const MovingAverage& r2) const;
     private:
       UInt32 windowSize_;
+      // Ring buffer; once full, firstIndex_ is the oldest value
       std::vector<Real32> slidingWindow_;
+      UInt32 firstIndex_;
       Real32 total_;
     };
   }
@@ -0,0 +1,119 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Fork-join helpers shared by the multi-threaded kernels (SparseMatrix,
+ * NearestNeighbor, the image helpers, GaborNode, CondProbTable and
+ * SpatialPooler).
+ */
+
+#ifndef NTA_PARALLEL_FOR_HPP
+#define NTA_PARALLEL_FOR_HPP
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace nupic
+{
+  /**
+   * Number of threads to use for n tasks: nThreads, or the hardware
+   * concurrency if nThreads is 0, capped by n and at least 1.
+   *
+   * If minWorkPerThread is not 0, the count is also capped so that each
+   * thread gets at least minWorkPerThread of the total work.
+   */
+  inline size_t parallelThreads(size_t n, size_t nThreads,
+                                size_t work = 0, size_t minWorkPerThread = 0)
+  {
+    if (nThreads == 0)
+      nThreads = (size_t)std::thread::hardware_concurrency();
+    if (minWorkPerThread != 0)
+      nThreads = std::min(nThreads, work / minWorkPerThread);
+    nThreads = std::min(nThreads, n);
+    return std::max(nThreads, (size_t)1);
+  }
+
+  /**
+   * Calls f(t) for t in [0, nThreads), on nThreads - 1 new threads and on
+   * the calling thread, and returns when all the calls have returned.
+   *
+   * If some calls throw, the exception of the lowest t is rethrown on the
+   * calling thread once all the threads have been joined.
+   */
+  template <typename F>
+  inline void parallelFor(size_t nThreads, F f)
+  {
+    if (nThreads <= 1) {
+      f((size_t)0);
+      return;
+    }
+
+    std::vector<std::exception_ptr> errors(nThreads);
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1);
+
+    try {
+      for (size_t t = 1; t < nThreads; ++t)
+        threads.emplace_back([&f, &errors, t]() {
+          try {
+            f(t);
+          } catch (...) {
+            errors[t] = std::current_exception();
+          }
+        });
+      f((size_t)0);
+    } catch (...) {
+      errors[0] = std::current_exception();
+    }
+
+    for (std::thread& thread : threads)
+      thread.join();
+
+    for (const std::exception_ptr& error : errors)
+      if (error)
+        std::rethrow_exception(error);
+  }
+
+  /**
+   * Calls f(begin, end) on contiguous shards of [0, n), one per thread,
+   * with the first shard on the calling thread. Each call of f runs on a
+   * single thread, so scratch buffers local to f need no locking.
+   * Exceptions are handled as in parallelFor.
+   */
+  template <typename F>
+  inline void parallelForShards(size_t n, size_t nThreads, F f)
+  {
+    if (nThreads <= 1) {
+      f((size_t)0, n);
+      return;
+    }
+
+    parallelFor(nThreads, [&](size_t t) {
+      f(t * n / nThreads, (t + 1) * n / nThreads);
+    });
+  }
+
+} // end namespace nupic
+
+#endif // NTA_PARALLEL_FOR_HPP
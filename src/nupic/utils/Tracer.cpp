@@ -0,0 +1,531 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Implementation of the Tracer, TraceSpan and LatencyHistogram classes
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+
+#include <nupic/utils/Log.hpp>
+#include <nupic/utils/Tracer.hpp>
+
+namespace nupic
+{
+
+  // Values below 2^mantissaBits get one bucket each; above that, every
+  // power of two is split into 2^mantissaBits buckets.
+  static const size_t mantissaBits = 4;
+  static const size_t subBuckets = 1 << mantissaBits;
+  static const size_t bucketCount = subBuckets + (64 - mantissaBits) * subBuckets;
+
+  static Int64 steadyNanoseconds()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  LatencyHistogram::LatencyHistogram() :
+    buckets_(bucketCount, 0)
+  {
+    reset();
+  }
+
+  void LatencyHistogram::reset()
+  {
+    std::fill(buckets_.begin(), buckets_.end(), 0);
+    count_ = 0;
+    total_ = 0;
+    min_ = std::numeric_limits<UInt64>::max();
+    max_ = 0;
+  }
+
+  size_t LatencyHistogram::bucketIndex_(UInt64 value)
+  {
+    if (value < subBuckets)
+      return (size_t) value;
+
+    size_t exponent = 0;
+    for (UInt64 v = value; v > 1; v >>= 1)
+      exponent++;
+
+    size_t shift = exponent - mantissaBits;
+    size_t mantissa = (size_t) ((value >> shift) & (subBuckets - 1));
+    return subBuckets + shift * subBuckets + mantissa;
+  }
+
+  UInt64 LatencyHistogram::bucketUpperBound_(size_t index)
+  {
+    if (index < subBuckets)
+      return index;
+
+    size_t shift = (index - subBuckets) / subBuckets;
+    UInt64 mantissa = (index - subBuckets) % subBuckets;
+    // Wraps to the maximum value for the last bucket
+    return ((subBuckets + mantissa + 1) << shift) - 1;
+  }
+
+  void LatencyHistogram::add(UInt64 nanoseconds)
+  {
+    buckets_[bucketIndex_(nanoseconds)]++;
+    count_++;
+    total_ += nanoseconds;
+    if (nanoseconds < min_)
+      min_ = nanoseconds;
+    if (nanoseconds > max_)
+      max_ = nanoseconds;
+  }
+
+  void LatencyHistogram::merge(const LatencyHistogram& other)
+  {
+    for (size_t i = 0; i < buckets_.size(); i++)
+      buckets_[i] += other.buckets_[i];
+    count_ += other.count_;
+    total_ += other.total_;
+    if (other.min_ < min_)
+      min_ = other.min_;
+    if (other.max_ > max_)
+      max_ = other.max_;
+  }
+
+  UInt64 LatencyHistogram::getCount() const
+  {
+    return count_;
+  }
+
+  UInt64 LatencyHistogram::getTotal() const
+  {
+    return total_;
+  }
+
+  UInt64 LatencyHistogram::getMin() const
+  {
+    return count_ == 0 ? 0 : min_;
+  }
+
+  UInt64 LatencyHistogram::getMax() const
+  {
+    return max_;
+  }
+
+  UInt64 LatencyHistogram::getPercentile(Real64 percentile) const
+  {
+    NTA_CHECK(percentile >= 0.0 && percentile <= 100.0)
+      << "Invalid percentile " << percentile;
+
+    if (count_ == 0)
+      return 0;
+
+    UInt64 rank = (UInt64) std::ceil(percentile / 100.0 * count_);
+    if (rank == 0)
+      rank = 1;
+
+    UInt64 seen = 0;
+    for (size_t i = 0; i < buckets_.size(); i++)
+    {
+      seen += buckets_[i];
+      if (seen >= rank)
+        return std::min(std::max(bucketUpperBound_(i), min_), max_);
+    }
+    return max_;
+  }
+
+
+  Tracer& Tracer::getInstance()
+  {
+    static Tracer instance;
+    return instance;
+  }
+
+  const UInt32 Tracer::noThread_ = std::numeric_limits<UInt32>::max();
+
+  Tracer::ThreadBuffer_::ThreadBuffer_(size_t maxEvents) :
+    thread(noThread_),
+    maxEvents(maxEvents),
+    next(0),
+    dropped(0)
+  {
+  }
+
+  std::vector<TraceEvent> Tracer::ThreadBuffer_::getEvents() const
+  {
+    if (events.size() < maxEvents)
+      return events;
+
+    std::vector<TraceEvent> result(events.begin() + next, events.end());
+    result.insert(result.end(), events.begin(), events.begin() + next);
+    return result;
+  }
+
+  void Tracer::ThreadBuffer_::resize(size_t newMaxEvents)
+  {
+    if (newMaxEvents == maxEvents)
+      return;
+
+    std::vector<TraceEvent> kept = getEvents();
+    if (kept.size() > newMaxEvents)
+    {
+      dropped += kept.size() - newMaxEvents;
+      kept.erase(kept.begin(), kept.end() - newMaxEvents);
+    }
+    events.swap(kept);
+    maxEvents = newMaxEvents;
+    next = events.size() % maxEvents;
+  }
+
+  void Tracer::ThreadBuffer_::clear()
+  {
+    thread = noThread_;
+    events.clear();
+    next = 0;
+    dropped = 0;
+    histograms.clear();
+  }
+
+  Tracer::Tracer() :
+    enabled_(false),
+    epoch_(steadyNanoseconds()),
+    nextThread_(0),
+    maxEvents_(0)
+  {
+  }
+
+  void Tracer::enable(size_t maxEvents)
+  {
+    NTA_CHECK(maxEvents > 0) << "Tracer needs room for at least one event";
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxEvents_ = maxEvents;
+    for (auto& buffer : buffers_)
+    {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      buffer->resize(maxEvents);
+    }
+    enabled_.store(true);
+  }
+
+  void Tracer::disable()
+  {
+    enabled_.store(false);
+  }
+
+  void Tracer::reset()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& buffer : buffers_)
+    {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      buffer->clear();
+    }
+    nextThread_.store(0);
+    epoch_.store(steadyNanoseconds());
+  }
+
+  UInt64 Tracer::now() const
+  {
+    Int64 elapsed = steadyNanoseconds() - epoch_.load();
+    return elapsed < 0 ? 0 : (UInt64)elapsed;
+  }
+
+  Tracer::ThreadBuffer_& Tracer::threadBuffer_()
+  {
+    static thread_local ThreadBuffer_* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffers_.emplace_back(new ThreadBuffer_(maxEvents_));
+      buffer = buffers_.back().get();
+    }
+    return *buffer;
+  }
+
+  void Tracer::record(const std::string& category, const std::string& name,
+                      UInt64 start, UInt64 duration,
+                      Int64 iteration, UInt64 bytes)
+  {
+    ThreadBuffer_& buffer = threadBuffer_();
+    // Only contended while the events are exported
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.maxEvents == 0)
+      return;
+
+    if (buffer.thread == noThread_)
+      buffer.thread = nextThread_++;
+
+    // Slots of a full ring are overwritten in place, reusing their strings
+    TraceEvent* event;
+    if (buffer.events.size() < buffer.maxEvents)
+    {
+      buffer.events.push_back(TraceEvent());
+      event = &buffer.events.back();
+    }
+    else
+    {
+      event = &buffer.events[buffer.next];
+      buffer.dropped++;
+    }
+    buffer.next = (buffer.next + 1) % buffer.maxEvents;
+
+    event->category = category;
+    event->name = name;
+    event->thread = buffer.thread;
+    event->start = start;
+    event->duration = duration;
+    event->iteration = iteration;
+    event->bytes = bytes;
+
+    buffer.histograms[category][name].add(duration);
+  }
+
+  std::vector<TraceEvent> Tracer::getEvents() const
+  {
+    std::vector<TraceEvent> events;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const auto& buffer : buffers_)
+      {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        std::vector<TraceEvent> threadEvents = buffer->getEvents();
+        events.insert(events.end(), threadEvents.begin(), threadEvents.end());
+      }
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const TraceEvent& a, const TraceEvent& b)
+                     { return a.start < b.start; });
+    return events;
+  }
+
+  UInt64 Tracer::getDroppedEventCount() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    UInt64 dropped = 0;
+    for (const auto& buffer : buffers_)
+    {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      dropped += buffer->dropped;
+    }
+    return dropped;
+  }
+
+  Tracer::Histograms Tracer::getHistograms_() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Histograms histograms;
+    for (const auto& buffer : buffers_)
+    {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      for (const auto& category : buffer->histograms)
+      {
+        for (const auto& name : category.second)
+          histograms[category.first][name.first].merge(name.second);
+      }
+    }
+    return histograms;
+  }
+
+  LatencyHistogram Tracer::getHistogram(const std::string& category,
+                                        const std::string& name) const
+  {
+    Histograms histograms = getHistograms_();
+    auto c = histograms.find(category);
+    if (c == histograms.end())
+      return LatencyHistogram();
+    auto it = c->second.find(name);
+    if (it == c->second.end())
+      return LatencyHistogram();
+    return it->second;
+  }
+
+  static std::string jsonEscape(const std::string& s)
+  {
+    std::string escaped;
+    for (char c : s)
+    {
+      switch (c)
+      {
+      case '"': escaped += "\\\""; break;
+      case '\\': escaped += "\\\\"; break;
+      case '\n': escaped += "\\n"; break;
+      case '\r': escaped += "\\r"; break;
+      case '\t': escaped += "\\t"; break;
+      default:
+        if ((unsigned char) c < 0x20)
+        {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", (unsigned int) c);
+          escaped += buf;
+        }
+        else
+        {
+          escaped += c;
+        }
+      }
+    }
+    return escaped;
+  }
+
+  static std::string csvEscape(const std::string& s)
+  {
+    if (s.find_first_of(",\"\n") == std::string::npos)
+      return s;
+
+    std::string escaped = "\"";
+    for (char c : s)
+    {
+      if (c == '"')
+        escaped += '"';
+      escaped += c;
+    }
+    return escaped + "\"";
+  }
+
+  // Nanoseconds as fractional microseconds, the unit of both output formats
+  static void writeMicroseconds(std::ostream& out, UInt64 nanoseconds)
+  {
+    out << nanoseconds / 1000 << "."
+        << std::setw(3) << std::setfill('0') << nanoseconds % 1000
+        << std::setfill(' ');
+  }
+
+  void Tracer::writeChromeTrace(std::ostream& out) const
+  {
+    std::vector<TraceEvent> events = getEvents();
+
+    out << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); i++)
+    {
+      const TraceEvent& e = events[i];
+      if (i > 0)
+        out << ",";
+      out << "\n{\"name\":\"" << jsonEscape(e.name)
+          << "\",\"cat\":\"" << jsonEscape(e.category)
+          << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread
+          << ",\"ts\":";
+      writeMicroseconds(out, e.start);
+      out << ",\"dur\":";
+      writeMicroseconds(out, e.duration);
+      out << ",\"args\":{";
+      bool first = true;
+      if (e.iteration >= 0)
+      {
+        out << "\"iteration\":" << e.iteration;
+        first = false;
+      }
+      if (e.bytes > 0)
+      {
+        if (!first)
+          out << ",";
+        out << "\"bytes\":" << e.bytes;
+      }
+      out << "}}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  }
+
+  void Tracer::writeCSV(std::ostream& out) const
+  {
+    std::vector<TraceEvent> events = getEvents();
+
+    out << "category,name,thread,start_us,duration_us,iteration,bytes\n";
+    for (const TraceEvent& e : events)
+    {
+      out << csvEscape(e.category) << "," << csvEscape(e.name) << ","
+          << e.thread << ",";
+      writeMicroseconds(out, e.start);
+      out << ",";
+      writeMicroseconds(out, e.duration);
+      out << "," << e.iteration << "," << e.bytes << "\n";
+    }
+  }
+
+  void Tracer::writeSummaryCSV(std::ostream& out) const
+  {
+    Histograms histograms = getHistograms_();
+
+    out << "category,name,count,total_us,min_us,p50_us,p99_us,max_us\n";
+    for (const auto& category : histograms)
+    {
+      for (const auto& item : category.second)
+      {
+        const LatencyHistogram& h = item.second;
+        out << csvEscape(category.first) << ","
+            << csvEscape(item.first) << "," << h.getCount() << ",";
+        writeMicroseconds(out, h.getTotal());
+        out << ",";
+        writeMicroseconds(out, h.getMin());
+        out << ",";
+        writeMicroseconds(out, h.getPercentile(50));
+        out << ",";
+        writeMicroseconds(out, h.getPercentile(99));
+        out << ",";
+        writeMicroseconds(out, h.getMax());
+        out << "\n";
+      }
+    }
+  }
+
+
+  TraceSpan::TraceSpan(const char* category) :
+    active_(Tracer::getInstance().isEnabled()),
+    category_(category),
+    start_(0),
+    iteration_(-1),
+    bytes_(0)
+  {
+    if (active_)
+      start_ = Tracer::getInstance().now();
+  }
+
+  TraceSpan::~TraceSpan()
+  {
+    if (!active_)
+      return;
+
+    Tracer& tracer = Tracer::getInstance();
+    UInt64 end = tracer.now();
+    // The tracer was reset while the span was open
+    if (end < start_)
+      return;
+    tracer.record(category_, name_, start_, end - start_, iteration_, bytes_);
+  }
+
+  void TraceSpan::setName(const std::string& name)
+  {
+    name_ = name;
+  }
+
+  void TraceSpan::setIteration(Int64 iteration)
+  {
+    iteration_ = iteration;
+  }
+
+  void TraceSpan::addBytes(UInt64 bytes)
+  {
+    bytes_ += bytes;
+  }
+
+} // namespace nupic
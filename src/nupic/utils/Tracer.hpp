@@ -0,0 +1,277 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Interface for the Tracer, TraceSpan and LatencyHistogram classes
+ */
+
+#ifndef NTA_TRACER_HPP
+#define NTA_TRACER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nupic/types/Types.hpp>
+
+namespace nupic
+{
+
+  /**
+   * Fixed-memory histogram of latencies.
+   *
+   * Values are bucketed with 4 bits of mantissa per power of two, so
+   * reported percentiles are within 1/16 (about 6%) of the true value,
+   * independent of the number of samples.
+   */
+  class LatencyHistogram
+  {
+  public:
+    LatencyHistogram();
+
+    // Add one latency, in nanoseconds
+    void add(UInt64 nanoseconds);
+
+    // Add every latency of @a other
+    void merge(const LatencyHistogram& other);
+
+    void reset();
+
+    UInt64 getCount() const;
+    UInt64 getTotal() const;
+    UInt64 getMin() const;
+    UInt64 getMax() const;
+
+    /**
+     * @param percentile In [0, 100], e.g. 50 or 99
+     * @returns An upper bound of the latency at @a percentile, in
+     * nanoseconds, or 0 if the histogram is empty
+     */
+    UInt64 getPercentile(Real64 percentile) const;
+
+  private:
+    static size_t bucketIndex_(UInt64 value);
+    static UInt64 bucketUpperBound_(size_t index);
+
+    std::vector<UInt64> buckets_;
+    UInt64 count_;
+    UInt64 total_;
+    UInt64 min_;
+    UInt64 max_;
+  };
+
+  /**
+   * A completed span of work, e.g. one region compute.
+   */
+  struct TraceEvent
+  {
+    std::string category;
+    std::string name;
+    UInt32 thread;      // small integer id, in order of first use
+    UInt64 start;       // nanoseconds since the tracer epoch
+    UInt64 duration;    // nanoseconds
+    Int64 iteration;    // network iteration, or -1
+    UInt64 bytes;       // bytes moved, e.g. by a link copy
+  };
+
+  /**
+   * Process-wide collector of trace events and latency histograms for the
+   * Network engine.
+   *
+   * The engine instruments Network iterations and callbacks, region
+   * compute, Input::prepare and Link::compute (with the number of bytes
+   * copied) through the NTA_TRACE_* macros below. The macros compile to
+   * nothing unless nupic.core is built with NTA_TRACING defined (CMake
+   * option NUPIC_TRACING), and cost one relaxed atomic load per span while
+   * the tracer is disabled.
+   *
+   * Each thread records into its own buffer, so threads don't contend for
+   * a lock while tracing. The most recent events of each thread are kept in
+   * a ring buffer; histograms aggregate every event since the last reset().
+   * Results can be exported as Chrome trace JSON (load it in
+   * chrome://tracing) or as CSV.
+   *
+   * Sample usage:
+   *
+   *   Tracer& tracer = Tracer::getInstance();
+   *   tracer.enable();
+   *   net.run(1000);
+   *   tracer.disable();
+   *   OFStream f("trace.json");
+   *   tracer.writeChromeTrace(f);
+   */
+  class Tracer
+  {
+  public:
+    static Tracer& getInstance();
+
+    /**
+     * Start recording.
+     *
+     * @param maxEvents Capacity of the event ring buffer of each thread
+     */
+    void enable(size_t maxEvents = 1000000);
+
+    void disable();
+
+    bool isEnabled() const
+    {
+      return enabled_.load(std::memory_order_relaxed);
+    }
+
+    // Drop all events and histograms and restart the clock
+    void reset();
+
+    // Nanoseconds since the tracer epoch
+    UInt64 now() const;
+
+    // Thread safe
+    void record(const std::string& category, const std::string& name,
+                UInt64 start, UInt64 duration,
+                Int64 iteration = -1, UInt64 bytes = 0);
+
+    // Recorded events of all threads, by start time
+    std::vector<TraceEvent> getEvents() const;
+
+    // Number of events that were overwritten in the ring buffers
+    UInt64 getDroppedEventCount() const;
+
+    // Histogram of the spans recorded with @a category and @a name
+    LatencyHistogram getHistogram(const std::string& category,
+                                  const std::string& name) const;
+
+    // Chrome trace event format, "X" (complete) events
+    void writeChromeTrace(std::ostream& out) const;
+
+    // One line per event:
+    // category,name,thread,start_us,duration_us,iteration,bytes
+    void writeCSV(std::ostream& out) const;
+
+    // One line per span name:
+    // category,name,count,total_us,min_us,p50_us,p99_us,max_us
+    void writeSummaryCSV(std::ostream& out) const;
+
+  private:
+    Tracer();
+    Tracer(const Tracer&);
+    Tracer& operator=(const Tracer&);
+
+    // Histograms by category, then name
+    typedef std::map<std::string, std::map<std::string, LatencyHistogram> >
+      Histograms;
+
+    // The events and histograms recorded by one thread. Only that thread
+    // records into it; mutex is held by exporters and reset().
+    struct ThreadBuffer_
+    {
+      ThreadBuffer_(size_t maxEvents);
+
+      // Events, oldest first
+      std::vector<TraceEvent> getEvents() const;
+      void resize(size_t maxEvents);
+      void clear();
+
+      std::mutex mutex;
+      UInt32 thread;  // noThread_ until the first event since reset()
+      size_t maxEvents;
+      std::vector<TraceEvent> events;
+      size_t next;
+      UInt64 dropped;
+      Histograms histograms;
+    };
+
+    static const UInt32 noThread_;
+
+    // The buffer of the calling thread, created on first use
+    ThreadBuffer_& threadBuffer_();
+
+    Histograms getHistograms_() const;
+
+    std::atomic<bool> enabled_;
+    // steady_clock time of the last reset(), in nanoseconds since the clock's
+    // own epoch. Atomic so that now() does not need the mutex.
+    std::atomic<Int64> epoch_;
+    // Next thread id to hand out since reset()
+    std::atomic<UInt32> nextThread_;
+
+    // Guards maxEvents_ and the list of buffers. Buffers live as long as
+    // the tracer, so the events of threads that exited are kept.
+    mutable std::mutex mutex_;
+    size_t maxEvents_;
+    std::vector<std::unique_ptr<ThreadBuffer_> > buffers_;
+  };
+
+  /**
+   * Records one TraceEvent covering its own lifetime, if the Tracer was
+   * enabled when it was constructed. Use through the NTA_TRACE_* macros.
+   */
+  class TraceSpan
+  {
+  public:
+    TraceSpan(const char* category);
+    ~TraceSpan();
+
+    bool isActive() const
+    {
+      return active_;
+    }
+
+    void setName(const std::string& name);
+    void setIteration(Int64 iteration);
+    void addBytes(UInt64 bytes);
+
+  private:
+    TraceSpan(const TraceSpan&);
+    TraceSpan& operator=(const TraceSpan&);
+
+    bool active_;
+    const char* category_;
+    std::string name_;
+    UInt64 start_;
+    Int64 iteration_;
+    UInt64 bytes_;
+  };
+
+} // namespace nupic
+
+// The span name expression is only evaluated while the tracer is enabled.
+#ifdef NTA_TRACING
+#define NTA_TRACE_SPAN(span, category, name) \
+  nupic::TraceSpan span(category);           \
+  if (span.isActive()) span.setName(name)
+#define NTA_TRACE_ITERATION(span, iteration) \
+  do { if (span.isActive()) span.setIteration(iteration); } while (0)
+#define NTA_TRACE_BYTES(span, bytes) \
+  do { if (span.isActive()) span.addBytes(bytes); } while (0)
+#else
+#define NTA_TRACE_SPAN(span, category, name)
+#define NTA_TRACE_ITERATION(span, iteration) do {} while (0)
+#define NTA_TRACE_BYTES(span, bytes) do {} while (0)
+#endif
+
+#endif // NTA_TRACER_HPP
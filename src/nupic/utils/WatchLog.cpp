@@ -0,0 +1,656 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Implementation of the watch log
+ */
+
+#include <cstring>
+#include <exception>
+#include <ostream>
+
+#include <nupic/types/BasicType.hpp>
+#include <nupic/utils/Log.hpp>
+#include <nupic/utils/WatchLog.hpp>
+
+namespace nupic
+{
+  const char WatchLog::magic[8] = {'N', 'T', 'A', 'W', 'A', 'T', 'C', 'H'};
+  const UInt32 WatchLog::formatVersion = 1;
+
+  namespace
+  {
+    // ----- Binary encoding -----
+
+    void putVarint_(std::string& buf, UInt64 v)
+    {
+      while (v >= 0x80)
+      {
+        buf.push_back((char)((v & 0x7f) | 0x80));
+        v >>= 7;
+      }
+      buf.push_back((char)v);
+    }
+
+    void putSigned_(std::string& buf, Int64 v)
+    {
+      putVarint_(buf, ((UInt64)v << 1) ^ (UInt64)(v >> 63));
+    }
+
+    void putString_(std::string& buf, const std::string& s)
+    {
+      putVarint_(buf, s.size());
+      buf.append(s);
+    }
+
+    // Writes a record: payload length, type, payload
+    void putRecord_(std::ostream& out, char type, const std::string& payload)
+    {
+      NTA_CHECK(payload.size() < 0xffffffffu)
+        << "Watch log record too large: " << payload.size() << " bytes";
+      UInt32 length = (UInt32)payload.size() + 1;
+      out.write((const char*)&length, sizeof(length));
+      out.put(type);
+      out.write(payload.data(), payload.size());
+    }
+
+    // Bounds-checked reader of one record's payload
+    struct Cursor
+    {
+      const Byte* p;
+      const Byte* end;
+      const std::string& fileName;
+
+      void need(size_t n)
+      {
+        if ((size_t)(end - p) < n)
+          NTA_THROW << "Corrupt watch log " << fileName
+                    << ": record ends unexpectedly";
+      }
+
+      unsigned char getByte()
+      {
+        need(1);
+        return (unsigned char)*p++;
+      }
+
+      UInt64 getVarint()
+      {
+        UInt64 v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+          unsigned char b = getByte();
+          v |= (UInt64)(b & 0x7f) << shift;
+          if (!(b & 0x80))
+            return v;
+        }
+        NTA_THROW << "Corrupt watch log " << fileName << ": bad varint";
+        return 0;
+      }
+
+      Int64 getSigned()
+      {
+        UInt64 v = getVarint();
+        return (Int64)(v >> 1) ^ -(Int64)(v & 1);
+      }
+
+      std::string getString()
+      {
+        UInt64 n = getVarint();
+        need(n);
+        std::string s((const char*)p, n);
+        p += n;
+        return s;
+      }
+
+      void getBytes(std::vector<Byte>& bytes, UInt64 n)
+      {
+        need(n);
+        bytes.assign(p, p + n);
+        p += n;
+      }
+    };
+
+    // Decodes the payload of a record of the given type
+    void decodeRecord_(Cursor& c, char type, std::vector<WatchInfo>& watches,
+                       UInt64& iteration, std::vector<WatchValue>& values)
+    {
+      switch (type)
+      {
+      case 'W':
+        {
+          watches.resize(c.getVarint());
+          for (WatchInfo& watch : watches)
+          {
+            watch.watchID = (UInt32)c.getVarint();
+            watch.regionName = c.getString();
+            watch.nodeType = c.getString();
+            watch.nodeIndex = c.getSigned();
+            watch.varName = c.getString();
+            watch.varType = (NTA_BasicType)c.getByte();
+            watch.sparseOutput = c.getByte() != 0;
+          }
+          break;
+        }
+      case 'V':
+        {
+          iteration = c.getVarint();
+          values.resize(c.getVarint());
+          for (WatchValue& value : values)
+          {
+            value.watchID = (UInt32)c.getVarint();
+            value.iteration = iteration;
+            value.kind = (WatchValue::Kind)c.getByte();
+            value.type = (NTA_BasicType)c.getByte();
+            value.count = 0;
+            value.bytes.clear();
+            value.indices.clear();
+            switch (value.kind)
+            {
+            case WatchValue::noValue:
+              break;
+            case WatchValue::scalarValue:
+              c.getBytes(value.bytes, c.getVarint());
+              if (!BasicType::isValid(value.type) ||
+                  value.bytes.size() != BasicType::getSize(value.type))
+                NTA_THROW << "Corrupt watch log " << c.fileName
+                          << ": bad scalar value";
+              break;
+            case WatchValue::stringValue:
+              c.getBytes(value.bytes, c.getVarint());
+              break;
+            case WatchValue::denseValue:
+              value.count = c.getVarint();
+              if (!BasicType::isValid(value.type))
+                NTA_THROW << "Corrupt watch log " << c.fileName
+                          << ": bad value type";
+              c.getBytes(value.bytes,
+                         value.count * BasicType::getSize(value.type));
+              break;
+            case WatchValue::sparseValue:
+              {
+                value.count = c.getVarint();
+                UInt64 n = c.getVarint();
+                c.need(n); // at least one byte per index
+                value.indices.resize(n);
+                UInt64 index = 0;
+                for (UInt64 i = 0; i < n; i++)
+                {
+                  index += c.getVarint();
+                  value.indices[i] = index;
+                }
+                break;
+              }
+            default:
+              NTA_THROW << "Corrupt watch log " << c.fileName
+                        << ": bad value kind";
+            }
+          }
+          break;
+        }
+      default:
+        NTA_THROW << "Corrupt watch log " << c.fileName
+                  << ": unknown record type";
+      }
+    }
+
+    // ----- Text encoding -----
+
+    // Writes count values, each preceded by a space if spaced
+    template <typename T>
+    void putTextValues_(std::ostream& out, const Byte* bytes, UInt64 count,
+                        bool spaced)
+    {
+      const T* values = (const T*)bytes;
+      for (UInt64 i = 0; i < count; i++)
+      {
+        if (spaced)
+          out << " ";
+        out << values[i];
+      }
+    }
+
+    void putTextValues_(std::ostream& out, NTA_BasicType type,
+                        const Byte* bytes, UInt64 count, bool spaced)
+    {
+      switch (type)
+      {
+      case NTA_BasicType_Byte:
+        putTextValues_<Byte>(out, bytes, count, spaced);
+        break;
+      case NTA_BasicType_Int32:
+        putTextValues_<Int32>(out, bytes, count, spaced);
+        break;
+      case NTA_BasicType_UInt32:
+        putTextValues_<UInt32>(out, bytes, count, spaced);
+        break;
+      case NTA_BasicType_Int64:
+        putTextValues_<Int64>(out, bytes, count, spaced);
+        break;
+      case NTA_BasicType_UInt64:
+        putTextValues_<UInt64>(out, bytes, count, spaced);
+        break;
+      case NTA_BasicType_Real32:
+        putTextValues_<Real32>(out, bytes, count, spaced);
+        break;
+      case NTA_BasicType_Real64:
+        putTextValues_<Real64>(out, bytes, count, spaced);
+        break;
+      default:
+        NTA_THROW << "Watch log does not support type "
+                  << BasicType::getName(type);
+      }
+    }
+
+    template <typename T>
+    void sparsify_(const Byte* bytes, UInt64 count,
+                   std::vector<UInt64>& indices)
+    {
+      const T* values = (const T*)bytes;
+      for (UInt64 i = 0; i < count; i++)
+      {
+        if (values[i] != (T)0)
+          indices.push_back(i);
+      }
+    }
+  } // end namespace
+
+  void WatchValue::sparsify()
+  {
+    NTA_ASSERT(kind == denseValue);
+
+    indices.clear();
+    switch (type)
+    {
+    case NTA_BasicType_Int32:
+      sparsify_<Int32>(bytes.data(), count, indices);
+      break;
+    case NTA_BasicType_UInt32:
+      sparsify_<UInt32>(bytes.data(), count, indices);
+      break;
+    case NTA_BasicType_Int64:
+      sparsify_<Int64>(bytes.data(), count, indices);
+      break;
+    case NTA_BasicType_UInt64:
+      sparsify_<UInt64>(bytes.data(), count, indices);
+      break;
+    case NTA_BasicType_Real32:
+      sparsify_<Real32>(bytes.data(), count, indices);
+      break;
+    case NTA_BasicType_Real64:
+      sparsify_<Real64>(bytes.data(), count, indices);
+      break;
+    default:
+      NTA_THROW << "Cannot sparsify a watch value of type "
+                << BasicType::getName(type);
+    }
+    bytes.clear();
+    kind = sparseValue;
+  }
+
+  void WatchLog::writeHeader(std::ostream& out)
+  {
+    out.write(magic, sizeof(magic));
+    out.write((const char*)&formatVersion, sizeof(formatVersion));
+  }
+
+  void WatchLog::writeWatches(std::ostream& out,
+                              const std::vector<WatchInfo>& watches,
+                              bool binary)
+  {
+    if (!binary)
+    {
+      out << "Info: watchID, regionName, nodeType, nodeIndex, varName" << "\n";
+      for (const WatchInfo& watch : watches)
+      {
+        out << watch.watchID << ", ";
+        out << watch.regionName << ", ";
+        out << watch.nodeType << ", ";
+        out << watch.nodeIndex << ", ";
+        out << watch.varName << "\n";
+      }
+      out << "Data: watchID, iteration, paramValue" << "\n";
+      return;
+    }
+
+    std::string payload;
+    putVarint_(payload, watches.size());
+    for (const WatchInfo& watch : watches)
+    {
+      putVarint_(payload, watch.watchID);
+      putString_(payload, watch.regionName);
+      putString_(payload, watch.nodeType);
+      putSigned_(payload, watch.nodeIndex);
+      putString_(payload, watch.varName);
+      payload.push_back((char)watch.varType);
+      payload.push_back((char)watch.sparseOutput);
+    }
+    putRecord_(out, 'W', payload);
+  }
+
+  void WatchLog::writeValues(std::ostream& out, UInt64 iteration,
+                             const std::vector<WatchValue>& values,
+                             bool binary)
+  {
+    if (!binary)
+    {
+      for (const WatchValue& value : values)
+      {
+        out << value.watchID << ", " << iteration << ", ";
+        switch (value.kind)
+        {
+        case WatchValue::noValue:
+          break;
+        case WatchValue::scalarValue:
+          putTextValues_(out, value.type, value.bytes.data(), 1, false);
+          break;
+        case WatchValue::stringValue:
+          out.write((const char*)value.bytes.data(), value.bytes.size());
+          break;
+        case WatchValue::denseValue:
+          out << value.count;
+          putTextValues_(out, value.type, value.bytes.data(), value.count,
+                         true);
+          break;
+        case WatchValue::sparseValue:
+          out << value.count;
+          for (UInt64 index : value.indices)
+            out << " " << index;
+          break;
+        }
+        out << "\n";
+      }
+      return;
+    }
+
+    std::string payload;
+    putVarint_(payload, iteration);
+    putVarint_(payload, values.size());
+    for (const WatchValue& value : values)
+    {
+      putVarint_(payload, value.watchID);
+      payload.push_back((char)value.kind);
+      payload.push_back((char)value.type);
+      switch (value.kind)
+      {
+      case WatchValue::noValue:
+        break;
+      case WatchValue::scalarValue:
+      case WatchValue::stringValue:
+        putVarint_(payload, value.bytes.size());
+        payload.append((const char*)value.bytes.data(), value.bytes.size());
+        break;
+      case WatchValue::denseValue:
+        putVarint_(payload, value.count);
+        payload.append((const char*)value.bytes.data(), value.bytes.size());
+        break;
+      case WatchValue::sparseValue:
+        {
+          putVarint_(payload, value.count);
+          putVarint_(payload, value.indices.size());
+          UInt64 previous = 0;
+          for (UInt64 index : value.indices)
+          {
+            putVarint_(payload, index - previous);
+            previous = index;
+          }
+          break;
+        }
+      }
+    }
+    putRecord_(out, 'V', payload);
+  }
+
+  // ----- WatchLogWriter -----
+
+  const size_t WatchLogWriter::bufferSize = 1 << 16;
+
+  namespace
+  {
+    // Bytes reserved in the AsyncBufferWriter at a time
+    const size_t reserveSize = 4096;
+  } // end namespace
+
+  WatchLogWriter::StreamBuffer::StreamBuffer(AsyncBufferWriter& writer) :
+    writer_(writer)
+  {
+  }
+
+  // Grows the reservation rather than committing what is encoded, so
+  // that the writer thread never gets part of a record
+  WatchLogWriter::StreamBuffer::int_type
+  WatchLogWriter::StreamBuffer::overflow(int_type c)
+  {
+    size_t n = pptr() - pbase();
+    char* p = (char*)writer_.reserve(n + reserveSize);
+    setp(p, p + n + reserveSize);
+    pbump((int)n);
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+      return traits_type::not_eof(c);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+  }
+
+  // Commits what was encoded. The reservation is dropped, since
+  // committing may hand the buffer to the writer thread.
+  int WatchLogWriter::StreamBuffer::sync()
+  {
+    size_t n = pptr() - pbase();
+    setp(nullptr, nullptr);
+    if (n > 0)
+      writer_.commit(n);
+    return 0;
+  }
+
+  WatchLogWriter::WatchLogWriter(std::ostream& out, bool binary,
+                                 size_t capacity) :
+    out_(out),
+    binary_(binary),
+    closed_(false),
+    writer_(out, bufferSize, capacity,
+            [this](const Byte* data, size_t n) { format_(data, n); }),
+    buffer_(writer_),
+    stream_(&buffer_)
+  {
+    // Rethrow errors of the AsyncBufferWriter rather than just setting
+    // badbit
+    stream_.exceptions(std::ios::badbit);
+    // Nothing is queued yet, so the writer thread does not use out
+    if (binary_)
+      WatchLog::writeHeader(out_);
+  }
+
+  WatchLogWriter::~WatchLogWriter()
+  {
+    try
+    {
+      close();
+    }
+    catch (std::exception& e)
+    {
+      NTA_WARN << "Watch log writer: " << e.what();
+    }
+  }
+
+  void WatchLogWriter::writeWatches(const std::vector<WatchInfo>& watches)
+  {
+    NTA_CHECK(!closed_) << "Watch log writer is closed";
+    WatchLog::writeWatches(stream_, watches, true);
+    buffer_.pubsync();
+  }
+
+  void WatchLogWriter::writeValues(UInt64 iteration,
+                                   const std::vector<WatchValue>& values)
+  {
+    NTA_CHECK(!closed_) << "Watch log writer is closed";
+    WatchLog::writeValues(stream_, iteration, values, true);
+    buffer_.pubsync();
+  }
+
+  void WatchLogWriter::format_(const Byte* data, size_t n)
+  {
+    static const std::string source = "watch log buffer";
+
+    const Byte* end = data + n;
+    while (data != end)
+    {
+      UInt32 length;
+      NTA_ASSERT((size_t)(end - data) > sizeof(length));
+      ::memcpy(&length, data, sizeof(length));
+      data += sizeof(length);
+
+      char type = (char)*data;
+      Cursor c = {data + 1, data + length, source};
+      UInt64 iteration = 0;
+      decodeRecord_(c, type, watches_, iteration, values_);
+      data += length;
+
+      if (type == 'W')
+      {
+        for (const WatchInfo& watch : watches_)
+        {
+          if (sparse_.size() <= watch.watchID)
+            sparse_.resize(watch.watchID + 1);
+          sparse_[watch.watchID] = watch.sparseOutput &&
+            watch.varType != NTA_BasicType_Byte;
+        }
+        WatchLog::writeWatches(out_, watches_, binary_);
+        continue;
+      }
+
+      for (WatchValue& value : values_)
+      {
+        if (value.kind == WatchValue::denseValue &&
+            value.watchID < sparse_.size() && sparse_[value.watchID])
+          value.sparsify();
+      }
+      WatchLog::writeValues(out_, iteration, values_, binary_);
+    }
+  }
+
+  void WatchLogWriter::flush()
+  {
+    // close() has written everything
+    if (closed_)
+      return;
+    buffer_.pubsync();
+    writer_.flush();
+  }
+
+  void WatchLogWriter::close()
+  {
+    if (closed_)
+      return;
+    closed_ = true;
+    try
+    {
+      buffer_.pubsync();
+    }
+    catch (std::exception&)
+    {
+      // An earlier write failed; close() reports it
+    }
+    writer_.close();
+  }
+
+  // ----- WatchLogReader -----
+
+  WatchLogReader::WatchLogReader(const std::string& fileName) :
+    in_(fileName.c_str(), std::ios::in | std::ios::binary),
+    fileName_(fileName)
+  {
+    if (!in_.is_open())
+      NTA_THROW << "Unable to open watch log " << fileName;
+
+    char header[sizeof(WatchLog::magic)];
+    UInt32 version = 0;
+    in_.read(header, sizeof(header));
+    in_.read((char*)&version, sizeof(version));
+    if (!in_ || ::memcmp(header, WatchLog::magic, sizeof(header)) != 0)
+      NTA_THROW << fileName << " is not a binary watch log";
+    if (version != WatchLog::formatVersion)
+      NTA_THROW << "Unsupported watch log version " << version
+                << " in " << fileName;
+  }
+
+  bool WatchLogReader::readRecord_(char& type,
+                                   std::vector<WatchInfo>& watches,
+                                   UInt64& iteration,
+                                   std::vector<WatchValue>& values)
+  {
+    UInt32 length = 0;
+    in_.read((char*)&length, sizeof(length));
+    if (in_.gcount() == 0 && in_.eof())
+      return false;
+    if (!in_ || length == 0)
+      NTA_THROW << "Corrupt watch log " << fileName_
+                << ": bad record length";
+
+    payload_.resize(length);
+    in_.read((char*)payload_.data(), length);
+    if (!in_)
+      NTA_THROW << "Corrupt watch log " << fileName_
+                << ": record ends unexpectedly";
+
+    type = (char)payload_[0];
+    Cursor c = {payload_.data() + 1, payload_.data() + length, fileName_};
+    decodeRecord_(c, type, watches, iteration, values);
+    return true;
+  }
+
+  bool WatchLogReader::next(std::vector<WatchValue>& values)
+  {
+    char type;
+    std::vector<WatchInfo> watches;
+    UInt64 iteration;
+    while (readRecord_(type, watches, iteration, values))
+    {
+      if (type == 'V')
+        return true;
+      watches_.insert(watches_.end(), watches.begin(), watches.end());
+    }
+    return false;
+  }
+
+  void WatchLogReader::toText(std::ostream& out)
+  {
+    char type;
+    std::vector<WatchInfo> watches;
+    UInt64 iteration = 0;
+    std::vector<WatchValue> values;
+    while (readRecord_(type, watches, iteration, values))
+    {
+      if (type == 'W')
+      {
+        watches_.insert(watches_.end(), watches.begin(), watches.end());
+        WatchLog::writeWatches(out, watches, false);
+      }
+      else
+      {
+        WatchLog::writeValues(out, iteration, values, false);
+      }
+    }
+  }
+
+} // namespace nupic
@@ -0,0 +1,271 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Definitions for the watch log: the records written by Watcher, their
+ * binary encoding, the buffered writer and the offline reader.
+ */
+
+#ifndef NTA_WATCH_LOG_HPP
+#define NTA_WATCH_LOG_HPP
+
+#include <fstream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <nupic/types/Types.hpp>
+#include <nupic/utils/AsyncBufferWriter.hpp>
+
+namespace nupic
+{
+  /**
+   * Description of one watch, written once when a Watcher is attached.
+   */
+  struct WatchInfo
+  {
+    UInt32 watchID;
+    std::string regionName;
+    std::string nodeType;
+    Int64 nodeIndex;
+    std::string varName;
+    NTA_BasicType varType;
+    bool sparseOutput;
+  };
+
+  /**
+   * The value of one watch at one iteration.
+   */
+  struct WatchValue
+  {
+    enum Kind
+    {
+      noValue,     // nothing recorded (uncloned node parameters)
+      scalarValue, // bytes holds one value of type
+      stringValue, // bytes holds the characters
+      denseValue,  // bytes holds count values of type
+      sparseValue  // indices holds the nonzero elements of count
+    };
+
+    UInt32 watchID;
+    UInt64 iteration;
+    NTA_BasicType type;
+    Kind kind;
+    UInt64 count;
+    std::vector<Byte> bytes;
+    std::vector<UInt64> indices;
+
+    /**
+     * Turns a dense value into a sparse one: indices of the nonzero
+     * elements, ascending.
+     */
+    void sparsify();
+  };
+
+  /**
+   * Encoding of the watch log, text or binary.
+   *
+   * @b Description
+   * The text format is the one Watcher has always written: an "Info"
+   * block describing the watches, then a "Data" line per watch per
+   * iteration. In sparse mode, array values are written as their
+   * element count followed by the indices of the nonzero elements.
+   *
+   * The binary format starts with the 8 byte magic "NTAWATCH" and a
+   * 32-bit format version. It is followed by length-prefixed records:
+   * a 32-bit payload length, a one byte record type, then the payload.
+   *
+   * - 'W' (watches): the WatchInfo of each watch of one attachment.
+   * - 'V' (values): the iteration and the WatchValue of each watch.
+   *
+   * Integers in a payload are LEB128 varints (zigzag for signed ones).
+   * Sparse indices are delta-encoded, each from the previous index.
+   * Raw values are in host byte order.
+   */
+  class WatchLog
+  {
+  public:
+    static const char magic[8];
+    static const UInt32 formatVersion;
+
+    static void writeHeader(std::ostream& out);
+
+    static void writeWatches(std::ostream& out,
+                             const std::vector<WatchInfo>& watches,
+                             bool binary);
+
+    static void writeValues(std::ostream& out, UInt64 iteration,
+                            const std::vector<WatchValue>& values,
+                            bool binary);
+  };
+
+  /**
+   * Writes watch log records on a background thread.
+   *
+   * @b Description
+   * The calling thread only copies the records, in the binary record
+   * format and without sparsifying them, into the buffers of an
+   * AsyncBufferWriter. The writer thread decodes them, sparsifies the
+   * values of sparse watches, and formats them to the stream as text or
+   * binary. capacity bounds the number of full buffers waiting for the
+   * writer thread; writeValues() blocks while they do, so a slow disk
+   * slows the network down rather than growing memory without bound.
+   *
+   * @b Constraints
+   *
+   * All methods must be called from one thread.
+   */
+  class WatchLogWriter
+  {
+  public:
+    /**
+     * @param out Stream to write to. Must outlive the writer.
+     * @param binary Whether to write the binary format.
+     * @param capacity Maximum number of full buffers waiting, each of
+     *        bufferSize bytes.
+     */
+    WatchLogWriter(std::ostream& out, bool binary, size_t capacity = 64);
+
+    /**
+     * Writes what is buffered. Errors are logged rather than thrown.
+     */
+    ~WatchLogWriter();
+
+    void writeWatches(const std::vector<WatchInfo>& watches);
+
+    /**
+     * Copies the values of one iteration, to be formatted and written by
+     * the writer thread.
+     *
+     * @throws if an earlier write failed.
+     */
+    void writeValues(UInt64 iteration, const std::vector<WatchValue>& values);
+
+    /**
+     * Blocks until everything copied is written, then flushes the
+     * stream. Does nothing once closed.
+     *
+     * @throws if a write failed.
+     */
+    void flush();
+
+    /**
+     * Writes what is buffered and stops the writer thread. Idempotent.
+     *
+     * @throws if a write failed.
+     */
+    void close();
+
+    // Size of the buffers handed to the writer thread
+    static const size_t bufferSize;
+
+  private:
+    // Stream buffer whose put area is reserved in the AsyncBufferWriter.
+    // A record is only committed whole, once it is synced.
+    class StreamBuffer : public std::streambuf
+    {
+    public:
+      StreamBuffer(AsyncBufferWriter& writer);
+
+    protected:
+      int_type overflow(int_type c) override;
+      int sync() override;
+
+    private:
+      AsyncBufferWriter& writer_;
+    };
+
+    // Decodes the records of one buffer and formats them to out_. Runs
+    // on the writer thread.
+    void format_(const Byte* data, size_t n);
+
+    std::ostream& out_;
+    bool binary_;
+    bool closed_;
+
+    // State of the writer thread: the sparse output flag of each watch,
+    // by watchID, and the records being formatted
+    std::vector<bool> sparse_;
+    std::vector<WatchInfo> watches_;
+    std::vector<WatchValue> values_;
+
+    AsyncBufferWriter writer_;
+    StreamBuffer buffer_;
+    std::ostream stream_;
+  };
+
+  /**
+   * Reads a binary watch log, for offline analysis.
+   *
+   * Sample usage:
+   *
+   * WatchLogReader reader("fileName");
+   * std::vector<WatchValue> values;
+   * while (reader.next(values))
+   * {
+   *   ...
+   * }
+   */
+  class WatchLogReader
+  {
+  public:
+    /**
+     * @throws if the file cannot be opened or is not a binary watch log.
+     */
+    WatchLogReader(const std::string& fileName);
+
+    /**
+     * Reads the values of the next iteration. Watch descriptions met on
+     * the way are added to getWatches().
+     *
+     * @returns false at the end of the log.
+     * @throws if the log is corrupt or truncated.
+     */
+    bool next(std::vector<WatchValue>& values);
+
+    /**
+     * @returns The descriptions of the watches read so far.
+     */
+    const std::vector<WatchInfo>& getWatches() const { return watches_; }
+
+    /**
+     * Writes the rest of the log in the text format, exactly as a text
+     * Watcher would have.
+     */
+    void toText(std::ostream& out);
+
+  private:
+    // Reads one record; returns false at the end of the log
+    bool readRecord_(char& type, std::vector<WatchInfo>& watches,
+                     UInt64& iteration, std::vector<WatchValue>& values);
+
+    std::ifstream in_;
+    std::string fileName_;
+    std::vector<Byte> payload_;
+    std::vector<WatchInfo> watches_;
+  };
+
+} // namespace nupic
+
+#endif // NTA_WATCH_LOG_HPP
@@ -24,7 +24,6 @@
  * Implementation of the Watcher class
  */
 
-#include <sstream>
 #include <string>
 #include <vector>
 #include <exception>
@@ -43,23 +42,40 @@
 namespace nupic
 {
 
-  Watcher::Watcher(std::string fileName)
+  Watcher::Watcher(std::string fileName,
+                   watcherFormat format,
+                   size_t queueCapacity)
   {
     data_.fileName = fileName;
+    data_.closed = false;
     try 
     {
-      data_.outStream = new OFStream(fileName.c_str());
+      data_.outStream = new OFStream(fileName.c_str(),
+                                     format == binaryFormat ?
+                                     std::ios::out | std::ios::binary :
+                                     std::ios::out);
     }
     catch (std::exception &)
     {
       NTA_THROW << "Unable to open filename " << fileName << " for network watcher";
     }
+    data_.writer = new WatchLogWriter(*data_.outStream,
+                                      format == binaryFormat,
+                                      queueCapacity);
   }
 
   Watcher::~Watcher()
   {
-    this->flushFile();
-    this->closeFile();
+    try
+    {
+      this->flushFile();
+      this->closeFile();
+    }
+    catch (std::exception& e)
+    {
+      NTA_WARN << "Watcher: " << e.what();
+    }
+    delete data_.writer;
     delete data_.outStream;
   }
 
@@ -95,389 +111,140 @@ namespace nupic
     return watch.watchID;
   }
 
-  //TODO: clean up, add support for uncloned arrays,
+  //Copies the elements of an array into value
+  static void copyArray(const ArrayBase& a, WatchValue& value)
+  {
+    const Byte* buf = (const Byte*) a.getBuffer();
+    value.kind = WatchValue::denseValue;
+    value.count = a.getCount();
+    value.bytes.assign(buf, buf + a.getCount() *
+                       BasicType::getSize(a.getType()));
+  }
+
+  //Copies a scalar into value
+  template <typename T>
+  static void copyScalar(T p, WatchValue& value)
+  {
+    const Byte* buf = (const Byte*) &p;
+    value.kind = WatchValue::scalarValue;
+    value.bytes.assign(buf, buf + sizeof(T));
+  }
+
+  //TODO: add support for uncloned arrays,
   //add support for output of a different type than Real32
   void Watcher::watcherCallback(Network* net, UInt64 iteration, void* dataIn)
   {
     allData& data = *(static_cast<allData*>(dataIn));
-    //iterate through each watch
-    for (auto & elem : data.watches)
+    if (data.closed)
+      return;
+    data.values.resize(data.watches.size());
+
+    //iterate through each watch, copying its value; the writer
+    //formats and writes the values
+    for (size_t i = 0; i < data.watches.size(); i++)
     {
-      watchData watch = elem;
-      std::string value;
-      std::stringstream out;
+      watchData& watch = data.watches[i];
+      WatchValue& value = data.values[i];
+      value.watchID = watch.watchID;
+      value.iteration = iteration;
+      value.type = watch.varType;
+      value.kind = WatchValue::noValue;
+      value.count = 0;
+      value.bytes.clear();
+      value.indices.clear();
+
       if (watch.wType == parameter)
       {
         if (watch.isArray) //currently don't support uncloned arrays
         {
-          switch(watch.varType)
-          {
-          case NTA_BasicType_Int32:
-          {
-            Array a(NTA_BasicType_Int32);
-            watch.region->getParameterArray(watch.varName, a);
-            Int32* buf = (Int32*) a.getBuffer();
-            out << a.getCount();
-            if (watch.sparseOutput)
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                if (buf[j] != (Int32)0)
-                  out << " " << j;
-              }
-            }
-            else
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                out << " " << buf[j];
-              }
-            }
-            break;
-          }
-          case NTA_BasicType_UInt32:
-          {
-            Array a(NTA_BasicType_UInt32);
-            watch.region->getParameterArray(watch.varName, a);
-            UInt32* buf = (UInt32*) a.getBuffer();
-            out << a.getCount();
-            if (watch.sparseOutput)
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                if (buf[j] != (UInt32)0)
-                  out << " " << j;
-              }
-            }
-            else
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                out << " " << buf[j];
-              }
-            }
-            break;
-          }
-          case NTA_BasicType_Int64:
-          {
-            Array a(NTA_BasicType_Int64);
-            watch.region->getParameterArray(watch.varName, a);
-            Int64* buf = (Int64*) a.getBuffer();
-            out << a.getCount();
-            if (watch.sparseOutput)
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                if (buf[j] != (Int64)0)
-                  out << " " << j;
-              }
-            }
-            else
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                out << " " << buf[j];
-              }
-            }
-            break;
-          }
-          case NTA_BasicType_UInt64:
-          {
-            Array a(NTA_BasicType_UInt64);
-            watch.region->getParameterArray(watch.varName, a);
-            UInt64* buf = (UInt64*) a.getBuffer();
-            out << a.getCount();
-            if (watch.sparseOutput)
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                if (buf[j] != (UInt64)0)
-                  out << " " << j;
-              }
-            }
-            else
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                out << " " << buf[j];
-              }
-            }
-            break;
-          }
-          case NTA_BasicType_Real32:
-          {
-            Array a(NTA_BasicType_Real32);
-            watch.region->getParameterArray(watch.varName, a);
-            Real32* buf = (Real32*) a.getBuffer();
-            out << a.getCount();
-            if (watch.sparseOutput)
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                if (buf[j] != (Real32)0)
-                  out << " " << j;
-              }
-            }
-            else
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                out << " " << buf[j];
-              }
-            }
-            break;
-          }
-          case NTA_BasicType_Real64:
-          {
-            Array a(NTA_BasicType_Real64);
-            watch.region->getParameterArray(watch.varName, a);
-            Real64* buf = (Real64*) a.getBuffer();
-            out << a.getCount();
-            if (watch.sparseOutput)
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                if (buf[j] != (Real64)0)
-                  out << " " << j;
-              }
-            }
-            else
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                out << " " << buf[j];
-              }
-            }
-            break;
-          }
-          case NTA_BasicType_Byte:
-          {
-            Array a(NTA_BasicType_Byte);
-            watch.region->getParameterArray(watch.varName, a);
-            Byte* buf = (Byte*) a.getBuffer();
-            out << a.getCount();
-            if (watch.sparseOutput)
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                out << " " << buf[j];
-              }
-            }
-            else
-            {
-              for (UInt j = 0; j < a.getCount(); j++)
-              {
-                out << " " << buf[j];
-              }
-            }
-            break;
-          }
-          default:
-            NTA_THROW << "Internal error.";
-          }
+          //the buffer is reused across iterations, as long as the
+          //parameter keeps its size
+          size_t count = watch.region->getParameterArrayCount(watch.varName);
+          if (watch.paramArray->getCount() != count)
+            watch.paramArray->releaseBuffer();
+          watch.region->getParameterArray(watch.varName, *watch.paramArray);
+          copyArray(*watch.paramArray, value);
         }
         else if (watch.nodeIndex == -1) 
         {
           switch (watch.varType)
           {
           case NTA_BasicType_Int32:
-          {
-            Int32 p = watch.region->getParameterInt32(watch.varName);
-            out << p;
+            copyScalar(watch.region->getParameterInt32(watch.varName), value);
             break;
-          }
           case NTA_BasicType_UInt32:
-          {
-            UInt32 p = watch.region->getParameterUInt32(watch.varName);
-            out << p;
+            copyScalar(watch.region->getParameterUInt32(watch.varName), value);
             break;
-          }
           case NTA_BasicType_Int64:
-          {
-            Int64 p = watch.region->getParameterInt64(watch.varName);
-            out << p;
+            copyScalar(watch.region->getParameterInt64(watch.varName), value);
             break;
-          }
           case NTA_BasicType_UInt64:
-          {
-            UInt64 p = watch.region->getParameterUInt64(watch.varName);
-            out << p;
+            copyScalar(watch.region->getParameterUInt64(watch.varName), value);
             break;
-          }
           case NTA_BasicType_Real32:
-          {
-            Real32 p = watch.region->getParameterReal32(watch.varName);
-            out << p;
+            copyScalar(watch.region->getParameterReal32(watch.varName), value);
             break;
-          }
           case NTA_BasicType_Real64:
-          {
-            Real64 p = watch.region->getParameterReal64(watch.varName);
-            out << p;
+            copyScalar(watch.region->getParameterReal64(watch.varName), value);
             break;
-          }
           case NTA_BasicType_Byte:
           {
             std::string p = watch.region->getParameterString(watch.varName);
-            out << p;
+            value.kind = WatchValue::stringValue;
+            value.bytes.assign(p.begin(), p.end());
             break;
           }
           default:
             NTA_THROW << "Internal error.";
           }
         }
-        //else //nodeIndex != -1
-        //{
-        //  Node n = watch.region->getNodeAtIndex((size_t)watch.nodeIndex);
-        //  switch (watch.varType)
-        //  {
-        //  case NTA_BasicType_Int32:
-        //  {
-        //    Int32 p = n.getParameterInt32(watch.varName);
-        //    out << p;
-        //    break;
-        //  }
-        //  case NTA_BasicType_UInt32:
-        //  {
-        //    UInt32 p = n.getParameterUInt32(watch.varName);
-        //    out << p;
-        //    break;
-        //  }
-        //  case NTA_BasicType_Int64:
-        //  {
-        //    Int64 p = n.getParameterInt64(watch.varName);
-        //    out << p;
-        //    break;
-        //  }
-        //  case NTA_BasicType_UInt64:
-        //  {
-        //    UInt64 p = n.getParameterUInt64(watch.varName);
-        //    out << p;
-        //    break;
-        //  }
-        //  case NTA_BasicType_Real32:
-        //  {
-        //    Real32 p = n.getParameterReal32(watch.varName);
-        //    out << p;
-        //    break;
-        //  }
-        //  case NTA_BasicType_Real64:
-        //  {
-        //    Real64 p = n.getParameterReal64(watch.varName);
-        //    out << p;
-        //    break;
-        //  }
-        //  case NTA_BasicType_Byte:
-        //  {
-        //    std::string p = n.getParameterString(watch.varName);
-        //    out << p;
-        //    break;
-        //  }
-        //  default:
-        //    NTA_THROW << "Internal error.";
-        //  }
-        //}
+        //else nodeIndex != -1: uncloned node parameters are not
+        //supported yet, and nothing is recorded
       }
       else if (watch.wType == output)
       {
-        switch (watch.varType)
-        {
-        case NTA_BasicType_Real32:
+        if (watch.varType != NTA_BasicType_Real32 &&
+            watch.varType != NTA_BasicType_Real64)
         {
-          Real32* outputData = (Real32*)(watch.array->getBuffer());
-          unsigned int numOuts = watch.array->getCount();
-          out << numOuts;
-          
-          if (watch.sparseOutput)
-          {
-            for (UInt j = 0; j < numOuts; j++)
-            {
-              if (outputData[j] != (Real32)0)
-              {
-                out << " " << j;
-              }
-            }
-          }
-          else
-          {
-            for (UInt j = 0; j < numOuts; j++)
-            {
-              out << " " << outputData[j];
-            }
-          }
-          break;
-        }
-        case NTA_BasicType_Real64:
-        {
-          Real64* outputData = (Real64*)(watch.array->getBuffer());
-          unsigned int numOuts = watch.array->getCount();
-          out << numOuts;
-          
-          if (watch.sparseOutput)
-          {
-            for (UInt j = 0; j < numOuts; j++)
-            {
-              if (outputData[j] != (Real64)0)
-              {
-                out << " " << j;
-              }
-            }
-          }
-          else
-          {
-            for (UInt j = 0; j < numOuts; j++)
-            {
-              out << " " << outputData[j];
-            }
-          }
-          break;
-        }
-        default:
           NTA_THROW << "Watcher only supports Real32 or Real64 outputs.";
         }
+        copyArray(*watch.array, value);
       }
       else //should never happen
       {
         NTA_THROW << "Watcher can only watch parameters or outputs.";
       }
-      
-      value = out.str();
-
-      (*data.outStream) << watch.watchID << ", " << iteration << ", " << value << "\n";
     }
-    data.outStream->flush();
+
+    data.writer->writeValues(iteration, data.values);
   }
 
   void Watcher::closeFile()
   {
+    data_.closed = true;
+    data_.writer->close();
     data_.outStream->close();
   }
 
   void Watcher::flushFile()
   {
-    data_.outStream->flush();
+    //the values were written and the file closed by closeFile()
+    if (data_.closed)
+      return;
+    data_.writer->flush();
   }
 
   //attach Watcher to a network and do initial writing to files
   void Watcher::attachToNetwork(Network& net)
   {
-    (*data_.outStream) << "Info: watchID, regionName, nodeType, nodeIndex, varName" << "\n";
+    std::vector<WatchInfo> infos;
 
     //go through each watch
-    watchData watch;
-
-    for (UInt i = 0; i < data_.watches.size(); i++)
+    for (auto & watch : data_.watches)
     {
-      watch = data_.watches.at(i);
       const Collection<Region*>& regions = net.getRegions();
       watch.region = regions.getByName(watch.regionName);
 
-      //output general information for each watch
-      (*data_.outStream) << watch.watchID << ", ";
-      (*data_.outStream) << watch.regionName << ", ";
-      (*data_.outStream) << watch.region->getType() << ", ";
-      (*data_.outStream) << watch.nodeIndex  << ", ";
-
       if (watch.wType == parameter)
       {
         //find out varType and add it to watch struct
@@ -501,12 +268,12 @@ namespace nupic
         watch.isArray = ((p.count == 0 || p.count > 1)
                          && watch.varType != NTA_BasicType_Byte);
 
-        (*data_.outStream) << watch.varName << "\n";
+        if (watch.isArray)
+          watch.paramArray = std::make_shared<Array>(watch.varType);
       }
       else if (watch.wType == output)
       {
         watch.output = watch.region->getOutput(watch.varName);
-        (*data_.outStream) << watch.varName << "\n";
 
         watch.array = &(watch.output->getData());
 
@@ -518,14 +285,19 @@ namespace nupic
         NTA_THROW << "Watcher can only watch parameters or outputs.";
       }
 
-      //add the modified watch struct to data_.watches
-      allWatchData::iterator it;
-      it = data_.watches.begin() + i;
-      data_.watches.insert(it, watch);
-      data_.watches.erase(data_.watches.begin() + i + 1);
+      //output general information for each watch
+      WatchInfo info;
+      info.watchID = watch.watchID;
+      info.regionName = watch.regionName;
+      info.nodeType = watch.region->getType();
+      info.nodeIndex = watch.nodeIndex;
+      info.varName = watch.varName;
+      info.varType = watch.varType;
+      info.sparseOutput = watch.sparseOutput;
+      infos.push_back(info);
     }
 
-    (*data_.outStream) << "Data: watchID, iteration, paramValue" << "\n";
+    data_.writer->writeWatches(infos);
     
     //actually attach to the network
     Collection<Network::callbackItem>& callbacks = net.getCallbacks();
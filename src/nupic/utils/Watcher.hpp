@@ -27,13 +27,16 @@
 #ifndef NTA_WATCHER_HPP
 #define NTA_WATCHER_HPP
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <nupic/engine/Output.hpp>
+#include <nupic/utils/WatchLog.hpp>
 
 namespace nupic
 {
+  class Array;
   class ArrayBase;
   class Network;
   class Region;
@@ -44,6 +47,12 @@ namespace nupic
     parameter,
     output
   };
+
+  enum watcherFormat
+  {
+    textFormat,
+    binaryFormat
+  };
   
   //Contains data specific for each individual parameter
   //to be watched.
@@ -61,6 +70,8 @@ namespace nupic
     NTA_BasicType varType;
     std::string nodeName;
     const ArrayBase * array;
+    //Reused by every call to getParameterArray()
+    std::shared_ptr<Array> paramArray;
     bool isArray;
     bool sparseOutput;
   };
@@ -71,6 +82,12 @@ namespace nupic
     OFStream* outStream;
     std::string fileName;
     std::vector<watchData> watches;
+    //Formats and writes the values on a background thread
+    WatchLogWriter* writer;
+    //Values of the current iteration, reused across iterations
+    std::vector<WatchValue> values;
+    //Set by closeFile(); a callback still attached then writes nothing
+    bool closed;
   };
 
   /*
@@ -92,11 +109,19 @@ namespace nupic
    * net.run();
    *
    * w.detachFromNetwork(net);
+   *
+   * The callback only copies the values into buffers; a background
+   * thread formats and writes them (see WatchLogWriter). Up to
+   * queueCapacity full buffers wait for it before the network does.
+   * With binaryFormat the file is a binary watch log, which
+   * WatchLogReader reads back, or converts to the text format.
    */
   class Watcher
   {
   public:
-    Watcher(const std::string fileName);
+    Watcher(const std::string fileName,
+            watcherFormat format = textFormat,
+            size_t queueCapacity = 64);
 
     //calls flushFile() and closeFile()
     ~Watcher();
@@ -127,11 +152,12 @@ namespace nupic
     void
     detachFromNetwork(Network&);
 
-    //Closes the OFStream.
+    //Writes the queued values and closes the OFStream.
     void
     closeFile();
     
-    //Flushes the OFStream.
+    //Waits for the queued values to be written and flushes the OFStream.
+    //Does nothing after closeFile().
     void
     flushFile();
 
@@ -0,0 +1,417 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Benchmarks of the algorithms' compute methods
+ */
+
+#include <vector>
+
+#include <capnp/message.h>
+#include <capnp/serialize.h>
+
+#include <nupic/algorithms/Anomaly.hpp>
+#include <nupic/algorithms/Cells4.hpp>
+#include <nupic/algorithms/ClassifierResult.hpp>
+#include <nupic/algorithms/Connections.hpp>
+#include <nupic/algorithms/SDRClassifier.hpp>
+#include <nupic/algorithms/SpatialPooler.hpp>
+#include <nupic/algorithms/TemporalMemory.hpp>
+#include <nupic/proto/SpatialPoolerProto.capnp.h>
+#include <nupic/utils/Random.hpp>
+
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace nupic;
+using namespace nupic::benchmark;
+using namespace nupic::algorithms::anomaly;
+using namespace nupic::algorithms::connections;
+using nupic::algorithms::Cells4::Cells4;
+using nupic::algorithms::cla_classifier::ClassifierResult;
+using nupic::algorithms::sdr_classifier::SDRClassifier;
+using nupic::algorithms::spatial_pooler::SpatialPooler;
+using nupic::algorithms::temporal_memory::TemporalMemory;
+
+#define SEED 42
+
+// Number of distinct inputs each benchmark cycles through
+static const UInt numPatterns = 64;
+
+// Active columns per pattern for the sequence memory benchmarks
+static const UInt numActiveColumns = 40;
+
+/**
+ * SpatialPooler::compute on random dense inputs.
+ * Arguments: number of columns, learn, global inhibition.
+ */
+static void BM_SpatialPoolerCompute(State& state)
+{
+  const UInt numColumns = (UInt) state.range(0);
+  const bool learn = state.range(1) != 0;
+  const bool globalInhibition = state.range(2) != 0;
+  const UInt numInputs = 2 * numColumns;
+
+  SpatialPooler sp({numInputs}, {numColumns},
+                   /*potentialRadius*/ 16,
+                   /*potentialPct*/ 0.5,
+                   globalInhibition,
+                   /*localAreaDensity*/ -1.0,
+                   /*numActiveColumnsPerInhArea*/ 10,
+                   /*stimulusThreshold*/ 0,
+                   /*synPermInactiveDec*/ 0.008,
+                   /*synPermActiveInc*/ 0.05,
+                   /*synPermConnected*/ 0.1,
+                   /*minPctOverlapDutyCycles*/ 0.001,
+                   /*dutyCyclePeriod*/ 1000,
+                   /*boostStrength*/ 0.0,
+                   SEED);
+
+  Random rng(SEED);
+  vector<vector<UInt> > inputs(numPatterns, vector<UInt>(numInputs, 0));
+  for (auto& input : inputs)
+    for (UInt bit : randomIndices(rng, numInputs, numInputs / 10))
+      input[bit] = 1;
+  vector<UInt> active(numColumns);
+
+  UInt i = 0;
+  while (state.keepRunning())
+  {
+    sp.compute(inputs[i++ % numPatterns].data(), learn, active.data());
+    doNotOptimize(active);
+  }
+  state.setItemsProcessed(state.iterations());
+}
+NTA_BENCHMARK(BM_SpatialPoolerCompute)
+  ->argNames({"columns", "learn", "global"})
+  ->args({2048, 1, 1})
+  ->args({2048, 0, 1})
+  ->args({1024, 1, 0})
+  ->args({1024, 0, 0});
+
+/**
+ * SpatialPooler::initialize, with one input per column and potential pools
+ * of half the inputs, in each InitMode. A lazy pooler is timed until its
+ * first compute.
+ * Arguments: number of columns, mode (0 serial, 1 parallel, 2 lazy).
+ */
+static void BM_SpatialPoolerInitialize(State& state)
+{
+  const UInt numColumns = (UInt) state.range(0);
+  const auto mode = (SpatialPooler::InitMode) state.range(1);
+  const UInt numInputs = numColumns;
+  vector<UInt> input(numInputs, 0), active(numColumns);
+
+  while (state.keepRunning())
+  {
+    SpatialPooler sp;
+    sp.setInitMode(mode);
+    sp.initialize({numInputs}, {numColumns},
+                  /*potentialRadius*/ numInputs / 4,
+                  /*potentialPct*/ 0.5);
+    if (mode == SpatialPooler::initLazy)
+      sp.compute(input.data(), false, active.data());
+    doNotOptimize(sp.getNumColumns());
+  }
+  state.setItemsProcessed(state.iterations() * numColumns);
+}
+NTA_BENCHMARK(BM_SpatialPoolerInitialize)
+  ->argNames({"columns", "mode"})
+  ->args({4096, 0})
+  ->args({4096, 1})
+  ->args({4096, 2});
+
+/**
+ * SpatialPooler::write to a capnp message, and SpatialPooler::read back
+ * from it, with numInputs = columns / 4 and potentialPct 0.5.
+ * Arguments: number of columns, read.
+ */
+static void BM_SpatialPoolerSerialize(State& state)
+{
+  const UInt numColumns = (UInt) state.range(0);
+  const bool read = state.range(1) != 0;
+  const UInt numInputs = numColumns / 4;
+
+  SpatialPooler sp({numInputs}, {numColumns},
+                   /*potentialRadius*/ numInputs,
+                   /*potentialPct*/ 0.5);
+
+  capnp::MallocMessageBuilder message;
+  auto proto = message.initRoot<SpatialPoolerProto>();
+  sp.write(proto);
+  auto reader = proto.asReader();
+  size_t bytes = capnp::computeSerializedSizeInWords(message) * sizeof(capnp::word);
+
+  SpatialPooler copy;
+  while (state.keepRunning())
+  {
+    if (read)
+    {
+      copy.read(reader);
+      doNotOptimize(copy.getNumColumns());
+    }
+    else
+    {
+      capnp::MallocMessageBuilder out;
+      auto outProto = out.initRoot<SpatialPoolerProto>();
+      sp.write(outProto);
+      doNotOptimize(capnp::computeSerializedSizeInWords(out));
+    }
+  }
+  state.setBytesProcessed(state.iterations() * bytes);
+}
+NTA_BENCHMARK(BM_SpatialPoolerSerialize)
+  ->argNames({"columns", "read"})
+  ->args({16384, 0})
+  ->args({16384, 1});
+
+/**
+ * TemporalMemory::compute on a repeating sequence of random column SDRs.
+ * Arguments: number of columns, learn.
+ */
+static void BM_TemporalMemoryCompute(State& state)
+{
+  const UInt numColumns = (UInt) state.range(0);
+  const bool learn = state.range(1) != 0;
+
+  TemporalMemory tm({numColumns}, /*cellsPerColumn*/ 32);
+
+  Random rng(SEED);
+  vector<vector<UInt> > sequence;
+  for (UInt i = 0; i < numPatterns; i++)
+    sequence.push_back(randomIndices(rng, numColumns, numActiveColumns));
+
+  // Let the inference benchmark see learned segments
+  if (!learn)
+    for (UInt pass = 0; pass < 5; pass++)
+      for (auto& columns : sequence)
+        tm.compute(columns.size(), columns.data(), true);
+
+  UInt i = 0;
+  while (state.keepRunning())
+  {
+    const vector<UInt>& columns = sequence[i++ % numPatterns];
+    tm.compute(columns.size(), columns.data(), learn);
+  }
+  state.setItemsProcessed(state.iterations());
+}
+NTA_BENCHMARK(BM_TemporalMemoryCompute)
+  ->argNames({"columns", "learn"})
+  ->args({2048, 1})
+  ->args({2048, 0})
+  ->args({8192, 0});
+
+/**
+ * Connections::computeActivity over randomly connected segments.
+ * Arguments: number of cells, segments per cell, synapses per segment.
+ */
+static void BM_ConnectionsComputeActivity(State& state)
+{
+  const UInt numCells = (UInt) state.range(0);
+  const UInt segmentsPerCell = (UInt) state.range(1);
+  const UInt synapsesPerSegment = (UInt) state.range(2);
+
+  Connections connections(numCells, segmentsPerCell, synapsesPerSegment);
+  Random rng(SEED);
+  for (CellIdx cell = 0; cell < numCells; cell++)
+  {
+    for (UInt s = 0; s < segmentsPerCell; s++)
+    {
+      Segment segment = connections.createSegment(cell);
+      for (UInt presynapticCell :
+             randomIndices(rng, numCells, synapsesPerSegment))
+      {
+        connections.createSynapse(segment, presynapticCell,
+                                  (Permanence) rng.getReal64());
+      }
+    }
+  }
+
+  vector<vector<CellIdx> > activeCells;
+  for (UInt i = 0; i < numPatterns; i++)
+    activeCells.push_back(randomIndices(rng, numCells, numCells / 50));
+
+  vector<UInt32> numActiveConnected(connections.segmentFlatListLength());
+  vector<UInt32> numActivePotential(connections.segmentFlatListLength());
+
+  UInt i = 0;
+  while (state.keepRunning())
+  {
+    std::fill(numActiveConnected.begin(), numActiveConnected.end(), 0);
+    std::fill(numActivePotential.begin(), numActivePotential.end(), 0);
+    connections.computeActivity(numActiveConnected, numActivePotential,
+                                activeCells[i++ % numPatterns], 0.5);
+    doNotOptimize(numActiveConnected);
+  }
+  state.setItemsProcessed(state.iterations());
+}
+NTA_BENCHMARK(BM_ConnectionsComputeActivity)
+  ->argNames({"cells", "segments", "synapses"})
+  ->args({65536, 1, 20})
+  ->args({65536, 4, 20})
+  ->args({16384, 4, 64});
+
+/**
+ * SDRClassifier::compute with learning and inference.
+ * Arguments: input size, number of buckets.
+ */
+static void BM_SDRClassifierCompute(State& state)
+{
+  const UInt inputSize = (UInt) state.range(0);
+  const UInt numBuckets = (UInt) state.range(1);
+
+  SDRClassifier classifier({1}, 0.001, 0.3, 0);
+
+  Random rng(SEED);
+  vector<vector<UInt> > patterns;
+  for (UInt i = 0; i < numPatterns; i++)
+    patterns.push_back(randomIndices(rng, inputSize, inputSize / 50));
+
+  UInt recordNum = 0;
+  while (state.keepRunning())
+  {
+    UInt bucket = recordNum % numBuckets;
+    ClassifierResult result;
+    classifier.compute(recordNum, patterns[recordNum % numPatterns], bucket,
+                       (Real64) bucket, false, true, true, &result);
+    recordNum++;
+  }
+  state.setItemsProcessed(state.iterations());
+}
+NTA_BENCHMARK(BM_SDRClassifierCompute)
+  ->argNames({"inputs", "buckets"})
+  ->args({2048, 10})
+  ->args({65536, 100});
+
+/**
+ * Cells4::compute on a repeating sequence of random column SDRs.
+ * Arguments: number of columns, cells per column, learn.
+ */
+static void BM_Cells4Compute(State& state)
+{
+  const UInt numColumns = (UInt) state.range(0);
+  const UInt cellsPerColumn = (UInt) state.range(1);
+  const bool learn = state.range(2) != 0;
+
+  Cells4 cells(numColumns, cellsPerColumn, 12, 8, 15, 5, .5, .8, 1.0, .1, .1,
+               0.0, false, SEED, true, false);
+
+  Random rng(SEED);
+  vector<vector<Real> > sequence(numPatterns, vector<Real>(numColumns, 0));
+  for (auto& input : sequence)
+    for (UInt column : randomIndices(rng, numColumns, numActiveColumns))
+      input[column] = 1;
+  vector<Real> output(numColumns * cellsPerColumn);
+
+  if (!learn)
+    for (UInt pass = 0; pass < 5; pass++)
+      for (auto& input : sequence)
+        cells.compute(input.data(), output.data(), true, true);
+
+  UInt i = 0;
+  while (state.keepRunning())
+  {
+    cells.compute(sequence[i++ % numPatterns].data(), output.data(),
+                  true, learn);
+    doNotOptimize(output);
+  }
+  state.setItemsProcessed(state.iterations());
+}
+NTA_BENCHMARK(BM_Cells4Compute)
+  ->argNames({"columns", "cells", "learn"})
+  ->args({2048, 32, 1})
+  ->args({2048, 32, 0});
+
+// Random active and predicted column SDRs for the anomaly benchmarks
+static void anomalyInputs(UInt numStreams, vector<vector<UInt> >& active,
+                          vector<vector<UInt> >& predicted)
+{
+  Random rng(SEED);
+  for (UInt i = 0; i < numStreams; i++)
+  {
+    active.push_back(randomIndices(rng, 2048, numActiveColumns));
+    predicted.push_back(randomIndices(rng, 2048, numActiveColumns));
+  }
+}
+
+/**
+ * One Anomaly per stream, the existing path.
+ * Arguments: number of streams.
+ */
+static void BM_AnomalyCompute(State& state)
+{
+  const UInt numStreams = (UInt) state.range(0);
+  vector<vector<UInt> > active, predicted;
+  anomalyInputs(numStreams, active, predicted);
+  vector<Anomaly> anomalies;
+  for (UInt i = 0; i < numStreams; i++)
+    anomalies.emplace_back(10);
+
+  while (state.keepRunning())
+  {
+    for (UInt i = 0; i < numStreams; i++)
+    {
+      Real32 score = anomalies[i].compute(active[i], predicted[i]);
+      doNotOptimize(score);
+    }
+  }
+  state.setItemsProcessed(state.iterations() * numStreams);
+}
+NTA_BENCHMARK(BM_AnomalyCompute)
+  ->argNames({"streams"})
+  ->arg(1000);
+
+/**
+ * All streams scored by one MultiStreamAnomaly.
+ * Arguments: number of streams.
+ */
+static void BM_MultiStreamAnomalyCompute(State& state)
+{
+  const UInt numStreams = (UInt) state.range(0);
+  vector<vector<UInt> > active, predicted;
+  anomalyInputs(numStreams, active, predicted);
+
+  vector<UInt> activeFlat, predictedFlat;
+  vector<UInt> activeOffsets = {0}, predictedOffsets = {0};
+  for (UInt i = 0; i < numStreams; i++)
+  {
+    activeFlat.insert(activeFlat.end(), active[i].begin(), active[i].end());
+    activeOffsets.push_back(activeFlat.size());
+    predictedFlat.insert(predictedFlat.end(),
+                         predicted[i].begin(), predicted[i].end());
+    predictedOffsets.push_back(predictedFlat.size());
+  }
+
+  MultiStreamAnomaly anomaly(numStreams, 10);
+  vector<Real32> scores(numStreams);
+  while (state.keepRunning())
+  {
+    anomaly.compute(activeFlat.data(), activeOffsets.data(),
+                    predictedFlat.data(), predictedOffsets.data(),
+                    nullptr, scores.data());
+    doNotOptimize(scores);
+  }
+  state.setItemsProcessed(state.iterations() * numStreams);
+}
+NTA_BENCHMARK(BM_MultiStreamAnomalyCompute)
+  ->argNames({"streams"})
+  ->arg(1000);
@@ -0,0 +1,413 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Implementation of the microbenchmark harness
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include <nupic/os/FStream.hpp>
+#include <nupic/os/Regex.hpp>
+#include <nupic/utils/Log.hpp>
+
+#include "Benchmark.hpp"
+
+namespace nupic
+{
+  namespace benchmark
+  {
+
+    State::State(UInt64 maxIterations, const std::vector<Int64>& ranges) :
+      iterations_(0),
+      maxIterations_(maxIterations),
+      ranges_(ranges),
+      running_(false),
+      cpuStart_(0),
+      realTime_(0.0),
+      cpuTime_(0.0),
+      itemsProcessed_(0),
+      bytesProcessed_(0)
+    {
+    }
+
+    void State::pauseTiming()
+    {
+      if (!running_)
+        return;
+
+      realTime_ += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - realStart_).count();
+      cpuTime_ += double(std::clock() - cpuStart_) / CLOCKS_PER_SEC;
+      running_ = false;
+    }
+
+    void State::resumeTiming()
+    {
+      if (running_)
+        return;
+
+      running_ = true;
+      cpuStart_ = std::clock();
+      realStart_ = std::chrono::steady_clock::now();
+    }
+
+    Int64 State::range(size_t i) const
+    {
+      NTA_CHECK(i < ranges_.size())
+        << "Benchmark has no argument " << i;
+      return ranges_[i];
+    }
+
+    void State::setItemsProcessed(Int64 items)
+    {
+      itemsProcessed_ = items;
+    }
+
+    void State::setBytesProcessed(Int64 bytes)
+    {
+      bytesProcessed_ = bytes;
+    }
+
+    void State::setLabel(const std::string& label)
+    {
+      label_ = label;
+    }
+
+
+    Benchmark::Benchmark(const std::string& name, BenchmarkFunction function) :
+      name_(name),
+      function_(function)
+    {
+    }
+
+    Benchmark* Benchmark::arg(Int64 a)
+    {
+      args_.push_back(std::vector<Int64>(1, a));
+      return this;
+    }
+
+    Benchmark* Benchmark::args(const std::vector<Int64>& a)
+    {
+      args_.push_back(a);
+      return this;
+    }
+
+    Benchmark* Benchmark::argNames(const std::vector<std::string>& names)
+    {
+      argNames_ = names;
+      return this;
+    }
+
+
+    std::vector<UInt> randomIndices(Random& rng, UInt n, UInt k)
+    {
+      std::vector<UInt> population(n);
+      for (UInt i = 0; i < n; i++)
+        population[i] = i;
+      std::vector<UInt> indices(k);
+      rng.sample(population.data(), n, indices.data(), k);
+      return indices;
+    }
+
+
+    static std::vector<std::unique_ptr<Benchmark> >& registry()
+    {
+      static std::vector<std::unique_ptr<Benchmark> > benchmarks;
+      return benchmarks;
+    }
+
+    Benchmark* registerBenchmark(const std::string& name,
+                                 BenchmarkFunction function)
+    {
+      registry().emplace_back(new Benchmark(name, function));
+      return registry().back().get();
+    }
+
+
+    struct Result
+    {
+      std::string name;
+      UInt64 iterations;
+      double realTime;  // seconds, total
+      double cpuTime;   // seconds, total
+      Int64 itemsProcessed;
+      Int64 bytesProcessed;
+      std::string label;
+    };
+
+    class Runner
+    {
+    public:
+      Runner() :
+        minTime_(0.5),
+        format_("console"),
+        list_(false)
+      {
+      }
+
+      void parse(int argc, const char* argv[])
+      {
+        for (int i = 1; i < argc; i++)
+        {
+          std::string arg = argv[i];
+          std::string value;
+          if (flag_(arg, "--benchmark_filter", value))
+            filter_ = value;
+          else if (flag_(arg, "--benchmark_format", value))
+            format_ = value;
+          else if (flag_(arg, "--benchmark_out", value))
+            out_ = value;
+          else if (flag_(arg, "--benchmark_min_time", value))
+            minTime_ = std::atof(value.c_str());
+          else if (arg == "--benchmark_list_tests")
+            list_ = true;
+          else
+            NTA_THROW << "Unknown argument " << arg;
+        }
+        NTA_CHECK(format_ == "console" || format_ == "json")
+          << "Invalid --benchmark_format " << format_;
+      }
+
+      int run()
+      {
+        std::vector<Result> results;
+        bool console = (format_ == "console");
+        if (console && !list_)
+          printConsoleHeader_();
+
+        for (const auto& benchmark : registry())
+        {
+          std::vector<std::vector<Int64> > args = benchmark->args_;
+          if (args.empty())
+            args.push_back(std::vector<Int64>());
+
+          for (const auto& a : args)
+          {
+            std::string name = instanceName_(*benchmark, a);
+            if (!filter_.empty() &&
+                !regex::match(".*(" + filter_ + ").*", name))
+              continue;
+
+            if (list_)
+            {
+              std::cout << name << std::endl;
+              continue;
+            }
+
+            Result result = runInstance_(*benchmark, name, a);
+            if (console)
+              printConsoleResult_(result);
+            results.push_back(result);
+          }
+        }
+
+        if (list_)
+          return 0;
+
+        if (!console)
+          writeJSON_(std::cout, results);
+
+        if (!out_.empty())
+        {
+          OFStream f(out_.c_str());
+          writeJSON_(f, results);
+          f.close();
+          NTA_CHECK(!f.fail()) << "Unable to write " << out_;
+        }
+        return 0;
+      }
+
+    private:
+      static bool flag_(const std::string& arg, const std::string& name,
+                        std::string& value)
+      {
+        if (arg.compare(0, name.size() + 1, name + "=") != 0)
+          return false;
+        value = arg.substr(name.size() + 1);
+        return true;
+      }
+
+      static std::string instanceName_(const Benchmark& benchmark,
+                                       const std::vector<Int64>& args)
+      {
+        std::stringstream name;
+        name << benchmark.name_;
+        for (size_t i = 0; i < args.size(); i++)
+        {
+          name << "/";
+          if (i < benchmark.argNames_.size())
+            name << benchmark.argNames_[i] << ":";
+          name << args[i];
+        }
+        return name.str();
+      }
+
+      // Grow the iteration count until the timed loop runs for minTime_
+      Result runInstance_(const Benchmark& benchmark, const std::string& name,
+                          const std::vector<Int64>& args) const
+      {
+        const UInt64 maxIterations = 1000000000;
+        UInt64 iterations = 1;
+        while (true)
+        {
+          State state(iterations, args);
+          benchmark.function_(state);
+          NTA_CHECK(state.iterations_ == iterations && !state.running_)
+            << name << " did not run its keepRunning() loop to completion";
+
+          if (state.realTime_ >= minTime_ || iterations >= maxIterations)
+          {
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.realTime = state.realTime_;
+            result.cpuTime = state.cpuTime_;
+            result.itemsProcessed = state.itemsProcessed_;
+            result.bytesProcessed = state.bytesProcessed_;
+            result.label = state.label_;
+            return result;
+          }
+
+          double multiplier = 10.0;
+          if (state.realTime_ > 0.0)
+            multiplier = std::min(10.0, 1.4 * minTime_ / state.realTime_);
+          iterations = std::min(maxIterations,
+                                std::max(iterations + 1,
+                                         UInt64(iterations * multiplier)));
+        }
+      }
+
+      static void printConsoleHeader_()
+      {
+        std::cout << std::left << std::setw(72) << "Benchmark"
+                  << std::right << std::setw(15) << "Time"
+                  << std::setw(15) << "CPU"
+                  << std::setw(12) << "Iterations" << std::endl;
+        std::cout << std::string(114, '-') << std::endl;
+      }
+
+      static void printConsoleResult_(const Result& r)
+      {
+        std::stringstream realTime, cpuTime;
+        realTime << std::fixed << std::setprecision(0)
+                 << r.realTime * 1e9 / r.iterations << " ns";
+        cpuTime << std::fixed << std::setprecision(0)
+                << r.cpuTime * 1e9 / r.iterations << " ns";
+
+        std::cout << std::left << std::setw(72) << r.name
+                  << std::right << std::setw(15) << realTime.str()
+                  << std::setw(15) << cpuTime.str()
+                  << std::setw(12) << r.iterations;
+        if (r.itemsProcessed > 0 && r.realTime > 0.0)
+          std::cout << "  " << std::setprecision(4)
+                    << r.itemsProcessed / r.realTime << " items/s";
+        if (r.bytesProcessed > 0 && r.realTime > 0.0)
+          std::cout << "  " << std::setprecision(4)
+                    << r.bytesProcessed / r.realTime / (1 << 20) << " MB/s";
+        if (!r.label.empty())
+          std::cout << "  " << r.label;
+        std::cout << std::endl;
+      }
+
+      static std::string jsonEscape_(const std::string& s)
+      {
+        std::string escaped;
+        for (char c : s)
+        {
+          if (c == '"' || c == '\\')
+            escaped += '\\';
+          escaped += c;
+        }
+        return escaped;
+      }
+
+      static void writeJSON_(std::ostream& out,
+                             const std::vector<Result>& results)
+      {
+        char date[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S",
+                      std::localtime(&now));
+
+        out << "{\n";
+        out << "  \"context\": {\n";
+        out << "    \"date\": \"" << date << "\",\n";
+        out << "    \"num_cpus\": " << std::thread::hardware_concurrency()
+            << ",\n";
+#ifdef NDEBUG
+        out << "    \"library_build_type\": \"release\"\n";
+#else
+        out << "    \"library_build_type\": \"debug\"\n";
+#endif
+        out << "  },\n";
+        out << "  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+          const Result& r = results[i];
+          out << (i == 0 ? "\n" : ",\n");
+          out << "    {\n";
+          out << "      \"name\": \"" << jsonEscape_(r.name) << "\",\n";
+          out << "      \"iterations\": " << r.iterations << ",\n";
+          out << std::setprecision(10);
+          out << "      \"real_time\": " << r.realTime * 1e9 / r.iterations
+              << ",\n";
+          out << "      \"cpu_time\": " << r.cpuTime * 1e9 / r.iterations
+              << ",\n";
+          if (r.itemsProcessed > 0 && r.realTime > 0.0)
+            out << "      \"items_per_second\": "
+                << r.itemsProcessed / r.realTime << ",\n";
+          if (r.bytesProcessed > 0 && r.realTime > 0.0)
+            out << "      \"bytes_per_second\": "
+                << r.bytesProcessed / r.realTime << ",\n";
+          if (!r.label.empty())
+            out << "      \"label\": \"" << jsonEscape_(r.label) << "\",\n";
+          out << "      \"time_unit\": \"ns\"\n";
+          out << "    }";
+        }
+        out << "\n  ]\n";
+        out << "}\n";
+      }
+
+      double minTime_;
+      std::string filter_;
+      std::string format_;
+      std::string out_;
+      bool list_;
+    };
+
+    int runBenchmarks(int argc, const char* argv[])
+    {
+      Runner runner;
+      runner.parse(argc, argv);
+      return runner.run();
+    }
+
+  } // end namespace benchmark
+} // end namespace nupic
@@ -0,0 +1,190 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Minimal microbenchmark harness for the nupic.core benchmarks executable
+ *
+ * The API and the JSON output follow Google Benchmark closely, so results
+ * can be compared between builds with Google Benchmark's tools/compare.py:
+ *
+ *   static void BM_Example(benchmark::State& state)
+ *   {
+ *     std::vector<UInt> v(state.range(0));
+ *     while (state.keepRunning())
+ *       std::sort(v.begin(), v.end());
+ *     state.setItemsProcessed(state.iterations() * v.size());
+ *   }
+ *   NTA_BENCHMARK(BM_Example)->arg(1024)->arg(65536);
+ *
+ * Command line flags:
+ *
+ *   --benchmark_filter=<regex>     Run the benchmarks whose name matches
+ *   --benchmark_format=console|json
+ *   --benchmark_out=<file>         Also write JSON results to <file>
+ *   --benchmark_min_time=<seconds> Minimum timed duration of each benchmark
+ *   --benchmark_list_tests         Print the benchmark names and exit
+ */
+
+#ifndef NTA_BENCHMARK_HPP
+#define NTA_BENCHMARK_HPP
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <nupic/types/Types.hpp>
+#include <nupic/utils/Random.hpp>
+
+namespace nupic
+{
+  namespace benchmark
+  {
+
+    /**
+     * Timing state of one benchmark run, passed to the benchmark function.
+     */
+    class State
+    {
+    public:
+      State(UInt64 maxIterations, const std::vector<Int64>& ranges);
+
+      /**
+       * Loop condition of the timed loop. Starts the timer on the first call
+       * and stops it after the last iteration.
+       */
+      bool keepRunning()
+      {
+        if (iterations_ < maxIterations_)
+        {
+          if (iterations_++ == 0)
+            resumeTiming();
+          return true;
+        }
+        pauseTiming();
+        return false;
+      }
+
+      // Exclude setup work inside the timed loop
+      void pauseTiming();
+      void resumeTiming();
+
+      // The i-th argument of this benchmark instance
+      Int64 range(size_t i = 0) const;
+
+      UInt64 iterations() const
+      {
+        return maxIterations_;
+      }
+
+      void setItemsProcessed(Int64 items);
+      void setBytesProcessed(Int64 bytes);
+      void setLabel(const std::string& label);
+
+    private:
+      friend class Runner;
+
+      UInt64 iterations_;
+      UInt64 maxIterations_;
+      std::vector<Int64> ranges_;
+      bool running_;
+      std::chrono::steady_clock::time_point realStart_;
+      std::clock_t cpuStart_;
+      double realTime_;
+      double cpuTime_;
+      Int64 itemsProcessed_;
+      Int64 bytesProcessed_;
+      std::string label_;
+    };
+
+    typedef void (*BenchmarkFunction)(State&);
+
+    /**
+     * A registered benchmark and the argument lists it runs with.
+     */
+    class Benchmark
+    {
+    public:
+      Benchmark(const std::string& name, BenchmarkFunction function);
+
+      // Add an instance with a single argument
+      Benchmark* arg(Int64 a);
+
+      // Add an instance with several arguments
+      Benchmark* args(const std::vector<Int64>& a);
+
+      // Names of the arguments, used in the instance name, e.g. "cols:2048"
+      Benchmark* argNames(const std::vector<std::string>& names);
+
+    private:
+      friend class Runner;
+
+      std::string name_;
+      BenchmarkFunction function_;
+      std::vector<std::vector<Int64> > args_;
+      std::vector<std::string> argNames_;
+    };
+
+    /**
+     * Register a benchmark. The returned pointer is owned by the registry.
+     */
+    Benchmark* registerBenchmark(const std::string& name,
+                                 BenchmarkFunction function);
+
+    /**
+     * Run the registered benchmarks selected by the command line.
+     *
+     * @returns The process exit code
+     */
+    int runBenchmarks(int argc, const char* argv[]);
+
+    /**
+     * @returns @a k distinct random indices in [0, n), sorted. Shared input
+     * generator for the benchmarks.
+     */
+    std::vector<UInt> randomIndices(Random& rng, UInt n, UInt k);
+
+    /**
+     * Keep the compiler from optimizing away a computed value.
+     */
+    template <typename T>
+    inline void doNotOptimize(const T& value)
+    {
+#if defined(NTA_COMPILER_MSVC)
+      static volatile const void* sink;
+      sink = &value;
+#else
+      asm volatile("" : : "g"(&value) : "memory");
+#endif
+    }
+
+  } // end namespace benchmark
+} // end namespace nupic
+
+#define NTA_BENCHMARK_CONCAT_(a, b) a##b
+#define NTA_BENCHMARK_NAME_(line) NTA_BENCHMARK_CONCAT_(benchmark_, line)
+
+#define NTA_BENCHMARK(function)                                          \
+  static nupic::benchmark::Benchmark* NTA_BENCHMARK_NAME_(__LINE__) =    \
+    nupic::benchmark::registerBenchmark(#function, function)
+
+#endif // NTA_BENCHMARK_HPP
@@ -0,0 +1,54 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Benchmarks main program
+ */
+
+#include <exception>
+#include <iostream>
+
+#include <apr-1/apr_general.h>
+
+#include "Benchmark.hpp"
+
+int main(int argc, const char* argv[])
+{
+  // APR must be explicitly initialized
+  apr_status_t result = apr_app_initialize(&argc, (char const *const **)&argv,
+                                           nullptr /*env*/);
+  if (result)
+  {
+    std::cerr << "error initializing APR. Err code: " << result << std::endl;
+    return 1;
+  }
+
+  try
+  {
+    return nupic::benchmark::runBenchmarks(argc, argv);
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
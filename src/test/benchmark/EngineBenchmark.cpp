@@ -0,0 +1,238 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Benchmarks of the Network engine
+ */
+
+#include <nupic/engine/Input.hpp>
+#include <nupic/engine/Network.hpp>
+#include <nupic/engine/NetworkFactory.hpp>
+#include <nupic/engine/Output.hpp>
+#include <nupic/engine/Region.hpp>
+#include <nupic/ntypes/Array.hpp>
+#include <nupic/ntypes/ArrayRef.hpp>
+#include <nupic/ntypes/Dimensions.hpp>
+#include <nupic/os/Path.hpp>
+#include <nupic/types/BasicType.hpp>
+
+#include <sstream>
+#include <yaml-cpp/yaml.h>
+
+#include "Benchmark.hpp"
+
+using namespace nupic;
+using namespace nupic::benchmark;
+
+/**
+ * Link::compute copies, driven through Input::prepare of a TestNode region
+ * fed by a size x size TestNode region.
+ * Arguments: size.
+ */
+static void BM_LinkCompute(State& state)
+{
+  const size_t size = (size_t) state.range(0);
+
+  Network net;
+  Region* level1 = net.addRegion("level1", "TestNode", "");
+  Dimensions d;
+  d.push_back(size);
+  d.push_back(size);
+  level1->setDimensions(d);
+  net.addRegion("level2", "TestNode", "");
+  net.link("level1", "level2", "TestFanIn2", "");
+  net.initialize();
+
+  Input* input = net.getRegions().getByName("level2")->getInput("bottomUpIn");
+  const Array& src = level1->getOutput("bottomUpOut")->getData();
+  const size_t bytes = src.getCount() * BasicType::getSize(src.getType());
+
+  while (state.keepRunning())
+    input->prepare();
+
+  state.setBytesProcessed(state.iterations() * bytes);
+}
+NTA_BENCHMARK(BM_LinkCompute)
+  ->argNames({"size"})
+  ->arg(16)
+  ->arg(256)
+  ->arg(1024);
+
+/**
+ * Network::run of a TestNode region fed by a size x size TestNode region:
+ * the per-iteration overhead of the engine on top of the two computes.
+ * Arguments: size.
+ */
+static void BM_NetworkRun(State& state)
+{
+  const size_t size = (size_t) state.range(0);
+
+  Network net;
+  Region* level1 = net.addRegion("level1", "TestNode", "");
+  Dimensions d;
+  d.push_back(size);
+  d.push_back(size);
+  level1->setDimensions(d);
+  net.addRegion("level2", "TestNode", "");
+  net.link("level1", "level2", "TestFanIn2", "");
+  net.initialize();
+
+  while (state.keepRunning())
+    net.run(1);
+
+  state.setItemsProcessed(state.iterations());
+}
+NTA_BENCHMARK(BM_NetworkRun)
+  ->argNames({"size"})
+  ->arg(2)
+  ->arg(16);
+
+/**
+ * A yaml network description of a chain of TestNode regions.
+ */
+static std::string chainYAML(size_t regions)
+{
+  std::stringstream s;
+  s << "Regions:\n";
+  for (size_t i = 0; i < regions; i++)
+    s << "    - name: \"level " << i << "\"\n"
+      << "      nodeType: \"TestNode\"\n"
+      << "      nodeParams: \"{int32Param: " << i
+      << ", real32ArrayParam: [1, 2, 3, 4], boolParam: true}\"\n";
+  s << "Links:\n";
+  for (size_t i = 1; i < regions; i++)
+    s << "    - srcRegion: \"level " << i - 1 << "\"\n"
+      << "      destRegion: \"level " << i << "\"\n"
+      << "      type: \"TestFanIn2\"\n"
+      << "      params: \"\"\n"
+      << "      srcOutput: \"bottomUpOut\"\n"
+      << "      destInput: \"bottomUpIn\"\n";
+  return s.str();
+}
+
+/**
+ * NetworkFactory::createNetworkFromYAML of a chain of TestNode regions:
+ * parses the yaml and creates the network every time.
+ * Arguments: regions.
+ */
+static void BM_NetworkCreateFromYAML(State& state)
+{
+  const std::string yaml = chainYAML((size_t) state.range(0));
+  NetworkFactory factory;
+
+  while (state.keepRunning())
+  {
+    std::stringstream s(yaml);
+    YAML::Parser parser(s);
+    Network net = factory.createNetworkFromYAML(parser);
+    doNotOptimize(net.getRegions().getCount());
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+NTA_BENCHMARK(BM_NetworkCreateFromYAML)
+  ->argNames({"regions"})
+  ->arg(3)
+  ->arg(20);
+
+/**
+ * NetworkFactory::createNetwork of a parsed description of a chain of
+ * TestNode regions, with new parameters for the first region each time
+ * when deltas is 1.
+ * Arguments: regions, deltas.
+ */
+static void BM_NetworkCreateFromDescription(State& state)
+{
+  std::stringstream s(chainYAML((size_t) state.range(0)));
+  YAML::Parser parser(s);
+  NetworkFactory factory;
+  const NetworkDescription description = factory.parseYAML(parser);
+  std::map<std::string, std::string> deltas;
+  Int64 iteration = 0;
+
+  while (state.keepRunning())
+  {
+    if (state.range(1))
+    {
+      std::stringstream delta;
+      delta << "{int32Param: " << iteration++ << "}";
+      deltas["level 0"] = delta.str();
+    }
+    Network net = factory.createNetwork(description, deltas);
+    doNotOptimize(net.getRegions().getCount());
+  }
+
+  state.setItemsProcessed(state.iterations());
+}
+NTA_BENCHMARK(BM_NetworkCreateFromDescription)
+  ->argNames({"regions", "deltas"})
+  ->args({3, 0})
+  ->args({3, 1})
+  ->args({20, 0})
+  ->args({20, 1});
+
+/**
+ * VectorFileEffector::compute of a 2048 element input with 40 nonzero
+ * elements, written as text, binary or sparse records. The file is
+ * flushed when the benchmark ends, so buffered writes are included.
+ * Arguments: format (0 text, 1 binary, 2 sparse).
+ */
+static void BM_VectorFileEffectorCompute(State& state)
+{
+  const char* formats[] = {"text", "binary", "sparse"};
+  const std::string format = formats[state.range(0)];
+  const std::string fileName = "VectorFileEffectorBenchmark.out";
+  const UInt size = 2048;
+  if (Path::exists(fileName))
+    Path::remove(fileName);
+
+  Network net;
+  std::stringstream params;
+  params << "{activeOutputCount: " << size << "}";
+  Region* sensor = net.addRegion("sensor", "VectorFileSensor", params.str());
+  Dimensions d;
+  d.push_back(1);
+  sensor->setDimensions(d);
+  Region* effector = net.addRegion("effector", "VectorFileEffector",
+                                   "{outputFormat: " + format + "}");
+  net.link("sensor", "effector", "UniformLink", "");
+  net.initialize();
+  effector->setParameterString("outputFile", fileName);
+
+  Random rng(42);
+  Real32* input = (Real32*) effector->getInputData("dataIn").getBuffer();
+  for (UInt i : randomIndices(rng, size, 40))
+    input[i] = 1;
+
+  while (state.keepRunning())
+    effector->compute();
+  effector->executeCommand({"flushFile"});
+
+  state.setItemsProcessed(state.iterations());
+  effector->executeCommand({"closeFile"});
+  Path::remove(fileName);
+}
+NTA_BENCHMARK(BM_VectorFileEffectorCompute)
+  ->argNames({"format"})
+  ->arg(0)
+  ->arg(1)
+  ->arg(2);
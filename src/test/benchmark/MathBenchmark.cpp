@@ -0,0 +1,409 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Benchmarks of the SparseMatrix and SparseBinaryMatrix products, of
+ * NearestNeighbor queries, and of the SparseTensor storages
+ */
+
+#include <vector>
+
+#include <nupic/math/Convolution.hpp>
+#include <nupic/math/Index.hpp>
+#include <nupic/math/NearestNeighbor.hpp>
+#include <nupic/math/SparseBinaryMatrix.hpp>
+#include <nupic/math/SparseMatrix.hpp>
+#include <nupic/math/SparseTensor.hpp>
+#include <nupic/utils/Random.hpp>
+
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace nupic;
+using namespace nupic::benchmark;
+
+#define SEED 42
+
+typedef SparseMatrix<UInt32, Real32, Int32, Real64> SM;
+typedef SparseBinaryMatrix<UInt32, UInt32> SBM;
+
+// Random matrix with density/1000 of its entries set
+static SM randomSparseMatrix(UInt nrows, UInt ncols, UInt density)
+{
+  Random rng(SEED);
+  SM sm(0, ncols);
+  const UInt nnzr = ncols * density / 1000;
+  vector<Real32> values(nnzr);
+  for (UInt i = 0; i < nrows; i++)
+  {
+    vector<UInt> ind = randomIndices(rng, ncols, nnzr);
+    for (auto& v : values)
+      v = (Real32) rng.getReal64() + 0.01f;
+    sm.addRow(ind.begin(), ind.end(), values.begin());
+  }
+  return sm;
+}
+
+static SBM randomSparseBinaryMatrix(UInt nrows, UInt ncols, UInt density)
+{
+  Random rng(SEED);
+  SBM sbm(ncols);
+  const UInt nnzr = ncols * density / 1000;
+  for (UInt i = 0; i < nrows; i++)
+  {
+    vector<UInt> ind = randomIndices(rng, ncols, nnzr);
+    sbm.appendSparseRow(ind.begin(), ind.end());
+  }
+  return sbm;
+}
+
+static vector<Real32> randomBinaryVector(UInt n)
+{
+  Random rng(SEED + 1);
+  vector<Real32> x(n, 0);
+  for (UInt i : randomIndices(rng, n, n / 50))
+    x[i] = 1;
+  return x;
+}
+
+/**
+ * Arguments: rows, columns, density in per mille.
+ */
+static void BM_SparseMatrixRightVecProd(State& state)
+{
+  SM sm = randomSparseMatrix((UInt) state.range(0), (UInt) state.range(1),
+                             (UInt) state.range(2));
+  vector<Real32> x(sm.nCols());
+  Random rng(SEED + 1);
+  for (auto& v : x)
+    v = (Real32) rng.getReal64();
+  vector<Real32> y(sm.nRows());
+
+  while (state.keepRunning())
+  {
+    sm.rightVecProd(x.begin(), y.begin());
+    doNotOptimize(y);
+  }
+  state.setItemsProcessed(state.iterations() * sm.nNonZeros());
+}
+NTA_BENCHMARK(BM_SparseMatrixRightVecProd)
+  ->argNames({"rows", "cols", "density"})
+  ->args({2048, 2048, 10})
+  ->args({2048, 16384, 50})
+  ->args({16384, 2048, 500});
+
+static void BM_SparseMatrixRightVecSumAtNZ(State& state)
+{
+  SM sm = randomSparseMatrix((UInt) state.range(0), (UInt) state.range(1),
+                             (UInt) state.range(2));
+  vector<Real32> x = randomBinaryVector(sm.nCols());
+  vector<Real32> y(sm.nRows());
+
+  while (state.keepRunning())
+  {
+    sm.rightVecSumAtNZ(x.begin(), y.begin());
+    doNotOptimize(y);
+  }
+  state.setItemsProcessed(state.iterations() * sm.nNonZeros());
+}
+NTA_BENCHMARK(BM_SparseMatrixRightVecSumAtNZ)
+  ->argNames({"rows", "cols", "density"})
+  ->args({2048, 2048, 10})
+  ->args({2048, 16384, 50})
+  ->args({16384, 2048, 500});
+
+static void BM_SparseMatrixLeftVecSumAtNZ(State& state)
+{
+  SM sm = randomSparseMatrix((UInt) state.range(0), (UInt) state.range(1),
+                             (UInt) state.range(2));
+  vector<Real32> x = randomBinaryVector(sm.nRows());
+  vector<Real32> y(sm.nCols());
+
+  while (state.keepRunning())
+  {
+    sm.leftVecSumAtNZ(x.begin(), y.begin());
+    doNotOptimize(y);
+  }
+  state.setItemsProcessed(state.iterations() * sm.nNonZeros());
+}
+NTA_BENCHMARK(BM_SparseMatrixLeftVecSumAtNZ)
+  ->argNames({"rows", "cols", "density"})
+  ->args({2048, 2048, 10})
+  ->args({16384, 2048, 500});
+
+static void BM_SparseBinaryMatrixRightVecSumAtNZ(State& state)
+{
+  SBM sbm = randomSparseBinaryMatrix((UInt) state.range(0),
+                                     (UInt) state.range(1),
+                                     (UInt) state.range(2));
+  vector<Real32> x = randomBinaryVector(sbm.nCols());
+  vector<Real32> y(sbm.nRows());
+
+  while (state.keepRunning())
+  {
+    sbm.rightVecSumAtNZ(x.begin(), x.end(), y.begin(), y.end());
+    doNotOptimize(y);
+  }
+  state.setItemsProcessed(state.iterations() * sbm.nNonZeros());
+}
+NTA_BENCHMARK(BM_SparseBinaryMatrixRightVecSumAtNZ)
+  ->argNames({"rows", "cols", "density"})
+  ->args({2048, 2048, 10})
+  ->args({2048, 16384, 50})
+  ->args({16384, 2048, 500});
+
+/**
+ * Row-parallel SparseMatrix kernels on a 10k x 100k matrix with 100 non-zeros
+ * per row. The matrix is built once and shared by all the thread counts.
+ * Arguments: threads, kernel (0: rightVecProd, 1: rightVecSumAtNZ,
+ * 2: rowMax, 3: normalizeRows).
+ */
+static void BM_SparseMatrixThreads(State& state)
+{
+  static SM sm;
+  if (sm.nRows() == 0)
+  {
+    const UInt nrows = 10000, ncols = 100000, nnzr = 100;
+    Random rng(SEED);
+    sm.resize(nrows, ncols);
+    for (UInt row = 0; row < nrows; row++)
+      for (UInt k = 0; k < nnzr; k++)
+        sm.set(row, rng.getUInt32(ncols), (Real32) rng.getReal64() + 0.01f);
+  }
+
+  const UInt nThreads = (UInt) state.range(0);
+  const int kernel = (int) state.range(1);
+  SM m(sm);
+  vector<Real32> x = randomBinaryVector(m.nCols()), y(m.nRows());
+  vector<UInt> indices(m.nRows());
+
+  while (state.keepRunning())
+  {
+    switch (kernel) {
+    case 0: m.rightVecProd(x.begin(), y.begin(), nThreads); break;
+    case 1: m.rightVecSumAtNZ(x.begin(), y.begin(), nThreads); break;
+    case 2: m.rowMax(indices.begin(), y.begin(), nThreads); break;
+    case 3: m.normalizeRows(1.0, false, nThreads); break;
+    }
+    doNotOptimize(y);
+  }
+  state.setItemsProcessed(state.iterations() * m.nNonZeros());
+}
+NTA_BENCHMARK(BM_SparseMatrixThreads)
+  ->argNames({"threads", "kernel"})
+  ->args({1, 0})
+  ->args({2, 0})
+  ->args({4, 0})
+  ->args({8, 0})
+  ->args({1, 1})
+  ->args({2, 1})
+  ->args({4, 1})
+  ->args({8, 1})
+  ->args({1, 2})
+  ->args({2, 2})
+  ->args({4, 2})
+  ->args({8, 2})
+  ->args({1, 3})
+  ->args({2, 3})
+  ->args({4, 3})
+  ->args({8, 3});
+
+/**
+ * L0 k-nearest queries of binary prototypes: one L0Nearest call per query,
+ * LpNearestBatch, or L0NearestIndexed.
+ * Arguments: prototypes, mode (0: per query, 1: batch, 2: indexed).
+ */
+static void BM_NearestNeighborL0(State& state)
+{
+  typedef NearestNeighbor<SM> NN;
+  const UInt nrows = (UInt) state.range(0), ncols = 2048, k = 10, nx = 64;
+  const int mode = (int) state.range(1);
+
+  NN nn(0, ncols);
+  Random rng(SEED);
+  vector<Real32> ones(ncols / 50, 1);
+  for (UInt i = 0; i < nrows; i++)
+  {
+    vector<UInt> ind = randomIndices(rng, ncols, ncols / 50);
+    nn.addRow(ind.begin(), ind.end(), ones.begin());
+  }
+  if (mode == 2)
+    nn.buildInvertedIndex();
+
+  vector<Real32> dense(nx * ncols, 0);
+  vector<UInt> offsets = {0}, indices;
+  for (UInt q = 0; q < nx; q++)
+  {
+    for (UInt j : randomIndices(rng, ncols, ncols / 50))
+    {
+      dense[q * ncols + j] = 1;
+      indices.push_back(j);
+    }
+    offsets.push_back(indices.size());
+  }
+  vector<NN::neighbor_type> out(nx * k);
+
+  while (state.keepRunning())
+  {
+    if (mode == 0)
+      for (UInt q = 0; q < nx; q++)
+        nn.L0Nearest(dense.begin() + q * ncols, out.begin() + q * k, k);
+    else if (mode == 1)
+      nn.LpNearestBatch(0, nx, dense.begin(), out.begin(), k);
+    else
+      nn.L0NearestIndexed(nx, offsets.begin(), indices.begin(), out.begin(), k);
+    doNotOptimize(out);
+  }
+  state.setItemsProcessed(state.iterations() * nx);
+}
+NTA_BENCHMARK(BM_NearestNeighborL0)
+  ->argNames({"prototypes", "mode"})
+  ->args({20000, 0})
+  ->args({20000, 1})
+  ->args({20000, 2});
+
+// One SparseTensor operation, on a 64 x 64 x 64 tensor with 1% non-zeros
+template <template <typename, typename> class Storage>
+static void sparseTensorOp(State& state, int op)
+{
+  typedef Index<UInt32, 3> I3;
+  typedef Index<UInt32, 2> I2;
+  typedef Index<UInt32, 1> I1;
+  typedef SparseTensor<I3, Real32, Storage> ST3;
+  typedef SparseTensor<I2, Real32, Storage> ST2;
+  const UInt32 n = 64, nnz = n * n * n / 100;
+
+  Random rng(SEED);
+  vector<pair<I3, Real32> > values;
+  for (UInt32 i = 0; i < nnz; i++)
+    values.push_back(make_pair(I3(rng.getUInt32(n), rng.getUInt32(n),
+                                  rng.getUInt32(n)),
+                               (Real32) rng.getReal64() + 0.01f));
+  ST3 a(I3(n, n, n)), b(I3(n, n, n)), c(I3(n, n, n));
+  a.fromIdxVal(values.size(), values.begin());
+  for (auto& v : values)
+    v.first[2] = (v.first[2] + 1) % n;
+  b.fromIdxVal(values.size(), values.begin());
+  ST2 factor(I2(n, n)), marginal(I2(n, n));
+  b.marginalize(I1((UInt32) 1), factor);
+
+  while (state.keepRunning())
+  {
+    switch (op) {
+    case 0:
+      for (auto& v : values)
+        c.set(v.first, a.get(v.first) + 1);
+      break;
+    case 1:
+      a.marginalize(I1((UInt32) 1), marginal);
+      break;
+    case 2:
+      a.factor_apply_fast(I2(0, 2), factor, c, multiplies<Real32>());
+      break;
+    case 3:
+      c = a;
+      c.add(b);
+      break;
+    }
+    doNotOptimize(c);
+  }
+  state.setItemsProcessed(state.iterations() * nnz);
+}
+
+/**
+ * SparseTensor operations, as PySparseTensor calls them.
+ * Arguments: storage (0: std::map, 1: sorted array, 2: hash table),
+ * op (0: set/get, 1: marginalize, 2: factor multiply, 3: add).
+ */
+static void BM_SparseTensor(State& state)
+{
+  const int op = (int) state.range(1);
+  switch (state.range(0)) {
+  case 0: sparseTensorOp<SparseTensorMapStorage>(state, op); break;
+  case 1: sparseTensorOp<SparseTensorSortedStorage>(state, op); break;
+  default: sparseTensorOp<SparseTensorHashStorage>(state, op); break;
+  }
+}
+NTA_BENCHMARK(BM_SparseTensor)
+  ->argNames({"storage", "op"})
+  ->args({0, 0})
+  ->args({1, 0})
+  ->args({2, 0})
+  ->args({0, 1})
+  ->args({1, 1})
+  ->args({2, 1})
+  ->args({0, 2})
+  ->args({1, 2})
+  ->args({2, 2})
+  ->args({0, 3})
+  ->args({1, 3})
+  ->args({2, 3});
+
+/**
+ * 7x7 separable convolutions of a batch of 16 square images, one compute
+ * call per image or one computeBatch call on several threads.
+ * Arguments: image size, threads (0: one compute call per image).
+ */
+static void BM_SeparableConvolution2D(State& state)
+{
+  const size_t size = (size_t) state.range(0), nImages = 16;
+  const size_t nThreads = (size_t) state.range(1);
+  Random rng(SEED);
+
+  vector<Real32> f1(7), f2(7);
+  for (size_t k = 0; k < 7; k++) {
+    f1[k] = (Real32) rng.getReal64();
+    f2[k] = (Real32) rng.getReal64();
+  }
+  vector<vector<Real32> > images(nImages, vector<Real32>(size * size)),
+    convolved(nImages, vector<Real32>(size * size));
+  vector<const Real32*> data;
+  vector<Real32*> out;
+  for (size_t k = 0; k < nImages; k++) {
+    for (Real32& x : images[k])
+      x = (Real32) rng.getReal64();
+    data.push_back(images[k].data());
+    out.push_back(convolved[k].data());
+  }
+
+  SeparableConvolution2D<Real32> convolution;
+  convolution.init(size, size, 7, 7, f1.data(), f2.data());
+
+  while (state.keepRunning())
+  {
+    if (nThreads == 0)
+      for (size_t k = 0; k < nImages; k++)
+        convolution.compute(images[k].data(), out[k]);
+    else
+      convolution.computeBatch(nImages, data.data(), out.data(), nThreads);
+    doNotOptimize(convolved);
+  }
+  state.setItemsProcessed(state.iterations() * nImages * size * size);
+}
+NTA_BENCHMARK(BM_SeparableConvolution2D)
+  ->argNames({"size", "threads"})
+  ->args({64, 0})
+  ->args({512, 0})
+  ->args({2048, 0})
+  ->args({512, 1})
+  ->args({512, 4})
+  ->args({2048, 4});
@@ -152,3 +152,100 @@ TEST(Anomaly, SelectModePure)
   std::vector<UInt> predicted = {3, 5, 7};
   ASSERT_FLOAT_EQ(a.compute(active, predicted), 2.0 / 3.0);
 };
+
+
+TEST(ComputeRawAnomalyScore, Unsorted)
+{
+  // Unsorted input and duplicates take the general path
+  std::vector<UInt> active = {6, 2, 3, 3};
+  std::vector<UInt> predicted = {7, 3, 5};
+  ASSERT_FLOAT_EQ(computeRawAnomalyScore(active, predicted), 3.0 / 4.0);
+};
+
+
+TEST(ComputeRawAnomalyScore, SortedArrays)
+{
+  const UInt active[] = {2, 3, 6, 9};
+  const UInt predicted[] = {0, 3, 5, 6, 7};
+  ASSERT_FLOAT_EQ(computeRawAnomalyScore(active, 4, predicted, 5), 0.5);
+  ASSERT_FLOAT_EQ(computeRawAnomalyScore(active, 0, predicted, 5), 0.0);
+  ASSERT_FLOAT_EQ(computeRawAnomalyScore(active, 4, predicted, 0), 1.0);
+};
+
+
+TEST(MultiStreamAnomaly, MatchesAnomalyPerStream)
+{
+  // The streams of the Cumulative test, shifted by one step each
+  std::vector< std::vector<UInt> > acts = {
+    {1, 2, 6},
+    {1, 2, 6},
+    {1, 4, 6},
+    {6, 10, 11},
+    {10, 11, 12},
+    {10, 11, 12},
+    {10, 11, 12},
+    {1, 2, 6},
+    {1, 2, 6}
+  };
+  const std::vector<UInt> predicted = {1, 2, 6};
+  const UInt numStreams = 3;
+
+  MultiStreamAnomaly multi(numStreams, 3);
+  std::vector<Anomaly> single;
+  for (UInt stream = 0; stream < numStreams; stream++)
+    single.emplace_back(3);
+
+  for (size_t step = 0; step < acts.size(); step++)
+  {
+    std::vector<UInt> activeFlat, predictedFlat;
+    std::vector<UInt> activeOffsets = {0}, predictedOffsets = {0};
+    std::vector<Real32> expected;
+    for (UInt stream = 0; stream < numStreams; stream++)
+    {
+      const std::vector<UInt>& active = acts[(step + stream) % acts.size()];
+      activeFlat.insert(activeFlat.end(), active.begin(), active.end());
+      activeOffsets.push_back(activeFlat.size());
+      predictedFlat.insert(predictedFlat.end(),
+                           predicted.begin(), predicted.end());
+      predictedOffsets.push_back(predictedFlat.size());
+      expected.push_back(single[stream].compute(active, predicted));
+    }
+
+    std::vector<Real32> scores(numStreams);
+    multi.compute(activeFlat.data(), activeOffsets.data(),
+                  predictedFlat.data(), predictedOffsets.data(),
+                  nullptr, scores.data());
+    for (UInt stream = 0; stream < numStreams; stream++)
+    {
+      ASSERT_EQ(expected[stream], scores[stream])
+        << "step " << step << " stream " << stream;
+    }
+  }
+}
+
+
+TEST(MultiStreamAnomaly, WeightedAndBinary)
+{
+  const UInt active[] = {2, 3, 6, 1, 2};
+  const UInt activeOffsets[] = {0, 3, 5};
+  const UInt predicted[] = {3, 5, 7, 1, 2};
+  const UInt predictedOffsets[] = {0, 3, 5};
+  const Real32 likelihoods[] = {0.5, 0.25};
+  Real32 scores[2];
+
+  MultiStreamAnomaly weighted(2, 0, AnomalyMode::WEIGHTED);
+  weighted.compute(active, activeOffsets, predicted, predictedOffsets,
+                   likelihoods, scores);
+  ASSERT_FLOAT_EQ(scores[0], 2.0 / 3.0 * 0.5);
+  ASSERT_FLOAT_EQ(scores[1], 0.0);
+  ASSERT_ANY_THROW(weighted.compute(active, activeOffsets, predicted,
+                                    predictedOffsets, nullptr, scores));
+
+  MultiStreamAnomaly binary(2, 0, AnomalyMode::PURE, 0.5);
+  binary.compute(active, activeOffsets, predicted, predictedOffsets,
+                 nullptr, scores);
+  ASSERT_FLOAT_EQ(scores[0], 1.0);
+  ASSERT_FLOAT_EQ(scores[1], 0.0);
+
+  ASSERT_ANY_THROW(MultiStreamAnomaly(2, 0, AnomalyMode::LIKELIHOOD));
+}
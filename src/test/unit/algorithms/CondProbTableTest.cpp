@@ -306,7 +306,91 @@ namespace {
 
 
   }
-  
+
+  //----------------------------------------------------------------------
+  // Fills a table with random rows, some of them updated more than once
+  // and some of them decreased
+  static void makeRandomTable(CondProbTable& table, UInt nRows, UInt nCols)
+  {
+    srand(42);
+    vector<Real> row(nCols);
+    for (UInt i = 0; i < 3 * nRows; i++) {
+      for (UInt c = 0; c < nCols; c++)
+        row[c] = rand() % 3 ? 0 : (Real)(rand() % 8) / 8;
+      table.updateRow(rand() % nRows, row);
+    }
+    for (UInt i = 0; i < nRows; i++) {
+      for (UInt c = 0; c < nCols; c++)
+        row[c] = rand() % 4 ? 0 : -(Real)(rand() % 4) / 8;
+      table.updateRow(i, row);
+    }
+  }
+
+  //----------------------------------------------------------------------
+  TEST(CondProbTableTest, InferRowsMatchesInferRow)
+  {
+    const UInt nRows = 23, nCols = 37, nDists = 41;
+    CondProbTable table;
+    makeRandomTable(table, nRows, nCols);
+
+    // Take the table rows as some of the distributions
+    vector<Real> dists(nDists * nCols);
+    vector<Real> row;
+    for (UInt k = 0; k < nDists; k++) {
+      if (k < nRows) {
+        table.getRow(k, row);
+        copy(row.begin(), row.end(), dists.begin() + k * nCols);
+      } else {
+        for (UInt c = 0; c < nCols; c++)
+          dists[k * nCols + c] = (Real)(rand() % 16) / 16;
+      }
+    }
+
+    CondProbTable::inferType methods[] = {
+      CondProbTable::inferMarginal, CondProbTable::inferRowEvidence,
+      CondProbTable::inferMaxProd, CondProbTable::inferViterbi };
+
+    for (auto infer : methods) {
+      vector<Real> expected(nDists * nRows), output(nRows);
+      for (UInt k = 0; k < nDists; k++) {
+        vector<Real> dist(dists.begin() + k * nCols,
+                          dists.begin() + (k + 1) * nCols);
+        table.inferRow(dist, output, infer);
+        copy(output.begin(), output.end(), expected.begin() + k * nRows);
+      }
+
+      for (UInt nThreads : {1, 3, 0}) {
+        vector<Real> scores(nDists * nRows, -1);
+        table.inferRows(&dists[0], nDists, &scores[0], infer, nThreads);
+        ASSERT_EQ(expected, scores) << "infer " << infer
+                                    << ", " << nThreads << " threads";
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------
+  TEST(CondProbTableTest, IncrementalCleanCPT)
+  {
+    const UInt nRows = 17, nCols = 29;
+    CondProbTable table;
+    makeRandomTable(table, nRows, nCols);
+
+    // A reloaded table builds its clean CPT from scratch
+    stringstream state;
+    table.saveState(state);
+    CondProbTable newTable;
+    newTable.readState(state);
+
+    vector<Real> dist(nCols), output(nRows), expected(nRows);
+    for (UInt i = 0; i < 20; i++) {
+      for (UInt c = 0; c < nCols; c++)
+        dist[c] = (Real)(rand() % 16) / 16;
+      table.inferRow(dist, output, CondProbTable::inferViterbi);
+      newTable.inferRow(dist, expected, CondProbTable::inferViterbi);
+      ASSERT_EQ(expected, output);
+    }
+  }
+
   //----------------------------------------------------------------------
 } // end namespace
 
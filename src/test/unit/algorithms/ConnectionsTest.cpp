@@ -26,7 +26,10 @@
 
 #include <fstream>
 #include <iostream>
+#include <set>
+#include <string>
 #include <nupic/algorithms/Connections.hpp>
+#include <nupic/utils/Random.hpp>
 #include "gtest/gtest.h"
 
 using namespace std;
@@ -544,6 +547,80 @@ namespace {
     ASSERT_EQ(3, numActivePotentialSynapsesForSegment[segment2_1.flatIdx]);
   }
 
+  /**
+   * The array version of computeActivity matches the vector version.
+   */
+  TEST(ConnectionsTest, testComputeActivityArrays)
+  {
+    Connections connections(1024);
+    setupSampleConnections(connections);
+
+    vector<UInt32> input = {50, 52, 53,
+                            80, 81, 82,
+                            150, 151};
+
+    vector<UInt32> numActiveConnected(connections.segmentFlatListLength(), 0);
+    vector<UInt32> numActivePotential(connections.segmentFlatListLength(), 0);
+    connections.computeActivity(numActiveConnected, numActivePotential,
+                                input, 0.5);
+
+    UInt32 arrayActiveConnected[16] = {0}, arrayActivePotential[16] = {0};
+    ASSERT_LE(connections.segmentFlatListLength(), 16);
+    connections.computeActivity(arrayActiveConnected, arrayActivePotential,
+                                input.size(), input.data(), 0.5);
+
+    for (UInt32 i = 0; i < connections.segmentFlatListLength(); i++)
+    {
+      ASSERT_EQ(numActiveConnected[i], arrayActiveConnected[i]);
+      ASSERT_EQ(numActivePotential[i], arrayActivePotential[i]);
+    }
+  }
+
+  /**
+   * The touched-segment version of computeActivity matches the vector version
+   * and lists exactly the segments with active potential synapses, once each.
+   */
+  TEST(ConnectionsTest, testComputeActivityTouchedSegments)
+  {
+    Connections connections(1024);
+    setupSampleConnections(connections);
+
+    vector<UInt32> input = {50, 52, 53,
+                            80, 81, 82,
+                            150, 151};
+
+    vector<UInt32> numActiveConnected(connections.segmentFlatListLength(), 0);
+    vector<UInt32> numActivePotential(connections.segmentFlatListLength(), 0);
+    connections.computeActivity(numActiveConnected, numActivePotential,
+                                input, 0.5);
+
+    vector<UInt32> touchedActiveConnected(
+      connections.segmentFlatListLength(), 0);
+    vector<UInt32> touchedActivePotential(
+      connections.segmentFlatListLength(), 0);
+    vector<Segment> touched;
+    connections.computeActivity(touchedActiveConnected, touchedActivePotential,
+                                touched, input, 0.5);
+
+    ASSERT_EQ(numActiveConnected, touchedActiveConnected);
+    ASSERT_EQ(numActivePotential, touchedActivePotential);
+
+    set<UInt32> expected, actual;
+    for (UInt32 i = 0; i < connections.segmentFlatListLength(); i++)
+    {
+      if (numActivePotential[i] > 0)
+      {
+        expected.insert(i);
+      }
+    }
+    for (Segment segment : touched)
+    {
+      actual.insert(segment.flatIdx);
+    }
+    ASSERT_EQ(expected.size(), touched.size());
+    ASSERT_EQ(expected, actual);
+  }
+
 
 
   bool TEST_EVENT_HANDLER_DESTRUCTED = false;
@@ -645,6 +722,234 @@ namespace {
     EXPECT_TRUE(TEST_EVENT_HANDLER_DESTRUCTED);
   }
 
+  /**
+   * Applies random creations, destructions and permanence updates. Small
+   * limits, so segments and synapses also get destroyed to make room.
+   */
+  void mutateRandomly(Connections& connections, Random& rng, UInt count)
+  {
+    for (UInt i = 0; i < count; i++)
+    {
+      const CellIdx cell = rng.getUInt32(32);
+      const vector<Segment> segments = connections.segmentsForCell(cell);
+      const UInt32 op = rng.getUInt32(5);
+      if (segments.empty() || op == 0)
+      {
+        const Segment segment = connections.createSegment(cell);
+        connections.createSynapse(segment, rng.getUInt32(32), 0.5);
+        continue;
+      }
+
+      const Segment segment = segments[rng.getUInt32(segments.size())];
+      const vector<Synapse> synapses = connections.synapsesForSegment(segment);
+      if (op == 1 || synapses.empty())
+      {
+        connections.createSynapse(segment, rng.getUInt32(32),
+                                  0.1 + 0.8 * rng.getReal64());
+      }
+      else if (op == 2)
+      {
+        connections.destroySynapse(synapses[rng.getUInt32(synapses.size())]);
+      }
+      else if (op == 3)
+      {
+        connections.destroySegment(segment);
+      }
+      else
+      {
+        connections.updateSynapsePermanence(
+          synapses[rng.getUInt32(synapses.size())],
+          0.1 + 0.8 * rng.getReal64());
+      }
+    }
+  }
+
+  /**
+   * Records every event as a string.
+   */
+  class LogConnectionsEventHandler : public ConnectionsEventHandler
+  {
+  public:
+    LogConnectionsEventHandler(vector<string>& log)
+      :log_(log)
+    {
+    }
+
+    virtual void onCreateSegment(Segment segment)
+    {
+      log_.push_back("createSegment " + to_string(segment.flatIdx));
+    }
+
+    virtual void onDestroySegment(Segment segment)
+    {
+      log_.push_back("destroySegment " + to_string(segment.flatIdx));
+    }
+
+    virtual void onCreateSynapse(Synapse synapse)
+    {
+      log_.push_back("createSynapse " + to_string(synapse.flatIdx));
+    }
+
+    virtual void onDestroySynapse(Synapse synapse)
+    {
+      log_.push_back("destroySynapse " + to_string(synapse.flatIdx));
+    }
+
+    virtual void onUpdateSynapsePermanence(Synapse synapse,
+                                           Permanence permanence)
+    {
+      log_.push_back("updateSynapsePermanence " + to_string(synapse.flatIdx) +
+                     " " + to_string(permanence));
+    }
+
+  private:
+    vector<string>& log_;
+  };
+
+  /**
+   * Batches of mutations leave the connections, including the presynaptic
+   * index, as they would be without batching.
+   */
+  TEST(ConnectionsTest, BatchMatchesUnbatched)
+  {
+    Connections unbatched(32, 3, 4);
+    Connections batched(32, 3, 4);
+    Random rng1(42), rng2(42);
+
+    vector<CellIdx> input(32);
+    for (CellIdx cell = 0; cell < 32; cell++)
+    {
+      input[cell] = cell;
+    }
+
+    for (UInt round = 0; round < 20; round++)
+    {
+      mutateRandomly(unbatched, rng1, 50);
+
+      batched.beginBatch();
+      ASSERT_TRUE(batched.inBatch());
+      mutateRandomly(batched, rng2, 50);
+      batched.commitBatch();
+      ASSERT_FALSE(batched.inBatch());
+
+      ASSERT_EQ(unbatched, batched);
+      for (CellIdx cell = 0; cell < 32; cell++)
+      {
+        ASSERT_EQ(unbatched.synapsesForPresynapticCell(cell),
+                  batched.synapsesForPresynapticCell(cell));
+      }
+
+      vector<UInt32> unbatchedConnected(unbatched.segmentFlatListLength(), 0);
+      vector<UInt32> unbatchedPotential(unbatched.segmentFlatListLength(), 0);
+      unbatched.computeActivity(unbatchedConnected, unbatchedPotential,
+                                input, 0.5);
+      vector<UInt32> batchedConnected(batched.segmentFlatListLength(), 0);
+      vector<UInt32> batchedPotential(batched.segmentFlatListLength(), 0);
+      batched.computeActivity(batchedConnected, batchedPotential, input, 0.5);
+      ASSERT_EQ(unbatchedConnected, batchedConnected);
+      ASSERT_EQ(unbatchedPotential, batchedPotential);
+    }
+  }
+
+  /**
+   * Event handlers hear about a batch when it's committed, in order.
+   */
+  TEST(ConnectionsTest, BatchDefersEvents)
+  {
+    vector<string> unbatchedLog, batchedLog;
+    Connections unbatched(32, 3, 4);
+    Connections batched(32, 3, 4);
+    unbatched.subscribe(new LogConnectionsEventHandler(unbatchedLog));
+    batched.subscribe(new LogConnectionsEventHandler(batchedLog));
+    Random rng1(42), rng2(42);
+
+    mutateRandomly(unbatched, rng1, 200);
+
+    batched.beginBatch();
+    mutateRandomly(batched, rng2, 200);
+    EXPECT_TRUE(batchedLog.empty());
+    batched.commitBatch();
+
+    EXPECT_FALSE(unbatchedLog.empty());
+    EXPECT_EQ(unbatchedLog, batchedLog);
+  }
+
+  /**
+   * With fixed-point permanences, synapses get rounded permanences that stay
+   * positive, and the resolution is serialized.
+   */
+  TEST(ConnectionsTest, PermanenceBits)
+  {
+    Connections connections(32);
+    Segment segment = connections.createSegment(10);
+    Synapse synapse1 = connections.createSynapse(segment, 1, 0.3);
+
+    connections.setPermanenceBits(8);
+    ASSERT_EQ(8, connections.getPermanenceBits());
+    EXPECT_FLOAT_EQ(77.0f / 255,
+                    connections.dataForSynapse(synapse1).permanence);
+
+    Synapse synapse2 = connections.createSynapse(segment, 2, 0.0001);
+    EXPECT_FLOAT_EQ(1.0f / 255,
+                    connections.dataForSynapse(synapse2).permanence);
+
+    connections.updateSynapsePermanence(synapse1, 0.5);
+    EXPECT_FLOAT_EQ(128.0f / 255,
+                    connections.dataForSynapse(synapse1).permanence);
+
+    EXPECT_EQ(0, connections.roundPermanence(0));
+    EXPECT_FLOAT_EQ(1.0f / 255, connections.roundPermanence(0.0001));
+
+    stringstream ss;
+    connections.save(ss);
+    Connections loaded;
+    loaded.load(ss);
+    EXPECT_EQ(8, loaded.getPermanenceBits());
+    EXPECT_EQ(connections, loaded);
+  }
+
+  /**
+   * Batches don't nest, and a commit needs a batch.
+   */
+  TEST(ConnectionsTest, BatchMisuse)
+  {
+    Connections connections(32);
+    EXPECT_THROW(connections.commitBatch(), std::exception);
+    connections.beginBatch();
+    EXPECT_THROW(connections.beginBatch(), std::exception);
+    connections.commitBatch();
+  }
+
+  /**
+   * A scoped batch commits when an exception leaves its scope, so the
+   * presynaptic index stays in sync and the next batch can begin.
+   */
+  TEST(ConnectionsTest, ScopedBatchCommitsOnException)
+  {
+    Connections connections(32);
+    Segment segment = connections.createSegment(10);
+    try
+    {
+      ConnectionsBatch batch(connections);
+      connections.createSynapse(segment, 5, 0.5);
+      ASSERT_TRUE(connections.inBatch());
+      throw std::runtime_error("learning failed");
+    }
+    catch (std::runtime_error&)
+    {
+    }
+    EXPECT_FALSE(connections.inBatch());
+    EXPECT_EQ(1, connections.synapsesForPresynapticCell(5).size());
+
+    ConnectionsBatch batch(connections);
+    EXPECT_TRUE(connections.inBatch());
+    batch.commit();
+    EXPECT_FALSE(connections.inBatch());
+
+    ConnectionsBatch disabled(connections, false);
+    EXPECT_FALSE(connections.inBatch());
+  }
+
   /**
    * Creates a sample set of connections, and makes sure that we can get the
    * correct number of segments.
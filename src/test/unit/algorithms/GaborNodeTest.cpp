@@ -0,0 +1,243 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Implementation of unit tests for the Gabor filter bank
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "nupic/algorithms/GaborNode.hpp"
+#include "nupic/utils/Random.hpp"
+
+using namespace nupic;
+using namespace std;
+
+namespace {
+
+  // A C-ordered array, seen through the NUMPY_ARRAY structure that the
+  // python wrappers pass to gaborCompute (dimensions and strides are
+  // longs).
+  template <typename T>
+  struct TestArray
+  {
+    vector<T> data;
+    vector<long> dims;
+    vector<long> strides;
+    NUMPY_ARRAY array;
+
+    TestArray(const vector<long>& d, T value = T(0))
+      : dims(d), strides(d.size())
+    {
+      long size = 1;
+      for (size_t k = d.size(); k > 0; k--) {
+        strides[k - 1] = size * sizeof(T);
+        size *= d[k - 1];
+      }
+      data.assign(size, value);
+      array.nNumDims = (int) d.size();
+      array.pnDimensions = (const int *) dims.data();
+      array.pnStrides = (const int *) strides.data();
+      array.pData = (const char *) data.data();
+    }
+
+    const NUMPY_ARRAY * operator&() const { return &array; }
+  };
+
+  struct GaborSetup
+  {
+    EDGE_MODE eEdgeMode;
+    bool bAlpha;
+    PHASE_MODE ePhaseMode;
+    NORMALIZE_METHOD eNormalizeMethod;
+    NORMALIZE_MODE eNormalizeMode;
+    PHASENORM_MODE ePhaseNormMode;
+    POSTPROC_METHOD ePostProcMethod;
+  };
+
+  const long nRows = 37, nCols = 34, nNumFilters = 4;
+
+  // Runs the serial or the parallel implementation on a fixed random
+  // image and filter bank, and returns the outputs.
+  vector<float> runGabor(const GaborSetup& s, int nFilterDim, bool bParallel,
+                         int nThreads)
+  {
+    Random rng(42);
+    const long nShrinkage = nFilterDim - 1;
+
+    TestArray<float> input({nRows, nCols});
+    for (float& x : input.data)
+      x = (float) rng.getUInt32(256);
+
+    TestArray<float> alpha({nRows, nCols}, 1.0f);
+    for (float& x : alpha.data)
+      if (rng.getUInt32(10) == 0)
+        x = 0.0f;
+
+    // Random filters, scaled by 2^GABOR_SCALING_SHIFT, whose absolute
+    // values sum to less than one
+    TestArray<int> bank({nNumFilters, nFilterDim, nFilterDim});
+    for (long k = 0; k < nNumFilters; k++) {
+      vector<double> coefs(nFilterDim * nFilterDim);
+      double sum = 0;
+      for (double& c : coefs) {
+        c = 2 * rng.getReal64() - 1;
+        sum += fabs(c);
+      }
+      for (size_t i = 0; i < coefs.size(); i++)
+        bank.data[k * coefs.size() + i] =
+          (int) (0.9 * (1 << GABOR_SCALING_SHIFT) * coefs[i] / sum);
+    }
+
+    TestArray<int> imageBox({4});
+    imageBox.data = {0, 0, (int) nCols, (int) nRows};
+    imageBox.array.pData = (const char *) imageBox.data.data();
+    TestArray<int> bbox({4});
+    long nOutRows, nOutCols, nBufferInRows, nBufferInCols;
+    if (s.eEdgeMode == EDGE_MODE_CONSTRAINED) {
+      bbox.data = {4, 2, (int) nCols - 3, (int) nRows - 1};
+      nOutRows = nRows - nShrinkage;
+      nOutCols = nCols - nShrinkage;
+      nBufferInRows = nRows;
+      nBufferInCols = (nCols + 3) & ~3;
+    }
+    else {
+      bbox.data = {1, 1, (int) nCols - 2, (int) nRows - 1};
+      nOutRows = nRows;
+      nOutCols = nCols;
+      nBufferInRows = nRows + nShrinkage;
+      nBufferInCols = (((nCols + 3) & ~3) + nShrinkage + 3) & ~3;
+    }
+    bbox.array.pData = (const char *) bbox.data.data();
+
+    const long nBufferOutCols = (nOutCols + 3) & ~3;
+    const long nNumPhases = (s.ePhaseMode == PHASE_MODE_DUAL) ? 2 : 1;
+    TestArray<int> bufferIn({nBufferInRows, nBufferInCols});
+    TestArray<int> bufferOut({nNumFilters, nOutRows, nBufferOutCols});
+    TestArray<float> output({nNumFilters * nNumPhases, nOutRows, nOutCols},
+                            -1.0f);
+
+    TestArray<float> lut({256});
+    for (size_t i = 0; i < lut.data.size(); i++)
+      lut.data[i] = (float) i / 255;
+
+    int result;
+    if (bParallel)
+      result = gaborComputeParallel(
+        &bank, &input, s.bAlpha ? &alpha : nullptr, &bbox, &imageBox,
+        &output, 1.0f, s.eEdgeMode, 0.0f, s.ePhaseMode, s.eNormalizeMethod,
+        s.eNormalizeMode, s.ePhaseNormMode, s.ePostProcMethod,
+        5.0f, 0.5f, 0.0f, 1.0f, &bufferIn, &bufferOut, &lut, 200.0f,
+        nThreads);
+    else
+      result = gaborCompute(
+        &bank, &input, s.bAlpha ? &alpha : nullptr, &bbox, &imageBox,
+        &output, 1.0f, s.eEdgeMode, 0.0f, s.ePhaseMode, s.eNormalizeMethod,
+        s.eNormalizeMode, s.ePhaseNormMode, s.ePostProcMethod,
+        5.0f, 0.5f, 0.0f, 1.0f, &bufferIn, &bufferOut, &lut, 200.0f);
+    EXPECT_EQ(0, result);
+
+    return output.data;
+  }
+
+  vector<GaborSetup> allSetups()
+  {
+    vector<GaborSetup> setups;
+    for (EDGE_MODE eEdgeMode : {EDGE_MODE_CONSTRAINED, EDGE_MODE_SWEEPOFF})
+    for (bool bAlpha : {false, true})
+    for (PHASE_MODE ePhaseMode : {PHASE_MODE_SINGLE, PHASE_MODE_DUAL})
+    for (int m = 0; m < NORMALIZE_METHOD__LAST; m++)
+    for (NORMALIZE_MODE eNormalizeMode : {NORMALIZE_MODE_GLOBAL,
+                                          NORMALIZE_MODE_PERORIENT})
+    for (PHASENORM_MODE ePhaseNormMode : {PHASENORM_MODE_COMBO,
+                                          PHASENORM_MODE_INDIV})
+    for (POSTPROC_METHOD ePostProcMethod : {POSTPROC_METHOD_RAW,
+                                            POSTPROC_METHOD_SIGMOID}) {
+      // With a LUT, the mean power normalizer doesn't bound the
+      // responses, so the LUT would have to be built for the image
+      if (m == NORMALIZE_METHOD_MEANPOWER &&
+          ePostProcMethod != POSTPROC_METHOD_RAW)
+        continue;
+      GaborSetup s = {eEdgeMode, bAlpha, ePhaseMode, (NORMALIZE_METHOD) m,
+                      eNormalizeMode, ePhaseNormMode, ePostProcMethod};
+      setups.push_back(s);
+    }
+    return setups;
+  }
+
+  // The parallel path must give exactly the outputs of the serial one,
+  // for all the edge, phase, normalization and post-processing modes.
+  TEST(GaborNodeTest, ParallelMatchesSerial)
+  {
+    for (const GaborSetup& s : allSetups())
+      for (int nFilterDim : {5, 7}) {
+        const vector<float> expected = runGabor(s, nFilterDim, false, 1);
+        for (int nThreads : {1, 3}) {
+          ASSERT_EQ(expected, runGabor(s, nFilterDim, true, nThreads))
+            << "edge " << s.eEdgeMode << " alpha " << s.bAlpha
+            << " phase " << s.ePhaseMode << " method " << s.eNormalizeMethod
+            << " mode " << s.eNormalizeMode << " phasenorm "
+            << s.ePhaseNormMode << " postproc " << s.ePostProcMethod
+            << " dim " << nFilterDim << " threads " << nThreads;
+        }
+      }
+  }
+
+  // Golden outputs of both paths for a few setups, to catch changes in
+  // the serial implementation as well.
+  TEST(GaborNodeTest, GoldenOutputs)
+  {
+    struct Golden {
+      GaborSetup s;
+      double sum;
+      double sumSquares;
+    };
+    const Golden goldens[] = {
+      {{EDGE_MODE_CONSTRAINED, false, PHASE_MODE_SINGLE,
+        NORMALIZE_METHOD_FIXED, NORMALIZE_MODE_GLOBAL, PHASENORM_MODE_COMBO,
+        POSTPROC_METHOD_RAW}, 121.671164, 9.333723},
+      {{EDGE_MODE_SWEEPOFF, true, PHASE_MODE_DUAL,
+        NORMALIZE_METHOD_MAX, NORMALIZE_MODE_PERORIENT, PHASENORM_MODE_INDIV,
+        POSTPROC_METHOD_SIGMOID}, 931.721593, 318.728676},
+      {{EDGE_MODE_CONSTRAINED, true, PHASE_MODE_DUAL,
+        NORMALIZE_METHOD_MEAN, NORMALIZE_MODE_GLOBAL, PHASENORM_MODE_COMBO,
+        POSTPROC_METHOD_SIGMOID}, 176.411770, 21.940809},
+    };
+
+    for (const Golden& golden : goldens)
+      for (bool bParallel : {false, true}) {
+        const vector<float> output = runGabor(golden.s, 7, bParallel, 0);
+        double sum = 0, sumSquares = 0;
+        for (float x : output) {
+          sum += x;
+          sumSquares += x * x;
+        }
+        EXPECT_NEAR(golden.sum, sum, 1e-3);
+        EXPECT_NEAR(golden.sumSquares, sumSquares, 1e-3);
+      }
+  }
+
+} // end namespace
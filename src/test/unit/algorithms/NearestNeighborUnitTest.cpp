@@ -24,12 +24,19 @@
  * Implementation of unit tests for NearestNeighbor
  */     
 
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
 #include <nupic/math/StlIo.hpp>
 #include <nupic/math/NearestNeighbor.hpp>
+#include <nupic/utils/Random.hpp>
 #include "../math/SparseMatrixUnitTest.hpp"
 
 
 using namespace std;
+using namespace nupic;
 
 namespace {
 
@@ -495,6 +502,174 @@ namespace {
 //  }
 //
   //--------------------------------------------------------------------------------
+  typedef NearestNeighbor<SparseMatrix<UInt32, Real32> > NN;
+
+  // Random rows with about a third of their entries set, to values in
+  // (0, 1] if !binary, else to 1. Some rows are left empty.
+  NN randomNN(UInt32 nrows, UInt32 ncols, bool binary, Random& rng)
+  {
+    NN nn(0, ncols);
+    vector<Real32> row(ncols);
+    for (UInt32 i = 0; i != nrows; ++i) {
+      for (UInt32 j = 0; j != ncols; ++j) {
+        row[j] = 0;
+        if (i % 7 != 3 && rng.getUInt32(3) == 0)
+          row[j] = binary ? 1.0f : (Real32) (1.0 - rng.getReal64());
+      }
+      nn.addRow(row.begin());
+    }
+    return nn;
+  }
+
+  // The k nearest rows by (distance, index), from a distance per row
+  vector<NN::neighbor_type> expectedNearest(const vector<Real32>& dist,
+                                            UInt32 k, bool largest =false)
+  {
+    vector<NN::neighbor_type> all;
+    for (UInt32 i = 0; i != dist.size(); ++i)
+      all.push_back(NN::neighbor_type(i, dist[i]));
+    std::sort(all.begin(), all.end(),
+              [largest](const NN::neighbor_type& a, const NN::neighbor_type& b) {
+                if (a.second != b.second)
+                  return largest ? a.second > b.second : a.second < b.second;
+                return a.first < b.first;
+              });
+    all.resize(k);
+    return all;
+  }
+
+  TEST(NearestNeighborTest, LpNearestBatch)
+  {
+    Random rng(42);
+    const UInt32 nrows = 700, ncols = 50, nx = 9, k = 5;
+    NN nn = randomNN(nrows, ncols, false, rng);
+
+    vector<Real32> X(nx * ncols);
+    for (Real32& v : X)
+      v = rng.getUInt32(2) ? (Real32) rng.getReal64() : 0;
+
+    for (Real32 p : {0.0f, 1.0f, 2.0f, 3.0f}) {
+      for (bool takeRoot : {false, true}) {
+        vector<NN::neighbor_type> single(nx * k), multi(nx * k);
+        nn.LpNearestBatch(p, nx, X.begin(), single.begin(), k, takeRoot, 1);
+        nn.LpNearestBatch(p, nx, X.begin(), multi.begin(), k, takeRoot, 8);
+        ASSERT_EQ(single, multi) << "p = " << p;
+
+        for (UInt32 q = 0; q != nx; ++q) {
+          vector<Real32> dist(nrows);
+          nn.LpDist(p, X.begin() + q * ncols, dist.begin(), takeRoot);
+          vector<NN::neighbor_type> expected = expectedNearest(dist, k);
+          for (UInt32 i = 0; i != k; ++i) {
+            EXPECT_EQ(expected[i].first, single[q * k + i].first)
+              << "p = " << p << ", query " << q << ", neighbor " << i;
+            EXPECT_FLOAT_EQ(expected[i].second, single[q * k + i].second);
+          }
+        }
+      }
+    }
+  }
+
+  TEST(NearestNeighborTest, IndexedNearest)
+  {
+    Random rng(42);
+    const UInt32 nrows = 300, ncols = 40;
+    NN nn = randomNN(nrows, ncols, true, rng);
+    nn.buildInvertedIndex();
+    ASSERT_TRUE(nn.hasInvertedIndex());
+
+    // Sparse queries, the last one empty
+    vector<UInt32> offsets = {0}, indices;
+    vector<vector<Real32> > dense;
+    for (UInt32 q = 0; q != 6; ++q) {
+      dense.push_back(vector<Real32>(ncols, 0));
+      if (q != 5) {
+        for (UInt32 j = 0; j != ncols; ++j) {
+          if (rng.getUInt32(4) == 0) {
+            indices.push_back(j);
+            dense.back()[j] = 1;
+          }
+        }
+      }
+      offsets.push_back((UInt32) indices.size());
+    }
+    const UInt32 nx = (UInt32) dense.size();
+
+    for (UInt32 k : {1u, 10u, nrows}) {
+      vector<NN::neighbor_type> l0(nx * k), l0Threads(nx * k);
+      vector<NN::neighbor_type> overlap(nx * k);
+      nn.L0NearestIndexed(nx, offsets.begin(), indices.begin(), l0.begin(), k, 1);
+      nn.L0NearestIndexed(nx, offsets.begin(), indices.begin(),
+                          l0Threads.begin(), k, 4);
+      nn.overlapNearestIndexed(nx, offsets.begin(), indices.begin(),
+                               overlap.begin(), k);
+      EXPECT_EQ(l0, l0Threads);
+
+      for (UInt32 q = 0; q != nx; ++q) {
+        vector<Real32> dist(nrows), dot(nrows);
+        nn.L0Dist(dense[q].begin(), dist.begin());
+        nn.rightVecProd(dense[q].begin(), dot.begin());
+        vector<NN::neighbor_type> expectedL0 = expectedNearest(dist, k);
+        vector<NN::neighbor_type> expectedOverlap =
+          expectedNearest(dot, k, true);
+        for (UInt32 i = 0; i != k; ++i) {
+          EXPECT_EQ(expectedL0[i], l0[q * k + i])
+            << "k = " << k << ", query " << q << ", neighbor " << i;
+          EXPECT_EQ(expectedOverlap[i], overlap[q * k + i])
+            << "k = " << k << ", query " << q << ", neighbor " << i;
+        }
+      }
+    }
+  }
+
+  TEST(NearestNeighborTest, InvertedIndexErrors)
+  {
+    Random rng(42);
+    NN nn = randomNN(20, 10, true, rng);
+    vector<UInt32> offsets = {0, 1}, indices = {3};
+    vector<NN::neighbor_type> out(1);
+
+    EXPECT_FALSE(nn.hasInvertedIndex());
+    EXPECT_THROW(nn.L0NearestIndexed(1, offsets.begin(), indices.begin(),
+                                     out.begin()),
+                 exception);
+
+    nn.buildInvertedIndex();
+    indices[0] = 10;
+    EXPECT_THROW(nn.overlapNearestIndexed(1, offsets.begin(), indices.begin(),
+                                          out.begin()),
+                 exception);
+
+    // Stale after the matrix changes
+    vector<Real32> row(10, 1);
+    nn.addRow(row.begin());
+    EXPECT_FALSE(nn.hasInvertedIndex());
+
+    row[4] = 0.5;
+    nn.addRow(row.begin());
+    EXPECT_THROW(nn.buildInvertedIndex(), exception);
+  }
+
+  TEST(NearestNeighborTest, BatchInvalidK)
+  {
+    Random rng(42);
+    NN nn = randomNN(20, 10, true, rng);
+    nn.buildInvertedIndex();
+    vector<UInt32> offsets = {0, 1}, indices = {3};
+    vector<Real32> X(10, 1);
+    vector<NN::neighbor_type> out(21);
+
+    for (UInt32 k : {0u, 21u}) {
+      EXPECT_THROW(nn.LpNearestBatch(2.0f, 1, X.begin(), out.begin(), k),
+                   exception) << "k = " << k;
+      EXPECT_THROW(nn.L0NearestIndexed(1, offsets.begin(), indices.begin(),
+                                       out.begin(), k),
+                   exception) << "k = " << k;
+      EXPECT_THROW(nn.overlapNearestIndexed(1, offsets.begin(), indices.begin(),
+                                            out.begin(), k),
+                   exception) << "k = " << k;
+    }
+  }
+
 } // end namespace nupic
 
 
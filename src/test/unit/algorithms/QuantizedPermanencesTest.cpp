@@ -0,0 +1,101 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Implementation of unit tests for fixed-point permanences
+ */
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "nupic/algorithms/QuantizedPermanences.hpp"
+#include "nupic/types/Types.hpp"
+
+using namespace nupic::algorithms;
+using namespace nupic;
+using namespace std;
+
+
+TEST(PermanenceQuantizer, Disabled)
+{
+  PermanenceQuantizer quantizer;
+  EXPECT_FALSE(quantizer.enabled());
+  EXPECT_EQ(0.123456f, quantizer.round(0.123456f));
+}
+
+TEST(PermanenceQuantizer, InvalidBits)
+{
+  EXPECT_ANY_THROW(PermanenceQuantizer(12));
+  EXPECT_ANY_THROW(QuantizedPermanenceRows(0));
+}
+
+TEST(PermanenceQuantizer, RoundsToNearestLevel)
+{
+  for (UInt bits : {8, 16})
+  {
+    PermanenceQuantizer quantizer(bits);
+    const UInt32 maxLevel = (1u << bits) - 1;
+    const Real32 halfStep = 0.5f / maxLevel;
+
+    EXPECT_EQ(0, quantizer.toLevel(-0.5f));
+    EXPECT_EQ(0, quantizer.toLevel(0));
+    EXPECT_EQ(maxLevel, quantizer.toLevel(1));
+    EXPECT_EQ(maxLevel, quantizer.toLevel(1.5f));
+
+    for (Real32 p = 0; p <= 1; p += 0.001f)
+    {
+      const Real32 rounded = quantizer.round(p);
+      EXPECT_LE(std::abs(rounded - p), halfStep * 1.001f);
+      // The grid's own values don't move.
+      EXPECT_EQ(rounded, quantizer.round(rounded));
+    }
+
+    for (UInt32 level = 0; level <= maxLevel; level += maxLevel / 255)
+    {
+      EXPECT_EQ(level, quantizer.toLevel(quantizer.fromLevel(level)));
+    }
+  }
+}
+
+TEST(QuantizedPermanenceRows, GetSetRow)
+{
+  for (UInt bits : {8, 16})
+  {
+    QuantizedPermanenceRows rows(bits);
+    rows.resize(2);
+
+    const vector<UInt> indices = {1, 3, 4};
+    const Real32 dense[6] = {0.9f, 0.25f, 0.9f, 0.0f, 1.0f, 0.9f};
+    rows.setRow(1, indices, dense);
+    EXPECT_EQ(3 * bits / 8, rows.nBytes());
+
+    Real32 actual[6] = {-1, -1, -1, -1, -1, -1};
+    rows.getRow(1, indices, actual);
+    EXPECT_EQ(-1, actual[0]);
+    EXPECT_EQ(rows.quantizer().round(0.25f), actual[1]);
+    EXPECT_EQ(-1, actual[2]);
+    EXPECT_EQ(0, actual[3]);
+    EXPECT_EQ(1, actual[4]);
+    EXPECT_EQ(-1, actual[5]);
+  }
+}
@@ -27,11 +27,16 @@
 #include <cstring>
 #include <fstream>
 #include <stdio.h>
+#include <thread>
+
+#include <capnp/message.h>
 
 #include <nupic/algorithms/SpatialPooler.hpp>
+#include <nupic/proto/SpatialPoolerProto.capnp.h>
 #include <nupic/math/StlIo.hpp>
 #include <nupic/types/Types.hpp>
 #include <nupic/utils/Log.hpp>
+#include <nupic/utils/Random.hpp>
 #include "gtest/gtest.h"
 
 using namespace std;
@@ -151,6 +156,7 @@ namespace {
               sp2.getIterationLearnNum());
     ASSERT_TRUE(sp1.getSpVerbosity() == sp2.getSpVerbosity());
     ASSERT_TRUE(sp1.getWrapAround() == sp2.getWrapAround());
+    ASSERT_TRUE(sp1.getPermanenceBits() == sp2.getPermanenceBits());
     ASSERT_TRUE(sp1.getUpdatePeriod() == sp2.getUpdatePeriod());
     ASSERT_TRUE(almost_eq(sp1.getSynPermTrimThreshold(),
               sp2.getSynPermTrimThreshold()));
@@ -2269,4 +2275,478 @@ namespace {
     ASSERT_TRUE(ret == 0) << "Failed to delete " << filename;
   }
 
+  TEST(SpatialPoolerTest, ReadColumnListsFormat)
+  {
+    SpatialPooler sp1({100}, {50});
+    vector<UInt> input(100), active(50);
+    Random rng(42);
+    for (UInt i = 0; i < 20; i++)
+    {
+      for (UInt& bit : input)
+      {
+        bit = rng.getReal64() < 0.2;
+      }
+      sp1.compute(input.data(), true, active.data());
+    }
+
+    // Rewrite the message the way versions before columnsFormat 1 did
+    capnp::MallocMessageBuilder message;
+    SpatialPoolerProto::Builder proto =
+      message.initRoot<SpatialPoolerProto>();
+    sp1.write(proto);
+    proto.setColumnsFormat(0);
+    const UInt numColumns = sp1.getNumColumns();
+    const UInt numInputs = sp1.getNumInputs();
+
+    auto potentialPools = proto.initPotentialPools();
+    potentialPools.setNumRows(numColumns);
+    potentialPools.setNumColumns(numInputs);
+    auto potentialIndices = potentialPools.initIndices(numColumns);
+    auto permanences = proto.initPermanences();
+    permanences.setNumRows(numColumns);
+    permanences.setNumColumns(numInputs);
+    auto permanenceRows = permanences.initRows(numColumns);
+    vector<UInt> potential(numInputs);
+    vector<Real> permanence(numInputs);
+    for (UInt i = 0; i < numColumns; i++)
+    {
+      sp1.getPotential(i, potential.data());
+      sp1.getPermanence(i, permanence.data());
+      auto indices = potentialIndices.init(i, countNonzero(potential));
+      UInt nPermanences = 0;
+      for (UInt j = 0; j < numInputs; j++)
+      {
+        nPermanences += permanence[j] != 0;
+      }
+      auto values = permanenceRows[i].initValues(nPermanences);
+      for (UInt j = 0, k = 0, n = 0; j < numInputs; j++)
+      {
+        if (potential[j])
+        {
+          indices.set(k++, j);
+        }
+        if (permanence[j] != 0)
+        {
+          values[n].setIndex(j);
+          values[n++].setValue(permanence[j]);
+        }
+      }
+    }
+
+    auto tieBreakerData = proto.getColumns().getTieBreaker();
+    auto tieBreaker = proto.initTieBreaker(numColumns);
+    for (UInt i = 0; i < numColumns; i++)
+    {
+      Real32 value;
+      ::memcpy(&value, tieBreakerData.begin() + i * sizeof(Real32),
+               sizeof(Real32));
+      tieBreaker.set(i, value);
+    }
+
+    vector<Real> columnValues(numColumns);
+    sp1.getOverlapDutyCycles(columnValues.data());
+    auto overlapDutyCycles = proto.initOverlapDutyCycles(numColumns);
+    for (UInt i = 0; i < numColumns; i++)
+    {
+      overlapDutyCycles.set(i, columnValues[i]);
+    }
+    sp1.getActiveDutyCycles(columnValues.data());
+    auto activeDutyCycles = proto.initActiveDutyCycles(numColumns);
+    for (UInt i = 0; i < numColumns; i++)
+    {
+      activeDutyCycles.set(i, columnValues[i]);
+    }
+    sp1.getMinOverlapDutyCycles(columnValues.data());
+    auto minOverlapDutyCycles = proto.initMinOverlapDutyCycles(numColumns);
+    for (UInt i = 0; i < numColumns; i++)
+    {
+      minOverlapDutyCycles.set(i, columnValues[i]);
+    }
+    sp1.getBoostFactors(columnValues.data());
+    auto boostFactors = proto.initBoostFactors(numColumns);
+    for (UInt i = 0; i < numColumns; i++)
+    {
+      boostFactors.set(i, columnValues[i]);
+    }
+
+    // Drop the arrays, so only the lists can be read
+    proto.initColumns();
+
+    SpatialPooler sp2;
+    SpatialPoolerProto::Reader reader = proto.asReader();
+    sp2.read(reader);
+    ASSERT_NO_FATAL_FAILURE(check_spatial_eq(sp1, sp2));
+
+    vector<UInt> active2(50);
+    sp1.compute(input.data(), true, active.data());
+    sp2.compute(input.data(), true, active2.data());
+    EXPECT_EQ(active, active2);
+
+    proto.setColumnsFormat(2);
+    reader = proto.asReader();
+    EXPECT_THROW(sp2.read(reader), std::exception);
+  }
+
+  // Learns on random inputs, and returns the fraction of active columns
+  // that both poolers agree on.
+  Real learnTogether(SpatialPooler& sp1, SpatialPooler& sp2, UInt steps)
+  {
+    const UInt numInputs = sp1.getNumInputs();
+    const UInt numColumns = sp1.getNumColumns();
+    Random rng(42);
+    vector<UInt> input(numInputs), active1(numColumns), active2(numColumns);
+    UInt same = 0, total = 0;
+    for (UInt step = 0; step < steps; step++)
+    {
+      for (UInt i = 0; i < numInputs; i++)
+      {
+        input[i] = rng.getReal64() < 0.2 ? 1 : 0;
+      }
+      sp1.compute(input.data(), true, active1.data());
+      sp2.compute(input.data(), true, active2.data());
+      for (UInt i = 0; i < numColumns; i++)
+      {
+        same += active1[i] && active2[i];
+        total += active1[i];
+      }
+    }
+    return (Real) same / total;
+  }
+
+  // Checks that the permanences are on the grid, and that the connected
+  // synapses are those at or above the connected permanence.
+  void checkQuantized(SpatialPooler& sp, UInt bits)
+  {
+    const UInt numInputs = sp.getNumInputs();
+    const Real step = 1.0f / ((1 << bits) - 1);
+    vector<Real> perm(numInputs);
+    vector<UInt> connected(numInputs);
+    for (UInt column = 0; column < sp.getNumColumns(); column++)
+    {
+      sp.getPermanence(column, perm.data());
+      sp.getConnectedSynapses(column, connected.data());
+      for (UInt i = 0; i < numInputs; i++)
+      {
+        const Real level = perm[i] / step;
+        ASSERT_NEAR(level, std::floor(level + 0.5f), 1e-3);
+        ASSERT_EQ(perm[i] >= sp.getSynPermConnected() - 0.00001,
+                  connected[i] != 0);
+      }
+    }
+  }
+
+  TEST(SpatialPoolerTest, QuantizedPermanences16)
+  {
+    SpatialPooler sp1({100}, {200});
+    SpatialPooler sp2({100}, {200});
+    sp2.setPermanenceBits(16);
+    ASSERT_EQ(16, sp2.getPermanenceBits());
+    ASSERT_NO_FATAL_FAILURE(checkQuantized(sp2, 16));
+
+    // Steps of 0.0000153: the poolers hardly ever disagree.
+    EXPECT_GT(learnTogether(sp1, sp2, 200), 0.98);
+    ASSERT_NO_FATAL_FAILURE(checkQuantized(sp2, 16));
+  }
+
+  TEST(SpatialPoolerTest, QuantizedPermanences8)
+  {
+    SpatialPooler sp1({100}, {200});
+    SpatialPooler sp2({100}, {200});
+    sp2.setPermanenceBits(8);
+    ASSERT_NO_FATAL_FAILURE(checkQuantized(sp2, 8));
+
+    // Steps of 0.0039, and increments rounded to them: the poolers drift
+    // apart a little.
+    EXPECT_GT(learnTogether(sp1, sp2, 200), 0.8);
+    ASSERT_NO_FATAL_FAILURE(checkQuantized(sp2, 8));
+
+    // Back to floats, keeping the rounded permanences.
+    sp2.setPermanenceBits(0);
+    ASSERT_EQ(0, sp2.getPermanenceBits());
+    ASSERT_NO_FATAL_FAILURE(checkQuantized(sp2, 8));
+  }
+
+  TEST(SpatialPoolerTest, QuantizedPermanencesSetPotential)
+  {
+    SpatialPooler sp({10}, {4}, /*potentialRadius*/ 10, /*potentialPct*/ 1.0);
+    sp.setPermanenceBits(8);
+
+    Real perm[10] = {0.5f, 0.05f, 0.5f, 0, 0, 0, 0, 0, 0, 0};
+    sp.setPermanence(0, perm);
+
+    UInt potential[10] = {1, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+    sp.setPotential(0, potential);
+
+    Real actual[10];
+    sp.getPermanence(0, actual);
+    EXPECT_NEAR(0.5f, actual[0], 0.002);
+    EXPECT_NEAR(0.05f, actual[1], 0.002);
+    EXPECT_EQ(0, actual[2]);
+
+    UInt connected[10];
+    sp.getConnectedSynapses(0, connected);
+    EXPECT_EQ(1, connected[0]);
+    EXPECT_EQ(0, connected[2]);
+  }
+
+  TEST(SpatialPoolerTest, QuantizedPermanencesSerialization)
+  {
+    const char* filename = "SpatialPoolerSerialization.tmp";
+    SpatialPooler sp1({100}, {200});
+    sp1.setPermanenceBits(8);
+    SpatialPooler sp2, sp3;
+
+    ofstream outfile(filename);
+    sp1.save(outfile);
+    outfile.close();
+    ifstream infile(filename);
+    sp2.load(infile);
+    infile.close();
+    ASSERT_NO_FATAL_FAILURE(check_spatial_eq(sp1, sp2));
+
+    ofstream os(filename, ios::binary);
+    sp1.write(os);
+    os.close();
+    ifstream is(filename, ios::binary);
+    sp3.read(is);
+    is.close();
+    ASSERT_NO_FATAL_FAILURE(check_spatial_eq(sp1, sp3));
+
+    int ret = ::remove(filename);
+    ASSERT_TRUE(ret == 0) << "Failed to delete " << filename;
+  }
+
+  // Checks that infer() with its own state gives the outputs of compute()
+  // without learning, with many streams sharing the spatial pooler.
+  void checkInfer(SpatialPooler& sp)
+  {
+    const UInt numInputs = sp.getNumInputs();
+    const UInt numColumns = sp.getNumColumns();
+    const UInt numStreams = 4, steps = 20;
+
+    Random rng(7);
+    vector<UInt> input(numInputs), active(numColumns);
+    for (UInt step = 0; step < 50; step++)
+    {
+      for (UInt i = 0; i < numInputs; i++)
+        input[i] = rng.getReal64() < 0.2 ? 1 : 0;
+      sp.compute(input.data(), true, active.data());
+    }
+
+    vector<vector<UInt> > inputs(numStreams * steps, vector<UInt>(numInputs));
+    vector<vector<UInt> > expected(inputs.size(), vector<UInt>(numColumns));
+    vector<vector<UInt> > expectedOverlaps(inputs.size());
+    for (UInt k = 0; k < inputs.size(); k++)
+    {
+      for (UInt i = 0; i < numInputs; i++)
+        inputs[k][i] = rng.getReal64() < 0.2 ? 1 : 0;
+      sp.compute(inputs[k].data(), false, expected[k].data());
+      expectedOverlaps[k] = sp.getOverlaps();
+    }
+
+    const UInt iterationNum = sp.getIterationNum();
+    const SpatialPooler& shared = sp;
+    vector<vector<UInt> > actual(inputs.size(), vector<UInt>(numColumns));
+    vector<vector<UInt> > actualOverlaps(inputs.size());
+    vector<std::thread> threads;
+    for (UInt stream = 0; stream < numStreams; stream++)
+    {
+      threads.emplace_back([&, stream]() {
+        SpatialPoolerState state;
+        for (UInt k = stream; k < inputs.size(); k += numStreams)
+        {
+          shared.infer(inputs[k].data(), actual[k].data(), state);
+          actualOverlaps[k] = state.overlaps;
+        }
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+
+    ASSERT_EQ(iterationNum, sp.getIterationNum());
+    for (UInt k = 0; k < inputs.size(); k++)
+    {
+      ASSERT_EQ(expected[k], actual[k]);
+      ASSERT_EQ(expectedOverlaps[k], actualOverlaps[k]);
+    }
+  }
+
+  TEST(SpatialPoolerTest, ComputeSparseMatchesCompute)
+  {
+    SpatialPooler dense({64}, {128}), sparse({64}, {128});
+    Random rng(42);
+    vector<UInt> input(64), active(128), activeColumns;
+    for (UInt i = 0; i < 20; i++)
+    {
+      vector<UInt> indices;
+      for (UInt j = 0; j < 64; j++)
+      {
+        input[j] = rng.getReal64() < 0.2;
+        if (input[j])
+          indices.push_back(j);
+      }
+      dense.compute(input.data(), i % 2 == 0, active.data());
+      sparse.computeSparse(indices.data(), indices.size(), i % 2 == 0,
+                           activeColumns);
+
+      vector<UInt> expected;
+      for (UInt column = 0; column < active.size(); column++)
+      {
+        if (active[column])
+          expected.push_back(column);
+      }
+      ASSERT_EQ(expected, activeColumns);
+    }
+    ASSERT_NO_FATAL_FAILURE(check_spatial_eq(dense, sparse));
+
+    // An invalid index is rejected before anything is computed
+    const UInt invalid[] = {3, 64};
+    EXPECT_THROW(sparse.computeSparse(invalid, 2, true, activeColumns),
+                 std::exception);
+    ASSERT_EQ(dense.getIterationNum(), sparse.getIterationNum());
+  }
+
+  TEST(SpatialPoolerTest, SharedInferenceGlobal)
+  {
+    SpatialPooler sp({100}, {200});
+    ASSERT_NO_FATAL_FAILURE(checkInfer(sp));
+  }
+
+  TEST(SpatialPoolerTest, SharedInferenceLocal)
+  {
+    SpatialPooler sp({10, 10}, {16, 16}, /*potentialRadius*/ 4,
+                     /*potentialPct*/ 0.5, /*globalInhibition*/ false,
+                     /*localAreaDensity*/ -1.0,
+                     /*numActiveColumnsPerInhArea*/ 5);
+    ASSERT_NO_FATAL_FAILURE(checkInfer(sp));
+  }
+
+  // Initializes a local inhibition pooler with the given InitMode
+  void initializeWithMode(SpatialPooler& sp, SpatialPooler::InitMode mode,
+                          UInt nThreads, UInt permanenceBits = 0)
+  {
+    sp.setInitMode(mode, nThreads);
+    sp.initialize({20, 20}, {16, 16}, /*potentialRadius*/ 5,
+                  /*potentialPct*/ 0.5, /*globalInhibition*/ false,
+                  /*localAreaDensity*/ -1.0,
+                  /*numActiveColumnsPerInhArea*/ 5,
+                  /*stimulusThreshold*/ 2);
+    // setPermanenceBits creates every column, which initLazy defers
+    if (permanenceBits != 0)
+    {
+      sp.setPermanenceBits(permanenceBits);
+    }
+  }
+
+  TEST(SpatialPoolerTest, InitParallelIsDeterministic)
+  {
+    for (UInt bits : {0, 8})
+    {
+      SpatialPooler sp1, sp2, sp3;
+      initializeWithMode(sp1, SpatialPooler::initParallel, 1, bits);
+      initializeWithMode(sp2, SpatialPooler::initParallel, 3, bits);
+      initializeWithMode(sp3, SpatialPooler::initSerial, 1, bits);
+      ASSERT_NO_FATAL_FAILURE(check_spatial_eq(sp1, sp2));
+
+      // The columns are drawn like the serial ones, from other streams
+      vector<UInt> counts(sp1.getNumColumns());
+      sp1.getConnectedCounts(counts.data());
+      vector<UInt> potential(sp1.getNumInputs());
+      for (UInt i = 0; i < sp1.getNumColumns(); i++)
+      {
+        sp1.getPotential(i, potential.data());
+        EXPECT_EQ(61, countNonzero(potential));
+        EXPECT_LE(2, counts[i]);
+      }
+      EXPECT_EQ(sp3.getInhibitionRadius(), sp1.getInhibitionRadius());
+    }
+  }
+
+  TEST(SpatialPoolerTest, InitLazyMatchesParallel)
+  {
+    SpatialPooler eager, lazy;
+    initializeWithMode(eager, SpatialPooler::initParallel, 2);
+    initializeWithMode(lazy, SpatialPooler::initLazy, 2);
+
+    // The const accessors don't create pending columns
+    const UInt numInputs = eager.getNumInputs();
+    vector<UInt> potential1(numInputs), potential2(numInputs);
+    vector<Real> perm1(numInputs), perm2(numInputs);
+    vector<UInt> counts(lazy.getNumColumns());
+    EXPECT_THROW(lazy.getPotential(200, potential2.data()), std::exception);
+    EXPECT_THROW(lazy.getConnectedCounts(counts.data()), std::exception);
+    EXPECT_THROW(lazy.getInhibitionRadius(), std::exception);
+
+    // A column is created on its own by its setters
+    for (UInt column : {200, 3})
+    {
+      eager.getPermanence(column, perm1.data());
+      lazy.setPermanence(column, perm1.data());
+      eager.getPotential(column, potential1.data());
+      lazy.getPotential(column, potential2.data());
+      EXPECT_EQ(potential1, potential2);
+      lazy.getPermanence(column, perm2.data());
+      EXPECT_EQ(perm1, perm2);
+    }
+
+    // and the others by the first compute
+    vector<UInt> input(numInputs), active1(256), active2(256);
+    Random rng(7);
+    for (UInt i = 0; i < 10; i++)
+    {
+      for (UInt& bit : input)
+      {
+        bit = rng.getReal64() < 0.2;
+      }
+      eager.compute(input.data(), true, active1.data());
+      lazy.compute(input.data(), true, active2.data());
+      ASSERT_EQ(active1, active2);
+    }
+    ASSERT_NO_FATAL_FAILURE(check_spatial_eq(eager, lazy));
+  }
+
+  TEST(SpatialPoolerTest, InitLazyKeepsInhibitionRadius)
+  {
+    SpatialPooler eager, lazy;
+    initializeWithMode(eager, SpatialPooler::initParallel, 2);
+    initializeWithMode(lazy, SpatialPooler::initLazy, 2);
+
+    // Creating the columns doesn't override an explicit radius
+    lazy.setInhibitionRadius(eager.getInhibitionRadius() + 3);
+    EXPECT_EQ(eager.getInhibitionRadius() + 3, lazy.getInhibitionRadius());
+    lazy.initializeColumns();
+    EXPECT_EQ(eager.getInhibitionRadius() + 3, lazy.getInhibitionRadius());
+
+    // but otherwise computes it, like initParallel
+    initializeWithMode(lazy, SpatialPooler::initLazy, 2);
+    lazy.initializeColumns();
+    EXPECT_EQ(eager.getInhibitionRadius(), lazy.getInhibitionRadius());
+  }
+
+  TEST(SpatialPoolerTest, InitLazyInferNeedsColumns)
+  {
+    SpatialPooler eager, lazy;
+    initializeWithMode(eager, SpatialPooler::initParallel, 2);
+    initializeWithMode(lazy, SpatialPooler::initLazy, 2);
+
+    const UInt numInputs = eager.getNumInputs();
+    vector<UInt> input(numInputs), active1(256), active2(256);
+    Random rng(7);
+    for (UInt& bit : input)
+    {
+      bit = rng.getReal64() < 0.2;
+    }
+
+    // infer() may run on several threads, so it doesn't create columns
+    SpatialPoolerState state1, state2;
+    EXPECT_THROW(lazy.infer(input.data(), active2.data(), state2),
+                 std::exception);
+
+    lazy.initializeColumns();
+    eager.infer(input.data(), active1.data(), state1);
+    lazy.infer(input.data(), active2.data(), state2);
+    ASSERT_EQ(active1, active2);
+    ASSERT_EQ(state1.overlaps, state2.overlaps);
+  }
+
 } // end anonymous namespace
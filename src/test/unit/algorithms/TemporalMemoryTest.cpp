@@ -24,12 +24,15 @@
  * Implementation of unit tests for TemporalMemory
  */
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <set>
 #include <stdio.h>
 #include <nupic/math/StlIo.hpp>
 #include <nupic/types/Types.hpp>
 #include <nupic/utils/Log.hpp>
+#include <nupic/utils/Random.hpp>
 
 #include <nupic/algorithms/TemporalMemory.hpp>
 #include "gtest/gtest.h"
@@ -1295,6 +1298,86 @@ namespace {
     EXPECT_EQ(before, tm.connections);
   }
 
+  /**
+   * The active and matching segments, found from the touched segments only,
+   * match a scan of every segment. Few segments per cell, so segments get
+   * destroyed and their flat indices reused while learning.
+   */
+  TEST(TemporalMemoryTest, ActiveAndMatchingSegmentsMatchFullScan)
+  {
+    TemporalMemory tm(
+      /*columnDimensions*/ {64},
+      /*cellsPerColumn*/ 4,
+      /*activationThreshold*/ 3,
+      /*initialPermanence*/ 0.55,
+      /*connectedPermanence*/ 0.50,
+      /*minThreshold*/ 2,
+      /*maxNewSynapseCount*/ 6,
+      /*permanenceIncrement*/ 0.10,
+      /*permanenceDecrement*/ 0.10,
+      /*predictedSegmentDecrement*/ 0.02,
+      /*seed*/ 42,
+      /*maxSegmentsPerCell*/ 2);
+
+    Random rng(42);
+    vector<vector<UInt>> patterns;
+    for (UInt i = 0; i < 12; i++)
+    {
+      vector<UInt> columns(64);
+      for (UInt c = 0; c < 64; c++)
+      {
+        columns[c] = c;
+      }
+      rng.shuffle(columns.begin(), columns.end());
+      columns.resize(6);
+      std::sort(columns.begin(), columns.end());
+      patterns.push_back(columns);
+    }
+
+    UInt stepsWithActiveSegments = 0;
+    for (UInt step = 0; step < 200; step++)
+    {
+      const vector<UInt>& columns = patterns[rng.getUInt32(12)];
+      tm.compute(columns.size(), columns.data(), step < 150);
+
+      const UInt32 length = tm.connections.segmentFlatListLength();
+      vector<UInt32> numActiveConnected(length, 0);
+      vector<UInt32> numActivePotential(length, 0);
+      tm.connections.computeActivity(numActiveConnected, numActivePotential,
+                                     tm.getActiveCells(),
+                                     tm.getConnectedPermanence());
+
+      set<UInt32> expectedActive, expectedMatching;
+      for (UInt32 i = 0; i < length; i++)
+      {
+        if (numActiveConnected[i] >= tm.getActivationThreshold())
+        {
+          expectedActive.insert(i);
+        }
+        if (numActivePotential[i] >= tm.getMinThreshold())
+        {
+          expectedMatching.insert(i);
+        }
+      }
+
+      set<UInt32> active, matching;
+      for (Segment segment : tm.getActiveSegments())
+      {
+        active.insert(segment.flatIdx);
+      }
+      for (Segment segment : tm.getMatchingSegments())
+      {
+        matching.insert(segment.flatIdx);
+      }
+      ASSERT_EQ(expectedActive, active) << "step " << step;
+      ASSERT_EQ(expectedMatching, matching) << "step " << step;
+      ASSERT_EQ(expectedActive.size(), tm.getActiveSegments().size());
+      ASSERT_EQ(expectedMatching.size(), tm.getMatchingSegments().size());
+      stepsWithActiveSegments += !active.empty();
+    }
+    EXPECT_GT(stepsWithActiveSegments, 0);
+  }
+
   TEST(TemporalMemoryTest, testColumnForCell1D)
   {
     TemporalMemory tm;
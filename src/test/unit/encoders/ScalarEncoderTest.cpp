@@ -27,6 +27,10 @@
 #include <string>
 #include <vector>
 #include <nupic/encoders/ScalarEncoder.hpp>
+#include <nupic/engine/Network.hpp>
+#include <nupic/engine/Output.hpp>
+#include <nupic/engine/Region.hpp>
+#include <nupic/ntypes/Array.hpp>
 #include "gtest/gtest.h"
 
 using namespace nupic;
@@ -77,6 +81,18 @@ void doScalarValueCases(ScalarEncoderBase& e, std::vector<ScalarValueCase> cases
             << "ACTUAL:" << std::endl
             << vec2str(actualOutput);
         }
+
+      // The sparse encoding should list the same bits, in increasing order
+      auto actualIndices = std::vector<UInt32>(e.getActiveBitCount());
+      e.encodeIntoIndices(c->input, &actualIndices[0]);
+      std::vector<UInt32> expectedIndices;
+      for (int i = 0; i < e.getOutputWidth(); i++)
+        {
+          if (c->expectedOutput[i] != 0)
+            expectedIndices.push_back(i);
+        }
+      EXPECT_EQ(expectedIndices, actualIndices)
+        << "For input " << c->input;
     }
 }
 
@@ -218,3 +234,81 @@ TEST(PeriodicScalarEncoder, FloorToNearestMultipleOfResolution)
 
   doScalarValueCases(encoder, cases);
 }
+
+TEST(ScalarEncoder, EncodeBatch)
+{
+  ScalarEncoder encoder(3, 0, 10, 0, 0, 1, true);
+  PeriodicScalarEncoder periodic(3, 0, 10, 0, 0, 1);
+
+  const Real64 inputs[] = {0.0, 4.6, 9.5};
+  std::vector<UInt32> indices(3 * 3);
+  std::vector<Int32> buckets(3);
+
+  encoder.encodeBatch(inputs, 3, &indices[0], &buckets[0]);
+  EXPECT_EQ(std::vector<UInt32>({0, 1, 2, 5, 6, 7, 10, 11, 12}), indices);
+  EXPECT_EQ(std::vector<Int32>({0, 5, 10}), buckets);
+
+  periodic.encodeBatch(inputs, 3, &indices[0]);
+  EXPECT_EQ(std::vector<UInt32>({0, 1, 9, 3, 4, 5, 0, 8, 9}), indices);
+}
+
+TEST(ScalarSensor, ActiveBitsOutput)
+{
+  Network net;
+  Region* sensor = net.addRegion(
+    "sensor", "ScalarSensor",
+    "{w: 3, minValue: 0, maxValue: 10, resolution: 1, periodic: true}");
+  net.initialize();
+
+  const Array& encoded = sensor->getOutput("encoded")->getData();
+  const Array& activeBits = sensor->getOutput("activeBits")->getData();
+  ASSERT_EQ(3u, activeBits.getCount());
+
+  const Real64 inputs[] = {5.0, 9.0, 0.0, 5.0};
+  for (Real64 input : inputs)
+  {
+    sensor->setParameterReal64("sensedValue", input);
+    net.run(1);
+
+    PeriodicScalarEncoder encoder(3, 0, 10, 0, 0, 1);
+    std::vector<Real32> expected = getEncoding(encoder, input);
+    std::vector<Real32> actual((Real32*)encoded.getBuffer(),
+                               (Real32*)encoded.getBuffer() + encoded.getCount());
+    EXPECT_EQ(expected, actual) << "For input " << input;
+
+    UInt32* bits = (UInt32*)activeBits.getBuffer();
+    for (size_t i = 0; i < activeBits.getCount(); i++)
+    {
+      EXPECT_EQ(1, actual[bits[i]]);
+    }
+  }
+}
+
+TEST(ScalarSensor, InvalidInputKeepsOutputs)
+{
+  Network net;
+  Region* sensor = net.addRegion(
+    "sensor", "ScalarSensor",
+    "{w: 3, minValue: 0, maxValue: 10, resolution: 1, clipInput: false}");
+  net.initialize();
+
+  const Array& encoded = sensor->getOutput("encoded")->getData();
+  ScalarEncoder encoder(3, 0, 10, 0, 0, 1, false);
+
+  sensor->setParameterReal64("sensedValue", 5.0);
+  net.run(1);
+
+  // A failed encoding leaves the previous one in place
+  sensor->setParameterReal64("sensedValue", 20.0);
+  EXPECT_THROW(net.run(1), std::exception);
+  std::vector<Real32> actual((Real32*)encoded.getBuffer(),
+                             (Real32*)encoded.getBuffer() + encoded.getCount());
+  EXPECT_EQ(getEncoding(encoder, 5.0), actual);
+
+  // and the next one replaces it entirely
+  sensor->setParameterReal64("sensedValue", 9.0);
+  net.run(1);
+  actual.assign((Real32*)encoded.getBuffer(),
+                (Real32*)encoded.getBuffer() + encoded.getCount());
+  EXPECT_EQ(getEncoding(encoder, 9.0), actual);
+}
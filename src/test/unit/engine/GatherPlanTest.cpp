@@ -0,0 +1,102 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Implementation of GatherPlan test
+ */
+
+#include <vector>
+
+#include <nupic/engine/GatherPlan.hpp>
+#include "gtest/gtest.h"
+
+using namespace nupic;
+
+TEST(GatherPlanTest, CompilesIndicesIntoRuns)
+{
+  const size_t indices[] = {4, 5, 6, 7, 20, 22, 24, 9, 1, 2};
+  GatherPlan plan;
+  for (size_t index : indices)
+    plan.append(index);
+
+  ASSERT_EQ(10u, plan.size());
+  const std::vector<GatherRun>& runs = plan.getRuns();
+  ASSERT_EQ(4u, runs.size());
+  EXPECT_EQ(4u, runs[0].offset);
+  EXPECT_EQ(4u, runs[0].count);
+  EXPECT_EQ(1u, runs[0].stride);
+  EXPECT_EQ(20u, runs[1].offset);
+  EXPECT_EQ(3u, runs[1].count);
+  EXPECT_EQ(2u, runs[1].stride);
+  EXPECT_EQ(9u, runs[2].offset);
+  EXPECT_EQ(1u, runs[2].count);
+  EXPECT_EQ(1u, runs[3].offset);
+  EXPECT_EQ(2u, runs[3].count);
+  EXPECT_EQ(1u, runs[3].stride);
+
+  std::vector<size_t> expanded;
+  plan.expand(expanded);
+  ASSERT_EQ(std::vector<size_t>(indices, indices + 10), expanded);
+}
+
+TEST(GatherPlanTest, AppendSpanAndPlan)
+{
+  GatherPlan plan;
+  plan.appendSpan(0, 3);
+  plan.appendSpan(3, 2);
+  plan.appendSpan(10, 0);
+  plan.appendSpan(8, 2);
+  ASSERT_EQ(7u, plan.size());
+  ASSERT_EQ(2u, plan.getRuns().size());
+
+  GatherPlan shifted;
+  shifted.append(1);
+  shifted.appendPlan(plan, 2);
+  std::vector<size_t> expanded;
+  shifted.expand(expanded);
+  const size_t expected[] = {1, 2, 3, 4, 5, 6, 10, 11};
+  ASSERT_EQ(std::vector<size_t>(expected, expected + 8), expanded);
+  ASSERT_EQ(2u, shifted.getRuns().size());
+
+  shifted.clear();
+  ASSERT_EQ(0u, shifted.size());
+  ASSERT_TRUE(shifted.getRuns().empty());
+}
+
+TEST(GatherPlanTest, Gather)
+{
+  std::vector<int> src(32);
+  for (size_t i = 0; i < src.size(); i++)
+    src[i] = (int) i * 10;
+
+  const size_t indices[] = {30, 3, 4, 5, 6, 12, 15, 18, 0};
+  GatherPlan plan;
+  for (size_t index : indices)
+    plan.append(index);
+
+  std::vector<int> dest(plan.size() + 1, -1);
+  plan.gather(&src[0], &dest[0]);
+  for (size_t i = 0; i < plan.size(); i++)
+    ASSERT_EQ(src[indices[i]], dest[i]);
+  ASSERT_EQ(-1, dest[plan.size()]);
+}
@@ -24,7 +24,10 @@
  * Implementation of Input test
  */
 
+#include <cstring>
+
 #include <nupic/engine/Input.hpp>
+#include <nupic/engine/Link.hpp>
 #include <nupic/engine/Network.hpp>
 #include <nupic/ntypes/Dimensions.hpp>
 #include <nupic/engine/Region.hpp>
@@ -159,6 +162,37 @@ TEST(InputTest, Links)
   }
 }
 
+TEST(InputTest, PaddedData)
+{
+  Network net;
+  Region * region1 = net.addRegion("region1", "TestNode", "");
+  Region * region2 = net.addRegion("region2", "TestNode", "");
+
+  Dimensions d1;
+  d1.push_back(8);
+  d1.push_back(4);
+  region1->setDimensions(d1);
+
+  net.link("region1", "region2", "TestFanIn2", "");
+  net.initialize();
+  net.run(2);
+
+  //TestNode's bottomUpIn requires a splitter map, so its data is followed
+  //by a zero sentinel in the same buffer
+  Input * in = region2->getInput("bottomUpIn");
+  const Array & data = in->getData();
+  const Array padded = in->getPaddedData();
+  ASSERT_EQ(data.getCount() + 1, padded.getCount());
+  ASSERT_EQ(data.getBuffer(), padded.getBuffer());
+  ASSERT_EQ(0.0, ((Real64*)padded.getBuffer())[data.getCount()]);
+
+  //the links still fill the data
+  const Array & out = region1->getOutput("bottomUpOut")->getData();
+  ASSERT_EQ(out.getCount(), data.getCount());
+  ASSERT_EQ(0, ::memcmp(out.getBuffer(), data.getBuffer(),
+                        out.getCount() * sizeof(Real64)));
+}
+
 TEST(InputTest, SplitterMap)
 {
   Network net;
@@ -243,6 +277,22 @@ TEST(InputTest, SplitterMap)
   ASSERT_EQ(6, input[1]);
   ASSERT_EQ(15, input[7]);
 
+  //test getGatherPlan() and the non-allocating getInputForNode()
+  for (size_t node = 0; node < sm.size(); node++)
+  {
+    const GatherPlan& plan = in2->getGatherPlan(node);
+    std::vector<size_t> expanded;
+    plan.expand(expanded);
+    ASSERT_EQ(sm[node], expanded);
+
+    in2->getInputForNode(node, input);
+    std::vector<Real64> nodeInput(plan.size());
+    ASSERT_EQ(plan.size(), in2->getInputForNode(node, &nodeInput[0]));
+    ASSERT_EQ(input, nodeInput);
+  }
+  // TestFanIn2 gathers two rows of four from a region of width 8
+  ASSERT_EQ(2u, in2->getGatherPlan(0).getRuns().size());
+
   //test getData()
   const ArrayBase * pa = &(in2->getData());
   ASSERT_EQ(64u, pa->getCount());
@@ -290,6 +340,12 @@ TEST(InputTest, LinkTwoRegionsOneInput)
   ASSERT_EQ(12u, sm[3][0]);
   ASSERT_EQ(31u, sm[3][7]);
 
+  //test Link::buildSplitterMap(), each link appends its block
+  std::vector< std::vector<size_t> > linkSm(sm.size());
+  for (Link * link : in3->getLinks())
+    link->buildSplitterMap(linkSm);
+  ASSERT_EQ(sm, linkSm);
+
   //test getInputForNode()
   std::vector<Real64> input;
   in3->getInputForNode(0, input);
@@ -114,3 +114,56 @@ TEST(NetworkFactory, EmptyRegions)
   const Collection<Region*> regionList = n.getRegions();
   ASSERT_EQ((UInt32)0, regionList.getCount());
 }
+
+TEST(NetworkFactory, ParamDeltas)
+{
+  NetworkFactory nf;
+  std::map<std::string, std::string> deltas;
+  deltas["level 2"] = "{int32Param: 7, real64Param: 1.5, boolParam: true}";
+  Network n = nf.createNetwork(Path::join(PATH_TO_FIXTURES, "network.yaml"),
+                               deltas);
+
+  const Collection<Region*> regionList = n.getRegions();
+  ASSERT_EQ((UInt32)3, regionList.getCount());
+  ASSERT_EQ(7, regionList.getByName("level 2")->getParameterInt32("int32Param"));
+  ASSERT_EQ(1.5, regionList.getByName("level 2")->getParameterReal64("real64Param"));
+  ASSERT_TRUE(regionList.getByName("level 2")->getParameterBool("boolParam"));
+  ASSERT_EQ(32, regionList.getByName("level 1")->getParameterInt32("int32Param"));
+  ASSERT_EQ(32, regionList.getByName("level 3")->getParameterInt32("int32Param"));
+
+  deltas.clear();
+  deltas["level 4"] = "{int32Param: 7}";
+  EXPECT_THROW(nf.createNetwork(Path::join(PATH_TO_FIXTURES, "network.yaml"),
+                                deltas),
+               std::exception);
+}
+
+TEST(NetworkFactory, CachedDescription)
+{
+  NetworkFactory nf;
+  const std::string path = Path::join(PATH_TO_FIXTURES, "network.yaml");
+  const NetworkDescription& d = nf.getDescription(path);
+  ASSERT_EQ(&d, &nf.getDescription(path));
+  ASSERT_EQ((size_t)3, d.regions.size());
+  ASSERT_EQ((size_t)3, d.links.size());
+  ASSERT_EQ("level 2", d.links[0].destRegion);
+
+  // Each network created from the description is independent
+  for (int i = 0; i < 3; i++)
+  {
+    Network n = nf.createNetwork(d);
+    ASSERT_EQ((UInt32)3, n.getRegions().getCount());
+  }
+}
+
+TEST(NetworkFactory, MergeParams)
+{
+  ASSERT_EQ("{a: 1, b: [1, 2]}",
+            NetworkFactory::mergeParams("{a: 1, b: [1, 2]}", ""));
+  ASSERT_EQ("{\"a\": \"3\", \"b\": [\"1\", \"2\"], \"c\": \"x \\\"y\\\"\"}",
+            NetworkFactory::mergeParams("{a: 1, b: [1, 2]}",
+                                        "{c: 'x \"y\"', a: 3}"));
+  ASSERT_EQ("{\"a\": \"1\"}", NetworkFactory::mergeParams("", "{a: 1}"));
+  EXPECT_THROW(NetworkFactory::mergeParams("[1, 2]", "{a: 1}"),
+               std::exception);
+}
@@ -29,7 +29,10 @@
 #include <nupic/engine/Network.hpp>
 #include <nupic/engine/NuPIC.hpp>
 #include <nupic/engine/Region.hpp>
+#include <nupic/ntypes/ArrayRef.hpp>
 #include <nupic/ntypes/Dimensions.hpp>
+#include <nupic/os/Directory.hpp>
+#include <nupic/os/Path.hpp>
 #include <nupic/utils/Log.hpp>
 
 using namespace nupic;
@@ -414,6 +417,47 @@ TEST(NetworkTest, Phases)
   computeHistory.clear();
 }
 
+static void reshapeDuringRun(Network* net, UInt64 iteration, void* data)
+{
+  if (iteration == 1)
+    net->removeRegion("level3");
+  else if (iteration == 2)
+    net->setMaxEnabledPhase(0);
+}
+
+TEST(NetworkTest, CallbackChangesNetwork)
+{
+  Network net;
+  Region *l1 = net.addRegion("level1", "TestNode", "");
+  Region *l2 = net.addRegion("level2", "TestNode", "");
+  Region *l3 = net.addRegion("level3", "TestNode", "");
+  Dimensions d;
+  d.push_back(2);
+  d.push_back(2);
+  l1->setDimensions(d);
+  l2->setDimensions(d);
+  net.link("level1", "level3", "TestFanIn2", "");
+  net.initialize();
+  l1->setParameterUInt64("computeCallback", (UInt64)recordCompute);
+  l2->setParameterUInt64("computeCallback", (UInt64)recordCompute);
+  l3->setParameterUInt64("computeCallback", (UInt64)recordCompute);
+
+  net.getCallbacks().add("reshape",
+                         Network::callbackItem(reshapeDuringRun, nullptr));
+
+  // Removing level3 and disabling phase 1 take effect on the next iteration
+  computeHistory.clear();
+  net.run(3);
+  ASSERT_EQ((UInt32)6, computeHistory.size());
+  EXPECT_STREQ("level1", computeHistory.at(0).c_str());
+  EXPECT_STREQ("level2", computeHistory.at(1).c_str());
+  EXPECT_STREQ("level3", computeHistory.at(2).c_str());
+  EXPECT_STREQ("level1", computeHistory.at(3).c_str());
+  EXPECT_STREQ("level2", computeHistory.at(4).c_str());
+  EXPECT_STREQ("level1", computeHistory.at(5).c_str());
+  computeHistory.clear();
+}
+
 TEST(NetworkTest, MinMaxPhase)
 {
   Network n;
@@ -526,6 +570,28 @@ TEST(NetworkTest, MinMaxPhase)
 
 }
 
+TEST(NetworkTest, RunCopiesLinks)
+{
+  Network n;
+  Region *l1 = n.addRegion("level1", "TestNode", "");
+  Region *l2 = n.addRegion("level2", "TestNode", "");
+  Dimensions d;
+  d.push_back(4);
+  d.push_back(4);
+  l1->setDimensions(d);
+  n.link("level1", "level2", "TestFanIn2", "");
+  n.run(2);
+
+  ArrayRef out = l1->getOutputData("bottomUpOut");
+  ArrayRef in = l2->getInputData("bottomUpIn");
+  ASSERT_EQ(out.getCount(), in.getCount());
+  Real64 *outValues = (Real64*)out.getBuffer();
+  Real64 *inValues = (Real64*)in.getBuffer();
+  for (size_t i = 0; i < out.getCount(); i++)
+    ASSERT_EQ(outValues[i], inValues[i]);
+  ASSERT_NE(0.0, inValues[0]);
+}
+
 TEST(NetworkTest, Callback)
 {
   Network n;
@@ -553,3 +619,96 @@ TEST(NetworkTest, Callback)
   EXPECT_STREQ("level3", mydata[5].c_str());
 
 }
+
+TEST(NetworkTest, Checkpoint)
+{
+  const std::string path = "NetworkTest_Checkpoint.ckpt";
+  if (Path::exists(path))
+    Directory::removeTree(path);
+
+  {
+    Network n;
+    Region *l1 = n.addRegion("level1", "TestNode", "");
+    n.addRegion("level2", "TestNode", "");
+    Dimensions d;
+    d.push_back(4);
+    d.push_back(4);
+    l1->setDimensions(d);
+    n.link("level1", "level2", "TestFanIn2", "");
+    n.run(2);
+
+    EXPECT_THROW(n.checkpoint("NetworkTest_Checkpoint.nta"), std::exception);
+
+    n.checkpoint(path);
+    n.waitForCheckpoint();
+    ASSERT_TRUE(Path::exists(Path::join(path, "network.yaml")));
+    ASSERT_TRUE(Path::exists(Path::join(path, "R0-1.capnp")));
+    ASSERT_TRUE(Path::exists(Path::join(path, "R1-1.capnp")));
+
+    // Only level2 changes, so only level2 is written again
+    n.getRegions().getByName("level2")->setParameterInt32("int32Param", 7);
+    n.checkpoint(path);
+    n.waitForCheckpoint();
+    EXPECT_TRUE(Path::exists(Path::join(path, "R0-1.capnp")));
+    EXPECT_FALSE(Path::exists(Path::join(path, "R1-1.capnp")));
+    EXPECT_TRUE(Path::exists(Path::join(path, "R1-2.capnp")));
+
+    Network n2(path);
+    ASSERT_EQ((size_t)2, n2.getRegions().getCount());
+    EXPECT_EQ(7, n2.getRegions().getByName("level2")->getParameterInt32("int32Param"));
+    EXPECT_EQ(n.getPhases("level2"), n2.getPhases("level2"));
+
+    n.run(1);
+    n2.run(1);
+    ArrayRef expected = n.getRegions().getByName("level2")->getOutputData("bottomUpOut");
+    ArrayRef actual = n2.getRegions().getByName("level2")->getOutputData("bottomUpOut");
+    ASSERT_EQ(expected.getCount(), actual.getCount());
+    for (size_t i = 0; i < expected.getCount(); i++)
+    {
+      EXPECT_EQ(((Real64*)expected.getBuffer())[i], ((Real64*)actual.getBuffer())[i]);
+    }
+
+    // Checkpoints in flight are completed by the destructor
+    n.checkpoint(path);
+  }
+
+  Directory::removeTree(path);
+}
+
+TEST(NetworkTest, CheckpointReplacedRegion)
+{
+  const std::string path = "NetworkTest_CheckpointReplacedRegion.ckpt";
+  if (Path::exists(path))
+    Directory::removeTree(path);
+
+  {
+    Dimensions d;
+    d.push_back(2);
+    Network n;
+    n.addRegion("level1", "TestNode", "")->setDimensions(d);
+    n.initialize();
+    n.checkpoint(path);
+    n.waitForCheckpoint();
+    EXPECT_TRUE(Path::exists(Path::join(path, "R0-1.capnp")));
+
+    // Nothing changed
+    n.checkpoint(path);
+    n.waitForCheckpoint();
+    EXPECT_TRUE(Path::exists(Path::join(path, "R0-1.capnp")));
+    EXPECT_FALSE(Path::exists(Path::join(path, "R0-2.capnp")));
+
+    // Same name and modification count, but a different region
+    n.removeRegion("level1");
+    n.addRegion("level1", "TestNode", "{int32Param: 7}")->setDimensions(d);
+    n.initialize();
+    n.checkpoint(path);
+    n.waitForCheckpoint();
+    EXPECT_FALSE(Path::exists(Path::join(path, "R0-1.capnp")));
+    EXPECT_TRUE(Path::exists(Path::join(path, "R0-3.capnp")));
+
+    Network n2(path);
+    EXPECT_EQ(7, n2.getRegions().getByName("level1")->getParameterInt32("int32Param"));
+  }
+
+  Directory::removeTree(path);
+}
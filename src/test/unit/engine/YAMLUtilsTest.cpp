@@ -244,3 +244,57 @@ TEST(YAMLUtilsTest, ParameterSpec)
       << __FILE__ << ":" << __LINE__ ;
   }
 }
+
+TEST(YAMLUtilsTest, DefaultValueMap)
+{
+  Collection<ParameterSpec> ps;
+  ps.add(
+    "int32Param", 
+    ParameterSpec(
+      "Int32 scalar parameter",  // description
+      NTA_BasicType_Int32,
+      1,                         // elementCount
+      "",                        // constraints
+      "32",                      // defaultValue
+      ParameterSpec::ReadWriteAccess));
+
+  ps.add(
+    "real64Param", 
+    ParameterSpec(
+      "Real64 scalar parameter",  // description
+      NTA_BasicType_Real64,
+      1,                         // elementCount
+      "",                        // constraints
+      "64.1",                    // defaultValue
+      ParameterSpec::ReadWriteAccess));
+
+  ps.add(
+    "int64ArrayParam",
+    ParameterSpec(
+      "int64 array parameter", 
+      NTA_BasicType_Int64,
+      0, // array
+      "", 
+      "[1, 2, 3]",
+      ParameterSpec::ReadWriteAccess));
+
+  ValueMap defaults = YAMLUtils::toDefaultValueMap(ps);
+  ASSERT_EQ((Int32)32, defaults.getScalarT<Int32>("int32Param"));
+  ASSERT_EQ((size_t)3, defaults.getArray("int64ArrayParam")->getCount());
+
+  // Same values as converting the defaults again
+  ValueMap vm = YAMLUtils::toValueMap("{ int32Param: 7 }", ps, defaults);
+  ValueMap expected = YAMLUtils::toValueMap("{ int32Param: 7 }", ps);
+  ASSERT_EQ((Int32)7, vm.getScalarT<Int32>("int32Param"));
+  ASSERT_EQ(expected.getScalarT<Real64>("real64Param"),
+            vm.getScalarT<Real64>("real64Param"));
+  boost::shared_ptr<Array> a = vm.getArray("int64ArrayParam");
+  ASSERT_EQ((size_t)3, a->getCount());
+  ASSERT_EQ(3, ((Int64*)a->getBuffer())[2]);
+
+  // The defaults are copied, not shared
+  ((Int64*)a->getBuffer())[2] = 4;
+  vm.getScalar("real64Param")->value.real64 = 0;
+  ASSERT_EQ(3, ((Int64*)defaults.getArray("int64ArrayParam")->getBuffer())[2]);
+  ASSERT_EQ(64.1, defaults.getScalarT<Real64>("real64Param"));
+}
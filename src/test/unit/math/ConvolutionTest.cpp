@@ -0,0 +1,313 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Unit tests for SeparableConvolution2D, Erosion and Rotation45
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <nupic/math/Convolution.hpp>
+#include <nupic/math/Erosion.hpp>
+#include <nupic/math/Rotation.hpp>
+#include <nupic/utils/Random.hpp>
+
+using namespace nupic;
+
+namespace {
+
+  std::vector<float> randomImage(Random& rng, size_t size)
+  {
+    std::vector<float> image(size);
+    for (float& x : image)
+      x = (float) (2 * rng.getReal64() - 1);
+    return image;
+  }
+
+  // Plain dot products over columns, then over rows, with zeros in the
+  // buffer columns the horizontal filter doesn't reach.
+  void referenceConvolution(size_t nrows, size_t ncols,
+                            const std::vector<float>& f1,
+                            const std::vector<float>& f2,
+                            const std::vector<float>& data,
+                            std::vector<float>& convolved)
+  {
+    std::vector<float> buffer(nrows * ncols, 0);
+    for (size_t i = 0; i != nrows; ++i)
+      for (size_t j = 0; j + f1.size() <= ncols; ++j) {
+        float dot = 0;
+        for (size_t k = 0; k != f1.size(); ++k)
+          dot += f1[k] * data[i*ncols + j + k];
+        buffer[i*ncols + j + f1.size()/2] = dot;
+      }
+
+    for (size_t i = 0; i + f2.size() <= nrows; ++i)
+      for (size_t j = 0; j != ncols; ++j) {
+        float dot = 0;
+        for (size_t k = 0; k != f2.size(); ++k)
+          dot += f2[k] * buffer[(i + k)*ncols + j];
+        convolved[(i + f2.size()/2)*ncols + j] = dot;
+      }
+  }
+
+  // One pass of a 3x3 min (or max) filter, a pixel at a time.
+  void referenceErosion(size_t nrows, size_t ncols, const float* in,
+                        float* out, bool dilate)
+  {
+    for (size_t i = 0; i != nrows; ++i)
+      for (size_t j = 0; j != ncols; ++j) {
+        if (!dilate && (i == 0 || j == 0 || i + 1 == nrows || j + 1 == ncols))
+        {
+          out[i*ncols + j] = 0;
+          continue;
+        }
+        float x = in[i*ncols + j];
+        for (size_t r = (i ? i - 1 : 0); r <= std::min(i + 1, nrows - 1); ++r)
+          for (size_t c = (j ? j - 1 : 0); c <= std::min(j + 1, ncols - 1);
+               ++c)
+            x = dilate ? std::max(x, in[r*ncols + c])
+                       : std::min(x, in[r*ncols + c]);
+        out[i*ncols + j] = x;
+      }
+  }
+
+  float round45(float x)
+  {
+    return floor(x + 0.5);
+  }
+
+  void referenceRotate(const float* original, float* rotated, size_t nrows,
+                       size_t ncols, size_t z)
+  {
+    size_t offset = size_t(float(ncols) * cos45);
+    for (int j = -1 * offset; j != int(z - offset); j++)
+      for (int i = 0; i != int(z); i++) {
+        int srow = int(round45(cos45 * float(j) + cos45 * float(i)));
+        int scol = int(round45(-1 * cos45 * float(j) + cos45 * float(i)));
+        if (0 <= srow && srow < int(nrows) && 0 <= scol && scol < int(ncols))
+          rotated[size_t(j + offset) * z + i] = original[srow * ncols + scol];
+      }
+  }
+
+  void referenceUnrotate(float* unrotated, const float* rotated, size_t nrows,
+                         size_t ncols, size_t z)
+  {
+    size_t offset = size_t(float(ncols) * cos45);
+    for (size_t j = 0; j != nrows; j++)
+      for (size_t i = 0; i != ncols; i++) {
+        int srow = int(round45(cos45 * float(j) + -1 * cos45 * float(i)));
+        int scol = int(round45(cos45 * float(j) + cos45 * float(i)));
+        srow += int(offset);
+        if (0 <= srow && srow < int(z) && 0 <= scol && scol < int(z))
+          unrotated[j * ncols + i] = rotated[srow * z + scol];
+      }
+  }
+
+  TEST(SeparableConvolution2DTest, MatchesReference)
+  {
+    Random rng(42);
+    // Sizes below and above the lane width and the column tile
+    const size_t sizes[][4] = {
+      {5, 7, 3, 3}, {16, 16, 5, 1}, {37, 300, 7, 9}, {20, 513, 1, 4}};
+    SeparableConvolution2D<float> convolution;
+
+    for (const auto& size : sizes) {
+      const size_t nrows = size[0], ncols = size[1];
+      std::vector<float> f1 = randomImage(rng, size[2]);
+      std::vector<float> f2 = randomImage(rng, size[3]);
+      std::vector<float> data = randomImage(rng, nrows * ncols);
+
+      std::vector<float> expected(nrows * ncols, -7);
+      referenceConvolution(nrows, ncols, f1, f2, data, expected);
+
+      // Re-initializing reuses the buffer from the previous size
+      convolution.init(nrows, ncols, f1.size(), f2.size(), f1.data(),
+                       f2.data());
+      std::vector<float> convolved(nrows * ncols, -7);
+      convolution.compute(data.data(), convolved.data());
+
+      ASSERT_EQ(expected, convolved) << nrows << "x" << ncols;
+    }
+  }
+
+  TEST(SeparableConvolution2DTest, BatchMatchesCompute)
+  {
+    Random rng(42);
+    const size_t nrows = 24, ncols = 40, nImages = 9;
+    std::vector<float> f1 = randomImage(rng, 5), f2 = randomImage(rng, 3);
+    std::vector<float> g1 = randomImage(rng, 3), g2 = randomImage(rng, 7);
+
+    SeparableConvolution2D<float> convolution, other;
+    convolution.init(nrows, ncols, 5, 3, f1.data(), f2.data());
+    other.init(nrows, ncols, 3, 7, g1.data(), g2.data());
+
+    std::vector<std::vector<float> > images, expected, expectedOther;
+    for (size_t k = 0; k != nImages; ++k) {
+      images.push_back(randomImage(rng, nrows * ncols));
+      expected.push_back(std::vector<float>(nrows * ncols, 0));
+      convolution.compute(images[k].data(), expected[k].data());
+      expectedOther.push_back(std::vector<float>(nrows * ncols, 0));
+      other.compute(images[k].data(), expectedOther[k].data());
+    }
+
+    for (size_t nThreads : {1, 3, 0}) {
+      std::vector<std::vector<float> > convolved(
+        nImages, std::vector<float>(nrows * ncols, 0));
+      std::vector<const float*> data;
+      std::vector<float*> out;
+      for (size_t k = 0; k != nImages; ++k) {
+        data.push_back(images[k].data());
+        out.push_back(convolved[k].data());
+      }
+      convolution.computeBatch(nImages, data.data(), out.data(), nThreads);
+      ASSERT_EQ(expected, convolved);
+
+      // Alternate filter pairs, one per image. They write different rows.
+      for (std::vector<float>& image : convolved)
+        std::fill(image.begin(), image.end(), 0);
+      std::vector<const SeparableConvolution2D<float>*> convolutions;
+      for (size_t k = 0; k != nImages; ++k)
+        convolutions.push_back(k % 2 ? &other : &convolution);
+      computeSeparableConvolutions(nImages, convolutions.data(), data.data(),
+                                   out.data(), nThreads);
+      for (size_t k = 0; k != nImages; ++k)
+        ASSERT_EQ(k % 2 ? expectedOther[k] : expected[k], convolved[k]);
+    }
+  }
+
+  TEST(ErosionTest, MatchesReference)
+  {
+    Random rng(42);
+    const size_t sizes[][2] = {{2, 2}, {3, 9}, {17, 31}, {40, 12}};
+    Erosion<float> erosion;
+
+    for (const auto& size : sizes) {
+      const size_t nrows = size[0], ncols = size[1];
+      std::vector<float> data = randomImage(rng, nrows * ncols);
+      erosion.init(nrows, ncols);
+
+      for (bool dilate : {false, true}) {
+        std::vector<float> expected = data, tmp(nrows * ncols);
+        for (size_t iter = 0; iter != 3; ++iter) {
+          referenceErosion(nrows, ncols, expected.data(), tmp.data(), dilate);
+          expected.swap(tmp);
+        }
+
+        std::vector<float> eroded(nrows * ncols);
+        erosion.compute(data.data(), eroded.data(), 3, dilate);
+        ASSERT_EQ(expected, eroded) << nrows << "x" << ncols;
+      }
+    }
+  }
+
+  TEST(ErosionTest, BatchMatchesCompute)
+  {
+    Random rng(42);
+    const size_t nrows = 19, ncols = 23, nImages = 5;
+    Erosion<float> erosion;
+    erosion.init(nrows, ncols);
+
+    std::vector<std::vector<float> > images, expected;
+    for (size_t k = 0; k != nImages; ++k) {
+      images.push_back(randomImage(rng, nrows * ncols));
+      expected.push_back(std::vector<float>(nrows * ncols));
+      erosion.compute(images[k].data(), expected[k].data(), 2, true);
+    }
+
+    std::vector<std::vector<float> > eroded(
+      nImages, std::vector<float>(nrows * ncols));
+    std::vector<const float*> data;
+    std::vector<float*> out;
+    for (size_t k = 0; k != nImages; ++k) {
+      data.push_back(images[k].data());
+      out.push_back(eroded[k].data());
+    }
+    erosion.computeBatch(nImages, data.data(), out.data(), 2, true, 2);
+    ASSERT_EQ(expected, eroded);
+  }
+
+  TEST(Rotation45Test, MatchesReference)
+  {
+    Random rng(42);
+    const size_t sizes[][2] = {{8, 8}, {13, 29}, {30, 7}};
+    Rotation45<float> rotation;
+
+    // Each size twice, the second time from the cached index tables
+    for (size_t pass = 0; pass != 2; ++pass)
+      for (const auto& size : sizes) {
+        const size_t nrows = size[0], ncols = size[1];
+        const size_t z = size_t(ceil((nrows + ncols) * cos45)) + 1;
+        std::vector<float> data = randomImage(rng, nrows * ncols);
+
+        std::vector<float> expected(z * z, 0), rotated(z * z, 0);
+        referenceRotate(data.data(), expected.data(), nrows, ncols, z);
+        rotation.rotate(data.data(), rotated.data(), nrows, ncols, z);
+        ASSERT_EQ(expected, rotated);
+
+        std::vector<float> expectedBack(nrows * ncols, 0),
+          unrotated(nrows * ncols, 0);
+        referenceUnrotate(expectedBack.data(), rotated.data(), nrows, ncols,
+                          z);
+        rotation.unrotate(unrotated.data(), rotated.data(), nrows, ncols, z);
+        ASSERT_EQ(expectedBack, unrotated);
+
+        std::vector<float*> batchOut(1, unrotated.data());
+        std::vector<const float*> batchIn(1, rotated.data());
+        std::fill(unrotated.begin(), unrotated.end(), 0);
+        rotation.unrotateBatch(1, batchOut.data(), batchIn.data(), nrows,
+                               ncols, z);
+        ASSERT_EQ(expectedBack, unrotated);
+      }
+  }
+
+  TEST(Rotation45Test, BatchMatchesRotate)
+  {
+    Random rng(42);
+    const size_t nrows = 21, ncols = 17, nImages = 6;
+    const size_t z = size_t(ceil((nrows + ncols) * cos45)) + 1;
+    Rotation45<float> rotation;
+
+    std::vector<std::vector<float> > images, expected;
+    for (size_t k = 0; k != nImages; ++k) {
+      images.push_back(randomImage(rng, nrows * ncols));
+      expected.push_back(std::vector<float>(z * z, 0));
+      rotation.rotate(images[k].data(), expected[k].data(), nrows, ncols, z);
+    }
+
+    std::vector<std::vector<float> > rotated(
+      nImages, std::vector<float>(z * z, 0));
+    std::vector<const float*> data;
+    std::vector<float*> out;
+    for (size_t k = 0; k != nImages; ++k) {
+      data.push_back(images[k].data());
+      out.push_back(rotated[k].data());
+    }
+    rotation.rotateBatch(nImages, data.data(), out.data(), nrows, ncols, z, 4);
+    ASSERT_EQ(expected, rotated);
+  }
+
+} // end namespace
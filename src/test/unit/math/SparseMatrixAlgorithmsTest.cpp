@@ -0,0 +1,203 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Unit tests for the LogSumApprox and LogDiffApprox tables
+ */
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <nupic/math/SparseMatrix.hpp>
+#include <nupic/math/SparseMatrixAlgorithms.hpp>
+#include <nupic/utils/Random.hpp>
+
+using namespace nupic;
+
+namespace {
+
+  // Pairs (a,b) in the fast domain [-14,14)^2, with |a|,|b| >= minFloor and,
+  // for logDiff, b < a
+  std::vector<std::pair<float, float> > randomPairs(bool ordered)
+  {
+    Random rng(42);
+    std::vector<std::pair<float, float> > pairs;
+    while (pairs.size() < 10000)
+    {
+      float a = (float) (28 * rng.getReal64() - 14);
+      float b = (float) (28 * rng.getReal64() - 14);
+      if (fabs(a) < 1e-3 || fabs(b) < 1e-3)
+        continue;
+      if (ordered && !(b < a - 1e-3))
+        continue;
+      pairs.push_back(std::make_pair(a, b));
+    }
+    return pairs;
+  }
+
+  double logSum(double a, double b)
+  {
+    return std::max(a, b) + std::log1p(std::exp(-fabs(a - b)));
+  }
+
+  double logDiff(double a, double b)
+  {
+    return a + std::log1p(-std::exp(b - a));
+  }
+
+  TEST(LogApproxTest, LogSumAccuracy)
+  {
+    LogSumApprox step(500000, -28, 28);
+    LogSumApprox interpolated(4096, -28, 28, false, true);
+
+    double stepError = 0, interpolatedError = 0;
+    for (auto& p : randomPairs(false))
+    {
+      double exact = logSum(p.first, p.second);
+      stepError = std::max(stepError,
+        fabs(step.fast_sum_of_logs(p.first, p.second) - exact));
+      interpolatedError = std::max(interpolatedError,
+        fabs(interpolated.fast_sum_of_logs(p.first, p.second) - exact));
+    }
+
+    // The step is 1.1e-4, and (56/4096)^2/32 = 5.8e-6, plus the float
+    // rounding of the position in the table and of the result
+    ASSERT_LT(stepError, 1.2e-4);
+    ASSERT_LT(interpolatedError, 5.8e-6 + 6e-6);
+  }
+
+  TEST(LogApproxTest, LogDiffAccuracy)
+  {
+    LogDiffApprox interpolated(4096, 1e-10f, 28, false, true);
+
+    double error = 0;
+    for (auto& p : randomPairs(true))
+    {
+      double exact = logDiff(p.first, p.second);
+      error = std::max(error,
+        fabs(interpolated.fast_diff_of_logs(p.first, p.second) - exact));
+    }
+
+    // (28/4096)^2/96 = 4.9e-7, plus float rounding and logf
+    ASSERT_LT(error, 5e-7 + 4e-6);
+  }
+
+  TEST(LogApproxTest, InterpolatedDomainMax)
+  {
+    // a - b = max_a falls on the last knot of the domain
+    LogSumApprox logSumTable(4096, -28, 28, false, true);
+    LogDiffApprox logDiffTable(4096, 1e-10f, 28, false, true);
+    const LogSumApprox::value_type a = 14, b = -14, y[] = {-14};
+    LogSumApprox::value_type z[1];
+
+    ASSERT_NEAR(logSum(a, b), logSumTable.fast_sum_of_logs(a, b), 1e-5);
+    logSumTable.fastLogSum(&a, y, z, 1);
+    ASSERT_NEAR(logSum(a, b), z[0], 1e-5);
+    ASSERT_NEAR(logDiff(a, b), logDiffTable.fast_diff_of_logs(a, b), 1e-5);
+    logDiffTable.fastLogDiff(&a, y, z, 1);
+    ASSERT_NEAR(logDiff(a, b), z[0], 1e-5);
+  }
+
+  TEST(LogApproxTest, TablesPerParameters)
+  {
+    // A coarse table first must not be reused by a finer one
+    LogSumApprox coarse(1000, -28, 28);
+    LogSumApprox fine(1000000, -28, 28);
+    LogSumApprox fine2(1000000, -28, 28);
+
+    float a = 3.3f, b = -2.1f;
+    double exact = logSum(a, b);
+    ASSERT_GT(fabs(coarse.fast_sum_of_logs(a, b) - exact), 1e-3);
+    ASSERT_LT(fabs(fine.fast_sum_of_logs(a, b) - exact), 1e-4);
+
+    size_t nTables = LogApproxTables::size();
+    LogSumApprox fine3(1000000, -28, 28);
+    ASSERT_EQ(nTables, LogApproxTables::size());
+  }
+
+  TEST(LogApproxTest, ConcurrentFirstUse)
+  {
+    const int nThreads = 8;
+    const size_t nTables = LogApproxTables::size();
+    std::vector<float> results(nThreads);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t)
+      threads.emplace_back([&results, t]() {
+          LogSumApprox lsa(123457, -28, 28);
+          LogDiffApprox lda(123457, 1e-10f, 28);
+          results[t] = lsa.fast_sum_of_logs(1.5f, -0.5f)
+            + lda.fast_diff_of_logs(1.5f, -0.5f);
+        });
+    for (auto& thread : threads)
+      thread.join();
+
+    ASSERT_EQ(nTables + 2, LogApproxTables::size());
+    for (int t = 1; t < nThreads; ++t)
+      ASSERT_EQ(results[0], results[t]);
+  }
+
+  TEST(LogApproxTest, VectorAndRowKernels)
+  {
+    LogSumApprox lsa(4096, -28, 28, false, true);
+    LogDiffApprox lda(4096, 1e-10f, 28, false, true);
+
+    std::vector<std::pair<float, float> > pairs = randomPairs(true);
+    const size_t n = 1000;
+    std::vector<float> a(n), b(n), y(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      a[i] = pairs[i].first;
+      b[i] = pairs[i].second;
+    }
+
+    lsa.fastLogSum(a.data(), b.data(), y.data(), n);
+    for (size_t i = 0; i < n; ++i)
+      ASSERT_EQ(lsa.fast_sum_of_logs(a[i], b[i]), y[i]);
+
+    lda.fastLogDiff(a.data(), b.data(), y.data(), n);
+    for (size_t i = 0; i < n; ++i)
+      ASSERT_EQ(lda.fast_diff_of_logs(a[i], b[i]), y[i]);
+
+    // Row n/10 holds a[col] at every 10th column, x holds b
+    SparseMatrix<UInt32, Real32> sm(10, n);
+    for (UInt32 col = 0; col < n; col += 10)
+      sm.set(col % 10, col, a[col]);
+    SparseMatrix<UInt32, Real32> sm2(sm);
+
+    for (UInt32 row = 0; row < 10; ++row)
+    {
+      lsa.fastLogSumRow(sm, row, b.data());
+      lda.fastLogDiffRow(sm2, row, b.data());
+    }
+    for (UInt32 col = 0; col < n; col += 10)
+    {
+      ASSERT_EQ(lsa.fast_sum_of_logs(a[col], b[col]), sm.get(col % 10, col));
+      ASSERT_EQ(lda.fast_diff_of_logs(a[col], b[col]), sm2.get(col % 10, col));
+    }
+  }
+
+} // end namespace
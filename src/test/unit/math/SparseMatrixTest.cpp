@@ -32,6 +32,7 @@
 #include <nupic/math/SparseMatrix.hpp>
 #include <nupic/proto/SparseMatrixProto.capnp.h>
 #include <nupic/types/Types.h>
+#include <nupic/utils/Random.hpp>
 
 
 using namespace nupic;
@@ -100,3 +101,75 @@ TEST(SparseMatrixReadWrite, Basic)
   ASSERT_EQ(m1r1[0].second, 3.0) << "Invalid value in original matrix";
   ASSERT_EQ(m1r1[0].second, m2r1[0].second) << "Invalid value in copied matrix";
 }
+
+// Large enough for the row-parallel kernels to actually split the rows
+static SparseMatrix<UInt, Real> randomThreadsMatrix()
+{
+  Random rng(42);
+  SparseMatrix<UInt, Real> m(2000, 1000);
+  for (UInt row = 0; row < m.nRows(); ++row)
+    for (UInt k = 0; k < 100; ++k)
+      m.set(row, rng.getUInt32(m.nCols()), (Real) rng.getReal64() + 0.01f);
+  return m;
+}
+
+TEST(SparseMatrixThreads, RowKernelsMatchSerial)
+{
+  SparseMatrix<UInt, Real> m = randomThreadsMatrix();
+  std::vector<Real> x(m.nCols());
+  Random rng(43);
+  for (auto& v : x)
+    v = (Real) rng.getReal64();
+
+  for (UInt nThreads : {0, 2, 4, 7})
+  {
+    std::vector<Real> y1(m.nRows()), y2(m.nRows());
+
+    m.rightVecProd(x.begin(), y1.begin());
+    m.rightVecProd(x.begin(), y2.begin(), nThreads);
+    ASSERT_EQ(y1, y2);
+
+    m.rightVecSumAtNZ(x.begin(), y1.begin());
+    m.rightVecSumAtNZ(x.begin(), y2.begin(), nThreads);
+    ASSERT_EQ(y1, y2);
+
+    m.rightVecSumAtNZGtThreshold(x.begin(), y1.begin(), 0.5);
+    m.rightVecSumAtNZGtThreshold(x.begin(), y2.begin(), 0.5, nThreads);
+    ASSERT_EQ(y1, y2);
+
+    std::vector<UInt> i1(m.nRows()), i2(m.nRows());
+    m.rowMax(i1.begin(), y1.begin());
+    m.rowMax(i2.begin(), y2.begin(), nThreads);
+    ASSERT_EQ(i1, i2);
+    ASSERT_EQ(y1, y2);
+  }
+}
+
+TEST(SparseMatrixThreads, RowUpdatesMatchSerial)
+{
+  for (UInt nThreads : {0, 2, 4, 7})
+  {
+    SparseMatrix<UInt, Real> m1 = randomThreadsMatrix(), m2 = m1;
+
+    m1.threshold(0.3);
+    m2.threshold(0.3, nThreads);
+    ASSERT_EQ(m1.nNonZeros(), m2.nNonZeros());
+
+    m1.normalizeRows(2.0, true);
+    m2.normalizeRows(2.0, true, nThreads);
+
+    std::vector<UInt> i1, i2;
+    std::vector<Real> v1, v2;
+    for (UInt row = 0; row < m1.nRows(); ++row)
+    {
+      i1.resize(m1.nNonZerosOnRow(row));
+      v1.resize(i1.size());
+      i2.resize(m2.nNonZerosOnRow(row));
+      v2.resize(i2.size());
+      m1.getRowToSparse(row, i1.begin(), v1.begin());
+      m2.getRowToSparse(row, i2.begin(), v2.begin());
+      ASSERT_EQ(i1, i2);
+      ASSERT_EQ(v1, v2);
+    }
+  }
+}
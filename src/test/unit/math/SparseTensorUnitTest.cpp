@@ -23,6 +23,232 @@
 /** @file
  * Implementation of unit testing for class SparseTensor
  */      
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <nupic/math/Index.hpp>
+#include <nupic/math/SparseTensor.hpp>
+#include <nupic/utils/Random.hpp>
+
+using namespace nupic;
+
+namespace {
+
+  typedef Index<UInt32, 1> I1;
+  typedef Index<UInt32, 2> I2;
+  typedef Index<UInt32, 3> I3;
+
+  // Random dense array of the given size, with about half its values zero
+  std::vector<Real> randomDense(UInt n, UInt32 seed)
+  {
+    Random rng(seed);
+    std::vector<Real> x(n, 0);
+    for (auto& v : x)
+      if (rng.getUInt32(2))
+        v = (Real) (rng.getUInt32(9) + 1);
+    return x;
+  }
+
+  template <typename I, template <typename, typename> class S>
+  std::vector<Real> dense(const SparseTensor<I, Real, S>& t)
+  {
+    std::vector<Real> x(product(t.getBounds()));
+    t.toDense(x.data());
+    return x;
+  }
+
+  template <typename I, template <typename, typename> class S>
+  SparseTensor<I, Real, S> fromDense(const I& bounds,
+                                     const std::vector<Real>& x)
+  {
+    SparseTensor<I, Real, S> t(bounds);
+    t.fromDense(x.begin());
+    return t;
+  }
+
+  // Runs the operations of SparseTensor with storage S and with the
+  // default std::map storage, and checks that the results agree.
+  template <template <typename, typename> class S>
+  void checkAgainstMap()
+  {
+    typedef SparseTensor<I3, Real, S> ST3;
+    typedef SparseTensor<I2, Real, S> ST2;
+    typedef SparseTensor<I1, Real, S> ST1;
+    typedef SparseTensor<I3, Real> MT3;
+    typedef SparseTensor<I2, Real> MT2;
+    typedef SparseTensor<I1, Real> MT1;
+
+    const I3 b3(4, 5, 6);
+    const I2 b2(4, 6);
+    const std::vector<Real> x = randomDense(120, 42), y = randomDense(120, 43);
+    const std::vector<Real> z = randomDense(24, 44);
+
+    ST3 a = fromDense<I3, S>(b3, x), b = fromDense<I3, S>(b3, y);
+    MT3 ma = fromDense<I3, SparseTensorMapStorage>(b3, x);
+    MT3 mb = fromDense<I3, SparseTensorMapStorage>(b3, y);
+    ASSERT_EQ(x, dense(a));
+    ASSERT_EQ(ma.getNNonZeros(), a.getNNonZeros());
+
+    // set, get and update
+    a.set(I3(1, 2, 3), 7);
+    ma.set(I3(1, 2, 3), 7);
+    a.set(I3(3, 4, 5), 0);
+    ma.set(I3(3, 4, 5), 0);
+    a.update(I3(0, 0, 0), 2, std::plus<Real>());
+    ma.update(I3(0, 0, 0), 2, std::plus<Real>());
+    ASSERT_EQ(dense(ma), dense(a));
+    ASSERT_EQ(7, a.get(I3(1, 2, 3)));
+    ASSERT_EQ(0, a.get(I3(3, 4, 5)));
+
+    // Bulk update, with repeated and cancelling indices
+    std::vector<std::pair<I3, Real> > iv;
+    iv.push_back(std::make_pair(I3(2, 2, 2), 1));
+    iv.push_back(std::make_pair(I3(0, 1, 0), 3));
+    iv.push_back(std::make_pair(I3(2, 2, 2), 4));
+    iv.push_back(std::make_pair(I3(1, 2, 3), -7));
+    a.updateFromIdxVal(iv.size(), iv.begin(), std::plus<Real>());
+    ma.updateFromIdxVal(iv.size(), iv.begin(), std::plus<Real>());
+    ASSERT_EQ(dense(ma), dense(a));
+    ASSERT_EQ(ma.getNNonZeros(), a.getNNonZeros());
+
+    // Comparison
+    ST3 a2(a);
+    ASSERT_TRUE(a == a2);
+    a2.set(I3(3, 3, 3), a2.get(I3(3, 3, 3)) + 1);
+    ASSERT_TRUE(a != a2);
+
+    // Binary element-wise operations
+    ST3 c(b3);
+    MT3 mc(b3);
+    a.axby(2, b, 3, c);
+    ma.axby(2, mb, 3, mc);
+    ASSERT_EQ(dense(mc), dense(c));
+    a.element_apply_nz(b, c, std::plus<Real>());
+    ma.element_apply_nz(mb, mc, std::plus<Real>());
+    ASSERT_EQ(dense(mc), dense(c));
+    a.element_apply_fast(b, c, std::multiplies<Real>());
+    ma.element_apply_fast(mb, mc, std::multiplies<Real>());
+    ASSERT_EQ(dense(mc), dense(c));
+    a.add(b);
+    ma.add(mb);
+    ASSERT_EQ(dense(ma), dense(a));
+    a.element_apply_nz(b, a, std::minus<Real>());
+    ma.element_apply_nz(mb, ma, std::minus<Real>());
+    ASSERT_EQ(dense(ma), dense(a));
+
+    std::vector<I3> nzA, nzB;
+    a.nz_intersection(b, nzA);
+    ma.nz_intersection(mb, nzB);
+    ASSERT_EQ(nzB.size(), nzA.size());
+    a.nz_union(b, nzA);
+    ma.nz_union(mb, nzB);
+    ASSERT_EQ(nzB.size(), nzA.size());
+
+    // Marginalization, factor products and normalization
+    ST2 m(b2);
+    MT2 mm(b2);
+    a.marginalize(I1((UInt32) 1), m);
+    ma.marginalize(I1((UInt32) 1), mm);
+    ASSERT_EQ(dense(mm), dense(m));
+
+    ST2 f = fromDense<I2, S>(b2, z);
+    MT2 mf = fromDense<I2, SparseTensorMapStorage>(b2, z);
+    a.factor_apply_fast(I2(0, 2), f, c, std::multiplies<Real>());
+    ma.factor_apply_fast(I2(0, 2), mf, mc, std::multiplies<Real>());
+    ASSERT_EQ(dense(mc), dense(c));
+    a.factor_apply_nz(I2(0, 2), f, std::multiplies<Real>());
+    ma.factor_apply_nz(I2(0, 2), mf, std::multiplies<Real>());
+    ASSERT_EQ(dense(ma), dense(a));
+
+    ST1 v(I1((UInt32) 6));
+    MT1 mv(I1((UInt32) 6));
+    v.set(I1((UInt32) 2), 3);
+    mv.set(I1((UInt32) 2), 3);
+    v.set(I1((UInt32) 5), 4);
+    mv.set(I1((UInt32) 5), 4);
+    SparseTensor<Index<UInt32, 4>, Real, S> o(Index<UInt32, 4>(4, 5, 6, 6));
+    SparseTensor<Index<UInt32, 4>, Real> mo(Index<UInt32, 4>(4, 5, 6, 6));
+    a.outer_product_nz(v, o, std::multiplies<Real>());
+    ma.outer_product_nz(mv, mo, std::multiplies<Real>());
+    ASSERT_EQ(dense(mo), dense(o));
+
+    // Slices
+    Domain<UInt> range(I3(1, 0, 2), I3(1, 5, 6));
+    ST2 slice(I2(5, 4));
+    MT2 mslice(I2(5, 4));
+    a.getSlice(range, slice);
+    ma.getSlice(range, mslice);
+    ASSERT_EQ(dense(mslice), dense(slice));
+    slice.multiply(2);
+    mslice.multiply(2);
+    a.setSlice(range, slice);
+    ma.setSlice(range, mslice);
+    ASSERT_EQ(dense(ma), dense(a));
+
+    // Unary operations, zeroing, reduction, permutation and resizing
+    auto threshold = [](Real v) { return v < 5 ? 0 : v - 4; };
+    a.element_apply_fast(threshold);
+    ma.element_apply_fast(threshold);
+    ASSERT_EQ(dense(ma), dense(a));
+    ASSERT_EQ(ma.getNNonZeros(), a.getNNonZeros());
+
+    Domain<UInt> zero(I3(0, 1, 1), I3(2, 3, 4));
+    a.setZero(zero);
+    ma.setZero(zero);
+    ASSERT_EQ(dense(ma), dense(a));
+
+    std::set<UInt> keep;
+    keep.insert(1);
+    keep.insert(3);
+    a.reduce(2, keep);
+    ma.reduce(2, keep);
+    ASSERT_EQ(dense(ma), dense(a));
+
+    a.permute(I3(2, 0, 1));
+    ma.permute(I3(2, 0, 1));
+    ASSERT_EQ(dense(ma), dense(a));
+
+    a.resize(I3(2, 3, 4));
+    ma.resize(I3(2, 3, 4));
+    ASSERT_EQ(dense(ma), dense(a));
+    ASSERT_EQ(ma.getNNonZeros(), a.getNNonZeros());
+  }
+}
+
+TEST(SparseTensorTest, MapStorage)
+{
+  checkAgainstMap<SparseTensorMapStorage>();
+}
+
+TEST(SparseTensorTest, SortedStorage)
+{
+  checkAgainstMap<SparseTensorSortedStorage>();
+}
+
+TEST(SparseTensorTest, HashStorage)
+{
+  checkAgainstMap<SparseTensorHashStorage>();
+}
+
+TEST(SparseTensorTest, HashStorageErase)
+{
+  // Many inserts and erases, so that tombstones pile up and get rehashed
+  SparseTensor<I2, Real, SparseTensorHashStorage> t(I2(64, 64));
+  SparseTensor<I2, Real> m(I2(64, 64));
+  Random rng(42);
+  for (UInt n = 0; n < 20000; ++n) {
+    I2 idx(rng.getUInt32(64), rng.getUInt32(64));
+    Real val = rng.getUInt32(3) ? 0 : (Real) (rng.getUInt32(9) + 1);
+    t.set(idx, val);
+    m.set(idx, val);
+  }
+  ASSERT_EQ(m.getNNonZeros(), t.getNNonZeros());
+  ASSERT_EQ(dense(m), dense(t));
+}
               
 // #include "SparseTensorUnitTest.hpp"
 //
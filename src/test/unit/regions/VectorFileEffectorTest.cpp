@@ -0,0 +1,199 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+
+/** @file
+ * Implementation of VectorFileEffector test
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <nupic/engine/Network.hpp>
+#include <nupic/engine/Region.hpp>
+#include <nupic/ntypes/Dimensions.hpp>
+#include <nupic/os/FStream.hpp>
+#include <nupic/os/Path.hpp>
+#include <nupic/regions/VectorFileEffector.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace nupic;
+
+namespace
+{
+  const UInt32 numElements = 7;
+
+  // Vectors of numElements, with some zeros
+  std::vector<std::vector<Real32> > sampleVectors()
+  {
+    std::vector<std::vector<Real32> > vectors;
+    for (UInt32 i = 0; i < 5; i++)
+    {
+      std::vector<Real32> v(numElements);
+      for (UInt32 j = 0; j < numElements; j++)
+        v[j] = (i + j) % 3 == 0 ? 0 : (Real32) (i * 10 + j) / 4;
+      vectors.push_back(v);
+    }
+    return vectors;
+  }
+
+  // Runs a VectorFileSensor reading vectors into an effector per format
+  void writeVectors(const std::vector<std::vector<Real32> >& vectors,
+                    const std::vector<std::string>& formats)
+  {
+    const std::string inputFile = "VectorFileEffectorTest.in";
+    {
+      OFStream in(inputFile.c_str());
+      for (const auto& v : vectors)
+      {
+        for (Real32 x : v)
+          in << x << " ";
+        in << "\n";
+      }
+    }
+
+    Network net;
+    Region* sensor = net.addRegion("sensor", "VectorFileSensor",
+                                   "{activeOutputCount: 7}");
+    Dimensions dims;
+    dims.push_back(1);
+    sensor->setDimensions(dims);
+    sensor->executeCommand({"loadFile", inputFile, "2"});
+
+    for (const std::string& format : formats)
+    {
+      const std::string name = "effector_" + format;
+      const std::string file = "VectorFileEffectorTest." + format;
+      if (Path::exists(file))
+        Path::remove(file);
+      Region* effector = net.addRegion(name, "VectorFileEffector",
+                                       "{outputFormat: " + format + "}");
+      net.link("sensor", name, "UniformLink", "");
+      effector->setParameterString("outputFile", file);
+    }
+
+    net.initialize();
+    net.run(vectors.size());
+
+    for (const std::string& format : formats)
+      net.getRegions().getByName("effector_" + format)->
+        executeCommand({"closeFile"});
+    Path::remove(inputFile);
+  }
+
+  // Reads a binary or sparse vector file, checking its header
+  std::vector<std::vector<Real32> > readVectors(const std::string& file,
+                                               UInt32 recordFormat)
+  {
+    std::vector<std::vector<Real32> > vectors;
+    IFStream in(file.c_str(), std::ios::in | std::ios::binary);
+    char magic[8];
+    UInt32 version = 0, format = 0;
+    in.read(magic, sizeof(magic));
+    in.read((char*) &version, sizeof(version));
+    in.read((char*) &format, sizeof(format));
+    EXPECT_EQ(0, ::memcmp(magic, VectorFileEffector::binaryMagic, 8));
+    EXPECT_EQ(VectorFileEffector::binaryVersion, version);
+    EXPECT_EQ(recordFormat, format);
+
+    UInt32 count;
+    while (in.read((char*) &count, sizeof(count)))
+    {
+      std::vector<Real32> v(count, 0);
+      if (recordFormat == 1)
+      {
+        in.read((char*) v.data(), count * sizeof(Real32));
+      }
+      else
+      {
+        UInt32 nonZeros = 0;
+        in.read((char*) &nonZeros, sizeof(nonZeros));
+        std::vector<UInt32> indices(nonZeros);
+        in.read((char*) indices.data(), nonZeros * sizeof(UInt32));
+        for (UInt32 i : indices)
+          v[i] = 1;
+      }
+      EXPECT_TRUE(in.good());
+      vectors.push_back(v);
+    }
+    return vectors;
+  }
+}
+
+TEST(VectorFileEffectorTest, OutputFormats)
+{
+  const auto vectors = sampleVectors();
+  writeVectors(vectors, {"text", "binary", "sparse"});
+
+  // Text output is a line of numbers per vector
+  {
+    IFStream text("VectorFileEffectorTest.text");
+    for (const auto& v : vectors)
+    {
+      for (Real32 x : v)
+      {
+        Real32 y;
+        text >> y;
+        EXPECT_FLOAT_EQ(x, y);
+      }
+    }
+  }
+
+  EXPECT_EQ(vectors, readVectors("VectorFileEffectorTest.binary", 1));
+
+  std::vector<std::vector<Real32> > sparse = vectors;
+  for (auto& v : sparse)
+    for (Real32& x : v)
+      x = x != 0;
+  EXPECT_EQ(sparse, readVectors("VectorFileEffectorTest.sparse", 2));
+
+  Path::remove("VectorFileEffectorTest.text");
+  Path::remove("VectorFileEffectorTest.binary");
+  Path::remove("VectorFileEffectorTest.sparse");
+}
+
+TEST(VectorFileEffectorTest, AppendBinary)
+{
+  const auto vectors = sampleVectors();
+  writeVectors(vectors, {"binary"});
+
+  // Reopening appends records, after the header
+  Network net;
+  Region* effector = net.addRegion("effector", "VectorFileEffector",
+                                   "{outputFormat: binary}");
+  effector->setParameterString("outputFile", "VectorFileEffectorTest.binary");
+  effector->executeCommand({"closeFile"});
+  EXPECT_EQ(vectors, readVectors("VectorFileEffectorTest.binary", 1));
+
+  // A file of another format cannot be appended to
+  effector->setParameterString("outputFormat", "sparse");
+  EXPECT_EQ("sparse", effector->getParameterString("outputFormat"));
+  EXPECT_THROW(effector->setParameterString(
+                 "outputFile", "VectorFileEffectorTest.binary"),
+               std::exception);
+  EXPECT_THROW(effector->setParameterString("outputFormat", "csv"),
+               std::exception);
+
+  Path::remove("VectorFileEffectorTest.binary");
+}
@@ -0,0 +1,89 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Implementation of unit tests for parallelFor and parallelForShards
+ */
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "nupic/utils/ParallelFor.hpp"
+
+using namespace nupic;
+
+
+TEST(ParallelForTest, Threads)
+{
+  ASSERT_EQ(3, parallelThreads(10, 3));
+  ASSERT_EQ(2, parallelThreads(2, 8));
+  ASSERT_EQ(1, parallelThreads(0, 8));
+  ASSERT_LE(1, parallelThreads(10, 0));
+
+  // At least 100 units of work per thread
+  ASSERT_EQ(4, parallelThreads(10, 8, 450, 100));
+  ASSERT_EQ(1, parallelThreads(10, 8, 50, 100));
+}
+
+TEST(ParallelForTest, ShardsCoverRange)
+{
+  const size_t n = 1001;
+  std::vector<int> counts(n, 0);
+
+  parallelForShards(n, 4, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      ++counts[i];
+  });
+
+  for (size_t i = 0; i < n; ++i)
+    ASSERT_EQ(1, counts[i]) << i;
+}
+
+TEST(ParallelForTest, WorkerExceptionRethrown)
+{
+  std::atomic<int> calls(0);
+
+  // The workers that do not throw still run and are joined
+  ASSERT_THROW(parallelFor(4, [&](size_t t) {
+    ++calls;
+    if (t == 2)
+      throw std::runtime_error("worker");
+  }), std::runtime_error);
+  ASSERT_EQ(4, calls);
+
+  // The exception of the lowest thread wins
+  try {
+    parallelForShards(100, 4, [](size_t begin, size_t end) {
+      if (begin != 0)
+        throw std::out_of_range("shard");
+      throw std::logic_error("first shard");
+    });
+    FAIL() << "Should have thrown";
+  } catch (const std::out_of_range&) {
+    FAIL() << "Should have rethrown the first shard's exception";
+  } catch (const std::logic_error& e) {
+    ASSERT_STREQ("first shard", e.what());
+  }
+}
@@ -0,0 +1,291 @@
+/* ---------------------------------------------------------------------
+ * Numenta Platform for Intelligent Computing (NuPIC)
+ * Copyright (C) 2016, Numenta, Inc.  Unless you have an agreement
+ * with Numenta, Inc., for a separate license for this software code, the
+ * following terms and conditions apply:
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Affero Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses.
+ *
+ * http://numenta.org/licenses/
+ * ---------------------------------------------------------------------
+ */
+
+/** @file
+ * Implementation of Tracer test
+ */
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <nupic/engine/Network.hpp>
+#include <nupic/engine/Region.hpp>
+#include <nupic/ntypes/Dimensions.hpp>
+#include <nupic/utils/Tracer.hpp>
+
+using namespace nupic;
+
+namespace
+{
+  // Restores the global tracer state after each test
+  class TracerTest : public ::testing::Test
+  {
+  protected:
+    virtual void SetUp()
+    {
+      Tracer::getInstance().reset();
+    }
+
+    virtual void TearDown()
+    {
+      Tracer::getInstance().disable();
+      Tracer::getInstance().reset();
+    }
+  };
+
+  std::vector<std::string> lines(const std::string& s)
+  {
+    std::vector<std::string> result;
+    std::istringstream in(s);
+    std::string line;
+    while (std::getline(in, line))
+      result.push_back(line);
+    return result;
+  }
+}
+
+TEST(LatencyHistogramTest, Empty)
+{
+  LatencyHistogram h;
+  ASSERT_EQ(0u, h.getCount());
+  ASSERT_EQ(0u, h.getMin());
+  ASSERT_EQ(0u, h.getMax());
+  ASSERT_EQ(0u, h.getPercentile(50));
+  ASSERT_ANY_THROW(h.getPercentile(101));
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact)
+{
+  LatencyHistogram h;
+  for (UInt64 i = 1; i <= 10; i++)
+    h.add(i);
+
+  ASSERT_EQ(10u, h.getCount());
+  ASSERT_EQ(55u, h.getTotal());
+  ASSERT_EQ(1u, h.getMin());
+  ASSERT_EQ(10u, h.getMax());
+  ASSERT_EQ(5u, h.getPercentile(50));
+  ASSERT_EQ(9u, h.getPercentile(90));
+  ASSERT_EQ(10u, h.getPercentile(100));
+  ASSERT_EQ(1u, h.getPercentile(0));
+}
+
+TEST(LatencyHistogramTest, RelativeError)
+{
+  LatencyHistogram h;
+  for (UInt64 i = 1; i <= 100000; i++)
+    h.add(i * 1000);
+
+  UInt64 p50 = h.getPercentile(50);
+  UInt64 p99 = h.getPercentile(99);
+  ASSERT_GE(p50, 50000000u);
+  ASSERT_LE(p50, 50000000u + 50000000u / 16);
+  ASSERT_GE(p99, 99000000u);
+  ASSERT_LE(p99, h.getMax());
+
+  h.reset();
+  ASSERT_EQ(0u, h.getCount());
+  h.add(std::numeric_limits<UInt64>::max());
+  ASSERT_EQ(std::numeric_limits<UInt64>::max(), h.getPercentile(50));
+}
+
+TEST_F(TracerTest, SpansOnlyRecordWhileEnabled)
+{
+  Tracer& tracer = Tracer::getInstance();
+  {
+    TraceSpan span("test");
+    ASSERT_FALSE(span.isActive());
+  }
+  ASSERT_TRUE(tracer.getEvents().empty());
+
+  tracer.enable();
+  {
+    TraceSpan span("test");
+    ASSERT_TRUE(span.isActive());
+    span.setName("work");
+    span.setIteration(7);
+    span.addBytes(10);
+    span.addBytes(6);
+  }
+  tracer.disable();
+
+  std::vector<TraceEvent> events = tracer.getEvents();
+  ASSERT_EQ(1u, events.size());
+  ASSERT_EQ("test", events[0].category);
+  ASSERT_EQ("work", events[0].name);
+  ASSERT_EQ(0u, events[0].thread);
+  ASSERT_EQ(7, events[0].iteration);
+  ASSERT_EQ(16u, events[0].bytes);
+  ASSERT_EQ(1u, tracer.getHistogram("test", "work").getCount());
+  ASSERT_EQ(0u, tracer.getHistogram("test", "other").getCount());
+}
+
+TEST_F(TracerTest, RingBuffer)
+{
+  Tracer& tracer = Tracer::getInstance();
+  tracer.enable(3);
+  for (UInt64 i = 0; i < 5; i++)
+    tracer.record("test", "span", i, 1, i);
+
+  std::vector<TraceEvent> events = tracer.getEvents();
+  ASSERT_EQ(3u, events.size());
+  ASSERT_EQ(2, events[0].iteration);
+  ASSERT_EQ(4, events[2].iteration);
+  ASSERT_EQ(2u, tracer.getDroppedEventCount());
+
+  // Histograms see every event
+  ASSERT_EQ(5u, tracer.getHistogram("test", "span").getCount());
+
+  // Shrinking keeps the newest events
+  tracer.enable(2);
+  events = tracer.getEvents();
+  ASSERT_EQ(2u, events.size());
+  ASSERT_EQ(3, events[0].iteration);
+  ASSERT_EQ(3u, tracer.getDroppedEventCount());
+
+  tracer.enable(1000000);
+}
+
+TEST_F(TracerTest, ChromeTrace)
+{
+  Tracer& tracer = Tracer::getInstance();
+  tracer.enable();
+  tracer.record("link", "a.out -> \"b\".in", 1500, 2001, 3, 64);
+  tracer.record("compute", "b", 4000, 10);
+  tracer.disable();
+
+  std::stringstream ss;
+  tracer.writeChromeTrace(ss);
+  std::string expected =
+    "{\"traceEvents\":[\n"
+    "{\"name\":\"a.out -> \\\"b\\\".in\",\"cat\":\"link\",\"ph\":\"X\","
+    "\"pid\":0,\"tid\":0,\"ts\":1.500,\"dur\":2.001,"
+    "\"args\":{\"iteration\":3,\"bytes\":64}},\n"
+    "{\"name\":\"b\",\"cat\":\"compute\",\"ph\":\"X\","
+    "\"pid\":0,\"tid\":0,\"ts\":4.000,\"dur\":0.010,\"args\":{}}\n"
+    "],\"displayTimeUnit\":\"ms\"}\n";
+  ASSERT_EQ(expected, ss.str());
+}
+
+TEST_F(TracerTest, CSV)
+{
+  Tracer& tracer = Tracer::getInstance();
+  tracer.enable();
+  tracer.record("link", "a,b", 1500, 2000, 3, 64);
+  tracer.record("link", "a,b", 5000, 4000, 4, 64);
+  tracer.disable();
+
+  std::stringstream events;
+  tracer.writeCSV(events);
+  std::vector<std::string> eventLines = lines(events.str());
+  ASSERT_EQ(3u, eventLines.size());
+  ASSERT_EQ("category,name,thread,start_us,duration_us,iteration,bytes",
+            eventLines[0]);
+  ASSERT_EQ("link,\"a,b\",0,1.500,2.000,3,64", eventLines[1]);
+  ASSERT_EQ("link,\"a,b\",0,5.000,4.000,4,64", eventLines[2]);
+
+  std::stringstream summary;
+  tracer.writeSummaryCSV(summary);
+  std::vector<std::string> summaryLines = lines(summary.str());
+  ASSERT_EQ(2u, summaryLines.size());
+  ASSERT_EQ("category,name,count,total_us,min_us,p50_us,p99_us,max_us",
+            summaryLines[0]);
+  ASSERT_EQ("link,\"a,b\",2,6.000,2.000,2.047,4.000,4.000", summaryLines[1]);
+}
+
+TEST_F(TracerTest, ThreadBuffers)
+{
+  Tracer& tracer = Tracer::getInstance();
+  tracer.enable(2);
+  tracer.record("test", "span", 10, 1);
+  std::thread other([&tracer]()
+  {
+    for (UInt64 i = 0; i < 3; i++)
+      tracer.record("test", "span", 5 + 10 * i, 2);
+  });
+  other.join();
+  tracer.record("test", "span", 30, 1);
+
+  // Each thread keeps its own newest events; all are merged by start
+  std::vector<TraceEvent> events = tracer.getEvents();
+  ASSERT_EQ(4u, events.size());
+  ASSERT_EQ(10u, events[0].start);
+  ASSERT_EQ(0u, events[0].thread);
+  ASSERT_EQ(15u, events[1].start);
+  ASSERT_EQ(1u, events[1].thread);
+  ASSERT_EQ(25u, events[2].start);
+  ASSERT_EQ(30u, events[3].start);
+  ASSERT_EQ(0u, events[3].thread);
+  ASSERT_EQ(1u, tracer.getDroppedEventCount());
+
+  LatencyHistogram h = tracer.getHistogram("test", "span");
+  ASSERT_EQ(5u, h.getCount());
+  ASSERT_EQ(8u, h.getTotal());
+  ASSERT_EQ(1u, h.getMin());
+  ASSERT_EQ(2u, h.getMax());
+
+  tracer.enable(1000000);
+}
+
+#ifdef NTA_TRACING
+TEST_F(TracerTest, NetworkSpans)
+{
+  Network net;
+  Region* l1 = net.addRegion("level1", "TestNode", "");
+  Dimensions d;
+  d.push_back(4);
+  d.push_back(4);
+  l1->setDimensions(d);
+  net.addRegion("level2", "TestNode", "");
+  net.link("level1", "level2", "TestFanIn2", "");
+  net.initialize();
+
+  Tracer& tracer = Tracer::getInstance();
+  tracer.enable();
+  net.run(3);
+  tracer.disable();
+
+  ASSERT_EQ(3u, tracer.getHistogram("network", "iteration").getCount());
+  ASSERT_EQ(3u, tracer.getHistogram("compute", "level1").getCount());
+  ASSERT_EQ(3u, tracer.getHistogram("compute", "level2").getCount());
+  ASSERT_EQ(3u, tracer.getHistogram("prepare", "level2.bottomUpIn").getCount());
+
+  std::string link = "level1.bottomUpOut -> level2.bottomUpIn";
+  ASSERT_EQ(3u, tracer.getHistogram("link", link).getCount());
+
+  bool sawLink = false;
+  for (const TraceEvent& e : tracer.getEvents())
+  {
+    if (e.name == link)
+    {
+      sawLink = true;
+      ASSERT_GT(e.bytes, 0u);
+    }
+  }
+  ASSERT_TRUE(sawLink);
+}
+#endif
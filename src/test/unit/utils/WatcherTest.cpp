@@ -37,6 +37,7 @@
 
 #include <nupic/ntypes/ArrayBase.hpp>
 
+#include <nupic/utils/LogItem.hpp>
 #include <nupic/utils/Watcher.hpp>
 
 #include <gtest/gtest.h>
@@ -278,3 +279,152 @@ TEST(WatcherTest, FileTest2)
         
   Path::remove("testfile2");
 }
+
+TEST(WatcherTest, BinaryMatchesText)
+{
+  Network n;
+  n.addRegion("level1", "TestNode", "");
+  n.addRegion("level2", "TestNode", "");
+  Dimensions d;
+  d.push_back(8);
+  d.push_back(4);
+  n.getRegions().getByName("level1")->setDimensions(d);
+  n.link("level1", "level2", "TestFanIn2", "");
+  n.initialize();
+
+  {
+    Watcher text("testfile3");
+    Watcher binary("testfile4", binaryFormat, 2);
+    for (Watcher* w : {&text, &binary})
+    {
+      w->watchParam("level1", "uint64Param");
+      w->watchParam("level1", "real32Param");
+      w->watchParam("level1", "stringParam");
+      w->watchParam("level1", "unclonedParam", 0);
+      w->watchParam("level1", "int64ArrayParam");
+      w->watchParam("level1", "real32ArrayParam", -1, false);
+      w->watchOutput("level1", "bottomUpOut");
+      w->watchOutput("level1", "bottomUpOut", false);
+      w->attachToNetwork(n);
+    }
+    n.run(5);
+    text.detachFromNetwork(n);
+    binary.detachFromNetwork(n);
+  }
+
+  IFStream textIn("testfile3");
+  std::stringstream expected;
+  expected << textIn.rdbuf();
+  textIn.close();
+
+  std::stringstream converted;
+  {
+    WatchLogReader reader("testfile4");
+    reader.toText(converted);
+    ASSERT_EQ(8u, reader.getWatches().size());
+    ASSERT_EQ("real32ArrayParam", reader.getWatches()[5].varName);
+  }
+  ASSERT_EQ(expected.str(), converted.str());
+
+  WatchLogReader reader("testfile4");
+  std::vector<WatchValue> values;
+  for (UInt64 iteration = 1; iteration <= 5; iteration++)
+  {
+    ASSERT_TRUE(reader.next(values));
+    ASSERT_EQ(8u, values.size());
+    ASSERT_EQ(iteration, values[0].iteration);
+    ASSERT_EQ(WatchValue::scalarValue, values[0].kind);
+    ASSERT_EQ(WatchValue::stringValue, values[2].kind);
+    ASSERT_EQ(WatchValue::noValue, values[3].kind);
+    ASSERT_EQ(WatchValue::sparseValue, values[4].kind);
+    ASSERT_EQ(WatchValue::denseValue, values[5].kind);
+    ASSERT_EQ(WatchValue::sparseValue, values[6].kind);
+    ASSERT_EQ(64u, values[6].count);
+    ASSERT_EQ(WatchValue::denseValue, values[7].kind);
+    ASSERT_EQ(64u * sizeof(Real64), values[7].bytes.size());
+  }
+  ASSERT_FALSE(reader.next(values));
+  ASSERT_EQ(8u, reader.getWatches().size());
+
+  // a text log is not a binary log
+  ASSERT_ANY_THROW(WatchLogReader("testfile3"));
+
+  Path::remove("testfile3");
+  Path::remove("testfile4");
+}
+
+TEST(WatcherTest, ArrayParamChangesSize)
+{
+  Network n;
+  Region* r = n.addRegion("level1", "TestNode", "");
+  Dimensions d;
+  d.push_back(2);
+  r->setDimensions(d);
+  n.initialize();
+
+  {
+    Watcher w("testfile5", binaryFormat);
+    w.watchParam("level1", "int64ArrayParam", -1, false);
+    w.attachToNetwork(n);
+
+    n.run(1);
+    r->executeCommand({"resizeInt64ArrayParam", "6"});
+    n.run(1);
+    r->executeCommand({"resizeInt64ArrayParam", "2"});
+    n.run(1);
+
+    // Closing the file while the callback is attached stops the output
+    w.closeFile();
+    n.run(1);
+    w.detachFromNetwork(n);
+  }
+
+  WatchLogReader reader("testfile5");
+  std::vector<WatchValue> values;
+  for (size_t count : {4, 6, 2})
+  {
+    ASSERT_TRUE(reader.next(values));
+    ASSERT_EQ(1u, values.size());
+    ASSERT_EQ(count, values[0].count);
+    ASSERT_EQ(count * sizeof(Int64), values[0].bytes.size());
+    const Int64* elements = (const Int64*) values[0].bytes.data();
+    ASSERT_EQ(Int64(count - 1) * 64, elements[count - 1]);
+  }
+  ASSERT_FALSE(reader.next(values));
+
+  Path::remove("testfile5");
+}
+
+TEST(WatcherTest, CloseThenDestroy)
+{
+  Network n;
+  Region* r = n.addRegion("level1", "TestNode", "");
+  Dimensions d;
+  d.push_back(2);
+  r->setDimensions(d);
+  n.initialize();
+
+  std::stringstream log;
+  LogItem::setOutputFile(log);
+  {
+    Watcher w("testfile6", binaryFormat);
+    w.watchOutput("level1", "bottomUpOut");
+    w.attachToNetwork(n);
+    n.run(2);
+    w.detachFromNetwork(n);
+
+    // The destructor flushes and closes again, which must be harmless
+    w.closeFile();
+    w.flushFile();
+  }
+  LogItem::setOutputFile(std::cerr);
+  ASSERT_EQ("", log.str());
+
+  WatchLogReader reader("testfile6");
+  std::vector<WatchValue> values;
+  ASSERT_TRUE(reader.next(values));
+  ASSERT_TRUE(reader.next(values));
+  ASSERT_FALSE(reader.next(values));
+
+  Path::remove("testfile6");
+}